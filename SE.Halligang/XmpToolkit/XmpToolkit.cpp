@@ -2,6 +2,7 @@
 //
 
 #include <string>
+#include <vector>
 #include <windows.h>
 using namespace std;
 
@@ -159,6 +160,91 @@ extern "C"
 	{
 		return SXMPFiles::GetFormatInfo(format, handlerFlags);
 	}
+
+	DllExport void XMPFiles_GetXMPBatch(XMP_Int32 fileCount, const XMP_StringPtr* filePaths, XMP_FileFormat format, XMP_OptionBits openFlags, XMP_Int32 maxThreads, XMP_BatchFileInfo* fileInfo, SXMPMeta** xmpObjs, bool getXmpPackets, XMP_StringPtr* xmpPackets, XMP_Uns32* xmpPacketLengths)
+	{
+		if (fileCount <= 0)
+		{
+			return;
+		}
+
+		// A NULL entry in xmpObjs reads that file as if xmpObjs were NULL, its packet is not parsed or
+		// reconciled. SXMPFiles wants the XMP objects in one array, so the files with and without an
+		// object are read as separate batches.
+		std::vector<XMP_Int32> objFiles, rawFiles;
+		for (XMP_Int32 i = 0; i < fileCount; i++)
+		{
+			((xmpObjs != NULL) && (xmpObjs[i] != NULL) ? objFiles : rawFiles).push_back(i);
+		}
+
+		std::vector<std::string> tmpXmpPackets;
+		if (getXmpPackets)
+		{
+			tmpXmpPackets.resize(fileCount);
+		}
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			const std::vector<XMP_Int32>& batchFiles = (pass == 0) ? objFiles : rawFiles;
+			XMP_Int32 batchCount = (XMP_Int32)batchFiles.size();
+			if (batchCount == 0)
+			{
+				continue;
+			}
+
+			std::vector<XMP_StringPtr> batchPaths(batchCount);
+			std::vector<XMP_BatchFileInfo> batchInfo(batchCount);
+			std::vector<std::string> batchPackets(getXmpPackets ? batchCount : 0);
+			std::vector<SXMPMeta> batchObjs;	// The copies share the client's XMP objects.
+			for (XMP_Int32 j = 0; j < batchCount; j++)
+			{
+				batchPaths[j] = filePaths[batchFiles[j]];
+				if (pass == 0)
+				{
+					batchObjs.push_back(*xmpObjs[batchFiles[j]]);
+				}
+			}
+
+			SXMPFiles::GetXMPBatch(batchCount, &batchPaths[0], format, openFlags, maxThreads, &batchInfo[0],
+				getXmpPackets ? &batchPackets[0] : 0,
+				(pass == 0) ? &batchObjs[0] : 0);
+
+			for (XMP_Int32 j = 0; j < batchCount; j++)
+			{
+				fileInfo[batchFiles[j]] = batchInfo[j];
+				if (getXmpPackets)
+				{
+					tmpXmpPackets[batchFiles[j]].swap(batchPackets[j]);
+				}
+			}
+		}
+
+		if (getXmpPackets)
+		{
+			// Each packet is freed by the caller with Common_FreeString.
+			for (XMP_Int32 i = 0; i < fileCount; i++)
+			{
+				xmpPacketLengths[i] = tmpXmpPackets[i].length();
+				xmpPackets[i] = (XMP_StringPtr)malloc(xmpPacketLengths[i]);
+				memcpy((void*)xmpPackets[i], tmpXmpPackets[i].c_str(), xmpPacketLengths[i]);
+			}
+		}
+	}
+
+	DllExport void XMPFiles_SetIndexCache(XMP_StringPtr cacheFolder, XMP_OptionBits options)
+	{
+		SXMPFiles::SetIndexCache(cacheFolder, options);
+	}
+
+	DllExport void XMPFiles_SetPerfCounters(XMP_OptionBits options)
+	{
+		SXMPFiles::SetPerfCounters(options);
+	}
+
+	DllExport bool XMPFiles_GetPerfCounters(XMP_FileFormat handlerFormat, XMP_PerfCounters* counters)
+	{
+		return SXMPFiles::GetPerfCounters(handlerFormat, counters);
+	}
 }
 
 // XMPMeta
@@ -231,6 +317,23 @@ extern "C"
 		return false;
 	}
 
+	DllExport XMP_Index XMPMeta_GetPropertyBatch(SXMPMeta* pXmpMeta, XMP_Index propCount, const XMP_StringPtr* schemaNS, const XMP_StringPtr* propNames, XMP_PropertyBatchInfo* propInfo, char* valueArena, XMP_Uns32 valueArenaCapacity, XMP_Uns32* valueArenaLength)
+	{
+		// The arena belongs to the caller and can be reused. If it is too small nothing is copied,
+		// valueArenaLength tells the caller how much to allocate before calling again.
+		std::string tmpValueArena;
+		XMP_Index foundCount = pXmpMeta->GetPropertyBatch(propCount, schemaNS, propNames, propInfo, &tmpValueArena);
+		if (valueArenaLength != NULL)
+		{
+			*valueArenaLength = tmpValueArena.length();
+		}
+		if ((valueArena != NULL) && (tmpValueArena.length() <= valueArenaCapacity))
+		{
+			memcpy(valueArena, tmpValueArena.c_str(), tmpValueArena.length());
+		}
+		return foundCount;
+	}
+
 	DllExport bool XMPMeta_GetArrayItem(SXMPMeta* pXmpMeta, XMP_StringPtr schemaNS, XMP_StringPtr arrayName, XMP_Index itemIndex, XMP_StringPtr* itemValue, XMP_Uns32* itemValueLength, XMP_OptionBits* options)
 	{
 		if (itemValueLength == NULL)
@@ -605,6 +708,65 @@ extern "C"
 		pXmpMeta->ParseFromBuffer(buffer, bufferSize, options);
 	}
 
+	DllExport void XMPMeta_SetParseFilter(SXMPMeta* pXmpMeta, XMP_OptionBits filterMode, const XMP_StringPtr* schemaList, XMP_Index schemaCount)
+	{
+		pXmpMeta->SetParseFilter(filterMode, schemaList, schemaCount);
+	}
+
+	DllExport void XMPMeta_ParseMany(XMP_Int32 packetCount, const XMP_StringPtr* packets, const XMP_StringLen* packetLens, XMP_OptionBits options, XMP_Int32 maxThreads, SXMPMeta** xmpObjs, XMP_Int32* errorIDs)
+	{
+		if (packetCount <= 0)
+		{
+			return;
+		}
+
+		if ((packets == NULL) || (packetLens == NULL) || (xmpObjs == NULL))
+		{
+			// Let SXMPMeta reject the null arrays.
+			SXMPMeta::ParseMany(packetCount, packets, packetLens, options, maxThreads, 0, errorIDs);
+			return;
+		}
+
+		// A NULL entry in xmpObjs skips that packet, its errorIDs entry gets 0. SXMPMeta wants the
+		// XMP objects in one array, so only the packets with an object are passed on.
+		std::vector<XMP_StringPtr> tmpPackets;
+		std::vector<XMP_StringLen> tmpPacketLens;
+		std::vector<SXMPMeta> tmpXmpObjs;	// The copies share the client's XMP objects.
+		std::vector<XMP_Int32> packetIndexes;
+		for (XMP_Int32 i = 0; i < packetCount; i++)
+		{
+			if (errorIDs != NULL)
+			{
+				errorIDs[i] = 0;
+			}
+			if (xmpObjs[i] != NULL)
+			{
+				tmpPackets.push_back(packets[i]);
+				tmpPacketLens.push_back(packetLens[i]);
+				tmpXmpObjs.push_back(*xmpObjs[i]);
+				packetIndexes.push_back(i);
+			}
+		}
+
+		XMP_Int32 tmpCount = (XMP_Int32)packetIndexes.size();
+		if (tmpCount == 0)
+		{
+			return;
+		}
+
+		std::vector<XMP_Int32> tmpErrorIDs(tmpCount);
+		SXMPMeta::ParseMany(tmpCount, &tmpPackets[0], &tmpPacketLens[0], options, maxThreads, &tmpXmpObjs[0],
+			(errorIDs != NULL) ? &tmpErrorIDs[0] : 0);
+
+		if (errorIDs != NULL)
+		{
+			for (XMP_Int32 j = 0; j < tmpCount; j++)
+			{
+				errorIDs[packetIndexes[j]] = tmpErrorIDs[j];
+			}
+		}
+	}
+
 	DllExport void XMPMeta_SerializeToBuffer1(SXMPMeta* pXmpMeta, XMP_StringPtr* rdfString, XMP_Uns32* rdfStringLength, XMP_OptionBits options, XMP_StringLen padding, XMP_StringPtr newline, XMP_StringPtr indent, XMP_Index baseIndent)
 	{
 		if (rdfStringLength != NULL)
@@ -663,6 +825,28 @@ extern "C"
 		}
 	}
 
+	DllExport void XMPMeta_SerializeToSnapshot(SXMPMeta* pXmpMeta, XMP_StringPtr* snapshot, XMP_Uns32* snapshotLength)
+	{
+		if (snapshotLength != NULL)
+		{
+			*snapshotLength = 0;
+			*snapshot = NULL;
+			std::string tmpSnapshot;
+			pXmpMeta->SerializeToSnapshot(&tmpSnapshot);
+			*snapshot = (XMP_StringPtr)malloc(tmpSnapshot.length());
+			if (*snapshot != NULL)
+			{
+				memcpy((void*)*snapshot, (void*)tmpSnapshot.c_str(), tmpSnapshot.length());
+				*snapshotLength = tmpSnapshot.length();
+			}
+		}
+	}
+
+	DllExport void XMPMeta_LoadFromSnapshot(SXMPMeta* pXmpMeta, XMP_StringPtr snapshot, XMP_StringLen snapshotSize)
+	{
+		pXmpMeta->LoadFromSnapshot(snapshot, snapshotSize);
+	}
+
 	// -------------------------------------------------------------------------
 	// Static Public Member Functions
 	// -------------------------------------------------------------------------
@@ -511,6 +511,36 @@ public:
                   tStringObj *     propValue,
                   XMP_OptionBits * options ) const;
 
+    //  --------------------------------------------------------------------------------------------
+    /// \brief \c GetPropertyBatch gets the values of a list of properties in one call. This is
+    /// equivalent to calling \c GetProperty for each one, but crosses into the library and takes
+    /// the lock only once, and all of the values come back in one string.
+    ///
+    /// \result Returns the number of properties that exist.
+    ///
+    /// \param propCount The number of properties, the length of all of the arrays.
+    ///
+    /// \param schemaNS The namespace URIs for the properties, as for \c GetProperty.
+    ///
+    /// \param propNames The names of the properties. Each may be a general path expression, as for
+    /// \c GetProperty.
+    ///
+    /// \param propInfo An array of \c propCount \c XMP_PropertyBatchInfo structures, one per
+    /// property, giving whether it exists, its options, and where its value is in \c valueArena.
+    ///
+    /// \param valueArena A pointer to the string that is assigned all of the values. Each value is
+    /// followed by a nul. May be null if only the existence and options are wanted.
+    ///
+    /// An exception is thrown for a bad schema or path in any of the requests, as for
+    /// \c GetProperty. A property that does not exist is not an error.
+
+    XMP_Index
+    GetPropertyBatch ( XMP_Index               propCount,
+                       const XMP_StringPtr *   schemaNS,
+                       const XMP_StringPtr *   propNames,
+                       XMP_PropertyBatchInfo * propInfo,
+                       tStringObj *            valueArena ) const;
+
     //  --------------------------------------------------------------------------------------------
     /// \brief \c GetArrayItem provides access to items within an array. The index is passed as an
     /// integer, you need not worry about the path string syntax for array items, convert a loop
@@ -1512,6 +1542,13 @@ public:
     /// \li \c kXMP_ParseMoreBuffers - This is not the last buffer of input, more calls follow.
     /// \li \c kXMP_RequireXMPMeta - The x:xmpmeta XML element is required around <tt>rdf:RDF</tt>.
     /// \li \c kXMP_StrictAliasing - Do not reconcile alias differences, throw an exception.
+    /// \li \c kXMP_ParseLazySchemas - Keep the RDF of each schema and only convert it when the
+    /// schema is first used. Schemas that are never looked at cost little more than the XML parse,
+    /// and are serialized again straight from the kept RDF unless \c kXMP_UseCompactFormat is used.
+    /// Errors in the RDF of a lazy schema are not reported until that schema is used.
+    /// \li \c kXMP_ParseFastXML - Scan the XML with a simple scanner that handles the plain UTF-8
+    /// XML that is normal for XMP, much faster than Expat. Anything else, including all malformed
+    /// XML, is parsed by Expat as usual. The option only matters on the first call for a stream.
     ///
     /// \note The \c kXMP_StrictAliasing option is not yet implemented.
 
@@ -1520,6 +1557,68 @@ public:
                       XMP_StringLen  bufferSize,
                       XMP_OptionBits options = 0 );
 
+    //  --------------------------------------------------------------------------------------------
+    /// \brief \c SetParseFilter limits the schemas that later calls to \c ParseFromBuffer put into
+    /// this XMP object.
+    ///
+    /// Top level properties in excluded schemas are skipped when the RDF is recognized. No XMP nodes
+    /// are made for them, their content is not checked, and the post-parse cleanup never sees them.
+    /// An alias is judged by the schema of its actual property, so \c photoshop:Caption is kept
+    /// when only the \c dc: schema is wanted. The filter stays in effect until it is changed, it is
+    /// not copied by \c Clone.
+    ///
+    /// \param filterMode \c kXMP_ParseOnlySchemas to keep only the listed schemas,
+    /// \c kXMP_ParseSkipSchemas to skip them, or 0 to turn the filter off.
+    ///
+    /// \param schemaList An array of namespace URIs. May be null if \c schemaCount is 0.
+    ///
+    /// \param schemaCount The number of URIs in \c schemaList.
+
+    void
+    SetParseFilter ( XMP_OptionBits        filterMode,
+                     const XMP_StringPtr * schemaList = 0,
+                     XMP_Index             schemaCount = 0 );
+
+    //  --------------------------------------------------------------------------------------------
+    /// \brief \c ParseMany parses a set of complete packets into a set of XMP objects, using a small
+    /// set of worker threads.
+    ///
+    /// Each packet is parsed exactly as if by a separate call to \c ParseFromBuffer for its object.
+    /// The packets are processed concurrently by up to \c maxThreads threads, the calling thread
+    /// being one of them. Namespaces used by the packets are registered as usual. Namespace lookups
+    /// by the workers take no lock, so adding new namespaces is the only point of contention.
+    ///
+    /// The library is locked for the duration of the call, other XMP calls from other threads wait
+    /// until all of the packets are parsed.
+    ///
+    /// \param packetCount The number of packets, the length of all of the arrays.
+    ///
+    /// \param packets The packets to parse.
+    ///
+    /// \param packetLens The length of each packet in bytes, or \c kXMP_UseNullTermination.
+    ///
+    /// \param options The options passed to \c ParseFromBuffer for every packet. Must not include
+    /// \c kXMP_ParseMoreBuffers.
+    ///
+    /// \param maxThreads The maximum number of threads to use. Pass 0 for a default.
+    ///
+    /// \param xmpObjs An array of \c packetCount distinct XMP objects to receive the parsed XMP.
+    /// Copies made by the copy constructor or assignment share one object, and count as the same
+    /// object. A repeated object is rejected with \c kXMPErr_BadParam before anything is parsed.
+    ///
+    /// \param errorIDs An optional array of \c packetCount values. Each gets 0 if its packet was
+    /// parsed or the \c XMP_Error ID if not, and a failure for one packet does not stop the others.
+    /// If null, the first failure in packet order is thrown after all of the packets are done.
+
+    static void
+    ParseMany ( XMP_Int32             packetCount,
+                const XMP_StringPtr * packets,
+                const XMP_StringLen * packetLens,
+                XMP_OptionBits        options,
+                XMP_Int32             maxThreads,
+                TXMPMeta *            xmpObjs,
+                XMP_Int32 *           errorIDs = 0 );
+
     //  --------------------------------------------------------------------------------------------
     /// \brief \c SerializeToBuffer serializes an XMP object into a string as RDF.
     ///
@@ -1581,6 +1680,47 @@ public:
                         XMP_OptionBits options = 0,
                         XMP_StringLen  padding = 0 ) const;
 
+    //  --------------------------------------------------------------------------------------------
+    /// \brief \c SerializeToSnapshot saves an XMP object in a compact binary form, for caches that
+    /// would otherwise store RDF and parse it again.
+    ///
+    /// A snapshot is much faster to load than RDF is to parse. It is not an interchange format, it
+    /// can change between versions of the toolkit. A snapshot of another version is rejected by
+    /// \c LoadFromSnapshot, the cache should then fall back to the RDF.
+    ///
+    /// A snapshot can be used straight from a memory mapped file. Its integers are little endian and
+    /// all of its content is located by offsets, so it does not depend on the host or its address.
+    /// It starts with the 8 characters "XMP_SNAP" followed by its total length as a 32 bit little
+    /// endian integer.
+    ///
+    /// \param snapshot A pointer to the string to receive the snapshot. Must not be null. The
+    /// snapshot is binary, it contains nul bytes.
+
+    void
+    SerializeToSnapshot ( tStringObj * snapshot ) const;
+
+    //  --------------------------------------------------------------------------------------------
+    /// \brief \c LoadFromSnapshot replaces the content of an XMP object with a snapshot made by
+    /// \c SerializeToSnapshot.
+    ///
+    /// Serializing the loaded object gives exactly the same RDF as serializing the original object,
+    /// for all serialization options. Namespaces used by the snapshot are registered if necessary.
+    /// If a namespace is now registered with a different prefix the names are changed to use it,
+    /// just as \c ParseFromBuffer would.
+    ///
+    /// The snapshot is checked completely before the object is changed. A damaged or truncated
+    /// snapshot throws an exception with \c kXMPErr_BadParse. The namespace registrations are
+    /// global and are made before the names are checked, so a snapshot rejected for a bad name can
+    /// leave its namespaces registered, as rejected RDF can with \c ParseFromBuffer.
+    ///
+    /// \param snapshot A pointer to the snapshot. It is only read during the call.
+    ///
+    /// \param snapshotSize The length of the snapshot in bytes.
+
+    void
+    LoadFromSnapshot ( XMP_StringPtr snapshot,
+                       XMP_StringLen snapshotSize );
+
     /// @}
 
     // =============================================================================================
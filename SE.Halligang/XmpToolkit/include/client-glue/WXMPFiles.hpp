@@ -52,6 +52,18 @@ extern "C" {
 #define zXMPFiles_GetFormatInfo_1(format,flags) \
 	WXMPFiles_GetFormatInfo_1 ( format, flags, &wResult )
 
+#define zXMPFiles_GetXMPBatch_1(fileCount,filePaths,format,openFlags,maxThreads,fileInfo,xmpRefs,xmpPackets,xmpPacketLens) \
+	WXMPFiles_GetXMPBatch_1 ( fileCount, filePaths, format, openFlags, maxThreads, fileInfo, xmpRefs, xmpPackets, xmpPacketLens, &wResult )
+
+#define zXMPFiles_SetIndexCache_1(cacheFolder,options) \
+	WXMPFiles_SetIndexCache_1 ( cacheFolder, options, &wResult )
+
+#define zXMPFiles_SetPerfCounters_1(options) \
+	WXMPFiles_SetPerfCounters_1 ( options, &wResult )
+
+#define zXMPFiles_GetPerfCounters_1(handlerFormat,counters) \
+	WXMPFiles_GetPerfCounters_1 ( handlerFormat, counters, &wResult )
+
 #define zXMPFiles_OpenFile_1(filePath,format,openFlags) \
 	WXMPFiles_OpenFile_1 ( this->xmpFilesRef, filePath, format, openFlags, &wResult )
     
@@ -100,6 +112,28 @@ extern void WXMPFiles_GetFormatInfo_1 ( XMP_FileFormat   format,
                                         XMP_OptionBits * flags,	// ! Can be null.
                                         WXMP_Result *    result );
 
+extern void WXMPFiles_GetXMPBatch_1 ( XMP_Int32             fileCount,
+                                      const XMP_StringPtr * filePaths,
+                                      XMP_FileFormat        format,
+                                      XMP_OptionBits        openFlags,
+                                      XMP_Int32             maxThreads,
+                                      XMP_BatchFileInfo *   fileInfo,
+                                      XMPMetaRef *          xmpRefs,		// ! Can be null, as can individual refs.
+                                      XMP_StringPtr *       xmpPackets,		// ! Can be null.
+                                      XMP_StringLen *       xmpPacketLens,	// ! Can be null.
+                                      WXMP_Result *         result );
+
+extern void WXMPFiles_SetIndexCache_1 ( XMP_StringPtr  cacheFolder,	// ! Can be null.
+                                        XMP_OptionBits options,
+                                        WXMP_Result *  result );
+
+extern void WXMPFiles_SetPerfCounters_1 ( XMP_OptionBits options,
+                                          WXMP_Result *  result );
+
+extern void WXMPFiles_GetPerfCounters_1 ( XMP_FileFormat     handlerFormat,
+                                          XMP_PerfCounters * counters,
+                                          WXMP_Result *      result );
+
 extern void WXMPFiles_OpenFile_1 ( XMPFilesRef    xmpFilesRef,
                                    XMP_StringPtr  filePath,
 					               XMP_FileFormat format,
@@ -0,0 +1,172 @@
+# ==================================================================================================
+# Copyright 2002-2007 Adobe Systems Incorporated
+# All Rights Reserved.
+#
+# NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+# of the Adobe license agreement accompanying it.
+# ==================================================================================================
+
+# ==================================================================================================
+
+# Define internal use variables.
+
+Error =
+TargetOS = ${OS}
+
+ifeq "${TargetOS}" ""
+	TargetOS = ${os}
+endif
+
+ifeq "${TargetOS}" ""
+	TargetOS = ${MACHTYPE}${OSTYPE}
+endif
+
+ifeq "${TargetOS}" "i386linux"	# Linux ${MACHTYPE}${OSTYPE} is i386linux.
+	TargetOS = i80386linux
+endif
+
+ifeq "${TargetOS}" "linux"
+	TargetOS = i80386linux
+endif
+
+ifeq "${TargetOS}" "solaris"
+	TargetOS = sparcsolaris
+endif
+
+ifneq "${TargetOS}" "i80386linux"
+	ifneq "${TargetOS}" "sparcsolaris"
+		Error += Invalid target OS "${TargetOS}"
+	endif
+endif
+
+TargetStage = ${STAGE}
+
+ifeq "${TargetStage}" ""
+	TargetStage = ${stage}
+endif
+
+ifeq "${TargetStage}" ""
+	TargetStage = debug
+endif
+
+ifneq "${TargetStage}" "debug"
+	ifneq "${TargetStage}" "release"
+		Error += Invalid target stage "${TargetStage}"
+	endif
+endif
+
+ifeq "${TargetStage}" "debug"
+   LibSuffix = StaticDebug
+endif
+
+ifeq "${TargetStage}" "release"
+   LibSuffix = StaticRelease
+endif
+
+BuildRoot   = ../..
+LibraryRoot = ${BuildRoot}/public/libraries/${TargetOS}/${TargetStage}
+TargetRoot  = ${BuildRoot}/public/benchmarks/${TargetOS}/${TargetStage}
+TempRoot    = ${BuildRoot}/intermediate/XMPBenchmark/${TargetOS}/${TargetStage}
+
+HeaderRoot  = ${BuildRoot}/public/include
+SampleRoot  = ${BuildRoot}/samples
+
+Benchmark   = ${TargetRoot}/XMPBenchmark
+LibXMPCore  = ${LibraryRoot}/libXMPCore${LibSuffix}.a
+LibXMPFiles = ${LibraryRoot}/libXMPFiles${LibSuffix}.a
+
+# The run target writes the results here, and rebuilds the file corpus under CorpusRoot.
+Results     = ${TargetRoot}/XMPBenchmark.csv
+CorpusRoot  = ${TempRoot}/corpus
+Samples     = 7
+
+# ==================================================================================================
+
+CPP = gcc -x c++
+LD  = gcc
+
+CPPFLAGS = -Wno-multichar -Wno-implicit -Wno-ctor-dtor-privacy -funsigned-char -fexceptions
+CPPFLAGS += -DUNIX_ENV=1 -D_FILE_OFFSET_BITS=64
+
+LDLibs = ${LibXMPFiles} ${LibXMPCore} -lc -lm -lpthread -lstdc++
+
+ifeq "${TargetOS}" "i80386linux"
+	ifneq "$(shell uname -m)" "x86_64"	# A 64 bit gcc rejects i686 tuning.
+		CPPFLAGS += -mtune=i686
+	endif
+	LDLibs += -lgcc_eh
+endif
+
+ifeq "${TargetOS}" "sparcsolaris"
+	CPPFLAGS += -mtune=ultrasparc
+endif
+
+ifeq "$(TargetStage)" "debug"
+	CPPFLAGS += -DDEBUG=1 -D_DEBUG=1 -g -O0
+endif
+
+ifeq "$(TargetStage)" "release"
+	CPPFLAGS += -DNDEBUG=1 -O2 -Os
+endif
+
+Includes = -I${HeaderRoot}
+
+# ==================================================================================================
+
+.PHONY: all run msg create_dirs libraries
+.NOTPARALLEL:	# The libraries must be built before the benchmark is linked.
+
+all : msg create_dirs libraries ${Benchmark}
+
+run : all
+	rm -rf ${CorpusRoot}
+	mkdir -p ${CorpusRoot}
+	${Benchmark} -o ${Results} -r ${Samples} ${SampleRoot}/BlueSquares ${CorpusRoot}
+	@echo ""
+	@echo "Benchmark results are in ${Results}"
+
+msg :
+ifeq "${Error}" ""
+	@echo ""
+	@echo Building XMP benchmarks for ${TargetOS} ${TargetStage}
+else
+	@echo ""
+	@echo "Error: ${Error}"
+	@echo ""
+	@echo "# To build and run the XMP benchmarks :"
+	@echo "#   make -f XMPBenchmark.mak [OS=<os>] [STAGE=<stage>] [all | run]"
+	@echo "# where"
+	@echo "#   OS    = i80386linux | sparcsolaris"
+	@echo "#   STAGE = debug | release"
+	@echo "#"
+	@echo "# The OS and STAGE symbols can also be lowercase, os and stage."
+	@echo "# The all target builds the XMPCore and XMPFiles libraries and"
+	@echo "# the benchmark program. The run target also runs it, writing"
+	@echo "# CSV results to public/benchmarks/<os>/<stage>/XMPBenchmark.csv."
+	@echo "# Use the release stage for timings that mean anything."
+	@echo ""
+	exit 1
+endif
+
+create_dirs :
+	mkdir -p ${TempRoot}
+	mkdir -p ${TargetRoot}
+
+libraries :
+	${MAKE} -f XMPCore.mak OS=${TargetOS} STAGE=${TargetStage}
+	${MAKE} -f XMPFiles.mak OS=${TargetOS} STAGE=${TargetStage}
+
+${TempRoot}/XMPBenchmark.o : ${SampleRoot}/source/XMPBenchmark.cpp
+	@echo ""
+	@echo "Compiling $<"
+	${CPP} ${CPPFLAGS} ${Includes} -c $< -o $@
+
+${Benchmark} : ${TempRoot}/XMPBenchmark.o ${LibXMPFiles} ${LibXMPCore}
+	@echo ""
+	@echo "Linking $@"
+	${LD} $< ${LDLibs} -o $@
+	@echo ""
+
+clean : msg
+	rm -rf ${TempRoot}
+	rm -f ${Benchmark} ${Results}
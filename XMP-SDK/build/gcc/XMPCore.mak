@@ -84,7 +84,9 @@ CPPFLAGS = -Wno-multichar -Wno-implicit -Wno-ctor-dtor-privacy -funsigned-char -
 CPPFLAGS += -DUNIX_ENV=1 -DXMP_IMPL=1 -DXMP_ClientBuild=0 -D_FILE_OFFSET_BITS=64 -DHAVE_EXPAT_CONFIG_H=1 -DXML_STATIC=1
 
 ifeq "${TargetOS}" "i80386linux"
-	CPPFLAGS += -mtune=i686
+	ifneq "$(shell uname -m)" "x86_64"	# A 64 bit gcc rejects i686 tuning.
+		CPPFLAGS += -mtune=i686
+	endif
 endif
 
 ifeq "${TargetOS}" "sparcsolaris"
@@ -127,11 +129,14 @@ CPPSources =  \
     XMPMeta-GetSet.cpp \
     XMPMeta-Parse.cpp \
     XMPMeta-Serialize.cpp \
+    XMPMeta-Snapshot.cpp \
     XMPIterator.cpp \
+    XMPFlatTree.cpp \
     XMPUtils.cpp \
     XMPUtils-FileInfo.cpp \
     XMPCore_Impl.cpp \
     ExpatAdapter.cpp \
+    FastXMLAdapter.cpp \
     ParseRDF.cpp \
     UnicodeConversions.cpp \
     MD5.cpp \
@@ -206,7 +211,7 @@ ${LibName} : ${CCObjs} ${CPPObjs}
 	@echo ""
 	@echo "Linking $@"
 	rm -f $@
-	${AR}  $@ $?
+	${AR}  $@ $^
 	@echo ""
 
 clean : msg
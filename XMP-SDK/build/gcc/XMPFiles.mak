@@ -0,0 +1,213 @@
+# ==================================================================================================
+# Copyright 2002-2007 Adobe Systems Incorporated
+# All Rights Reserved.
+#
+# NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+# of the Adobe license agreement accompanying it.
+# ==================================================================================================
+
+# ==================================================================================================
+
+# Define internal use variables.
+
+Error =
+TargetOS = ${OS}
+
+ifeq "${TargetOS}" ""
+	TargetOS = ${os}
+endif
+
+ifeq "${TargetOS}" ""
+	TargetOS = ${MACHTYPE}${OSTYPE}
+endif
+
+ifeq "${TargetOS}" "i386linux"	# Linux ${MACHTYPE}${OSTYPE} is i386linux.
+	TargetOS = i80386linux
+endif
+
+ifeq "${TargetOS}" "linux"
+	TargetOS = i80386linux
+endif
+
+ifeq "${TargetOS}" "solaris"
+	TargetOS = sparcsolaris
+endif
+
+ifneq "${TargetOS}" "i80386linux"
+	ifneq "${TargetOS}" "sparcsolaris"
+		Error += Invalid target OS "${TargetOS}"
+	endif
+endif
+
+TargetStage = ${STAGE}
+
+ifeq "${TargetStage}" ""
+	TargetStage = ${stage}
+endif
+
+ifeq "${TargetStage}" ""
+	TargetStage = debug
+endif
+
+ifneq "${TargetStage}" "debug"
+	ifneq "${TargetStage}" "release"
+		Error += Invalid target stage "${TargetStage}"
+	endif
+endif
+
+ifeq "${TargetStage}" "debug"
+   LibSuffix = StaticDebug
+endif
+
+ifeq "${TargetStage}" "release"
+   LibSuffix = StaticRelease
+endif
+
+BuildRoot  = ../..
+TargetRoot = ${BuildRoot}/public/libraries/${TargetOS}/${TargetStage}
+TempRoot   = ${BuildRoot}/intermediate/XMPFiles/${TargetOS}/${TargetStage}
+
+HeaderRoot = ${BuildRoot}/public/include
+SourceRoot = ${BuildRoot}/source
+FilesRoot  = ${SourceRoot}/XMPFiles
+MD5Root    = ${BuildRoot}/third-party/MD5
+
+LibName    = ${TargetRoot}/libXMPFiles${LibSuffix}.a
+
+# ==================================================================================================
+
+CC  = gcc
+CPP = gcc -x c++
+AR  = ar -rs
+
+CPPFLAGS = -Wno-multichar -Wno-implicit -Wno-ctor-dtor-privacy -funsigned-char -fexceptions
+CPPFLAGS += -DUNIX_ENV=1 -DXMP_IMPL=1 -DXMP_ClientBuild=0 -D_FILE_OFFSET_BITS=64
+
+ifeq "${TargetOS}" "i80386linux"
+	ifneq "$(shell uname -m)" "x86_64"	# A 64 bit gcc rejects i686 tuning.
+		CPPFLAGS += -mtune=i686
+	endif
+endif
+
+ifeq "${TargetOS}" "sparcsolaris"
+	CPPFLAGS += -mtune=ultrasparc
+endif
+
+ifeq "$(TargetStage)" "debug"
+	CPPFLAGS += -DDEBUG=1 -D_DEBUG=1 -g -O0
+endif
+
+ifeq "$(TargetStage)" "release"
+	CPPFLAGS += -DNDEBUG=1 -O2 -Os
+endif
+
+# ==================================================================================================
+
+# The XMPFiles library is linked with the XMPCore library, which already has the common code for
+# Unicode conversions and MD5. Clients link libXMPFiles before libXMPCore.
+
+CPPObjs = $(foreach objs,${CPPSources:.cpp=.o},${TempRoot}/$(objs))
+
+vpath %.incl_cpp \
+    ${HeaderRoot}: \
+    ${HeaderRoot}/client-glue:
+
+vpath %.cpp \
+    ${FilesRoot}: \
+    ${FilesRoot}/FileHandlers: \
+    ${FilesRoot}/FormatSupport:
+
+CPPSources =  \
+    XMPFiles.cpp \
+    XMPFiles_Impl.cpp \
+    WXMPFiles.cpp \
+    AVI_Handler.cpp \
+    Basic_Handler.cpp \
+    InDesign_Handler.cpp \
+    JPEG_Handler.cpp \
+    MP3_Handler.cpp \
+    MPEG_Handler.cpp \
+    PNG_Handler.cpp \
+    PostScript_Handler.cpp \
+    PSD_Handler.cpp \
+    Scanner_Handler.cpp \
+    TIFF_Handler.cpp \
+    Trivial_Handler.cpp \
+    WAV_Handler.cpp \
+    ID3_Support.cpp \
+    IPTC_Support.cpp \
+    PNG_Support.cpp \
+    PSIR_FileWriter.cpp \
+    PSIR_MemoryReader.cpp \
+    Reconcile_Impl.cpp \
+    ReconcileIPTC.cpp \
+    ReconcileLegacy.cpp \
+    ReconcileTIFF.cpp \
+    RIFF_Support.cpp \
+    TIFF_FileWriter.cpp \
+    TIFF_MemoryReader.cpp \
+    TIFF_Support.cpp \
+    XMPScanner.cpp
+
+Includes = \
+   -I${HeaderRoot} \
+   -I${FilesRoot} \
+   -I${FilesRoot}/FileHandlers \
+   -I${FilesRoot}/FormatSupport \
+   -I${SourceRoot}/common \
+   -I${BuildRoot}/build \
+   -I${BuildRoot}/build/gcc/${TargetOS} \
+   -I${MD5Root}
+
+.SUFFIXES:                # Delete the default suffixes
+.SUFFIXES: .o .cpp        # Define our suffix list
+
+# ==================================================================================================
+
+${TempRoot}/%.o : %.cpp
+	@echo ""
+	@echo "Compiling $<"
+	${CPP} ${CPPFLAGS} ${Includes} -c $< -o $@
+
+# ==================================================================================================
+
+.PHONY: all msg create_dirs
+
+all : msg create_dirs ${LibName}
+
+msg :
+ifeq "${Error}" ""
+	@echo ""
+	@echo Building XMPFiles library for ${TargetOS} ${TargetStage}
+else
+	@echo ""
+	@echo "Error: ${Error}"
+	@echo ""
+	@echo "# To build the XMPFiles library :"
+	@echo "#   make -f XMPFiles.mak [OS=<os>] [STAGE=<stage>]"
+	@echo "# where"
+	@echo "#   OS    = i80386linux | sparcsolaris"
+	@echo "#   STAGE = debug | release"
+	@echo "#"
+	@echo "# The OS and STAGE symbols can also be lowercase, os and stage."
+	@echo "# If the OS is omitted it will try to default from the OSTYPE and"
+	@echo "# MACHTYPE environment variables. If the stage is omitted it"
+	@echo "# defaults to debug. Clients also need the XMPCore library, see"
+	@echo "# XMPCore.mak."
+	@echo ""
+	exit 1
+endif
+
+create_dirs :
+	mkdir -p ${TempRoot}
+	mkdir -p ${TargetRoot}
+
+${LibName} : ${CPPObjs}
+	@echo ""
+	@echo "Linking $@"
+	rm -f $@
+	${AR}  $@ $^
+	@echo ""
+
+clean : msg
+	rm -f ${TempRoot}/* ${LibName}
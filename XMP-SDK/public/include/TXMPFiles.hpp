@@ -159,6 +159,111 @@ public:
     static bool GetFormatInfo ( XMP_FileFormat   format,
     							XMP_OptionBits * handlerFlags = 0 );
 
+    //  --------------------------------------------------------------------------------------------
+    /// \brief Read the XMP from a list of files in one call, using a small set of worker threads.
+    ///
+    /// Each file is opened read-only, its XMP is fetched, and the file is closed, exactly as if
+    /// done with a separate \c TXMPFiles object per file. The files are processed concurrently by
+    /// up to \c maxThreads threads, the calling thread being one of them. The results are always
+    /// stored in the same order as \c filePaths, no matter which file finishes first.
+    ///
+    /// A failure for one file does not stop the batch. The per-file result has a status of
+    /// \c kXMPFiles_BatchFailed and the \c XMP_Error ID. Exceptions are only thrown for bad
+    /// parameters, such as passing \c kXMPFiles_OpenForUpdate.
+    ///
+    /// If \c xmpObjs is null the raw packets are returned without being parsed or reconciled with
+    /// legacy metadata, which is considerably faster. In that case the status reflects only the
+    /// presence of an XMP packet in the file.
+    ///
+    /// The library is locked for the duration of the call, other \c TXMPFiles calls from other
+    /// threads wait until the batch is finished.
+    ///
+    /// \param fileCount The number of files, the length of all of the arrays.
+    ///
+    /// \param filePaths The UTF-8 paths for the files.
+    ///
+    /// \param format The format hint passed to \c OpenFile for every file.
+    ///
+    /// \param openFlags The options passed to \c OpenFile for every file. Must not include
+    /// \c kXMPFiles_OpenForUpdate.
+    ///
+    /// \param maxThreads The maximum number of threads to use. Pass 0 for a default.
+    ///
+    /// \param fileInfo An array of \c fileCount \c XMP_BatchFileInfo structures, one per file.
+    ///
+    /// \param xmpPackets An optional array of \c fileCount strings to receive the packets.
+    ///
+    /// \param xmpObjs An optional array of \c fileCount XMP objects to receive the parsed and
+    /// reconciled XMP.
+
+    static void GetXMPBatch ( XMP_Int32             fileCount,
+                              const XMP_StringPtr * filePaths,
+                              XMP_FileFormat        format,
+                              XMP_OptionBits        openFlags,
+                              XMP_Int32             maxThreads,
+                              XMP_BatchFileInfo *   fileInfo,
+                              tStringObj *          xmpPackets = 0,
+                              SXMPMeta *            xmpObjs = 0 );
+
+    //  --------------------------------------------------------------------------------------------
+    /// \brief Turn on or off a persistent cache of what \c OpenFile finds in each file.
+    ///
+    /// When the index cache is on, a read-only \c OpenFile first looks in the cache folder for an
+    /// entry made by an earlier open of the same file. The file is identified by its volume and
+    /// file ID (device and inode for POSIX), and the entry is only used if the file's size and
+    /// modification time are unchanged and the same open options and format hint are passed. A
+    /// cache hit does not read the file at all, the format, packet info, and raw packet come from
+    /// the entry.
+    ///
+    /// Entries are written by \c CloseFile for files opened read-only, and removed when a file
+    /// is updated by \c CloseFile. Files opened with \c kXMPFiles_OpenForUpdate or
+    /// \c kXMPFiles_OpenCacheTNail, and formats whose handler owns the file, never use the cache.
+    /// Failures to read or write the cache are ignored, they just act as a cache miss.
+    ///
+    /// Without \c kXMPFiles_IndexCacheXMPTree an entry only saves work for clients that want the
+    /// raw packet or packet info, \c GetXMP reopens the file normally when it must return the XMP
+    /// object. With it the processed XMP is also kept in the entry, once \c GetXMP has been called.
+    ///
+    /// \param cacheFolder The UTF-8 path of an existing folder for the cache entries. Pass null or
+    /// an empty string to turn the cache off, existing entries are left alone.
+    ///
+    /// \param options A set of option bits, \c kXMPFiles_IndexCacheXMPTree is the only one.
+
+    static void SetIndexCache ( XMP_StringPtr  cacheFolder,
+                                XMP_OptionBits options = 0 );
+
+    //  --------------------------------------------------------------------------------------------
+    /// \brief Turn on or off the gathering of performance counters, or clear them.
+    ///
+    /// When on, each \c OpenFile, \c CloseFile, \c GetXMP, \c GetThumbnail, \c PutXMP, and
+    /// \c CanPutXMP call is timed, as are the main phases within them: format checking, caching
+    /// the file data, processing the XMP, legacy reconciliation, serialization, updating the file,
+    /// and the temp file copying for safe saves. The number of file reads, writes, seeks, and
+    /// other I/O calls and the bytes read and written are also counted. Everything is kept both
+    /// as a total and per file handler. The counters are off by default, when off the cost is a
+    /// test of a flag.
+    ///
+    /// \param options A set of option bits. \c kXMPFiles_PerfCountersOn turns the counters on,
+    /// they are turned off if it is not passed. \c kXMPFiles_PerfCountersReset clears the counters.
+
+    static void SetPerfCounters ( XMP_OptionBits options );
+
+    //  --------------------------------------------------------------------------------------------
+    /// \brief Get the performance counters gathered since they were turned on or last reset.
+    ///
+    /// \param handlerFormat The file format whose handler's counters are wanted. Pass
+    /// \c kXMPFiles_PerfTotals for the totals over all handlers. The packet scanning handler
+    /// counts under \c kXMP_UnknownFile. A format check counts under the handler whose check was
+    /// run, whether or not the file was accepted. Other work done before the handler is known only
+    /// shows in the totals.
+    ///
+    /// \param counters The structure to receive the counters. It is cleared if there are none.
+    ///
+    /// \result Returns true if anything has been counted for the format.
+
+    static bool GetPerfCounters ( XMP_FileFormat     handlerFormat,
+                                  XMP_PerfCounters * counters );
+
     /// @}
 	
 	//  ============================================================================================
@@ -216,6 +321,11 @@ public:
     /// \li kXMPFiles_OpenStrictly - Be strict about locating XMP and reconciling with other forms.
     /// \li kXMPFiles_OpenUseSmartHandler - Require the use of a smart handler.
     /// \li kXMPFiles_OpenUsePacketScanning - Force packet scanning, don't use a smart handler.
+    /// \li kXMPFiles_OpenDropBehind - Keep whole-file scans and safe-save copies out of the OS file
+    /// cache. The packet scanner, the PostScript search for the last packet, and the file copies made
+    /// by \c CloseFile with \c kXMPFiles_UpdateSafely tell the OS to drop the pages behind them. Use
+    /// this on servers where a scan of a multi-gigabyte file would push other data out of the cache.
+    /// It is only a hint, currently acted on for UNIX.
     ///
     /// \result Returns true if the file is succesfully opened and attached to a file handler.
     /// Returns false for "anticipated" problems, e.g. passing kXMPFiles_OpenUseSmartHandler but not
@@ -58,14 +58,20 @@ extern "C" {
 
     typedef signed char XMP_Int8;
     typedef signed short XMP_Int16;
-    typedef signed long XMP_Int32;
     typedef signed long long XMP_Int64;
 
     typedef unsigned char XMP_Uns8;
     typedef unsigned short XMP_Uns16;
-    typedef unsigned long XMP_Uns32;
     typedef unsigned long long XMP_Uns64;
 
+    #if XMP_UNIXBuild	/* ! A long is 64 bits for LP64 UNIXes, an int is 32 bits for all of them. */
+        typedef signed int XMP_Int32;
+        typedef unsigned int XMP_Uns32;
+    #else
+        typedef signed long XMP_Int32;
+        typedef unsigned long XMP_Uns32;
+    #endif
+
 #endif
 
 typedef XMP_Uns8 XMP_Bool;
@@ -508,7 +514,14 @@ enum {  /* Option bits for the TXMPMeta::SetXyz functions. */
 enum {  /* Options for TXMPMeta::ParseFromBuffer. */
     kXMP_RequireXMPMeta   = 0x0001UL,  /* Require a surrounding x:xmpmeta element. */
     kXMP_ParseMoreBuffers = 0x0002UL,  /* This is the not last input buffer for this parse stream. */
-    kXMP_StrictAliasing   = 0x0004UL   /* Do not reconcile alias differences, throw an exception. */
+    kXMP_StrictAliasing   = 0x0004UL,  /* Do not reconcile alias differences, throw an exception. */
+    kXMP_ParseLazySchemas = 0x0008UL,  /* Keep each schema's RDF until the schema is first used. */
+    kXMP_ParseFastXML     = 0x0010UL   /* Scan plain RDF directly, use Expat only for unusual XML. */
+};
+
+enum {  /* Modes for TXMPMeta::SetParseFilter. */
+    kXMP_ParseOnlySchemas = 0x0001UL,  /* Keep only the top level properties in the listed schemas. */
+    kXMP_ParseSkipSchemas = 0x0002UL   /* Skip the top level properties in the listed schemas. */
 };
 
 enum {  /* Options for TXMPMeta::SerializeToBuffer. */
@@ -539,6 +552,23 @@ enum {  /* Options for TXMPMeta::SerializeToBuffer. */
 
 /* ---------------------------------------------------------------------------------------------- */
 
+struct XMP_PropertyBatchInfo {  /* One result from TXMPMeta::GetPropertyBatch. */
+    XMP_StringLen  valueOffset; /* The offset of the value within the value arena. */
+    XMP_StringLen  valueLen;    /* The length of the value, the arena has a nul after each value. */
+    XMP_OptionBits options;     /* The option flags of the property. */
+    XMP_Bool       found;       /* True if the property exists, otherwise all fields are 0. */
+    XMP_Uns8       pad1, pad2, pad3;
+    #if __cplusplus
+        XMP_PropertyBatchInfo() : valueOffset(0), valueLen(0), options(0), found(false),
+                                  pad1(0), pad2(0), pad3(0) {};
+    #endif
+};
+#if ! __cplusplus
+    typedef struct XMP_PropertyBatchInfo XMP_PropertyBatchInfo;
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
 enum {  /* Options for TXMPIterator construction. */
 
     kXMP_IterClassMask      = 0x00FFUL,  /* The low 8 bits are an enum of what data structure to iterate. */
@@ -748,6 +778,7 @@ enum {	/* Options for OpenFile. */
     kXMPFiles_OpenUseSmartHandler   = 0x00000020, /* Require the use of a smart handler. */
     kXMPFiles_OpenUsePacketScanning = 0x00000040, /* Force packet scanning, don't use a smart handler. */
     kXMPFiles_OpenLimitedScanning   = 0x00000080, /* Only packet scan files "known" to need scanning. */
+    kXMPFiles_OpenDropBehind        = 0x00000100, /* Keep whole-file scans and safe-save copies out of the OS file cache. */
     kXMPFiles_OpenInBackground      = 0x10000000  /* Set if calling from background thread. */
 };
 
@@ -759,6 +790,96 @@ enum {	/* Options for CloseFile. */
     kXMPFiles_UpdateSafely = 0x0001	/* Write into a temporary file and swap for crash safety. */
 };
 
+/* ---------------------------------------------------------------------------------------------- */
+
+enum {  /* Values for XMP_BatchFileInfo.status. */
+    kXMPFiles_BatchHasXMP    = 0, /* The file was opened and has XMP. */
+    kXMPFiles_BatchNoXMP     = 1, /* The file was opened but has no XMP. */
+    kXMPFiles_BatchNotOpened = 2, /* OpenFile returned false, e.g. no smart handler with kXMPFiles_OpenUseSmartHandler. */
+    kXMPFiles_BatchFailed    = 3  /* An exception was thrown, errorID has the XMP_Error ID. */
+};
+
+struct XMP_BatchFileInfo {
+    XMP_PacketInfo packetInfo;  /* Only meaningful if status is kXMPFiles_BatchHasXMP. */
+    XMP_FileFormat format;      /* The format of the file, kXMP_UnknownFile if not opened. */
+    XMP_Int32      errorID;     /* Only meaningful if status is kXMPFiles_BatchFailed. */
+    XMP_Uns8       status;      /* One of the kXMPFiles_Batch... values. */
+    XMP_Uns8       pad1, pad2, pad3;
+    #if __cplusplus
+        XMP_BatchFileInfo() : format(kXMP_UnknownFile), errorID(0), status(kXMPFiles_BatchNotOpened),
+                              pad1(0), pad2(0), pad3(0) {};
+    #endif
+};
+#if ! __cplusplus
+    typedef struct XMP_BatchFileInfo XMP_BatchFileInfo;
+#endif
+enum { kXMP_BatchFileInfoVersion = 1 };
+
+/* ---------------------------------------------------------------------------------------------- */
+
+enum {  /* Options for TXMPFiles::SetIndexCache. */
+    kXMPFiles_IndexCacheXMPTree = 0x00000001  /* Also cache the processed XMP, GetXMP need not parse or reconcile. */
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+enum {  /* Options for TXMPFiles::SetPerfCounters. */
+    kXMPFiles_PerfCountersOn    = 0x00000001, /* Gather timings and I/O counts, off by default. */
+    kXMPFiles_PerfCountersReset = 0x00000002  /* Clear everything gathered so far. */
+};
+
+enum {  /* Indices for XMP_PerfCounters.api, the public XMPFiles calls. */
+    kXMPFiles_PerfAPI_OpenFile     = 0,
+    kXMPFiles_PerfAPI_CloseFile    = 1,
+    kXMPFiles_PerfAPI_GetXMP       = 2,
+    kXMPFiles_PerfAPI_GetThumbnail = 3,
+    kXMPFiles_PerfAPI_PutXMP       = 4,
+    kXMPFiles_PerfAPI_CanPutXMP    = 5,
+    kXMPFiles_PerfAPICount         = 6
+};
+
+enum {  /* Indices for XMP_PerfCounters.phase, the internal steps of the API calls. */
+    kXMPFiles_PerfPhase_CheckFormat   = 0, /* The handlers' CheckFormat procs, in OpenFile. */
+    kXMPFiles_PerfPhase_CacheFileData = 1, /* Locating and reading the XMP, in OpenFile. */
+    kXMPFiles_PerfPhase_ProcessXMP    = 2, /* Parsing the XMP and reconciling it with legacy metadata. */
+    kXMPFiles_PerfPhase_Reconcile     = 3, /* Just the legacy reconciliation, nested within ProcessXMP or PutXMP. */
+    kXMPFiles_PerfPhase_Serialize     = 4, /* Serializing the XMP, in PutXMP or CloseFile. */
+    kXMPFiles_PerfPhase_UpdateFile    = 5, /* The handler's UpdateFile or WriteFile, in CloseFile. */
+    kXMPFiles_PerfPhase_SafeSaveCopy  = 6, /* Temp file creation and copying for kXMPFiles_UpdateSafely. */
+    kXMPFiles_PerfPhaseCount          = 7
+};
+
+/* Latency histograms use power of 2 buckets of microseconds. Bucket 0 counts times under 1us,  */
+/* bucket i counts times from 2^(i-1) up to 2^i us. The last bucket also counts all longer times. */
+enum { kXMPFiles_PerfBucketCount = 24 };
+
+enum { kXMPFiles_PerfTotals = 0 };  /* Format for TXMPFiles::GetPerfCounters to get the totals for all handlers. */
+
+struct XMP_PerfTiming {
+    XMP_Uns64 callCount;
+    XMP_Uns64 totalMicroseconds;
+    XMP_Uns64 maxMicroseconds;
+    XMP_Uns64 buckets [kXMPFiles_PerfBucketCount];
+};
+#if ! __cplusplus
+    typedef struct XMP_PerfTiming XMP_PerfTiming;
+#endif
+
+struct XMP_PerfCounters {
+    XMP_PerfTiming api [kXMPFiles_PerfAPICount];
+    XMP_PerfTiming phase [kXMPFiles_PerfPhaseCount];
+    XMP_Uns64 readCalls;     /* The I/O counts are for the file I/O layer, each call is roughly one system call. */
+    XMP_Uns64 bytesRead;
+    XMP_Uns64 writeCalls;
+    XMP_Uns64 bytesWritten;
+    XMP_Uns64 seekCalls;
+    XMP_Uns64 otherCalls;    /* Open, close, truncate, and so on. */
+};
+#if ! __cplusplus
+    typedef struct XMP_PerfCounters XMP_PerfCounters;
+#endif
+enum { kXMP_PerfCountersVersion = 1 };
+
 /* ============================================================================================== */
 /* Exception codes */
 /* =============== */
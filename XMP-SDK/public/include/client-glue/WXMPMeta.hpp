@@ -66,6 +66,9 @@ extern "C" {
 #define zXMPMeta_GetProperty_1(schemaNS,propName,propValue,valueSize,options) \
     WXMPMeta_GetProperty_1 ( this->xmpRef, schemaNS, propName, propValue, valueSize, options, &wResult )
 
+#define zXMPMeta_GetPropertyBatch_1(propCount,schemaNS,propNames,propInfo,valueArena,arenaSize) \
+    WXMPMeta_GetPropertyBatch_1 ( this->xmpRef, propCount, schemaNS, propNames, propInfo, valueArena, arenaSize, &wResult )
+
 #define zXMPMeta_GetArrayItem_1(schemaNS,arrayName,itemIndex,itemValue,valueSize,options) \
     WXMPMeta_GetArrayItem_1 ( this->xmpRef, schemaNS, arrayName, itemIndex, itemValue, valueSize, options, &wResult )
 
@@ -174,9 +177,21 @@ extern "C" {
 #define zXMPMeta_ParseFromBuffer_1(buffer,bufferSize,options) \
     WXMPMeta_ParseFromBuffer_1 ( this->xmpRef, buffer, bufferSize, options, &wResult )
 
+#define zXMPMeta_SetParseFilter_1(filterMode,schemaList,schemaCount) \
+    WXMPMeta_SetParseFilter_1 ( this->xmpRef, filterMode, schemaList, schemaCount, &wResult )
+
+#define zXMPMeta_ParseMany_1(packetCount,packets,packetLens,options,maxThreads,xmpRefs,errorIDs) \
+    WXMPMeta_ParseMany_1 ( packetCount, packets, packetLens, options, maxThreads, xmpRefs, errorIDs, &wResult )
+
 #define zXMPMeta_SerializeToBuffer_1(pktString,pktSize,options,padding,newline,indent,baseIndent) \
     WXMPMeta_SerializeToBuffer_1 ( this->xmpRef, pktString, pktSize, options, padding, newline, indent, baseIndent, &wResult )
 
+#define zXMPMeta_SerializeToSnapshot_1(snapshot,snapshotSize) \
+    WXMPMeta_SerializeToSnapshot_1 ( this->xmpRef, snapshot, snapshotSize, &wResult )
+
+#define zXMPMeta_LoadFromSnapshot_1(snapshot,snapshotSize) \
+    WXMPMeta_LoadFromSnapshot_1 ( this->xmpRef, snapshot, snapshotSize, &wResult )
+
 // =================================================================================================
 
 extern void
@@ -293,6 +308,16 @@ WXMPMeta_GetProperty_1 ( XMPMetaRef       xmpRef,
                          XMP_OptionBits * options,
                          WXMP_Result *    wResult ) /* const */ ;
 
+extern void
+WXMPMeta_GetPropertyBatch_1 ( XMPMetaRef              xmpRef,
+                              XMP_Index               propCount,
+                              const XMP_StringPtr *   schemaNS,
+                              const XMP_StringPtr *   propNames,
+                              XMP_PropertyBatchInfo * propInfo,
+                              XMP_StringPtr *         valueArena,
+                              XMP_StringLen *         arenaSize,
+                              WXMP_Result *           wResult ) /* const */ ;
+
 extern void
 WXMPMeta_GetArrayItem_1 ( XMPMetaRef       xmpRef,
                           XMP_StringPtr    schemaNS,
@@ -590,6 +615,23 @@ WXMPMeta_ParseFromBuffer_1 ( XMPMetaRef     xmpRef,
                              XMP_OptionBits options,
                              WXMP_Result *  wResult );
 
+extern void
+WXMPMeta_SetParseFilter_1 ( XMPMetaRef            xmpRef,
+                            XMP_OptionBits        filterMode,
+                            const XMP_StringPtr * schemaList,
+                            XMP_Index             schemaCount,
+                            WXMP_Result *         wResult );
+
+extern void
+WXMPMeta_ParseMany_1 ( XMP_Int32             packetCount,
+                       const XMP_StringPtr * packets,
+                       const XMP_StringLen * packetLens,
+                       XMP_OptionBits        options,
+                       XMP_Int32             maxThreads,
+                       XMPMetaRef *          xmpRefs,
+                       XMP_Int32 *           errorIDs,
+                       WXMP_Result *         wResult );
+
 extern void
 WXMPMeta_SerializeToBuffer_1 ( XMPMetaRef      xmpRef,
                                XMP_StringPtr * pktString,
@@ -601,6 +643,18 @@ WXMPMeta_SerializeToBuffer_1 ( XMPMetaRef      xmpRef,
                                XMP_Index       baseIndent,
                                WXMP_Result *   wResult ) /* const */ ;
 
+extern void
+WXMPMeta_SerializeToSnapshot_1 ( XMPMetaRef      xmpRef,
+                                 XMP_StringPtr * snapshot,
+                                 XMP_StringLen * snapshotSize,
+                                 WXMP_Result *   wResult ) /* const */ ;
+
+extern void
+WXMPMeta_LoadFromSnapshot_1 ( XMPMetaRef    xmpRef,
+                              XMP_StringPtr snapshot,
+                              XMP_StringLen snapshotSize,
+                              WXMP_Result * wResult );
+
 // =================================================================================================
 
 #if __cplusplus
@@ -0,0 +1,575 @@
+// =================================================================================================
+// Copyright 2002-2007 Adobe Systems Incorporated
+// All Rights Reserved.
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+// =================================================================================================
+
+// =================================================================================================
+// XMPBenchmark - Time the main XMPCore and XMPFiles operations, writing the results as CSV so that
+// runs can be compared to catch performance regressions.
+//
+//   XMPBenchmark [-o results.csv] [-r samples] [-c copies] <BlueSquares folder> <corpus folder>
+//
+// The XMPCore benchmarks use synthetic packets of growing size: parse, parse with kXMP_ParseFastXML,
+// parse keeping only the dc: schema, serialize, get and set, iterate, clone, and AppendProperties.
+// The XMPFiles benchmarks first fill the corpus folder, which must exist, with copies of the
+// BlueSquare sample files. Half of the copies get a much larger XMP packet. Then each copy is opened
+// for read with GetXMP, and opened for update with PutXMP. The copies are overwritten on every run.
+//
+// Each benchmark is run for a number of samples, the times are per operation in microseconds. The
+// size column is the serialized packet length for XMPCore, the sample file length for XMPFiles. The
+// file benchmarks also report the I/O per operation, from SXMPFiles::GetPerfCounters.
+// =================================================================================================
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if WIN_ENV
+	#include <Windows.h>
+#else
+	#include <sys/time.h>
+#endif
+
+#define TXMP_STRING_TYPE std::string
+#define XMP_INCLUDE_XMPFILES 1
+#include "XMP.hpp"
+#include "XMP.incl_cpp"
+
+using namespace std;
+
+#if WIN_ENV
+	#pragma warning ( disable : 4996 )	// '...' was declared deprecated
+#endif
+
+// -------------------------------------------------------------------------------------------------
+
+static FILE * sResults = 0;
+static int    sSampleCount = 7;
+static int    sCopyCount   = 10;
+
+static const char * kBenchNS = "http://ns.adobe.com/xmp/benchmark/1.0/";
+
+static const size_t kPacketSizes[] = { 10, 100, 1000, 10000, 0 };	// Number of top level properties.
+
+static const char * kCorpusFormats[] = { "jpg", "tif", "png", "psd", "wav", "avi", "mp3", "eps", "indd", 0 };
+
+// -------------------------------------------------------------------------------------------------
+
+static double NowMicroseconds()
+{
+
+	#if WIN_ENV
+		LARGE_INTEGER frequency, now;
+		QueryPerformanceFrequency ( &frequency );
+		QueryPerformanceCounter ( &now );
+		return (double)now.QuadPart * 1000000.0 / (double)frequency.QuadPart;
+	#else
+		struct timeval tod;
+		gettimeofday ( &tod, 0 );
+		return ((double)tod.tv_sec * 1000000.0) + (double)tod.tv_usec;
+	#endif
+
+}	// NowMicroseconds
+
+// -------------------------------------------------------------------------------------------------
+// Timing support
+// --------------
+//
+// A benchmark proc does one operation on its data. It is run in batches, the batch size is picked
+// so that a sample takes at least kMinSampleTime. The min, median, and mean are over the samples.
+
+struct BenchData;
+typedef void (* BenchProc) ( BenchData * data );
+
+static const double kMinSampleTime = 20*1000.0;	// Microseconds.
+
+struct BenchStats {
+	size_t opsPerSample;
+	double minTime, medianTime, meanTime;	// Microseconds per operation.
+	BenchStats() : opsPerSample(0), minTime(0.0), medianTime(0.0), meanTime(0.0) {};
+};
+
+static void ComputeStats ( vector<double> & times, BenchStats * stats )
+{
+	sort ( times.begin(), times.end() );
+	stats->minTime = times.front();
+	stats->medianTime = times [times.size() / 2];
+	stats->meanTime = 0.0;
+	for ( size_t i = 0; i < times.size(); ++i ) stats->meanTime += times[i];
+	stats->meanTime /= times.size();
+
+}	// ComputeStats
+
+static void TimeBenchmark ( BenchProc proc, BenchData * data, BenchStats * stats )
+{
+	size_t batch = 1;
+
+	while ( true ) {	// Find a batch size that takes long enough to time.
+		double start = NowMicroseconds();
+		for ( size_t i = 0; i < batch; ++i ) proc ( data );
+		double elapsed = NowMicroseconds() - start;
+		if ( (elapsed >= kMinSampleTime) || (batch >= 1000*1000) ) break;
+		batch *= ((elapsed < kMinSampleTime/10) ? 10 : 2);
+	}
+
+	vector<double> times;
+	for ( int sample = 0; sample < sSampleCount; ++sample ) {
+		double start = NowMicroseconds();
+		for ( size_t i = 0; i < batch; ++i ) proc ( data );
+		times.push_back ( (NowMicroseconds() - start) / batch );
+	}
+
+	stats->opsPerSample = batch;
+	ComputeStats ( times, stats );
+
+}	// TimeBenchmark
+
+// -------------------------------------------------------------------------------------------------
+
+struct IOStats {
+	double readCalls, bytesRead, writeCalls, bytesWritten;	// Per operation.
+	IOStats() : readCalls(0.0), bytesRead(0.0), writeCalls(0.0), bytesWritten(0.0) {};
+};
+
+static void WriteResultHeader()
+{
+	fprintf ( sResults, "suite,benchmark,variant,size,ops,min_us,median_us,mean_us,"
+						"reads_per_op,bytes_read_per_op,writes_per_op,bytes_written_per_op\n" );
+}
+
+static void WriteResult ( const char * suite, const char * benchmark, const char * variant, size_t size,
+						  const BenchStats & stats, const IOStats & io = IOStats() )
+{
+	fprintf ( sResults, "%s,%s,%s,%lu,%lu,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%.1f\n",
+			  suite, benchmark, variant, (unsigned long)size, (unsigned long)stats.opsPerSample,
+			  stats.minTime, stats.medianTime, stats.meanTime,
+			  io.readCalls, io.bytesRead, io.writeCalls, io.bytesWritten );
+	fflush ( sResults );
+}
+
+// =================================================================================================
+// XMPCore benchmarks
+// ==================
+
+struct BenchData {
+	SXMPMeta       meta;
+	std::string    packet;
+	vector<string> propNames;
+	size_t         counter;
+	BenchData() : counter(0) {};
+};
+
+// -------------------------------------------------------------------------------------------------
+// MakeSyntheticXMP
+// ----------------
+//
+// Fill an XMP object with propCount top level properties in a private namespace. Most are simple,
+// every 10th is an ordered array of 3 items, every 10th offset by 5 is a struct with 2 fields. A
+// few standard properties are added so the packet looks like real metadata.
+
+static void MakeSyntheticXMP ( size_t propCount, BenchData * data )
+{
+	char name [32], value [64];
+
+	data->meta = SXMPMeta();
+	data->propNames.clear();
+
+	data->meta.SetProperty ( kXMP_NS_XMP, "CreatorTool", "XMPBenchmark" );
+	data->meta.SetLocalizedText ( kXMP_NS_DC, "title", "", "x-default", "Synthetic benchmark packet" );
+	data->meta.AppendArrayItem ( kXMP_NS_DC, "subject", kXMP_PropArrayIsUnordered, "benchmark" );
+
+	for ( size_t i = 0; i < propCount; ++i ) {
+
+		if ( (i % 10) == 0 ) {
+			sprintf ( name, "List%lu", (unsigned long)i );
+			for ( int item = 1; item <= 3; ++item ) {
+				sprintf ( value, "Item %d of list %lu", item, (unsigned long)i );
+				data->meta.AppendArrayItem ( kBenchNS, name, kXMP_PropArrayIsOrdered, value );
+			}
+		} else if ( (i % 10) == 5 ) {
+			sprintf ( name, "Struct%lu", (unsigned long)i );
+			sprintf ( value, "First field of %lu", (unsigned long)i );
+			data->meta.SetStructField ( kBenchNS, name, kBenchNS, "First", value );
+			sprintf ( value, "Second field of %lu", (unsigned long)i );
+			data->meta.SetStructField ( kBenchNS, name, kBenchNS, "Second", value );
+		} else {
+			sprintf ( name, "Prop%lu", (unsigned long)i );
+			sprintf ( value, "Value of simple property %lu", (unsigned long)i );
+			data->meta.SetProperty ( kBenchNS, name, value );
+			data->propNames.push_back ( name );
+		}
+
+	}
+
+	data->meta.SerializeToBuffer ( &data->packet, kXMP_UseCompactFormat );
+
+}	// MakeSyntheticXMP
+
+// -------------------------------------------------------------------------------------------------
+
+static void BenchParse ( BenchData * data )
+{
+	SXMPMeta meta;
+	meta.ParseFromBuffer ( data->packet.c_str(), data->packet.size() );
+}
+
+static void BenchParseFast ( BenchData * data )
+{
+	SXMPMeta meta;
+	meta.ParseFromBuffer ( data->packet.c_str(), data->packet.size(), kXMP_ParseFastXML );
+}
+
+static void BenchParseFiltered ( BenchData * data )	// Keep only dc:, skip the benchmark schema.
+{
+	static const XMP_StringPtr kKeepSchemas[] = { kXMP_NS_DC };
+	SXMPMeta meta;
+	meta.SetParseFilter ( kXMP_ParseOnlySchemas, kKeepSchemas, 1 );
+	meta.ParseFromBuffer ( data->packet.c_str(), data->packet.size() );
+}
+
+static void BenchSerialize ( BenchData * data )
+{
+	std::string packet;
+	data->meta.SerializeToBuffer ( &packet, kXMP_UseCompactFormat );
+}
+
+static void BenchGetSet ( BenchData * data )	// One get and one set of each simple property.
+{
+	std::string value;
+	for ( size_t i = 0; i < data->propNames.size(); ++i ) {
+		const char * name = data->propNames[i].c_str();
+		data->meta.GetProperty ( kBenchNS, name, &value, 0 );
+		value[0] = ((data->counter & 1) ? 'V' : 'v');
+		data->meta.SetProperty ( kBenchNS, name, value.c_str() );
+	}
+	++data->counter;
+}
+
+static void BenchIterate ( BenchData * data )
+{
+	SXMPIterator iter ( data->meta );
+	std::string schemaNS, propPath, propValue;
+	while ( iter.Next ( &schemaNS, &propPath, &propValue ) ) {}
+}
+
+static void BenchClone ( BenchData * data )
+{
+	SXMPMeta copy = data->meta.Clone();
+}
+
+static void BenchAppend ( BenchData * data )
+{
+	SXMPMeta dest;
+	SXMPUtils::AppendProperties ( data->meta, &dest, kXMPUtil_DoAllProperties );
+}
+
+// -------------------------------------------------------------------------------------------------
+
+static void RunCoreBenchmarks()
+{
+	struct { const char * name; BenchProc proc; } kCoreBenchmarks[] =
+		{ { "parse", BenchParse }, { "parse-fastxml", BenchParseFast }, { "parse-filtered", BenchParseFiltered },
+		  { "serialize", BenchSerialize }, { "getset", BenchGetSet }, { "iterate", BenchIterate },
+		  { "clone", BenchClone }, { "append", BenchAppend }, { 0, 0 } };
+
+	BenchData data;
+
+	for ( size_t s = 0; kPacketSizes[s] != 0; ++s ) {
+
+		MakeSyntheticXMP ( kPacketSizes[s], &data );
+
+		char variant [32];
+		sprintf ( variant, "%lu-props", (unsigned long)kPacketSizes[s] );
+
+		for ( size_t b = 0; kCoreBenchmarks[b].name != 0; ++b ) {
+			BenchStats stats;
+			TimeBenchmark ( kCoreBenchmarks[b].proc, &data, &stats );
+			WriteResult ( "core", kCoreBenchmarks[b].name, variant, data.packet.size(), stats );
+		}
+
+	}
+
+}	// RunCoreBenchmarks
+
+// =================================================================================================
+// XMPFiles benchmarks
+// ===================
+
+static bool CopyFile ( const string & sourcePath, const string & destPath, size_t * fileSize )
+{
+	FILE * source = fopen ( sourcePath.c_str(), "rb" );
+	if ( source == 0 ) return false;
+	FILE * dest = fopen ( destPath.c_str(), "wb" );
+	if ( dest == 0 ) {
+		fclose ( source );
+		return false;
+	}
+
+	char   buffer [64*1024];
+	size_t count;
+	*fileSize = 0;
+
+	while ( (count = fread ( buffer, 1, sizeof(buffer), source )) > 0 ) {
+		fwrite ( buffer, 1, count, dest );
+		*fileSize += count;
+	}
+
+	fclose ( source );
+	fclose ( dest );
+	return true;
+
+}	// CopyFile
+
+// -------------------------------------------------------------------------------------------------
+// MakeCorpus
+// ----------
+//
+// Copy the sample for one format into the corpus folder, then add a large packet to the second
+// half of the copies, unless the format can't take it. Returns the paths of the copies of each
+// variant and the sample's file size.
+
+static bool MakeCorpus ( const string & sampleFolder, const string & corpusFolder, const char * ext,
+						 vector<string> * smallPaths, vector<string> * largePaths, size_t * fileSize )
+{
+	string samplePath = sampleFolder + "/BlueSquare." + ext;
+	char   copyName [64];
+
+	smallPaths->clear();
+	largePaths->clear();
+
+	for ( int i = 0; i < sCopyCount; ++i ) {
+		sprintf ( copyName, "/BlueSquare-%03d.%s", i, ext );
+		string copyPath = corpusFolder + copyName;
+		if ( ! CopyFile ( samplePath, copyPath, fileSize ) ) return false;
+		if ( i < (sCopyCount / 2) ) {
+			smallPaths->push_back ( copyPath );
+		} else {
+			largePaths->push_back ( copyPath );
+		}
+	}
+
+	BenchData synthetic;
+	MakeSyntheticXMP ( 1000, &synthetic );
+
+	for ( size_t i = 0; i < largePaths->size(); ++i ) {
+		SXMPFiles file;
+		SXMPMeta  meta;
+		if ( ! file.OpenFile ( (*largePaths)[i], kXMP_UnknownFile, kXMPFiles_OpenForUpdate ) ) return false;
+		file.GetXMP ( &meta );
+		SXMPUtils::AppendProperties ( synthetic.meta, &meta, kXMPUtil_DoAllProperties );
+		if ( ! file.CanPutXMP ( meta ) ) {	// Some formats, like EPS, can only update in place.
+			largePaths->clear();
+			break;
+		}
+		file.PutXMP ( meta );
+		file.CloseFile();
+	}
+
+	return true;
+
+}	// MakeCorpus
+
+// -------------------------------------------------------------------------------------------------
+
+static void ReadOneFile ( const string & filePath )
+{
+	SXMPFiles file;
+	SXMPMeta  meta;
+	if ( ! file.OpenFile ( filePath, kXMP_UnknownFile, kXMPFiles_OpenForRead ) ) {
+		throw XMP_Error ( kXMPErr_BadFileFormat, "OpenFile failed" );
+	}
+	file.GetXMP ( &meta );
+	file.CloseFile();
+}
+
+static void UpdateOneFile ( const string & filePath, size_t counter )
+{
+	SXMPFiles file;
+	SXMPMeta  meta;
+	char      value [32];
+	if ( ! file.OpenFile ( filePath, kXMP_UnknownFile, kXMPFiles_OpenForUpdate ) ) {
+		throw XMP_Error ( kXMPErr_BadFileFormat, "OpenFile failed" );
+	}
+	file.GetXMP ( &meta );
+	sprintf ( value, "Update %08lu", (unsigned long)counter );	// Same length every time.
+	meta.SetProperty ( kBenchNS, "UpdateCount", value );
+	file.PutXMP ( meta );
+	file.CloseFile();
+}
+
+// -------------------------------------------------------------------------------------------------
+// TimeFileBenchmark
+// -----------------
+//
+// Each sample reads or updates every file in the list once, the stats are per file. The I/O counts
+// are over all of the samples.
+
+static void TimeFileBenchmark ( const vector<string> & paths, bool forUpdate, BenchStats * stats, IOStats * io )
+{
+	vector<double> times;
+	static size_t counter = 0;
+
+	SXMPFiles::SetPerfCounters ( kXMPFiles_PerfCountersOn | kXMPFiles_PerfCountersReset );
+
+	for ( int sample = 0; sample < sSampleCount; ++sample ) {
+		double start = NowMicroseconds();
+		for ( size_t i = 0; i < paths.size(); ++i ) {
+			if ( forUpdate ) {
+				UpdateOneFile ( paths[i], ++counter );
+			} else {
+				ReadOneFile ( paths[i] );
+			}
+		}
+		times.push_back ( (NowMicroseconds() - start) / paths.size() );
+	}
+
+	XMP_PerfCounters counters;
+	SXMPFiles::GetPerfCounters ( kXMPFiles_PerfTotals, &counters );
+	SXMPFiles::SetPerfCounters ( 0 );
+
+	double opCount = (double)paths.size() * sSampleCount;
+	io->readCalls    = counters.readCalls / opCount;
+	io->bytesRead    = counters.bytesRead / opCount;
+	io->writeCalls   = counters.writeCalls / opCount;
+	io->bytesWritten = counters.bytesWritten / opCount;
+
+	stats->opsPerSample = paths.size();
+	ComputeStats ( times, stats );
+
+}	// TimeFileBenchmark
+
+// -------------------------------------------------------------------------------------------------
+
+static void RunFileBenchmarks ( const string & sampleFolder, const string & corpusFolder )
+{
+	vector<string> smallPaths, largePaths;
+	size_t fileSize;
+
+	for ( size_t f = 0; kCorpusFormats[f] != 0; ++f ) {
+
+		const char * ext = kCorpusFormats[f];
+		string variant;
+
+		try {
+
+			if ( ! MakeCorpus ( sampleFolder, corpusFolder, ext, &smallPaths, &largePaths, &fileSize ) ) {
+				fprintf ( stderr, "Can't make the %s corpus, skipping it\n", ext );
+				continue;
+			}
+
+			for ( int large = 0; large <= 1; ++large ) {
+
+				const vector<string> & paths = (large ? largePaths : smallPaths);
+				variant = string ( ext ) + (large ? "-large" : "-sample");
+				if ( paths.empty() ) continue;
+
+				BenchStats stats;
+				IOStats io;
+
+				TimeFileBenchmark ( paths, false, &stats, &io );
+				WriteResult ( "files", "read", variant.c_str(), fileSize, stats, io );
+
+				TimeFileBenchmark ( paths, true, &stats, &io );
+				WriteResult ( "files", "update", variant.c_str(), fileSize, stats, io );
+
+			}
+
+		} catch ( XMP_Error & excep ) {
+			SXMPFiles::SetPerfCounters ( 0 );
+			fprintf ( stderr, "Caught XMP_Error %d for %s : %s\n", excep.GetID(), ext, excep.GetErrMsg() );
+		}
+
+	}
+
+}	// RunFileBenchmarks
+
+// -------------------------------------------------------------------------------------------------
+
+static void Usage()
+{
+	fprintf ( stderr, "XMPBenchmark [-o results.csv] [-r samples] [-c copies] <BlueSquares folder> <corpus folder>\n" );
+	fprintf ( stderr, "   The corpus folder must exist, its BlueSquare-* files are overwritten.\n" );
+}
+
+// -------------------------------------------------------------------------------------------------
+
+extern "C" int main ( int argc, const char * argv[] )
+{
+	int result = 0;
+	const char * resultsPath = 0;
+	vector<string> folders;
+
+	for ( int i = 1; i < argc; ++i ) {
+		if ( (strcmp ( argv[i], "-o" ) == 0) && (i+1 < argc) ) {
+			resultsPath = argv[++i];
+		} else if ( (strcmp ( argv[i], "-r" ) == 0) && (i+1 < argc) ) {
+			sSampleCount = atoi ( argv[++i] );
+		} else if ( (strcmp ( argv[i], "-c" ) == 0) && (i+1 < argc) ) {
+			sCopyCount = atoi ( argv[++i] );
+		} else {
+			folders.push_back ( argv[i] );
+		}
+	}
+
+	if ( (folders.size() != 2) || (sSampleCount < 1) || (sCopyCount < 2) ) {
+		Usage();
+		return -1;
+	}
+
+	sResults = stdout;
+	if ( resultsPath != 0 ) {
+		sResults = fopen ( resultsPath, "w" );
+		if ( sResults == 0 ) {
+			fprintf ( stderr, "Can't open %s\n", resultsPath );
+			return -1;
+		}
+	}
+
+	try {
+
+		if ( ! SXMPMeta::Initialize() ) {
+			fprintf ( stderr, "## XMPMeta::Initialize failed!\n" );
+			return -1;
+		}
+		if ( ! SXMPFiles::Initialize() ) {
+			fprintf ( stderr, "## SXMPFiles::Initialize failed!\n" );
+			return -1;
+		}
+
+		XMP_VersionInfo coreVersion, filesVersion;
+		SXMPMeta::GetVersionInfo ( &coreVersion );
+		SXMPFiles::GetVersionInfo ( &filesVersion );
+		fprintf ( stderr, "XMPBenchmark using %s, %s\n", coreVersion.message, filesVersion.message );
+
+		SXMPMeta::RegisterNamespace ( kBenchNS, "bench", 0 );
+
+		WriteResultHeader();
+		RunCoreBenchmarks();
+		RunFileBenchmarks ( folders[0], folders[1] );
+
+	} catch ( XMP_Error & excep ) {
+
+		fprintf ( stderr, "Caught XMP_Error %d : %s\n", excep.GetID(), excep.GetErrMsg() );
+		result = -2;
+
+	} catch ( ... ) {
+
+		fprintf ( stderr, "## Caught unknown exception\n" );
+		result = -3;
+
+	}
+
+	SXMPFiles::Terminate();
+	SXMPMeta::Terminate();
+
+	if ( sResults != stdout ) fclose ( sResults );
+	return result;
+
+}	// main
@@ -267,6 +267,77 @@ static const char * kDateTimeRDF =
 	"  </rdf:Description>"
 	"</rdf:RDF>";
 
+// The packets below are only used to compare kXMP_ParseFastXML with Expat. The fast scanner takes
+// the first four itself, ParseFromBuffer turns the Latin-1 into UTF-8 before it is scanned. The CDATA
+// section makes the scanner fall back to Expat, the last two are errors for both.
+
+static const char * kReferenceRDF =
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kReferenceRDF' xmlns:ns1='ns:test1/'"
+	"                   ns1:AttrProp='&quot;a&quot; &amp; &apos;b&apos; &#x41;&#66;'>"
+	""
+	"    <ns1:Entities>&lt;tag&gt; &amp; &quot;quoted&quot; &apos;single&apos;</ns1:Entities>"
+	"    <ns1:CharRefs>&#x41;&#66;&#x20AC; &#xE9;</ns1:CharRefs>"
+	"    <ns1:UTF8>caf\xC3\xA9 \xE2\x82\xAC \xF0\x9D\x84\x9E</ns1:UTF8>"
+	""
+	"  </rdf:Description>"
+	"</rdf:RDF>";
+
+static const char * kCommentRDF =
+	"<?xpacket begin='\xEF\xBB\xBF' id='W5M0MpCehiHzreSzNTczkc9d'?>"
+	"<!-- Leading comment -->"
+	"<x:xmpmeta xmlns:x='adobe:ns:meta/'>"
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <!-- Comment before the description -->"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kCommentRDF' xmlns:ns1='ns:test1/'>"
+	""
+	"    <ns1:Split>before<!-- comment -->after</ns1:Split>"
+	"    <?other-pi some data?>"
+	"    <ns1:Struct rdf:parseType='Resource'><ns1:Field>value</ns1:Field></ns1:Struct>"
+	"    <ns1:Empty/>"
+	"    <ns1:Resource rdf:resource='http://www.adobe.com/'/>"
+	""
+	"  </rdf:Description>"
+	"</rdf:RDF>"
+	"</x:xmpmeta>"
+	"<?xpacket end='w'?>";
+
+static const char * kDefaultNSRDF =
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kDefaultNSRDF' xmlns='ns:test1/'>"
+	"    <DefaultProp>value</DefaultProp>"
+	"    <Nested xmlns='ns:test2/'>nested value</Nested>"
+	"  </rdf:Description>"
+	"</rdf:RDF>";
+
+static const char * kLatin1RDF =
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kLatin1RDF' xmlns:ns1='ns:test1/'>"
+	"    <ns1:Latin1>caf\xE9 \x80</ns1:Latin1>"
+	"  </rdf:Description>"
+	"</rdf:RDF>";
+
+static const char * kCDataRDF =
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kCDataRDF' xmlns:ns1='ns:test1/'>"
+	"    <ns1:CData><![CDATA[a < b & c]]></ns1:CData>"
+	"  </rdf:Description>"
+	"</rdf:RDF>";
+
+static const char * kMismatchedRDF =
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kMismatchedRDF' xmlns:ns1='ns:test1/'>"
+	"    <ns1:Open>value</ns1:Close>"
+	"  </rdf:Description>"
+	"</rdf:RDF>";
+
+static const char * kUndeclaredRDF =
+	"<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+	"  <rdf:Description rdf:about='Test:XMPCoreCoverage/kUndeclaredRDF'>"
+	"    <ns9:Prop>value</ns9:Prop>"
+	"  </rdf:Description>"
+	"</rdf:RDF>";
+
 // =================================================================================================
 
 #define FoundOrNot(b)	((b) ? "found" : "not found")
@@ -352,6 +423,125 @@ static void VerifyNewlines ( FILE * log, std::string xmp, const char * newline )
 	}
 }
 
+// -------------------------------------------------------------------------------------------------
+// CompareFastXML
+// --------------
+//
+// Parse the same RDF with Expat and with kXMP_ParseFastXML, then check that both serialize the same
+// or both throw the same error. If pieceLen is not 0 the fast parse is fed in pieces of that size.
+
+static void CompareFastXML ( FILE * log, const char * title, const char * rdf, size_t pieceLen = 0 )
+{
+	std::string expatXMP, fastXMP;
+	XMP_Int32   expatError = 0, fastError = 0;
+	size_t      rdfLen = strlen ( rdf );
+
+	try {
+		SXMPMeta meta;
+		meta.ParseFromBuffer ( rdf, rdfLen );
+		meta.SerializeToBuffer ( &expatXMP );
+	} catch ( XMP_Error & excep ) {
+		expatError = excep.GetID();
+	}
+
+	try {
+		SXMPMeta meta;
+		if ( pieceLen == 0 ) {
+			meta.ParseFromBuffer ( rdf, rdfLen, kXMP_ParseFastXML );
+		} else {
+			for ( size_t offset = 0; offset < rdfLen; offset += pieceLen ) {
+				size_t len = ( (rdfLen - offset) < pieceLen ) ? (rdfLen - offset) : pieceLen;
+				meta.ParseFromBuffer ( &rdf[offset], len, (kXMP_ParseFastXML | kXMP_ParseMoreBuffers) );
+			}
+			meta.ParseFromBuffer ( 0, 0, kXMP_ParseFastXML );
+		}
+		meta.SerializeToBuffer ( &fastXMP );
+	} catch ( XMP_Error & excep ) {
+		fastError = excep.GetID();
+	}
+
+	if ( expatError != fastError ) {
+		fprintf ( log, "** %s : Expat error %d, fast XML error %d\n", title, expatError, fastError );
+	} else if ( expatXMP != fastXMP ) {
+		fprintf ( log, "** %s : the serialized XMP differs\n", title );
+		fprintf ( log, "Expat :\n%s\nFast XML :\n%s\n", expatXMP.c_str(), fastXMP.c_str() );
+	} else if ( expatError != 0 ) {
+		fprintf ( log, "%s : same error %d\n", title, expatError );
+	} else {
+		fprintf ( log, "%s : same XMP, %d bytes\n", title, expatXMP.size() );
+	}
+
+}	// CompareFastXML
+
+// -------------------------------------------------------------------------------------------------
+// CompareSnapshot
+// ---------------
+//
+// Parse the RDF, save a snapshot, and load it into another object. Both objects must serialize the
+// same for each of the serialize options, and a snapshot of the loaded object must be identical. A
+// truncated snapshot must throw kXMPErr_BadParse and leave the object it is loaded into unchanged.
+
+static void CompareSnapshot ( FILE * log, const char * title, const char * rdf )
+{
+	static const XMP_OptionBits kSerializeOptions[] =
+		{ 0, kXMP_UseCompactFormat, kXMP_OmitPacketWrapper, (kXMP_UseCompactFormat | kXMP_WriteAliasComments) };
+	static const size_t kOptionCount = sizeof(kSerializeOptions) / sizeof(kSerializeOptions[0]);
+
+	try {
+
+		SXMPMeta origMeta ( rdf, strlen ( rdf ) );
+		std::string snapshot, reloadSnapshot;
+		origMeta.SerializeToSnapshot ( &snapshot );
+
+		SXMPMeta loadMeta;
+		loadMeta.LoadFromSnapshot ( snapshot.data(), snapshot.size() );
+
+		for ( size_t optNum = 0; optNum < kOptionCount; ++optNum ) {
+			std::string origXMP, loadXMP;
+			origMeta.SerializeToBuffer ( &origXMP, kSerializeOptions[optNum] );
+			loadMeta.SerializeToBuffer ( &loadXMP, kSerializeOptions[optNum] );
+			if ( origXMP != loadXMP ) {
+				fprintf ( log, "** %s : the serialized XMP differs, options %.8X\n", title, kSerializeOptions[optNum] );
+				fprintf ( log, "Parsed :\n%s\nLoaded :\n%s\n", origXMP.c_str(), loadXMP.c_str() );
+				return;
+			}
+		}
+
+		loadMeta.SerializeToSnapshot ( &reloadSnapshot );
+		if ( reloadSnapshot != snapshot ) {
+			fprintf ( log, "** %s : the snapshot of the loaded object differs\n", title );
+			return;
+		}
+
+		std::string beforeXMP, afterXMP;
+		loadMeta.SerializeToBuffer ( &beforeXMP );
+		const size_t truncLens[] = { 0, 8, snapshot.size() / 2, snapshot.size() - 1 };
+		for ( size_t truncNum = 0; truncNum < sizeof(truncLens)/sizeof(truncLens[0]); ++truncNum ) {
+			try {
+				loadMeta.LoadFromSnapshot ( snapshot.data(), truncLens[truncNum] );
+				fprintf ( log, "** %s : a snapshot truncated to %d bytes was accepted\n", title, truncLens[truncNum] );
+				return;
+			} catch ( XMP_Error & excep ) {
+				if ( excep.GetID() != kXMPErr_BadParse ) {
+					fprintf ( log, "** %s : a snapshot truncated to %d bytes threw error %d\n", title, truncLens[truncNum], excep.GetID() );
+					return;
+				}
+			}
+		}
+		loadMeta.SerializeToBuffer ( &afterXMP );
+		if ( afterXMP != beforeXMP ) {
+			fprintf ( log, "** %s : a rejected snapshot changed the object\n", title );
+			return;
+		}
+
+		fprintf ( log, "%s : same XMP, %d byte snapshot\n", title, snapshot.size() );
+
+	} catch ( XMP_Error & excep ) {
+		fprintf ( log, "** %s : caught error %d, %s\n", title, excep.GetID(), excep.GetErrMsg() );
+	}
+
+}	// CompareSnapshot
+
 // =================================================================================================
 
 static void DoXMPCoreCoverage ( FILE * log )
@@ -1900,6 +2090,60 @@ static void DoXMPCoreCoverage ( FILE * log )
 
 	// --------------------------------------------------------------------------------------------
 
+	{
+		WriteMajorLabel ( log, "Test kXMP_ParseFastXML against Expat" );
+		fprintf ( log, "\n" );
+
+		CompareFastXML ( log, "kRDFCoverage", kRDFCoverage );
+		CompareFastXML ( log, "kSimpleRDF", kSimpleRDF );
+		CompareFastXML ( log, "kSimpleRDF in 10 byte pieces", kSimpleRDF, 10 );
+		CompareFastXML ( log, "kNamespaceRDF", kNamespaceRDF );
+		CompareFastXML ( log, "kXMPMetaRDF", kXMPMetaRDF );
+		CompareFastXML ( log, "kNewlineRDF", kNewlineRDF );
+		CompareFastXML ( log, "kInconsistentRDF", kInconsistentRDF );
+		CompareFastXML ( log, "kDateTimeRDF", kDateTimeRDF );
+		CompareFastXML ( log, "kReferenceRDF", kReferenceRDF );
+		CompareFastXML ( log, "kReferenceRDF in 1 byte pieces", kReferenceRDF, 1 );
+		CompareFastXML ( log, "kCommentRDF", kCommentRDF );
+		CompareFastXML ( log, "kDefaultNSRDF", kDefaultNSRDF );
+		CompareFastXML ( log, "kLatin1RDF", kLatin1RDF );
+		CompareFastXML ( log, "kCDataRDF", kCDataRDF );
+		CompareFastXML ( log, "kMismatchedRDF", kMismatchedRDF );
+		CompareFastXML ( log, "kUndeclaredRDF", kUndeclaredRDF );
+
+		std::string manyAttrs ( "<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>"
+								"<rdf:Description rdf:about='' xmlns:ns1='ns:test1/'" );
+		for ( int attr = 0; attr < 40; ++attr ) {
+			char attrStr [64];
+			sprintf ( attrStr, " ns1:Attr%d='Value %d'", attr, attr );
+			manyAttrs += attrStr;
+		}
+		CompareFastXML ( log, "40 attributes", (manyAttrs + "/></rdf:RDF>").c_str() );
+		CompareFastXML ( log, "40 attributes and a repeat", (manyAttrs + " ns1:Attr7='Again'/></rdf:RDF>").c_str() );
+		CompareFastXML ( log, "40 attributes and about", (manyAttrs + " about=''/></rdf:RDF>").c_str() );
+
+	}
+
+	// --------------------------------------------------------------------------------------------
+
+	{
+		WriteMajorLabel ( log, "Test SerializeToSnapshot and LoadFromSnapshot" );
+		fprintf ( log, "\n" );
+
+		CompareSnapshot ( log, "kRDFCoverage", kRDFCoverage );
+		CompareSnapshot ( log, "kSimpleRDF", kSimpleRDF );
+		CompareSnapshot ( log, "kNamespaceRDF", kNamespaceRDF );
+		CompareSnapshot ( log, "kXMPMetaRDF", kXMPMetaRDF );
+		CompareSnapshot ( log, "kNewlineRDF", kNewlineRDF );
+		CompareSnapshot ( log, "kDateTimeRDF", kDateTimeRDF );
+		CompareSnapshot ( log, "kReferenceRDF", kReferenceRDF );
+		CompareSnapshot ( log, "kCommentRDF", kCommentRDF );
+		CompareSnapshot ( log, "kLatin1RDF", kLatin1RDF );
+
+	}
+
+	// --------------------------------------------------------------------------------------------
+
 	WriteMajorLabel ( log, "XMPCoreCoverage done" );
 	fprintf ( log, "\n" );
 
@@ -48,7 +48,7 @@ static void DefaultHandler               ( void * userData, XMP_StringPtr data,
 // =================================================================================================
 // =================================================================================================
 
-ExpatAdapter::ExpatAdapter() : parser(0), nesting(0)
+ExpatAdapter::ExpatAdapter() : parser(0), nesting(0), lastNamespace(0)
 {
 
 	#if XMP_DebugBuild & DumpXMLParseEvents
@@ -87,10 +87,6 @@ ExpatAdapter::~ExpatAdapter()
 
 // =================================================================================================
 
-#if XMP_DebugBuild
-	static XMP_VarString sExpatMessage;
-#endif
-
 static const char * kOneSpace = " ";
 
 void ExpatAdapter::ParseBuffer ( const void * buffer, size_t length, bool last )
@@ -109,10 +105,12 @@ void ExpatAdapter::ParseBuffer ( const void * buffer, size_t length, bool last )
 	
 		XMP_StringPtr errMsg = "XML parsing failure";
 
-		#if 0	// XMP_DebugBuild	// Disable for now to make test output uniform. Restore later with thread safety.
+		#if XMP_DebugBuild & DumpXMLParseEvents
 		
 			// *** This is a good candidate for a callback error notification mechanism.
-			// *** This code is not thread safe, the sExpatMessage isn't locked. But that's OK for debug usage.
+			// The Expat details only go to the parse log. XMP_Error keeps just the message pointer and
+			// the adapter is gone when the exception is caught, so the thrown message stays constant.
+			// The buffer is local, concurrent parses under ParseMany don't share it.
 
 			enum XML_Error expatErr = XML_GetErrorCode ( this->parser );
 			const char *   expatMsg = XML_ErrorString ( expatErr );
@@ -121,12 +119,7 @@ void ExpatAdapter::ParseBuffer ( const void * buffer, size_t length, bool last )
 			char msgBuffer[1000];
 			// AUDIT: Use of sizeof(msgBuffer) for snprintf length is safe.
 			snprintf ( msgBuffer, sizeof(msgBuffer), "# Expat error %d at line %d, \"%s\"", expatErr, errLine, expatMsg );
-			sExpatMessage = msgBuffer;
-			errMsg = sExpatMessage.c_str();
-
-			#if  DumpXMLParseEvents
-				if ( this->parseLog != 0 ) fprintf ( this->parseLog, "%s\n", errMsg, expatErr, errLine, expatMsg );
-			#endif
+			if ( this->parseLog != 0 ) fprintf ( this->parseLog, "%s\n", msgBuffer );
 
 		#endif
 
@@ -150,7 +143,55 @@ void ExpatAdapter::ParseBuffer ( const void * buffer, size_t length, bool last )
 
 // =================================================================================================
 
-static void SetQualName ( XMP_StringPtr fullName, XML_Node * node )
+// FindNamespace
+// =============
+//
+// Find the namespace info for a URI from an Expat full name. Looking up the registered prefix in the
+// global map for every element and attribute name is costly, so the adapter keeps the namespaces
+// seen in this parse. There are rarely more than a dozen, and consecutive names are usually in the
+// same namespace, so the one found last is checked first.
+
+static const ExpatAdapter::NamespaceInfo &
+FindNamespace ( ExpatAdapter * thiz, XMP_StringPtr uri, size_t uriLen )
+{
+	std::vector<ExpatAdapter::NamespaceInfo> & namespaces = thiz->namespaces;
+	const size_t nsCount = namespaces.size();
+
+	if ( thiz->lastNamespace < nsCount ) {
+		const ExpatAdapter::NamespaceInfo & lastInfo = namespaces[thiz->lastNamespace];
+		if ( (lastInfo.uri.size() == uriLen) && (memcmp ( lastInfo.uri.data(), uri, uriLen ) == 0) ) return lastInfo;
+	}
+
+	for ( size_t nsNum = 0; nsNum < nsCount; ++nsNum ) {
+		const ExpatAdapter::NamespaceInfo & nsInfo = namespaces[nsNum];
+		if ( (nsInfo.uri.size() == uriLen) && (memcmp ( nsInfo.uri.data(), uri, uriLen ) == 0) ) {
+			thiz->lastNamespace = nsNum;
+			return nsInfo;
+		}
+	}
+
+	// Not declared in this parse, e.g. the implicit xml namespace. Look it up once.
+
+	ExpatAdapter::NamespaceInfo newInfo;
+	XMP_StringPtr prefix;
+	XMP_StringLen prefixLen;
+
+	newInfo.uri.assign ( uri, uriLen );
+	newInfo.ns = newInfo.uri;
+	if ( newInfo.ns == "http://purl.org/dc/1.1/" ) newInfo.ns = "http://purl.org/dc/elements/1.1/";
+	bool found = XMPMeta::GetNamespacePrefix ( newInfo.ns.c_str(), &prefix, &prefixLen );
+	if ( ! found ) XMP_Throw ( "Unknown URI in Expat full name", kXMPErr_ExternalFailure );
+	newInfo.prefix.assign ( prefix, prefixLen );
+
+	namespaces.push_back ( newInfo );
+	thiz->lastNamespace = nsCount;
+	return namespaces.back();
+
+}	// FindNamespace
+
+// =================================================================================================
+
+static void SetQualName ( ExpatAdapter * thiz, XMP_StringPtr fullName, XML_Node * node )
 {
 	// Expat delivers the full name as a catenation of namespace URI, separator, and local name.
 
@@ -162,22 +203,20 @@ static void SetQualName ( XMP_StringPtr fullName, XML_Node * node )
 
 	// ! This code presumes the RDF namespace prefix is "rdf".
 
-	size_t sepPos = strlen(fullName);
+	const size_t fullLen = strlen(fullName);
+	size_t sepPos = fullLen;
 	for ( --sepPos; sepPos > 0; --sepPos ) {
 		if ( fullName[sepPos] == FullNameSeparator ) break;
 	}
 
 	if ( fullName[sepPos] == FullNameSeparator ) {
 
-		XMP_StringPtr prefix;
 		XMP_StringPtr localPart = fullName + sepPos + 1;
+		const ExpatAdapter::NamespaceInfo & nsInfo = FindNamespace ( thiz, fullName, sepPos );
 
-		node->ns.assign ( fullName, sepPos );
-		if ( node->ns == "http://purl.org/dc/1.1/" ) node->ns = "http://purl.org/dc/elements/1.1/";
-		bool found = XMPMeta::GetNamespacePrefix ( node->ns.c_str(), &prefix, &voidStringLen );
-		if ( ! found ) XMP_Throw ( "Unknown URI in Expat full name", kXMPErr_ExternalFailure );
-		
-		node->name = prefix;
+		node->ns = nsInfo.ns;
+		node->name.reserve ( nsInfo.prefix.size() + (fullLen - sepPos - 1) );
+		node->name = nsInfo.prefix;
 		node->name += localPart;
 
 	} else {
@@ -202,14 +241,10 @@ static void SetQualName ( XMP_StringPtr fullName, XML_Node * node )
 
 static void StartNamespaceDeclHandler ( void * userData, XMP_StringPtr prefix, XMP_StringPtr uri )
 {
-	IgnoreParam(userData);
+	ExpatAdapter * thiz = (ExpatAdapter*)userData;
 	
 	// As a bug fix hack, change a URI of "http://purl.org/dc/1.1/" to ""http://purl.org/dc/elements/1.1/.
 	// Early versions of Flash that put XMP in SWF used a bad URI for the dc: namespace.
-	
-	#if XMP_DebugBuild & DumpXMLParseEvents		// Avoid unused variable warning.
-		ExpatAdapter * thiz = (ExpatAdapter*)userData;
-	#endif
 
 	if ( prefix == 0 ) prefix = "_dflt_";	// Have default namespace.
 	if ( uri == 0 ) return;	// Ignore, have xmlns:pre="", no URI to register.
@@ -221,8 +256,26 @@ static void StartNamespaceDeclHandler ( void * userData, XMP_StringPtr prefix, X
 		}
 	#endif
 	
+	XMP_StringPtr expatURI = uri;
 	if ( XMP_LitMatch ( uri, "http://purl.org/dc/1.1/" ) ) uri = "http://purl.org/dc/elements/1.1/";
-	(void) XMPMeta::RegisterNamespace ( uri, prefix, &voidStringPtr, &voidStringLen );
+
+	XMP_StringPtr regPrefix;
+	XMP_StringLen regLen;
+	(void) XMPMeta::RegisterNamespace ( uri, prefix, &regPrefix, &regLen );
+
+	// Remember the registered prefix for SetQualName, unless this URI was already seen.
+
+	const size_t uriLen = strlen ( expatURI );
+	for ( size_t nsNum = 0, nsLim = thiz->namespaces.size(); nsNum < nsLim; ++nsNum ) {
+		const XMP_VarString & knownURI = thiz->namespaces[nsNum].uri;
+		if ( (knownURI.size() == uriLen) && (memcmp ( knownURI.data(), expatURI, uriLen ) == 0) ) return;
+	}
+
+	thiz->namespaces.push_back ( ExpatAdapter::NamespaceInfo() );
+	ExpatAdapter::NamespaceInfo & newInfo = thiz->namespaces.back();
+	newInfo.uri.assign ( expatURI, uriLen );
+	newInfo.ns.assign ( uri );
+	newInfo.prefix.assign ( regPrefix, regLen );
 
 }	// StartNamespaceDeclHandler
 
@@ -277,7 +330,7 @@ static void StartElementHandler ( void * userData, XMP_StringPtr name, XMP_Strin
 	XML_Node * parentNode = thiz->parseStack.back();
 	XML_Node * elemNode   = new XML_Node ( parentNode, "", kElemNode );
 	
-	SetQualName ( name, elemNode );
+	SetQualName ( thiz, name, elemNode );
 	
 	for ( XMP_StringPtr* attr = attrs; *attr != 0; attr += 2 ) {
 
@@ -285,7 +338,7 @@ static void StartElementHandler ( void * userData, XMP_StringPtr name, XMP_Strin
 		XMP_StringPtr attrValue = *(attr+1);
 		XML_Node * attrNode = new XML_Node ( elemNode, "", kAttrNode );
 
-		SetQualName ( attrName, attrNode );
+		SetQualName ( thiz, attrName, attrNode );
 		attrNode->value = attrValue;
 		if ( attrNode->name == "xml:lang" ) NormalizeLangValue ( &attrNode->value );
 		elemNode->attrs.push_back ( attrNode );
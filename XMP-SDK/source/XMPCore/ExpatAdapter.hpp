@@ -26,6 +26,15 @@ public:
 	XML_Parser parser;
 	size_t     nesting;
 	
+	struct NamespaceInfo {		// A namespace seen in this parse, see SetQualName.
+		XMP_VarString uri;		// The URI as Expat reports it.
+		XMP_VarString ns;		// The URI for the XML_Node, after the dc: fix.
+		XMP_VarString prefix;	// The registered prefix, including the colon.
+	};
+	
+	std::vector<NamespaceInfo> namespaces;
+	size_t lastNamespace;	// The index of the last one found.
+	
 	ExpatAdapter();
 	virtual ~ExpatAdapter();
 	
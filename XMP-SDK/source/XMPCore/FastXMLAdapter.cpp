@@ -0,0 +1,1014 @@
+// =================================================================================================
+// Copyright 2005-2007 Adobe Systems Incorporated
+// All Rights Reserved.
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+// =================================================================================================
+
+#include "XMP_Environment.h"	// ! Must be the first #include!
+#include "XMPCore_Impl.hpp"
+
+#include "FastXMLAdapter.hpp"
+#include "ExpatAdapter.hpp"
+#include "XMPMeta.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+// =================================================================================================
+// Notes
+// =====
+//
+// Almost all XMP is a narrow subset of XML: UTF-8, no DTD, no entities other than the predefined
+// ones, ASCII element and attribute names. The FastXMLAdapter scans that subset directly from the
+// buffered input and builds the same XML_Node tree as the ExpatAdapter, without Expat's per-event
+// overhead. The registered prefix is kept with each namespace binding.
+//
+// There are two differences in the tree, neither matters to the RDF parser:
+//	- Each text run is one kCDataNode, Expat often splits them at line ends and references.
+//	- Whitespace next to a child element is dropped, the RDF parser ignores it there anyway.
+//
+// Expat has no comment nodes and only keeps xpacket PIs, the text on both sides of a comment or of
+// another PI is one run. The scanner keeps that, so that text mixed with child elements is still
+// seen by the RDF parser the same way.
+//
+// Anything outside the subset makes ScanDocument give up, then the whole input is parsed by an
+// ExpatAdapter and its tree is taken over. That includes all malformed XML, so the checking and the
+// exceptions are exactly Expat's. The things that cause a fallback are:
+//	- Input that is not UTF-8, or an XML declaration with a different encoding.
+//	- UTF-8 that Expat might not accept: ASCII controls, overlong forms, surrogates, U+FFFE/FFFF.
+//	- A DOCTYPE, CDATA section, or entity reference other than amp, lt, gt, quot, and apos.
+//	- Names that are not ASCII, prefixes that are not declared, declarations of xml or xmlns.
+//	- Any syntax error, including mismatched tags, duplicate attributes, or misplaced text.
+//
+// The input is buffered because the XMPMeta::ParseFromBuffer code feeds it in pieces, e.g. around
+// replaced Latin-1 characters. The scan only runs at the last ParseBuffer call, by then all of the
+// input is known and the fallback can replay it.
+
+// =================================================================================================
+
+struct NSBinding {
+	XMP_StringPtr	prefix;		// Points into the input, not terminated.
+	size_t			prefixLen;	// Zero for the default namespace.
+	XMP_VarString	uri;		// Empty if this undeclares the default namespace.
+	XMP_VarString	xmpPrefix;	// The registered prefix for the URI, including the colon.
+};
+
+struct RawName {
+	XMP_StringPtr	start;		// Points into the input, not terminated.
+	size_t			len;
+	size_t			colonPos;	// Offset of the colon, zero if there is none.
+};
+
+struct RawAttr {
+	RawName			name;
+	XMP_VarString	value;
+	bool			isDecl;
+};
+
+struct OpenTag {
+	RawName			name;
+	size_t			bindingCount;	// The size of the bindings vector before this element.
+};
+
+struct AttrKey {
+	bool				hasPrefix;	// Prefixed and unprefixed names never match, see ScanStartTag.
+	const XML_Node *	node;
+	AttrKey ( bool _hasPrefix, const XML_Node * _node ) : hasPrefix(_hasPrefix), node(_node) {};
+};
+
+enum { kMaxPairwiseAttrs = 16 };	// Elements with more attributes are checked by HasDuplicateAttr.
+
+struct ScanState {
+	FastXMLAdapter *		adapter;
+	XMP_StringPtr			pos;
+	XMP_StringPtr			end;
+	bool					rootSeen;
+	std::vector<NSBinding>	bindings;
+	std::vector<OpenTag>	openTags;
+	std::vector<RawAttr>	rawAttrs;	// ! Reused, only the first attrCount are valid.
+	size_t					attrCount;
+	std::vector<AttrKey>	attrKeys;	// ! Reused, for the sorted check of many attributes.
+	XMP_VarString			pendingSpace;	// Whitespace after a child element, see ScanText.
+	ScanState ( FastXMLAdapter * _adapter )
+		: adapter(_adapter), pos(0), end(0), rootSeen(false), attrCount(0) {};
+};
+
+static inline bool IsNameStartChar ( char ch )
+{
+	return ( (('a' <= ch) && (ch <= 'z')) || (('A' <= ch) && (ch <= 'Z')) || (ch == '_') );
+}
+
+static inline bool IsNameChar ( char ch )
+{
+	return ( IsNameStartChar ( ch ) || (('0' <= ch) && (ch <= '9')) || (ch == '-') || (ch == '.') );
+}
+
+static inline bool SkipSpace ( ScanState & state )
+{
+	XMP_StringPtr start = state.pos;
+	while ( (state.pos < state.end) && IsWhitespaceChar ( *state.pos ) ) ++state.pos;
+	return (state.pos != start);
+}
+
+static inline bool MatchLiteral ( const ScanState & state, XMP_StringPtr literal, size_t len )
+{
+	return ( ((size_t)(state.end - state.pos) >= len) && (memcmp ( state.pos, literal, len ) == 0) );
+}
+
+static inline bool SameName ( const RawName & left, const RawName & right )
+{
+	return ( (left.len == right.len) && (memcmp ( left.start, right.start, left.len ) == 0) );
+}
+
+// -------------------------------------------------------------------------------------------------
+// HasDuplicateAttr
+// ----------------
+//
+// Check the keys of an element's attribute nodes for a repeated name. ScanStartTag compares a few
+// attributes pairwise, compact RDF can put thousands of properties on one rdf:Description and then
+// the keys are sorted and neighbors compared.
+
+static bool
+AttrKeyLess ( const AttrKey & left, const AttrKey & right )
+{
+	if ( left.hasPrefix != right.hasPrefix ) return right.hasPrefix;
+	int nameOrder = left.node->name.compare ( right.node->name );
+	if ( nameOrder != 0 ) return (nameOrder < 0);
+	return (left.node->ns < right.node->ns);
+}
+
+static bool
+HasDuplicateAttr ( std::vector<AttrKey> * attrKeys )
+{
+	std::sort ( attrKeys->begin(), attrKeys->end(), AttrKeyLess );
+	for ( size_t i = 1; i < attrKeys->size(); ++i ) {
+		if ( ! AttrKeyLess ( (*attrKeys)[i-1], (*attrKeys)[i] ) ) return true;
+	}
+	return false;
+}
+
+// =================================================================================================
+// IsPlainUTF8
+// ===========
+//
+// Check that the input is UTF-8 that Expat will surely take. The XMPMeta::ParseFromBuffer code has
+// already replaced ASCII controls and bytes that are not part of a UTF-8 sequence, but its UTF-8
+// check is loose. Here the check is strict: shortest form, no surrogates, U+FFFE, U+FFFF, or
+// anything past U+10FFFF. ASCII controls other than tab, LF, and CR are also rejected.
+
+static bool
+IsPlainUTF8 ( const XMP_Uns8 * bytePtr, const XMP_Uns8 * byteEnd )
+{
+
+	while ( bytePtr < byteEnd ) {
+
+		XMP_Uns8 ch = *bytePtr;
+
+		if ( ch < 0x80 ) {
+			if ( (ch < 0x20) && (! IsWhitespaceChar ( ch )) ) return false;
+			if ( ch == 0x7F ) return false;
+			++bytePtr;
+			continue;
+		}
+
+		size_t seqLen;
+		XMP_Uns8 minNext = 0x80, maxNext = 0xBF;	// The range for the second byte.
+
+		if ( (0xC2 <= ch) && (ch <= 0xDF) ) {
+			seqLen = 2;
+		} else if ( (0xE0 <= ch) && (ch <= 0xEF) ) {
+			seqLen = 3;
+			if ( ch == 0xE0 ) minNext = 0xA0;	// No overlong forms.
+			if ( ch == 0xED ) maxNext = 0x9F;	// No surrogates.
+		} else if ( (0xF0 <= ch) && (ch <= 0xF4) ) {
+			seqLen = 4;
+			if ( ch == 0xF0 ) minNext = 0x90;	// No overlong forms.
+			if ( ch == 0xF4 ) maxNext = 0x8F;	// Nothing past U+10FFFF.
+		} else {
+			return false;
+		}
+
+		if ( (size_t)(byteEnd - bytePtr) < seqLen ) return false;
+		if ( (bytePtr[1] < minNext) || (bytePtr[1] > maxNext) ) return false;
+		for ( size_t i = 2; i < seqLen; ++i ) {
+			if ( (bytePtr[i] & 0xC0) != 0x80 ) return false;
+		}
+		if ( (ch == 0xEF) && (bytePtr[1] == 0xBF) && (bytePtr[2] >= 0xBE) ) return false;	// U+FFFE and U+FFFF.
+
+		bytePtr += seqLen;
+
+	}
+
+	return true;
+
+}	// IsPlainUTF8
+
+// =================================================================================================
+// ScanName
+// ========
+//
+// Scan an element, attribute, or PI target name. Only ASCII names with at most one colon, and with
+// a non-empty prefix and local part, are accepted.
+
+static bool
+ScanName ( ScanState & state, RawName * name )
+{
+	XMP_StringPtr start = state.pos;
+
+	if ( (start >= state.end) || (! IsNameStartChar ( *start )) ) return false;
+
+	name->start = start;
+	name->colonPos = 0;
+
+	for ( ++state.pos; state.pos < state.end; ++state.pos ) {
+		char ch = *state.pos;
+		if ( IsNameChar ( ch ) ) continue;
+		if ( ch != ':' ) break;
+		if ( name->colonPos != 0 ) return false;	// A second colon.
+		name->colonPos = state.pos - start;
+		if ( ((state.pos + 1) >= state.end) || (! IsNameStartChar ( state.pos[1] )) ) return false;
+	}
+
+	if ( (state.pos < state.end) && ((unsigned char)*state.pos >= 0x80) ) return false;	// Not ASCII.
+
+	name->len = state.pos - start;
+	return true;
+
+}	// ScanName
+
+// =================================================================================================
+// AppendReference
+// ===============
+//
+// Decode a predefined entity or a character reference, the input position is at the '&'. Returns
+// false for anything else, including a character reference to something that is not an XML Char.
+
+static bool
+AppendReference ( XMP_StringPtr & refPtr, XMP_StringPtr refEnd, XMP_VarString * value )
+{
+	XMP_Assert ( *refPtr == '&' );
+
+	XMP_StringPtr namePtr = refPtr + 1;
+	XMP_StringPtr semiPtr = namePtr;
+	while ( (semiPtr < refEnd) && (*semiPtr != ';') && ((semiPtr - namePtr) < 10) ) ++semiPtr;
+	if ( (semiPtr >= refEnd) || (*semiPtr != ';') ) return false;
+
+	size_t nameLen = semiPtr - namePtr;
+	refPtr = semiPtr + 1;
+
+	if ( *namePtr != '#' ) {
+
+		if ( (nameLen == 3) && (memcmp ( namePtr, "amp", 3 ) == 0) ) {
+			*value += '&';
+		} else if ( (nameLen == 2) && (memcmp ( namePtr, "lt", 2 ) == 0) ) {
+			*value += '<';
+		} else if ( (nameLen == 2) && (memcmp ( namePtr, "gt", 2 ) == 0) ) {
+			*value += '>';
+		} else if ( (nameLen == 4) && (memcmp ( namePtr, "quot", 4 ) == 0) ) {
+			*value += '"';
+		} else if ( (nameLen == 4) && (memcmp ( namePtr, "apos", 4 ) == 0) ) {
+			*value += '\'';
+		} else {
+			return false;
+		}
+
+		return true;
+
+	}
+
+	// A character reference, decimal or hex.
+
+	XMP_Uns32 cp = 0;
+	XMP_StringPtr digitPtr = namePtr + 1;
+	bool isHex = ((digitPtr < semiPtr) && (*digitPtr == 'x'));
+	if ( isHex ) ++digitPtr;
+	if ( digitPtr == semiPtr ) return false;
+
+	for ( ; digitPtr < semiPtr; ++digitPtr ) {
+		char ch = *digitPtr;
+		if ( ('0' <= ch) && (ch <= '9') ) {
+			cp = (cp * (isHex ? 16 : 10)) + (ch - '0');
+		} else if ( isHex && ('a' <= ch) && (ch <= 'f') ) {
+			cp = (cp * 16) + (ch - 'a' + 10);
+		} else if ( isHex && ('A' <= ch) && (ch <= 'F') ) {
+			cp = (cp * 16) + (ch - 'A' + 10);
+		} else {
+			return false;
+		}
+		if ( cp > 0x10FFFF ) return false;
+	}
+
+	if ( cp < 0x20 ) {
+		if ( ! IsWhitespaceChar ( cp ) ) return false;
+	} else if ( ((0xD800 <= cp) && (cp <= 0xDFFF)) || (cp == 0xFFFE) || (cp == 0xFFFF) ) {
+		return false;
+	}
+
+	if ( cp < 0x80 ) {
+		*value += (char)cp;
+	} else if ( cp < 0x800 ) {
+		*value += (char)(0xC0 | (cp >> 6));
+		*value += (char)(0x80 | (cp & 0x3F));
+	} else if ( cp < 0x10000 ) {
+		*value += (char)(0xE0 | (cp >> 12));
+		*value += (char)(0x80 | ((cp >> 6) & 0x3F));
+		*value += (char)(0x80 | (cp & 0x3F));
+	} else {
+		*value += (char)(0xF0 | (cp >> 18));
+		*value += (char)(0x80 | ((cp >> 12) & 0x3F));
+		*value += (char)(0x80 | ((cp >> 6) & 0x3F));
+		*value += (char)(0x80 | (cp & 0x3F));
+	}
+
+	return true;
+
+}	// AppendReference
+
+// =================================================================================================
+// ScanAttrValue
+// =============
+//
+// Scan a quoted attribute value, the input position is at the opening quote. Line ends are
+// normalized, then tab, LF, and CR become spaces, as Expat does for attributes without a DTD.
+
+static bool
+ScanAttrValue ( ScanState & state, XMP_VarString * value )
+{
+	XMP_Assert ( (*state.pos == '"') || (*state.pos == '\'') );
+
+	const char quote = *state.pos;
+	XMP_StringPtr valueStart = state.pos + 1;
+	XMP_StringPtr valueEnd = valueStart;
+	bool isPlain = true;
+
+	for ( ; (valueEnd < state.end) && (*valueEnd != quote); ++valueEnd ) {
+		char ch = *valueEnd;
+		if ( ch == '<' ) return false;
+		if ( (ch == '&') || (ch == '\t') || (ch == '\n') || (ch == '\r') ) isPlain = false;
+	}
+	if ( valueEnd >= state.end ) return false;
+
+	state.pos = valueEnd + 1;
+
+	if ( isPlain ) {
+		value->assign ( valueStart, (valueEnd - valueStart) );
+		return true;
+	}
+
+	value->erase();
+	value->reserve ( valueEnd - valueStart );
+
+	for ( XMP_StringPtr valuePtr = valueStart; valuePtr < valueEnd; ) {
+		char ch = *valuePtr;
+		if ( ch == '&' ) {
+			if ( ! AppendReference ( valuePtr, valueEnd, value ) ) return false;
+		} else if ( IsWhitespaceChar ( ch ) ) {
+			*value += ' ';
+			++valuePtr;
+			if ( (ch == '\r') && (valuePtr < valueEnd) && (*valuePtr == '\n') ) ++valuePtr;
+		} else {
+			*value += ch;
+			++valuePtr;
+		}
+	}
+
+	return true;
+
+}	// ScanAttrValue
+
+// =================================================================================================
+// SetNodeName
+// ===========
+//
+// Set the namespace and name of an element or attribute node the way SetQualName in ExpatAdapter.cpp
+// does, using the in-scope namespace bindings. Returns false for an undeclared prefix.
+
+static bool
+SetNodeName ( ScanState & state, const RawName & rawName, bool isAttr, XML_Node * node )
+{
+	const NSBinding * binding = 0;
+	size_t prefixLen = rawName.colonPos;
+
+	if ( (prefixLen != 0) || (! isAttr) ) {
+		for ( size_t i = state.bindings.size(); i > 0; --i ) {
+			const NSBinding & currBinding = state.bindings[i-1];
+			if ( (currBinding.prefixLen == prefixLen) &&
+				 (memcmp ( currBinding.prefix, rawName.start, prefixLen ) == 0) ) {
+				binding = &currBinding;
+				break;
+			}
+		}
+		if ( (prefixLen != 0) && (binding == 0) ) return false;	// Expat rejects undeclared prefixes.
+		if ( (binding != 0) && binding->uri.empty() ) binding = 0;	// An undeclared default namespace.
+	}
+
+	if ( binding != 0 ) {
+
+		XMP_StringPtr localName = rawName.start + ((prefixLen == 0) ? 0 : prefixLen+1);
+		size_t localLen = rawName.len - (localName - rawName.start);
+
+		node->ns = binding->uri;
+		node->name.reserve ( binding->xmpPrefix.size() + localLen );
+		node->name = binding->xmpPrefix;
+		node->name.append ( localName, localLen );
+
+	} else {
+
+		node->name.assign ( rawName.start, rawName.len );	// The name is not in a namespace.
+
+		if ( node->parent->name == "rdf:Description" ) {	// ! Same compatibility hack as SetQualName.
+			if ( node->name == "about" ) {
+				node->ns   = kXMP_NS_RDF;
+				node->name = "rdf:about";
+			} else if ( node->name == "ID" ) {
+				node->ns   = kXMP_NS_RDF;
+				node->name = "rdf:ID";
+			}
+		}
+
+	}
+
+	return true;
+
+}	// SetNodeName
+
+// =================================================================================================
+// AddNamespaceBinding
+// ===================
+//
+// Handle an xmlns or xmlns:prefix attribute, registering the namespace like the ExpatAdapter's
+// StartNamespaceDeclHandler. The registered prefix is kept with the binding.
+
+static bool
+AddNamespaceBinding ( ScanState & state, const RawAttr & declAttr )
+{
+	const RawName & declName = declAttr.name;
+	NSBinding newBinding;
+
+	if ( declName.colonPos == 0 ) {
+		newBinding.prefix = "";
+		newBinding.prefixLen = 0;
+	} else {
+		newBinding.prefix = declName.start + declName.colonPos + 1;
+		newBinding.prefixLen = declName.len - declName.colonPos - 1;
+		if ( declAttr.value.empty() ) return false;	// Undeclaring a prefix is XML 1.1 only.
+		if ( (newBinding.prefixLen == 3) && (memcmp ( newBinding.prefix, "xml", 3 ) == 0) ) return false;
+		if ( (newBinding.prefixLen == 5) && (memcmp ( newBinding.prefix, "xmlns", 5 ) == 0) ) return false;
+	}
+
+	if ( (declAttr.value == kXMP_NS_XML) || (declAttr.value == "http://www.w3.org/2000/xmlns/") ) return false;
+
+	if ( ! declAttr.value.empty() ) {
+
+		// As a bug fix hack, change a URI of "http://purl.org/dc/1.1/" to ""http://purl.org/dc/elements/1.1/.
+		// Early versions of Flash that put XMP in SWF used a bad URI for the dc: namespace.
+
+		newBinding.uri = declAttr.value;
+		if ( newBinding.uri == "http://purl.org/dc/1.1/" ) newBinding.uri = "http://purl.org/dc/elements/1.1/";
+
+		XMP_VarString suggPrefix ( "_dflt_" );	// Have default namespace.
+		if ( newBinding.prefixLen != 0 ) suggPrefix.assign ( newBinding.prefix, newBinding.prefixLen );
+
+		XMP_StringPtr regPrefix;
+		XMP_StringLen regLen;
+		(void) XMPMeta::RegisterNamespace ( newBinding.uri.c_str(), suggPrefix.c_str(), &regPrefix, &regLen );
+		newBinding.xmpPrefix.assign ( regPrefix, regLen );
+
+	}
+
+	state.bindings.push_back ( newBinding );
+	return true;
+
+}	// AddNamespaceBinding
+
+// =================================================================================================
+// ScanStartTag
+// ============
+//
+// Scan a start tag or empty element tag, the input position is at the '<'. The attributes are
+// scanned first, so that the namespace declarations are known before the names are resolved.
+
+static bool
+ScanStartTag ( ScanState & state )
+{
+	FastXMLAdapter * thiz = state.adapter;
+	XML_Node * parentNode = thiz->parseStack.back();
+
+	if ( (parentNode == &thiz->tree) && state.rootSeen ) return false;	// Only one root element.
+
+	++state.pos;
+	RawName elemName;
+	if ( ! ScanName ( state, &elemName ) ) return false;
+
+	// Scan the attributes.
+
+	bool isEmptyElem = false;
+	bool hasDecls = false;
+	state.attrCount = 0;
+
+	while ( true ) {
+
+		bool hadSpace = SkipSpace ( state );
+		if ( state.pos >= state.end ) return false;
+
+		if ( *state.pos == '>' ) {
+			++state.pos;
+			break;
+		}
+
+		if ( *state.pos == '/' ) {
+			if ( ((state.pos + 1) >= state.end) || (state.pos[1] != '>') ) return false;
+			state.pos += 2;
+			isEmptyElem = true;
+			break;
+		}
+
+		if ( ! hadSpace ) return false;
+
+		if ( state.attrCount == state.rawAttrs.size() ) state.rawAttrs.push_back ( RawAttr() );
+		RawAttr & rawAttr = state.rawAttrs[state.attrCount];
+		++state.attrCount;
+
+		if ( ! ScanName ( state, &rawAttr.name ) ) return false;
+		(void) SkipSpace ( state );
+		if ( (state.pos >= state.end) || (*state.pos != '=') ) return false;
+		++state.pos;
+		(void) SkipSpace ( state );
+		if ( (state.pos >= state.end) || ((*state.pos != '"') && (*state.pos != '\'')) ) return false;
+		if ( ! ScanAttrValue ( state, &rawAttr.value ) ) return false;
+
+		const RawName & attrName = rawAttr.name;
+		rawAttr.isDecl = ( ((attrName.len == 5) || (attrName.colonPos == 5)) &&
+						   (memcmp ( attrName.start, "xmlns", 5 ) == 0) );
+		if ( rawAttr.isDecl ) hasDecls = true;
+
+	}
+
+	// Process the namespace declarations. A repeated declaration is an error.
+
+	const size_t bindingCount = state.bindings.size();
+
+	if ( hasDecls ) {
+		for ( size_t attrNum = 0; attrNum < state.attrCount; ++attrNum ) {
+			const RawAttr & rawAttr = state.rawAttrs[attrNum];
+			if ( ! rawAttr.isDecl ) continue;
+			for ( size_t prevNum = 0; prevNum < attrNum; ++prevNum ) {
+				if ( SameName ( rawAttr.name, state.rawAttrs[prevNum].name ) ) return false;
+			}
+			if ( ! AddNamespaceBinding ( state, rawAttr ) ) return false;
+		}
+	}
+
+	// Create the element node and its attribute nodes. A repeated attribute name is an error, it is
+	// checked before SetNodeName's about/ID hack like Expat's own check. The node goes into the tree
+	// right away so that it gets deleted if anything fails.
+
+	XML_Node * elemNode = new XML_Node ( parentNode, "", kElemNode );
+	parentNode->content.push_back ( elemNode );
+	state.pendingSpace.erase();
+	if ( ! SetNodeName ( state, elemName, false, elemNode ) ) return false;
+
+	if ( state.attrCount > 0 ) elemNode->attrs.reserve ( state.attrCount );
+
+	const bool sortedCheck = (state.attrCount > kMaxPairwiseAttrs);
+	if ( sortedCheck ) state.attrKeys.clear();
+
+	for ( size_t attrNum = 0; attrNum < state.attrCount; ++attrNum ) {
+
+		RawAttr & rawAttr = state.rawAttrs[attrNum];
+		if ( rawAttr.isDecl ) continue;
+
+		XML_Node * attrNode = new XML_Node ( elemNode, "", kAttrNode );
+		elemNode->attrs.push_back ( attrNode );
+		if ( ! SetNodeName ( state, rawAttr.name, true, attrNode ) ) return false;
+
+		if ( sortedCheck ) {
+			state.attrKeys.push_back ( AttrKey ( (rawAttr.name.colonPos != 0), attrNode ) );
+		} else {
+			size_t prevNode = 0;	// ! The declarations have no nodes.
+			for ( size_t prevNum = 0; prevNum < attrNum; ++prevNum ) {
+				const RawAttr & prevRaw = state.rawAttrs[prevNum];
+				if ( prevRaw.isDecl ) continue;
+				const XML_Node * prevAttr = elemNode->attrs[prevNode++];
+				if ( (prevRaw.name.colonPos == 0) != (rawAttr.name.colonPos == 0) ) continue;	// Only equal by the hack.
+				if ( (prevAttr->name == attrNode->name) && (prevAttr->ns == attrNode->ns) ) return false;
+			}
+		}
+
+		attrNode->value.swap ( rawAttr.value );
+		if ( attrNode->name == "xml:lang" ) NormalizeLangValue ( &attrNode->value );
+
+	}
+
+	if ( sortedCheck && HasDuplicateAttr ( &state.attrKeys ) ) return false;
+
+	if ( (elemNode->name == "rdf:RDF") || (elemNode->name == "pxmp:XMP_Packet") ) {
+		thiz->rootNode = elemNode;
+		++thiz->rootCount;
+	}
+
+	if ( isEmptyElem ) {
+		state.bindings.resize ( bindingCount );
+		if ( parentNode == &thiz->tree ) state.rootSeen = true;
+	} else {
+		OpenTag openTag;
+		openTag.name = elemName;
+		openTag.bindingCount = bindingCount;
+		state.openTags.push_back ( openTag );
+		thiz->parseStack.push_back ( elemNode );
+	}
+
+	return true;
+
+}	// ScanStartTag
+
+// =================================================================================================
+// ScanEndTag
+// ==========
+
+static bool
+ScanEndTag ( ScanState & state )
+{
+	FastXMLAdapter * thiz = state.adapter;
+	if ( state.openTags.empty() ) return false;
+
+	state.pos += 2;
+	RawName endName;
+	if ( ! ScanName ( state, &endName ) ) return false;
+	(void) SkipSpace ( state );
+	if ( (state.pos >= state.end) || (*state.pos != '>') ) return false;
+	++state.pos;
+
+	const OpenTag & openTag = state.openTags.back();
+	if ( ! SameName ( endName, openTag.name ) ) return false;
+
+	state.bindings.resize ( openTag.bindingCount );
+	state.pendingSpace.erase();
+	state.openTags.pop_back();
+	thiz->parseStack.pop_back();
+	if ( thiz->parseStack.size() == 1 ) state.rootSeen = true;
+
+	return true;
+
+}	// ScanEndTag
+
+// =================================================================================================
+// ScanComment
+// ===========
+//
+// Skip a comment, the input position is at the "<!--". A "--" inside a comment is an error.
+
+static bool
+ScanComment ( ScanState & state )
+{
+
+	for ( state.pos += 4; (state.pos + 1) < state.end; ++state.pos ) {
+		if ( (state.pos[0] != '-') || (state.pos[1] != '-') ) continue;
+		if ( ((state.pos + 2) >= state.end) || (state.pos[2] != '>') ) return false;
+		state.pos += 3;
+		return true;
+	}
+
+	return false;
+
+}	// ScanComment
+
+// =================================================================================================
+// ScanPI
+// ======
+//
+// Scan a processing instruction, the input position is at the "<?". Only xpacket PIs are kept, like
+// the ExpatAdapter's ProcessingInstructionHandler. A target of "xml" in any case is reserved, the
+// XML declaration itself is handled by ScanXMLDecl.
+
+static bool
+ScanPI ( ScanState & state )
+{
+	FastXMLAdapter * thiz = state.adapter;
+
+	state.pos += 2;
+	RawName target;
+	if ( ! ScanName ( state, &target ) ) return false;
+	if ( target.colonPos != 0 ) return false;
+	if ( (target.len == 3) && ((target.start[0] | 0x20) == 'x') &&
+		 ((target.start[1] | 0x20) == 'm') && ((target.start[2] | 0x20) == 'l') ) return false;
+
+	bool hadSpace = SkipSpace ( state );
+	XMP_StringPtr dataStart = state.pos;
+
+	for ( ; (state.pos + 1) < state.end; ++state.pos ) {
+		if ( (state.pos[0] == '?') && (state.pos[1] == '>') ) break;
+	}
+	if ( (state.pos + 1) >= state.end ) return false;
+	if ( (state.pos != dataStart) && (! hadSpace) ) return false;
+
+	XMP_StringPtr dataEnd = state.pos;
+	state.pos += 2;
+
+	if ( (target.len != 7) || (memcmp ( target.start, "xpacket", 7 ) != 0) ) return true;
+
+	XML_Node * parentNode = thiz->parseStack.back();
+	XML_Node * piNode  = new XML_Node ( parentNode, "xpacket", kPINode );
+	parentNode->content.push_back ( piNode );
+	state.pendingSpace.erase();
+
+	piNode->value.reserve ( dataEnd - dataStart );
+	for ( XMP_StringPtr dataPtr = dataStart; dataPtr < dataEnd; ++dataPtr ) {
+		if ( *dataPtr != '\r' ) {
+			piNode->value += *dataPtr;
+		} else {
+			piNode->value += '\n';
+			if ( ((dataPtr + 1) < dataEnd) && (dataPtr[1] == '\n') ) ++dataPtr;
+		}
+	}
+
+	return true;
+
+}	// ScanPI
+
+// =================================================================================================
+// ScanXMLDecl
+// ===========
+//
+// Scan the XML declaration, the input position is at the "<?xml". Only version 1.0 and an encoding
+// of UTF-8 are accepted.
+
+static bool
+MatchPseudoAttr ( ScanState & state, XMP_StringPtr attrName, XMP_VarString * value )
+{
+	size_t nameLen = strlen ( attrName );
+	if ( ! MatchLiteral ( state, attrName, nameLen ) ) return false;
+
+	XMP_StringPtr savedPos = state.pos;
+	state.pos += nameLen;
+	(void) SkipSpace ( state );
+	if ( (state.pos >= state.end) || (*state.pos != '=') ) {
+		state.pos = savedPos;
+		return false;
+	}
+	++state.pos;
+	(void) SkipSpace ( state );
+	if ( (state.pos >= state.end) || ((*state.pos != '"') && (*state.pos != '\'')) ) return false;
+
+	const char quote = *state.pos;
+	XMP_StringPtr valueStart = ++state.pos;
+	while ( (state.pos < state.end) && (*state.pos != quote) ) ++state.pos;
+	if ( state.pos >= state.end ) return false;
+	value->assign ( valueStart, (state.pos - valueStart) );
+	++state.pos;
+
+	return true;
+
+}	// MatchPseudoAttr
+
+static bool
+ScanXMLDecl ( ScanState & state )
+{
+	XMP_VarString value;
+
+	state.pos += 5;
+	if ( ! SkipSpace ( state ) ) return false;
+	if ( ! MatchPseudoAttr ( state, "version", &value ) ) return false;
+	if ( value != "1.0" ) return false;
+
+	bool hadSpace = SkipSpace ( state );
+
+	if ( MatchPseudoAttr ( state, "encoding", &value ) ) {
+		if ( ! hadSpace ) return false;
+		if ( value.size() != 5 ) return false;
+		if ( ((value[0] | 0x20) != 'u') || ((value[1] | 0x20) != 't') || ((value[2] | 0x20) != 'f') ||
+			 (value[3] != '-') || (value[4] != '8') ) return false;
+		hadSpace = SkipSpace ( state );
+	}
+
+	if ( MatchPseudoAttr ( state, "standalone", &value ) ) {
+		if ( ! hadSpace ) return false;
+		if ( (value != "yes") && (value != "no") ) return false;
+		(void) SkipSpace ( state );
+	}
+
+	if ( ! MatchLiteral ( state, "?>", 2 ) ) return false;
+	state.pos += 2;
+
+	return true;
+
+}	// ScanXMLDecl
+
+// =================================================================================================
+// AppendText
+// ==========
+//
+// Append character data to a node value. Line ends are normalized like Expat does.
+
+static bool
+AppendText ( XMP_StringPtr textStart, XMP_StringPtr textEnd, bool isPlain, XMP_VarString * value )
+{
+
+	if ( isPlain ) {
+		value->append ( textStart, (textEnd - textStart) );
+		return true;
+	}
+
+	value->reserve ( value->size() + (textEnd - textStart) );
+
+	for ( XMP_StringPtr textPtr = textStart; textPtr < textEnd; ) {
+		char ch = *textPtr;
+		if ( ch == '&' ) {
+			if ( ! AppendReference ( textPtr, textEnd, value ) ) return false;
+		} else if ( ch == '\r' ) {
+			*value += '\n';
+			++textPtr;
+			if ( (textPtr < textEnd) && (*textPtr == '\n') ) ++textPtr;
+		} else {
+			if ( (ch == ']') && ((textEnd - textPtr) >= 3) && (textPtr[1] == ']') && (textPtr[2] == '>') ) return false;
+			*value += ch;
+			++textPtr;
+		}
+	}
+
+	return true;
+
+}	// AppendText
+
+// =================================================================================================
+// ScanText
+// ========
+//
+// Scan character data up to the next '<' or the end of input. Text outside of the root element must
+// be whitespace and is dropped. Inside, whitespace next to a child element is dropped, see the notes
+// at the top. Comments and other PIs do not end a text run, Expat's character data continues across
+// them. So whitespace after a child element is held in pendingSpace until it is known whether more
+// text follows.
+
+static bool
+ScanText ( ScanState & state )
+{
+	FastXMLAdapter * thiz = state.adapter;
+	XML_Node * parentNode = thiz->parseStack.back();
+
+	XMP_StringPtr textStart = state.pos;
+	XMP_StringPtr textEnd = textStart;
+	bool isPlain = true;
+	bool isWhite = true;
+
+	for ( ; (textEnd < state.end) && (*textEnd != '<'); ++textEnd ) {
+		char ch = *textEnd;
+		if ( ch == ' ' ) continue;
+		if ( (ch == '&') || (ch == '\r') || (ch == ']') ) isPlain = false;
+		if ( ! IsWhitespaceChar ( ch ) ) isWhite = false;
+	}
+
+	state.pos = textEnd;
+
+	if ( parentNode == &thiz->tree ) return isWhite;
+
+	XML_Node * prevNode = 0;
+	if ( ! parentNode->content.empty() ) prevNode = parentNode->content.back();
+
+	if ( (prevNode != 0) && (prevNode->kind == kCDataNode) ) {
+		return AppendText ( textStart, textEnd, isPlain, &prevNode->value );	// Continue the run.
+	}
+
+	if ( isWhite ) {
+		if ( (prevNode != 0) && (prevNode->kind == kElemNode) ) {
+			return AppendText ( textStart, textEnd, isPlain, &state.pendingSpace );
+		}
+		if ( ((textEnd + 1) < state.end) && IsNameStartChar ( textEnd[1] ) ) return true;	// Before a child element.
+	}
+
+	XML_Node * cDataNode = new XML_Node ( parentNode, "", kCDataNode );
+	parentNode->content.push_back ( cDataNode );
+	cDataNode->value.swap ( state.pendingSpace );
+
+	return AppendText ( textStart, textEnd, isPlain, &cDataNode->value );
+
+}	// ScanText
+
+// =================================================================================================
+// ScanDocument
+// ============
+//
+// Scan the buffered input into the adapter's tree. Returns false if the input is not in the handled
+// subset, the partial tree must then be discarded.
+
+static bool
+ScanDocument ( FastXMLAdapter * thiz )
+{
+	ScanState state ( thiz );
+	state.pos = thiz->input.data();
+	state.end = state.pos + thiz->input.size();
+
+	if ( ! IsPlainUTF8 ( (const XMP_Uns8*)state.pos, (const XMP_Uns8*)state.end ) ) return false;
+
+	// The xml prefix is always bound. The XMP toolkit registers it, see XMPMeta::Initialize.
+
+	NSBinding xmlBinding;
+	xmlBinding.prefix = "xml";
+	xmlBinding.prefixLen = 3;
+	xmlBinding.uri = kXMP_NS_XML;
+	XMP_StringPtr xmlPrefix;
+	XMP_StringLen xmlPrefixLen;
+	if ( ! XMPMeta::GetNamespacePrefix ( kXMP_NS_XML, &xmlPrefix, &xmlPrefixLen ) ) return false;
+	xmlBinding.xmpPrefix.assign ( xmlPrefix, xmlPrefixLen );
+	state.bindings.push_back ( xmlBinding );
+
+	if ( MatchLiteral ( state, "\xEF\xBB\xBF", 3 ) ) state.pos += 3;	// Skip a UTF-8 BOM.
+	if ( MatchLiteral ( state, "<?xml", 5 ) && ((state.pos + 5) < state.end) && IsWhitespaceChar ( state.pos[5] ) ) {
+		if ( ! ScanXMLDecl ( state ) ) return false;
+	}
+
+	while ( state.pos < state.end ) {
+
+		bool ok;
+
+		if ( *state.pos != '<' ) {
+			ok = ScanText ( state );
+		} else if ( (state.pos + 1) >= state.end ) {
+			ok = false;
+		} else {
+			char next = state.pos[1];
+			if ( IsNameStartChar ( next ) ) {
+				ok = ScanStartTag ( state );
+			} else if ( next == '/' ) {
+				ok = ScanEndTag ( state );
+			} else if ( next == '?' ) {
+				ok = ScanPI ( state );
+			} else if ( MatchLiteral ( state, "<!--", 4 ) ) {
+				ok = ScanComment ( state );
+			} else {
+				ok = false;	// A DOCTYPE, CDATA section, or an error.
+			}
+		}
+
+		if ( ! ok ) return false;
+
+	}
+
+	return ( state.rootSeen && (thiz->parseStack.size() == 1) );
+
+}	// ScanDocument
+
+// =================================================================================================
+// =================================================================================================
+
+FastXMLAdapter::FastXMLAdapter()
+{
+
+	this->parseStack.push_back ( &this->tree );	// Push the XML root node.
+
+}	// FastXMLAdapter::FastXMLAdapter
+
+// =================================================================================================
+
+FastXMLAdapter::~FastXMLAdapter()
+{
+
+}	// FastXMLAdapter::~FastXMLAdapter
+
+// =================================================================================================
+
+void FastXMLAdapter::ParseBuffer ( const void * buffer, size_t length, bool last )
+{
+
+	this->input.append ( (const char *)buffer, length );
+	if ( ! last ) return;
+
+	bool scanned = false;
+	if ( this->charEncoding == kXMP_EncodeUTF8 ) scanned = ScanDocument ( this );
+	if ( ! scanned ) this->ParseWithExpat();
+
+	XMP_VarString().swap ( this->input );	// Release the input, the tree has copies of everything.
+
+}	// FastXMLAdapter::ParseBuffer
+
+// =================================================================================================
+
+void FastXMLAdapter::ParseWithExpat()
+{
+
+	// Discard whatever the scan had done, then parse everything with Expat and take its tree.
+
+	this->tree.RemoveContent();
+	this->parseStack.resize ( 1 );
+	this->rootNode  = 0;
+	this->rootCount = 0;
+
+	ExpatAdapter expat;
+	expat.charEncoding = this->charEncoding;
+	expat.ParseBuffer ( this->input.data(), this->input.size(), true );
+
+	this->tree.content.swap ( expat.tree.content );
+	for ( size_t childNum = 0, childLim = this->tree.content.size(); childNum < childLim; ++childNum ) {
+		this->tree.content[childNum]->parent = &this->tree;
+	}
+
+	this->rootNode  = expat.rootNode;
+	this->rootCount = expat.rootCount;
+
+}	// FastXMLAdapter::ParseWithExpat
+
+// =================================================================================================
@@ -0,0 +1,38 @@
+#ifndef __FastXMLAdapter_hpp__
+#define __FastXMLAdapter_hpp__
+
+// =================================================================================================
+// Copyright 2005-2007 Adobe Systems Incorporated
+// All Rights Reserved.
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+// =================================================================================================
+
+#include "XMP_Environment.h"	// ! Must be the first #include!
+#include "XMLParserAdapter.hpp"
+
+// =================================================================================================
+// Derived XML parser adapter that scans ordinary RDF directly, falling back to Expat for anything
+// unusual. See the notes in FastXMLAdapter.cpp.
+// =================================================================================================
+
+class FastXMLAdapter : public XMLParserAdapter {
+public:
+
+	XMP_VarString input;	// All of the input, it is scanned by the last ParseBuffer call.
+
+	FastXMLAdapter();
+	virtual ~FastXMLAdapter();
+
+	void ParseBuffer ( const void * buffer, size_t length, bool last );
+
+private:
+
+	void ParseWithExpat();
+
+};
+
+// =================================================================================================
+
+#endif	// __FastXMLAdapter_hpp__
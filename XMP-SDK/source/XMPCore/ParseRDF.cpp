@@ -8,8 +8,10 @@
 
 #include "XMP_Environment.h"	// ! This must be the first include!
 #include "XMPCore_Impl.hpp"
+#include "XMLParserAdapter.hpp"
 
 #include <cstring>
+#include <algorithm>
 
 #if DEBUG
 	#include <iostream>
@@ -161,21 +163,30 @@ using namespace std;
 //
 // Each of these is responsible for recognizing an RDF syntax production and adding the appropriate
 // structure to the XMP tree. They simply return for success, failures will throw an exception.
+//
+// The TopLevelInfo is only passed to the functions for the top level nodes. It is null for inner
+// nodes, and when there is neither a parse filter nor lazy schemas.
+
+struct TopLevelInfo {
+	const XMP_SchemaFilter * filter;	// Null if all schemas are wanted.
+	XMP_LazyXML *			 lazyXML;	// Null unless parsing with kXMP_ParseLazySchemas.
+	TopLevelInfo() : filter(0), lazyXML(0) {};
+};
 
 static void
-RDF_RDF ( XMP_Node * xmpTree, const XML_Node & xmlNode );
+RDF_RDF ( XMP_Node * xmpTree, const XML_Node & xmlNode, const TopLevelInfo * topInfo );
 
 static void
-RDF_NodeElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel );
+RDF_NodeElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel, const TopLevelInfo * topInfo );
 
 static void
-RDF_NodeElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel );
+RDF_NodeElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel, const TopLevelInfo * topInfo );
 
 static void
-RDF_NodeElementAttrs ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel );
+RDF_NodeElementAttrs ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel, const TopLevelInfo * topInfo );
 
 static void
-RDF_PropertyElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel );
+RDF_PropertyElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel, const TopLevelInfo * topInfo );
 enum { kIsTopLevel = true, kNotTopLevel = false };
 
 static void
@@ -398,6 +409,70 @@ IsPropertyAttributeName ( RDFTermKind term )
 }	// IsPropertyAttributeName
 
 
+// =================================================================================================
+// IsFilteredOut
+// =============
+//
+// Decide if the parse filter excludes a top level property. An alias is judged by the schema of its
+// actual property, that is where MoveExplicitAliases will put it. A property with no namespace is
+// let through so that AddChildNode reports the error.
+
+static bool
+IsFilteredOut ( const XML_Node & xmlNode, const XMP_SchemaFilter * filter )
+{
+	if ( (filter == 0) || xmlNode.ns.empty() ) return false;
+	
+	const XMP_VarString * schemaNS = &xmlNode.ns;
+	XMP_cAliasMapPos aliasPos = sRegisteredAliasMap->find ( xmlNode.name );
+	if ( aliasPos != sRegisteredAliasMap->end() ) schemaNS = &aliasPos->second[kSchemaStep].step;
+	
+	bool isListed = std::binary_search ( filter->schemas.begin(), filter->schemas.end(), *schemaNS );
+	return (isListed == (filter->mode == kXMP_ParseSkipSchemas));
+
+}	// IsFilteredOut
+
+
+// =================================================================================================
+// DeferTopLevelProperty
+// =====================
+//
+// Take care of the filtering and lazy schemas for a top level property. Returns true if the
+// property is now handled, false if it must be converted as usual. A lazy property just has its XML
+// node appended to the lazy schema node. An alias, or a property whose schema node is already
+// materialized, is converted now. That keeps the properties of each schema in document order.
+
+static bool
+DeferTopLevelProperty ( XMP_Node * xmpTree, const XML_Node & xmlNode, const TopLevelInfo & topInfo )
+{
+	XMP_Assert ( xmpTree->parent == 0 );
+
+	if ( IsFilteredOut ( xmlNode, topInfo.filter ) ) return true;	// Skip the whole subtree.
+	if ( (topInfo.lazyXML == 0) || xmlNode.ns.empty() ) return false;
+	if ( sRegisteredAliasMap->find ( xmlNode.name ) != sRegisteredAliasMap->end() ) return false;
+	
+	XMP_Node * schemaNode = 0;
+	for ( size_t schemaNum = 0, schemaLim = xmpTree->children.size(); schemaNum != schemaLim; ++schemaNum ) {
+		if ( xmpTree->children[schemaNum]->name == xmlNode.ns ) {
+			schemaNode = xmpTree->children[schemaNum];	// ! Don't use FindSchemaNode, it would materialize.
+			break;
+		}
+	}
+	
+	if ( schemaNode == 0 ) {
+		XMP_StringMap * uriMap = sNamespaceURIToPrefixMap;	// ! Load once, see XMPMeta::ParseMany.
+		XMP_StringMapPos uriPos = uriMap->find ( xmlNode.ns );
+		XMP_Enforce ( uriPos != uriMap->end() );	// The XML parser registered it.
+		schemaNode = new XMP_LazySchemaNode ( xmpTree, xmlNode.ns, uriPos->second, topInfo.lazyXML );
+		xmpTree->children.push_back ( schemaNode );
+	}
+	
+	if ( ! IsLazySchema ( schemaNode ) ) return false;
+	((XMP_LazySchemaNode*)schemaNode)->xmlProps.push_back ( &xmlNode );
+	return true;
+
+}	// DeferTopLevelProperty
+
+
 // =================================================================================================
 // AddChildNode
 // ============
@@ -665,15 +740,99 @@ FixupQualifiedNode ( XMP_Node * xmpParent )
 // *** Throw an exception if no XMP is found? By option?
 // *** Do parsing exceptions cause the partial tree to be deleted?
 
-void ProcessRDF ( XMP_Node * xmpTree, const XML_Node & rdfNode, XMP_OptionBits options )
+void ProcessRDF ( XMP_Node * xmpTree, const XML_Node & rdfNode, XMP_OptionBits options,
+				  const XMP_SchemaFilter & filter, XMP_LazyXML * lazyXML )
 {
 	IgnoreParam(options);
 	
-	RDF_RDF ( xmpTree, rdfNode );
+	TopLevelInfo topInfo;
+	if ( filter.mode != 0 ) topInfo.filter = &filter;
+	topInfo.lazyXML = lazyXML;
+	const bool needInfo = ((topInfo.filter != 0) || (topInfo.lazyXML != 0));
+	
+	try {
+		RDF_RDF ( xmpTree, rdfNode, (needInfo ? &topInfo : 0) );
+	} catch ( ... ) {
+		if ( lazyXML != 0 ) ReleaseLazyXML ( lazyXML );
+		throw;
+	}
+	
+	if ( lazyXML != 0 ) ReleaseLazyXML ( lazyXML );	// The lazy schema nodes hold their own references.
 
 }	// ProcessRDF
 
 
+// =================================================================================================
+// ReleaseLazyXML
+// ==============
+
+void ReleaseLazyXML ( XMP_LazyXML * lazyXML )
+{
+
+	--lazyXML->refCount;
+	if ( lazyXML->refCount == 0 ) {
+		delete lazyXML->xmlParser;
+		delete lazyXML;
+	}
+
+}	// ReleaseLazyXML
+
+
+// =================================================================================================
+// MaterializeSchema
+// =================
+//
+// Convert the saved XML of a lazy schema into XMP nodes. The lazy flag is cleared first, so that the
+// FindSchemaNode calls from AddChildNode find this schema without recursing. If the XML turns out to
+// be bad the exception goes to the caller, the schema keeps whatever was converted before that.
+
+void MaterializeSchema ( XMP_Node * schemaNode )
+{
+	XMP_Assert ( IsLazySchema ( schemaNode ) );
+	XMP_LazySchemaNode * lazyNode = (XMP_LazySchemaNode*)schemaNode;
+	XMP_Node * xmpTree = schemaNode->parent;
+	
+	schemaNode->options ^= kXMP_SchemaIsLazy;
+	XMP_LazyXML * lazyXML = lazyNode->xmlOwner;
+	lazyNode->xmlOwner = 0;
+	std::vector<const XML_Node*> xmlProps;
+	xmlProps.swap ( lazyNode->xmlProps );
+	
+	try {
+		for ( size_t propNum = 0, propLim = xmlProps.size(); propNum != propLim; ++propNum ) {
+			const XML_Node & xmlNode = *xmlProps[propNum];
+			if ( xmlNode.kind == kAttrNode ) {
+				AddChildNode ( xmpTree, xmlNode, xmlNode.value.c_str(), kIsTopLevel );
+			} else {
+				RDF_PropertyElement ( xmpTree, xmlNode, kIsTopLevel );
+			}
+		}
+	} catch ( ... ) {
+		ReleaseLazyXML ( lazyXML );
+		throw;
+	}
+	
+	ReleaseLazyXML ( lazyXML );
+
+}	// MaterializeSchema
+
+
+// =================================================================================================
+// MaterializeAllSchemas
+// =====================
+
+void MaterializeAllSchemas ( XMP_Node * xmpTree )
+{
+	XMP_Assert ( xmpTree->parent == 0 );
+
+	for ( size_t schemaNum = 0, schemaLim = xmpTree->children.size(); schemaNum != schemaLim; ++schemaNum ) {
+		XMP_Node * currSchema = xmpTree->children[schemaNum];
+		if ( IsLazySchema ( currSchema ) ) MaterializeSchema ( currSchema );
+	}
+
+}	// MaterializeAllSchemas
+
+
 // =================================================================================================
 // RDF_RDF
 // =======
@@ -687,11 +846,11 @@ void ProcessRDF ( XMP_Node * xmpTree, const XML_Node & rdfNode, XMP_OptionBits o
 // during construction of the XML tree.
 
 static void
-RDF_RDF ( XMP_Node * xmpTree, const XML_Node & xmlNode )
+RDF_RDF ( XMP_Node * xmpTree, const XML_Node & xmlNode, const TopLevelInfo * topInfo )
 {
 
 	if ( ! xmlNode.attrs.empty() ) XMP_Throw ( "Invalid attributes of rdf:RDF element", kXMPErr_BadRDF );
-	RDF_NodeElementList ( xmpTree, xmlNode, kIsTopLevel );
+	RDF_NodeElementList ( xmpTree, xmlNode, kIsTopLevel, topInfo );
 
 }	// RDF_RDF
 
@@ -704,7 +863,7 @@ RDF_RDF ( XMP_Node * xmpTree, const XML_Node & xmlNode )
 //		ws* ( nodeElement ws* )*
 
 static void
-RDF_NodeElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel )
+RDF_NodeElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel, const TopLevelInfo * topInfo )
 {
 	XMP_Assert ( isTopLevel );
 	
@@ -713,7 +872,7 @@ RDF_NodeElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isT
 
 	for ( ; currChild != endChild; ++currChild ) {
 		if ( IsWhitespaceNode ( **currChild ) ) continue;
-		RDF_NodeElement ( xmpParent, **currChild, isTopLevel );
+		RDF_NodeElement ( xmpParent, **currChild, isTopLevel, topInfo );
 	}
 
 }	// RDF_NodeElementList
@@ -735,7 +894,7 @@ RDF_NodeElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isT
 // A node element URI is rdf:Description or anything else that is not an RDF term.
 
 static void
-RDF_NodeElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel )
+RDF_NodeElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel, const TopLevelInfo * topInfo )
 {
 	RDFTermKind nodeTerm = GetRDFTermKind ( xmlNode.name );
 	if ( (nodeTerm != kRDFTerm_Description) && (nodeTerm != kRDFTerm_Other) ) {
@@ -745,8 +904,8 @@ RDF_NodeElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLeve
 	if ( isTopLevel && (nodeTerm == kRDFTerm_Other) ) {
 		XMP_Throw ( "Top level typedNode not allowed", kXMPErr_BadXMP );
 	} else {
-		RDF_NodeElementAttrs ( xmpParent, xmlNode, isTopLevel );
-		RDF_PropertyElementList ( xmpParent, xmlNode, isTopLevel );
+		RDF_NodeElementAttrs ( xmpParent, xmlNode, isTopLevel, topInfo );
+		RDF_PropertyElementList ( xmpParent, xmlNode, isTopLevel, topInfo );
 	}
 
 }	// RDF_NodeElement
@@ -772,7 +931,7 @@ RDF_NodeElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLeve
 static const XMP_OptionBits kExclusiveAttrMask = (kRDFMask_ID | kRDFMask_nodeID | kRDFMask_about);
 
 static void
-RDF_NodeElementAttrs ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel )
+RDF_NodeElementAttrs ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTopLevel, const TopLevelInfo * topInfo )
 {
 	XMP_OptionBits exclusiveAttrs = 0;	// Used to detect attributes that are mutually exclusive.
 
@@ -809,6 +968,7 @@ RDF_NodeElementAttrs ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTo
 				break;
 
 			case kRDFTerm_Other :
+				if ( (topInfo != 0) && DeferTopLevelProperty ( xmpParent, **currAttr, *topInfo ) ) break;
 				AddChildNode ( xmpParent, **currAttr, (*currAttr)->value.c_str(), isTopLevel );
 				break;
 
@@ -830,7 +990,7 @@ RDF_NodeElementAttrs ( XMP_Node * xmpParent, const XML_Node & xmlNode, bool isTo
 //		ws* ( propertyElt ws* )*
 
 static void
-RDF_PropertyElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel )
+RDF_PropertyElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool isTopLevel, const TopLevelInfo * topInfo )
 {
 	XML_cNodePos currChild = xmlParent.content.begin();
 	XML_cNodePos endChild  = xmlParent.content.end();
@@ -840,6 +1000,7 @@ RDF_PropertyElementList ( XMP_Node * xmpParent, const XML_Node & xmlParent, bool
 		if ( (*currChild)->kind != kElemNode ) {
 			XMP_Throw ( "Expected property element node not found", kXMPErr_BadRDF );
 		}
+		if ( (topInfo != 0) && DeferTopLevelProperty ( xmpParent, **currChild, *topInfo ) ) continue;
 		RDF_PropertyElement ( xmpParent, **currChild, isTopLevel );
 	}
 
@@ -1032,7 +1193,7 @@ RDF_ResourcePropertyElement ( XMP_Node * xmpParent, const XML_Node & xmlNode, bo
 		}
 	}
 
-	RDF_NodeElement ( newCompound, **currChild, kNotTopLevel );
+	RDF_NodeElement ( newCompound, **currChild, kNotTopLevel, 0 );
 	if ( newCompound->options & kRDF_HasValueElem ) {
 		FixupQualifiedNode ( newCompound );
 	} else if ( newCompound->options & kXMP_PropArrayIsAlternate ) {
@@ -1152,7 +1313,7 @@ RDF_ParseTypeResourcePropertyElement ( XMP_Node * xmpParent, const XML_Node & xm
 		}
 	}
 
-	RDF_PropertyElementList ( newStruct, xmlNode, kNotTopLevel );
+	RDF_PropertyElementList ( newStruct, xmlNode, kNotTopLevel, 0 );
 
 	if ( newStruct->options & kRDF_HasValueElem ) FixupQualifiedNode ( newStruct );
 	
@@ -426,6 +426,39 @@ WXMPMeta_GetProperty_1 ( XMPMetaRef		  xmpRef,
 
 // -------------------------------------------------------------------------------------------------
 
+void
+WXMPMeta_GetPropertyBatch_1 ( XMPMetaRef			  xmpRef,
+							  XMP_Index				  propCount,
+							  const XMP_StringPtr *	  schemaNS,
+							  const XMP_StringPtr *	  propNames,
+							  XMP_PropertyBatchInfo * propInfo,
+							  XMP_StringPtr *		  valueArena,
+							  XMP_StringLen *		  arenaSize,
+							  WXMP_Result *			  wResult ) /* const */
+{
+	XMP_ENTER_WRAPPER ( "WXMPMeta_GetPropertyBatch_1" )
+	
+		if ( propCount < 0 ) XMP_Throw ( "Negative property count", kXMPErr_BadParam );
+		if ( (propCount > 0) && ((schemaNS == 0) || (propNames == 0) || (propInfo == 0)) ) {
+			XMP_Throw ( "Null property batch parameter", kXMPErr_BadParam );
+		}
+		for ( XMP_Index i = 0; i < propCount; ++i ) {
+			if ( (schemaNS[i] == 0) || (*schemaNS[i] == 0) ) XMP_Throw ( "Empty schema namespace URI", kXMPErr_BadSchema );
+			if ( (propNames[i] == 0) || (*propNames[i] == 0) ) XMP_Throw ( "Empty property name", kXMPErr_BadXPath );
+		}
+		
+		if ( valueArena == 0 ) valueArena = &voidStringPtr;
+		if ( arenaSize == 0 ) arenaSize = &voidStringLen;
+
+		const XMPMeta & meta = WtoXMPMeta_Ref ( xmpRef );
+		XMP_Index foundCount = meta.GetPropertyBatch ( propCount, schemaNS, propNames, propInfo, valueArena, arenaSize );
+		wResult->int32Result = foundCount;
+
+	XMP_EXIT_WRAPPER_KEEP_LOCK ( true ) // ! Always keep the lock, the arena is always returned!
+}
+
+// -------------------------------------------------------------------------------------------------
+
 void
 WXMPMeta_GetArrayItem_1 ( XMPMetaRef	   xmpRef,
 						  XMP_StringPtr	   schemaNS,
@@ -1253,6 +1286,42 @@ WXMPMeta_ParseFromBuffer_1 ( XMPMetaRef		xmpRef,
 
 // -------------------------------------------------------------------------------------------------
 
+void
+WXMPMeta_SetParseFilter_1 ( XMPMetaRef			  xmpRef,
+							XMP_OptionBits		  filterMode,
+							const XMP_StringPtr * schemaList,
+							XMP_Index			  schemaCount,
+							WXMP_Result *		  wResult )
+{
+	XMP_ENTER_WRAPPER ( "WXMPMeta_SetParseFilter_1" )
+
+		XMPMeta * meta = WtoXMPMeta_Ptr ( xmpRef );
+		meta->SetParseFilter ( filterMode, schemaList, schemaCount );
+		
+	XMP_EXIT_WRAPPER
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void
+WXMPMeta_ParseMany_1 ( XMP_Int32			 packetCount,
+					   const XMP_StringPtr * packets,
+					   const XMP_StringLen * packetLens,
+					   XMP_OptionBits		 options,
+					   XMP_Int32			 maxThreads,
+					   XMPMetaRef *			 xmpRefs,
+					   XMP_Int32 *			 errorIDs,
+					   WXMP_Result *		 wResult )
+{
+	XMP_ENTER_WRAPPER ( "WXMPMeta_ParseMany_1" )
+
+		XMPMeta::ParseMany ( packetCount, packets, packetLens, options, maxThreads, xmpRefs, errorIDs );
+		
+	XMP_EXIT_WRAPPER
+}
+
+// -------------------------------------------------------------------------------------------------
+
 void
 WXMPMeta_SerializeToBuffer_1 ( XMPMetaRef	   xmpRef,
 							   XMP_StringPtr * rdfString,
@@ -1278,6 +1347,43 @@ WXMPMeta_SerializeToBuffer_1 ( XMPMetaRef	   xmpRef,
 	XMP_EXIT_WRAPPER_KEEP_LOCK ( true ) // ! Always keep the lock, a string is always returned!
 }
 
+// -------------------------------------------------------------------------------------------------
+
+void
+WXMPMeta_SerializeToSnapshot_1 ( XMPMetaRef	  xmpRef,
+								 XMP_StringPtr * snapshot,
+								 XMP_StringLen * snapshotSize,
+								 WXMP_Result *	  wResult ) /* const */
+{
+	XMP_ENTER_WRAPPER ( "WXMPMeta_SerializeToSnapshot_1" )
+
+		if ( snapshot == 0 ) snapshot = &voidStringPtr;
+		if ( snapshotSize == 0 ) snapshotSize = &voidStringLen;
+		
+		const XMPMeta & meta = WtoXMPMeta_Ref ( xmpRef );
+		meta.SerializeToSnapshot ( snapshot, snapshotSize );
+
+	XMP_EXIT_WRAPPER_KEEP_LOCK ( true ) // ! Always keep the lock, a string is always returned!
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void
+WXMPMeta_LoadFromSnapshot_1 ( XMPMetaRef	xmpRef,
+							  XMP_StringPtr snapshot,
+							  XMP_StringLen snapshotSize,
+							  WXMP_Result * wResult )
+{
+	XMP_ENTER_WRAPPER ( "WXMPMeta_LoadFromSnapshot_1" )
+
+		if ( snapshot == 0 ) XMP_Throw ( "Null snapshot buffer", kXMPErr_BadParam );
+
+		XMPMeta * meta = WtoXMPMeta_Ptr ( xmpRef );
+		meta->LoadFromSnapshot ( snapshot, snapshotSize );
+		
+	XMP_EXIT_WRAPPER
+}
+
 // =================================================================================================
 
 #if __cplusplus
@@ -15,6 +15,10 @@
 
 #include <algorithm>
 
+#if XMP_MacBuild
+	#include <libkern/OSAtomic.h>	// For OSMemoryBarrier.
+#endif
+
 using namespace std;
 
 #if XMP_WinBuild
@@ -48,8 +52,8 @@ using namespace std;
 
 XMP_Int32 sXMP_InitCount = 0;
 
-XMP_StringMap *	sNamespaceURIToPrefixMap = 0;
-XMP_StringMap *	sNamespacePrefixToURIMap = 0;
+XMP_StringMap * volatile	sNamespaceURIToPrefixMap = 0;
+XMP_StringMap * volatile	sNamespacePrefixToURIMap = 0;
 
 XMP_AliasMap *	sRegisteredAliasMap = 0;	// Needed by XMPIterator.
 
@@ -60,6 +64,10 @@ XMP_VarString * sExceptionMessage = 0;
 XMP_Mutex sXMPCoreLock;
 int sLockCount = 0;
 
+XMP_Mutex sNamespaceLock;
+bool sParallelParsing = false;
+std::vector<XMP_StringMap*> * sRetiredNamespaceMaps = 0;
+
 #if TraceXMPCalls
 	FILE * xmpOut = stderr;
 #endif
@@ -150,6 +158,169 @@ WXMP_Result 		void_wResult;
 
 #endif
 
+// -------------------------------------------------------------------------------------------------
+// XMP_MemoryBarrier
+// -----------------
+//
+// Make all prior stores visible before any later store. Used to fully build a namespace map before
+// publishing it to lock-free readers.
+
+void XMP_MemoryBarrier()
+{
+
+	#if XMP_MacBuild
+		OSMemoryBarrier();
+	#elif XMP_WinBuild
+		MemoryBarrier();
+	#elif XMP_UNIXBuild
+		__sync_synchronize();
+	#endif
+
+}	// XMP_MemoryBarrier
+
+// =================================================================================================
+// Worker Threads
+// ==============
+
+#if XMP_MacBuild
+
+	static OSStatus MacThreadEntry ( void * param )
+	{
+		XMP_Thread * thread = (XMP_Thread*)param;
+		thread->proc ( thread->procArg );
+		return noErr;
+	}
+
+	bool XMP_StartThread ( XMP_Thread * thread, XMP_ThreadProc proc, void * procArg )
+	{
+		thread->proc = proc;
+		thread->procArg = procArg;
+		OSStatus err = MPCreateQueue ( &thread->doneQueue );
+		if ( err != noErr ) return false;
+		err = MPCreateTask ( MacThreadEntry, thread, 0, thread->doneQueue, 0, 0, 0, &thread->taskID );
+		if ( err != noErr ) {
+			(void) MPDeleteQueue ( thread->doneQueue );
+			return false;
+		}
+		return true;
+	}
+
+	void XMP_JoinThread ( XMP_Thread * thread )
+	{
+		(void) MPWaitOnQueue ( thread->doneQueue, 0, 0, 0, kDurationForever );
+		(void) MPDeleteQueue ( thread->doneQueue );
+	}
+
+#elif XMP_WinBuild
+
+	static DWORD WINAPI WinThreadEntry ( LPVOID param )
+	{
+		XMP_Thread * thread = (XMP_Thread*)param;
+		thread->proc ( thread->procArg );
+		return 0;
+	}
+
+	bool XMP_StartThread ( XMP_Thread * thread, XMP_ThreadProc proc, void * procArg )
+	{
+		thread->proc = proc;
+		thread->procArg = procArg;
+		thread->handle = CreateThread ( 0, 0, WinThreadEntry, thread, 0, 0 );
+		return (thread->handle != 0);
+	}
+
+	void XMP_JoinThread ( XMP_Thread * thread )
+	{
+		(void) WaitForSingleObject ( thread->handle, INFINITE );
+		(void) CloseHandle ( thread->handle );
+	}
+
+#elif XMP_UNIXBuild
+
+	static void * UnixThreadEntry ( void * param )
+	{
+		XMP_Thread * thread = (XMP_Thread*)param;
+		thread->proc ( thread->procArg );
+		return 0;
+	}
+
+	bool XMP_StartThread ( XMP_Thread * thread, XMP_ThreadProc proc, void * procArg )
+	{
+		thread->proc = proc;
+		thread->procArg = procArg;
+		int err = pthread_create ( &thread->thread, 0, UnixThreadEntry, thread );
+		return (err == 0);
+	}
+
+	void XMP_JoinThread ( XMP_Thread * thread )
+	{
+		(void) pthread_join ( thread->thread, 0 );
+	}
+
+#endif
+
+// =================================================================================================
+// Per-thread Values
+// =================
+
+#if XMP_MacBuild
+
+	bool XMP_InitThreadKey ( XMP_ThreadKey * key ) {
+		OSStatus err = MPAllocateTaskStorageIndex ( key );
+		return (err == noErr);
+	}
+
+	void XMP_TermThreadKey ( XMP_ThreadKey & key ) {
+		(void) MPDeallocateTaskStorageIndex ( key );
+	}
+
+	void * XMP_GetThreadValue ( XMP_ThreadKey & key ) {
+		return (void*) MPGetTaskStorageValue ( key );
+	}
+
+	void XMP_SetThreadValue ( XMP_ThreadKey & key, void * value ) {
+		(void) MPSetTaskStorageValue ( key, (TaskStorageValue)value );
+	}
+
+#elif XMP_WinBuild
+
+	bool XMP_InitThreadKey ( XMP_ThreadKey * key ) {
+		*key = TlsAlloc();
+		return (*key != TLS_OUT_OF_INDEXES);
+	}
+
+	void XMP_TermThreadKey ( XMP_ThreadKey & key ) {
+		(void) TlsFree ( key );
+	}
+
+	void * XMP_GetThreadValue ( XMP_ThreadKey & key ) {
+		return TlsGetValue ( key );
+	}
+
+	void XMP_SetThreadValue ( XMP_ThreadKey & key, void * value ) {
+		(void) TlsSetValue ( key, value );
+	}
+
+#elif XMP_UNIXBuild
+
+	bool XMP_InitThreadKey ( XMP_ThreadKey * key ) {
+		int err = pthread_key_create ( key, 0 );
+		return (err == 0);
+	}
+
+	void XMP_TermThreadKey ( XMP_ThreadKey & key ) {
+		(void) pthread_key_delete ( key );
+	}
+
+	void * XMP_GetThreadValue ( XMP_ThreadKey & key ) {
+		return pthread_getspecific ( key );
+	}
+
+	void XMP_SetThreadValue ( XMP_ThreadKey & key, void * value ) {
+		(void) pthread_setspecific ( key, value );
+	}
+
+#endif
+
 // =================================================================================================
 // Local Utilities
 // ===============
@@ -186,8 +357,9 @@ VerifyXPathRoot	( XMP_StringPtr			schemaURI,
 		}
 	}
 
-	XMP_StringMapPos uriPos = sNamespaceURIToPrefixMap->find ( XMP_VarString ( schemaURI ) );
-	if ( uriPos == sNamespaceURIToPrefixMap->end() ) {
+	XMP_StringMap * uriMap = sNamespaceURIToPrefixMap;	// ! Load once, see XMPMeta::ParseMany.
+	XMP_StringMapPos uriPos = uriMap->find ( XMP_VarString ( schemaURI ) );
+	if ( uriPos == uriMap->end() ) {
 		XMP_Throw ( "Unregistered schema namespace URI", kXMPErr_BadSchema );
 	}
 
@@ -213,8 +385,9 @@ VerifyXPathRoot	( XMP_StringPtr			schemaURI,
 		VerifySimpleXMLName ( colonPos+1, colonPos+strlen(colonPos) );
 
 		XMP_VarString prefix ( propName, prefixLen );
-		XMP_StringMapPos prefixPos = sNamespacePrefixToURIMap->find ( prefix );
-		if ( prefixPos == sNamespacePrefixToURIMap->end() ) {
+		XMP_StringMap * prefixMap = sNamespacePrefixToURIMap;
+		XMP_StringMapPos prefixPos = prefixMap->find ( prefix );
+		if ( prefixPos == prefixMap->end() ) {
 			XMP_Throw ( "Unknown schema namespace prefix", kXMPErr_BadSchema );
 		}
 		if ( prefix != uriPos->second ) {
@@ -246,8 +419,9 @@ VerifyQualName ( XMP_StringPtr qualName, XMP_StringPtr nameEnd )
 
 	size_t prefixLen = colonPos - qualName + 1;	// ! Include the colon.
 	XMP_VarString prefix ( qualName, prefixLen );
-	XMP_StringMapPos prefixPos = sNamespacePrefixToURIMap->find ( prefix );
-	if ( prefixPos == sNamespacePrefixToURIMap->end() ) {
+	XMP_StringMap * prefixMap = sNamespacePrefixToURIMap;	// ! Load once, see XMPMeta::ParseMany.
+	XMP_StringMapPos prefixPos = prefixMap->find ( prefix );
+	if ( prefixPos == prefixMap->end() ) {
 		XMP_Throw ( "Unknown namespace prefix for qualified name", kXMPErr_BadXPath );
 	}
 
@@ -853,6 +1027,7 @@ FindSchemaNode	( XMP_Node *		xmpTree,
 		if ( currSchema->name == nsURI ) {
 			schemaNode = currSchema;
 			if ( ptrPos != 0 ) *ptrPos = xmpTree->children.begin() + schemaNum;
+			if ( IsLazySchema ( schemaNode ) ) MaterializeSchema ( schemaNode );
 			break;
 		}
 	}
@@ -1324,7 +1499,7 @@ void
 DeleteEmptySchema ( XMP_Node * schemaNode )
 {
 
-	if ( XMP_NodeIsSchema ( schemaNode->options ) && schemaNode->children.empty() ) {
+	if ( XMP_NodeIsSchema ( schemaNode->options ) && schemaNode->children.empty() && (! IsLazySchema ( schemaNode )) ) {
 
 		XMP_Node * xmpTree = schemaNode->parent;
 
@@ -24,6 +24,7 @@
 #include <map>
 
 #include <cassert>
+#include <cstring>
 
 #if XMP_MacBuild
 	#include <Multiprocessing.h>
@@ -68,8 +69,10 @@ extern XMP_Int32 sXMP_InitCount;
 
 extern XMP_AliasMap *	sRegisteredAliasMap;
 
-extern XMP_StringMap *	sNamespaceURIToPrefixMap;
-extern XMP_StringMap *	sNamespacePrefixToURIMap;
+// ! The namespace maps are replaced, not modified, while XMPMeta::ParseMany has worker threads
+// ! running. Code that can run in a worker must load each map pointer once and use that copy.
+extern XMP_StringMap * volatile	sNamespaceURIToPrefixMap;
+extern XMP_StringMap * volatile	sNamespacePrefixToURIMap;
 
 extern XMP_VarString *	sOutputNS;
 extern XMP_VarString *	sOutputStr;
@@ -210,6 +213,66 @@ extern void XMP_TermMutex ( XMP_Mutex & mutex );
 extern void XMP_EnterCriticalRegion ( XMP_Mutex & mutex );
 extern void XMP_ExitCriticalRegion ( XMP_Mutex & mutex );
 
+extern void XMP_MemoryBarrier();
+
+// -------------------------------------------------------------------------------------------------
+// Namespace registration from parallel parsing. The worker threads of XMPMeta::ParseMany run while
+// the caller holds sXMPCoreLock, RegisterNamespace serializes them with sNamespaceLock. Lookups take
+// no lock at all. While sParallelParsing is true RegisterNamespace builds new maps and publishes
+// them, the old maps are saved in sRetiredNamespaceMaps until ParseMany has joined its workers.
+
+extern XMP_Mutex sNamespaceLock;
+extern bool sParallelParsing;
+extern std::vector<XMP_StringMap*> * sRetiredNamespaceMaps;
+
+class XMP_NamespaceAutoMutex {
+public:
+	XMP_NamespaceAutoMutex() { XMP_EnterCriticalRegion ( sNamespaceLock ); };
+	~XMP_NamespaceAutoMutex() { XMP_ExitCriticalRegion ( sNamespaceLock ); };
+};
+
+// -------------------------------------------------------------------------------------------------
+// Minimal worker thread support, used by XMPMeta::ParseMany and XMPFiles::GetXMPBatch. A thread is
+// started, runs the proc once, and is joined. There is no detach or cancel. If XMP_StartThread
+// returns false the caller must do the work itself.
+
+typedef void (* XMP_ThreadProc) ( void * procArg );
+
+struct XMP_Thread {
+	XMP_ThreadProc proc;
+	void * procArg;
+	#if XMP_MacBuild
+		MPTaskID  taskID;
+		MPQueueID doneQueue;
+	#elif XMP_WinBuild
+		HANDLE    handle;
+	#elif XMP_UNIXBuild
+		pthread_t thread;
+	#endif
+};
+
+extern bool XMP_StartThread ( XMP_Thread * thread, XMP_ThreadProc proc, void * procArg );
+extern void XMP_JoinThread ( XMP_Thread * thread );
+
+// -------------------------------------------------------------------------------------------------
+// Per-thread values, used by the XMPFiles performance counters. A key holds one pointer for each
+// thread, 0 until the thread sets it. These use the OS thread storage and not compiler thread
+// locals, which don't work in a DLL loaded with LoadLibrary before Vista.
+
+#if XMP_MacBuild
+	typedef TaskStorageIndex XMP_ThreadKey;
+#elif XMP_WinBuild
+	typedef DWORD XMP_ThreadKey;
+#elif XMP_UNIXBuild
+	typedef pthread_key_t XMP_ThreadKey;
+#endif
+
+extern bool XMP_InitThreadKey ( XMP_ThreadKey * key );
+extern void XMP_TermThreadKey ( XMP_ThreadKey & key );
+
+extern void * XMP_GetThreadValue ( XMP_ThreadKey & key );
+extern void XMP_SetThreadValue ( XMP_ThreadKey & key, void * value );
+
 class XMP_AutoMutex {
 public:
 	XMP_AutoMutex() : mutex(&sXMPCoreLock) { XMP_EnterCriticalRegion ( *mutex ); ReportLock(); };
@@ -624,7 +687,61 @@ private:
 
 };
 
-extern void ProcessRDF ( XMP_Node * xmpTree, const XML_Node & xmlTree, XMP_OptionBits options );
+// The namespace filter used by ProcessRDF, set by XMPMeta::SetParseFilter. The mode is zero for no
+// filtering, or one of kXMP_ParseOnlySchemas and kXMP_ParseSkipSchemas. The schemas are sorted.
+
+struct XMP_SchemaFilter {
+	XMP_OptionBits mode;
+	std::vector<XMP_VarString> schemas;
+	XMP_SchemaFilter() : mode(0) {};
+};
+
+// Lazy schemas, see kXMP_ParseLazySchemas. A lazy schema node has no children yet, it has the top
+// level XML nodes of its properties instead. These are converted by MaterializeSchema, which is
+// called by FindSchemaNode. Code that gets to a schema through FindSchemaNode never sees a lazy
+// one. Code that walks the schema nodes directly must call MaterializeAllSchemas first, or use
+// IsLazySchema to not treat a lazy schema as empty. The XML tree is shared by all of the lazy
+// schemas from one parse. It is deleted when the last of them is materialized or deleted.
+
+enum { kXMP_SchemaIsLazy = 0x40000000UL };	// ! Must fit within kXMP_ImplReservedMask!
+
+#define IsLazySchema(node)	(((node)->options & kXMP_SchemaIsLazy) != 0)
+
+class XMLParserAdapter;
+
+class XMP_LazyXML {
+public:
+	XMLParserAdapter * xmlParser;	// Owns the XML tree.
+	XMP_Int32		   refCount;
+	XMP_LazyXML ( XMLParserAdapter * _xmlParser ) : xmlParser(_xmlParser), refCount(1) {};
+};
+
+extern void ReleaseLazyXML ( XMP_LazyXML * lazyXML );
+
+class XMP_LazySchemaNode : public XMP_Node {
+public:
+
+	XMP_LazyXML *	xmlOwner;	// Zero once materialized.
+	std::vector<const XML_Node*> xmlProps;	// Property elements and attributes, in document order.
+
+	XMP_LazySchemaNode ( XMP_Node * _parent, const XMP_VarString & _name, const XMP_VarString & _value, XMP_LazyXML * _xmlOwner )
+		: XMP_Node ( _parent, _name, _value, (kXMP_SchemaNode | kXMP_SchemaIsLazy) ), xmlOwner(_xmlOwner)
+	{
+		++xmlOwner->refCount;
+	};
+	
+	virtual ~XMP_LazySchemaNode() { if ( xmlOwner != 0 ) ReleaseLazyXML ( xmlOwner ); };
+
+};
+
+extern void MaterializeSchema ( XMP_Node * schemaNode );
+extern void MaterializeAllSchemas ( XMP_Node * xmpTree );
+
+// ProcessRDF takes over the caller's reference to the lazyXML, which is null unless parsing with
+// kXMP_ParseLazySchemas.
+
+extern void ProcessRDF ( XMP_Node * xmpTree, const XML_Node & xmlTree, XMP_OptionBits options,
+						 const XMP_SchemaFilter & filter, XMP_LazyXML * lazyXML );
 
 // =================================================================================================
 
@@ -0,0 +1,128 @@
+// =================================================================================================
+// Copyright 2002-2007 Adobe Systems Incorporated
+// All Rights Reserved.
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+// =================================================================================================
+
+#include "XMP_Environment.h"	// ! Must be the first #include!
+#include "XMPCore_Impl.hpp"
+
+#include "XMPFlatTree.hpp"
+
+#include <string.h>
+
+using namespace std;
+
+#if XMP_WinBuild
+	#pragma warning ( disable : 4800 )	// forcing value to bool 'true' or 'false' (performance warning)
+#endif
+
+// =================================================================================================
+// Support Routines
+// =================================================================================================
+
+typedef std::map < XMP_VarString, XMP_Uns32 > XMP_NameAtomMap;
+
+// -------------------------------------------------------------------------------------------------
+// AppendFlatNode
+// --------------
+//
+// Append a flat node for an XMP_Node. The offspring ranges are filled in when the new node is
+// reached by the breadth first loop in Flatten.
+
+static void
+AppendFlatNode ( XMP_FlatTree * flatTree, XMP_NameAtomMap * nameAtoms, const XMP_Node * origNode, XMP_Uns32 parent )
+{
+	XMP_FlatNode flatNode;
+	memset ( &flatNode, 0, sizeof(flatNode) );
+
+	flatNode.options = origNode->options;
+	flatNode.parent  = parent;
+
+	XMP_NameAtomMap::iterator atomPos = nameAtoms->find ( origNode->name );
+	if ( atomPos != nameAtoms->end() ) {
+		flatNode.nameAtom = atomPos->second;
+	} else {
+		flatNode.nameAtom = (XMP_Uns32)flatTree->nameOffsets.size();
+		flatTree->nameOffsets.push_back ( (XMP_Uns32)flatTree->namePool.size() );
+		flatTree->namePool.append ( origNode->name.c_str(), origNode->name.size()+1 );	// Include the nul.
+		nameAtoms->insert ( atomPos, XMP_NameAtomMap::value_type ( origNode->name, flatNode.nameAtom ) );
+	}
+
+	flatNode.valueOffset = (XMP_Uns32)flatTree->valuePool.size();
+	flatNode.valueLen    = (XMP_Uns32)origNode->value.size();
+	flatTree->valuePool.append ( origNode->value.c_str(), origNode->value.size()+1 );	// Include the nul.
+
+	flatTree->nodes.push_back ( flatNode );
+
+}	// AppendFlatNode
+
+// =================================================================================================
+// Class Methods
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+// Clear
+// -----
+
+void
+XMP_FlatTree::Clear()
+{
+
+	this->nodes.clear();
+	this->nameOffsets.clear();
+	this->namePool.erase();
+	this->valuePool.erase();
+
+}	// XMP_FlatTree::Clear
+
+// -------------------------------------------------------------------------------------------------
+// Flatten
+// -------
+//
+// The flat nodes are appended breadth first, origNodes parallels the flat nodes. Each node's
+// offspring are appended when the loop reaches it, that keeps each range contiguous.
+
+void
+XMP_FlatTree::Flatten ( const XMP_Node & root )
+{
+	XMP_NameAtomMap nameAtoms;
+	std::vector<const XMP_Node*> origNodes;
+
+	this->Clear();
+
+	origNodes.push_back ( &root );
+	AppendFlatNode ( this, &nameAtoms, &root, kXMP_FlatNoIndex );
+
+	for ( size_t nodeNum = 0; nodeNum < origNodes.size(); ++nodeNum ) {
+
+		const XMP_Node * origNode = origNodes[nodeNum];
+		if ( IsLazySchema ( origNode ) ) XMP_Throw ( "Can't flatten a lazy schema", kXMPErr_InternalFailure );
+
+		XMP_Uns32 firstQual = (XMP_Uns32)this->nodes.size();
+		for ( size_t qualNum = 0, qualLim = origNode->qualifiers.size(); qualNum < qualLim; ++qualNum ) {
+			const XMP_Node * currQual = origNode->qualifiers[qualNum];
+			origNodes.push_back ( currQual );
+			AppendFlatNode ( this, &nameAtoms, currQual, (XMP_Uns32)nodeNum );
+		}
+
+		XMP_Uns32 firstChild = (XMP_Uns32)this->nodes.size();
+		for ( size_t childNum = 0, childLim = origNode->children.size(); childNum < childLim; ++childNum ) {
+			const XMP_Node * currChild = origNode->children[childNum];
+			origNodes.push_back ( currChild );
+			AppendFlatNode ( this, &nameAtoms, currChild, (XMP_Uns32)nodeNum );
+		}
+
+		XMP_FlatNode & flatNode = this->nodes[nodeNum];	// ! Not until after the appends!
+		flatNode.firstQual  = firstQual;
+		flatNode.qualCount  = (XMP_Uns32)origNode->qualifiers.size();
+		flatNode.firstChild = firstChild;
+		flatNode.childCount = (XMP_Uns32)origNode->children.size();
+
+	}
+
+}	// XMP_FlatTree::Flatten
+
+// =================================================================================================
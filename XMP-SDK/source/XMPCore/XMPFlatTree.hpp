@@ -0,0 +1,63 @@
+#ifndef __XMPFlatTree_hpp__
+#define __XMPFlatTree_hpp__
+
+// =================================================================================================
+// Copyright 2002-2007 Adobe Systems Incorporated
+// All Rights Reserved.
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+// =================================================================================================
+
+#include "XMP_Environment.h"	// ! Must be the first #include!
+#include "XMPCore_Impl.hpp"
+
+// =================================================================================================
+// A compact, read-only form of an XMP_Node tree. The XMP_Node tree stays the live representation,
+// Flatten builds this form from it. SerializeToSnapshot writes it out as the body of a snapshot.
+//
+// The nodes are stored contiguously, nodes[0] is the root. The qualifiers of a node are a contiguous
+// range of nodes, as are its children, so offspring are found by index and walked sequentially. The
+// ranges are laid out breadth first, a node's qualifiers followed by its children. A node has no
+// vtable and no strings of its own. Names are atomized, each distinct name is stored once in the
+// name pool. Values are stored in one value pool. Both pools hold nul terminated strings.
+//
+// Flatten requires a tree without lazy schemas, call MaterializeAllSchemas first.
+// =================================================================================================
+
+enum { kXMP_FlatNoIndex = 0xFFFFFFFFUL };	// The parent of the root.
+
+struct XMP_FlatNode {	// ! Must stay a POD.
+	XMP_OptionBits	options;
+	XMP_Uns32		nameAtom;		// Index into nameOffsets.
+	XMP_Uns32		valueOffset;	// Offset into valuePool.
+	XMP_Uns32		valueLen;
+	XMP_Uns32		parent;			// Index into nodes, kXMP_FlatNoIndex for the root.
+	XMP_Uns32		firstQual, qualCount;
+	XMP_Uns32		firstChild, childCount;
+};
+
+class XMP_FlatTree {
+public:
+
+	std::vector<XMP_FlatNode>	nodes;
+	std::vector<XMP_Uns32>		nameOffsets;	// Atom to name, the offset in namePool.
+	XMP_VarString				namePool, valuePool;
+
+	XMP_FlatTree() {};
+
+	void Clear();
+
+	void Flatten ( const XMP_Node & root );
+
+	XMP_StringPtr Name ( const XMP_FlatNode & node ) const
+		{ return namePool.c_str() + nameOffsets[node.nameAtom]; };
+
+	XMP_StringPtr Value ( const XMP_FlatNode & node ) const
+		{ return valuePool.c_str() + node.valueOffset; };
+
+};
+
+// =================================================================================================
+
+#endif	// __XMPFlatTree_hpp__
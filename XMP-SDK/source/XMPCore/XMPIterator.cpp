@@ -501,6 +501,8 @@ XMPIterator::XMPIterator ( const XMPMeta & xmpObj,
 		
 		// First pick up the schema that exist.
 		
+		MaterializeAllSchemas ( const_cast<XMP_Node*>(&xmpObj.tree) );
+		
 		for ( size_t schemaNum = 0, schemaLim = xmpObj.tree.children.size(); schemaNum != schemaLim; ++schemaNum ) {
 
 			const XMP_Node * xmpSchema = xmpObj.tree.children[schemaNum];
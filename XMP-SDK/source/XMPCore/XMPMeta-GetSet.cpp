@@ -364,6 +364,56 @@ XMPMeta::GetProperty ( XMP_StringPtr	schemaNS,
 }	// GetProperty
 
 
+// -------------------------------------------------------------------------------------------------
+// GetPropertyBatch
+// ----------------
+//
+// The values are packed into sOutputStr, each followed by a nul. They are located by offset, so
+// growing the string does not invalidate earlier results. The wrapper keeps the lock until the
+// client has copied the arena.
+
+XMP_Index
+XMPMeta::GetPropertyBatch ( XMP_Index				propCount,
+							const XMP_StringPtr *	schemaNS,
+							const XMP_StringPtr *	propNames,
+							XMP_PropertyBatchInfo *	propInfo,
+							XMP_StringPtr *			valueArena,
+							XMP_StringLen *			arenaSize ) const
+{
+	XMP_Assert ( (propCount == 0) || ((schemaNS != 0) && (propNames != 0) && (propInfo != 0)) );	// Enforced by wrapper.
+	XMP_Assert ( (valueArena != 0) && (arenaSize != 0) );	// Enforced by wrapper.
+
+	XMP_Index foundCount = 0;
+	sOutputStr->erase();	// ! Keeps the capacity from earlier calls.
+
+	for ( XMP_Index i = 0; i < propCount; ++i ) {
+	
+		XMP_PropertyBatchInfo & info = propInfo[i];
+		info = XMP_PropertyBatchInfo();
+
+		XMP_StringPtr  value;
+		XMP_StringLen  valueLen;
+		XMP_OptionBits options;
+		if ( ! this->GetProperty ( schemaNS[i], propNames[i], &value, &valueLen, &options ) ) continue;
+		
+		info.valueOffset = sOutputStr->size();
+		info.valueLen    = valueLen;
+		info.options     = options;
+		info.found       = true;
+		
+		sOutputStr->append ( value, valueLen );
+		sOutputStr->append ( 1, 0 );
+		++foundCount;
+	
+	}
+	
+	*valueArena = sOutputStr->c_str();
+	*arenaSize  = sOutputStr->size();
+	return foundCount;
+	
+}	// GetPropertyBatch
+
+
 // -------------------------------------------------------------------------------------------------
 // GetArrayItem
 // ------------
@@ -18,6 +18,9 @@
 #include "UnicodeInlines.incl_cpp"
 #include "UnicodeConversions.hpp"
 #include "ExpatAdapter.hpp"
+#include "FastXMLAdapter.hpp"
+
+#include <algorithm>
 
 #if XMP_DebugBuild
 	#include <iostream>
@@ -475,7 +478,7 @@ MoveExplicitAliases ( XMP_Node * tree, XMP_OptionBits parseOptions )
 		}	// Property loop
 		
 		// Increment the counter or remove an empty schema node.
-		if ( currSchema->children.size() > 0 ) {
+		if ( (currSchema->children.size() > 0) || IsLazySchema ( currSchema ) ) {
 			++schemaNum;
 		} else {
 			delete tree->children[schemaNum];	// ! Delete the schema node itself.
@@ -517,11 +520,10 @@ FixGPSTimeStamp ( XMP_Node * exifSchema, XMP_Node * gpsDateTime )
 	binGPSStamp.month = binOtherDate.month;
 	binGPSStamp.day   = binOtherDate.day;
 
-	XMP_StringPtr goodStr;
-	XMP_StringLen goodLen;
-	XMPUtils::ConvertFromDate ( binGPSStamp, &goodStr, &goodLen );
+	XMP_VarString goodStr;
+	XMPUtils::ConvertFromDate ( binGPSStamp, &goodStr );	// ! Not the static output string, see ParseMany.
 	
-	gpsDateTime->value.assign ( goodStr, goodLen );
+	gpsDateTime->value.swap ( goodStr );
 
 }	// FixGPSTimeStamp
 
@@ -1057,6 +1059,40 @@ ProcessUTF8Portion ( XMLParserAdapter * xmlParser,
 }	// ProcessUTF8Portion
 
 
+// -------------------------------------------------------------------------------------------------
+// SetParseFilter
+// --------------
+//
+// The filter is only used by ProcessRDF, after the XML tree is built. It may be changed between the
+// buffers of a parse, the one set when the last buffer is passed is used.
+
+void
+XMPMeta::SetParseFilter ( XMP_OptionBits		  filterMode,
+						  const XMP_StringPtr * schemaList,
+						  XMP_Index				  schemaCount )
+{
+	if ( (filterMode != 0) && (filterMode != kXMP_ParseOnlySchemas) && (filterMode != kXMP_ParseSkipSchemas) ) {
+		XMP_Throw ( "Invalid parse filter mode", kXMPErr_BadOptions );
+	}
+	if ( schemaCount < 0 ) XMP_Throw ( "Negative schema count", kXMPErr_BadParam );
+	if ( (schemaList == 0) && (schemaCount != 0) ) XMP_Throw ( "Null schema list", kXMPErr_BadParam );
+	
+	std::vector<XMP_VarString> schemas;
+	if ( filterMode != 0 ) {
+		schemas.reserve ( schemaCount );
+		for ( XMP_Index i = 0; i < schemaCount; ++i ) {
+			if ( (schemaList[i] == 0) || (*schemaList[i] == 0) ) XMP_Throw ( "Empty schema namespace URI", kXMPErr_BadSchema );
+			schemas.push_back ( XMP_VarString ( schemaList[i] ) );
+		}
+		std::sort ( schemas.begin(), schemas.end() );
+	}
+	
+	this->parseFilter.mode = filterMode;
+	this->parseFilter.schemas.swap ( schemas );
+
+}	// SetParseFilter
+
+
 // -------------------------------------------------------------------------------------------------
 // ParseFromBuffer
 // ---------------
@@ -1087,7 +1123,11 @@ XMPMeta::ParseFromBuffer ( XMP_StringPtr  buffer,
 
 	if ( this->xmlParser == 0 ) {
 		if ( (xmpSize == 0) && lastClientCall ) return;	// Tolerate empty parse. Expat complains if there are no XML elements.
-		this->xmlParser = new ExpatAdapter;
+		if ( options & kXMP_ParseFastXML ) {
+			this->xmlParser = new FastXMLAdapter;
+		} else {
+			this->xmlParser = new ExpatAdapter;
+		}
 	}
 	
 	XMLParserAdapter& parser = *this->xmlParser;
@@ -1251,7 +1291,14 @@ XMPMeta::ParseFromBuffer ( XMP_StringPtr  buffer,
 
 			if ( xmlRoot != 0 ) {
 
-				ProcessRDF ( &this->tree, *xmlRoot, options );
+				// With lazy schemas the XML tree is kept until the last lazy schema is materialized.
+				XMP_LazyXML * lazyXML = 0;
+				if ( options & kXMP_ParseLazySchemas ) {
+					lazyXML = new XMP_LazyXML ( this->xmlParser );
+					this->xmlParser = 0;
+				}
+
+				ProcessRDF ( &this->tree, *xmlRoot, options, this->parseFilter, lazyXML );
 				NormalizeDCArrays ( &this->tree );
 				if ( this->tree.options & kXMP_PropHasAliases ) MoveExplicitAliases ( &this->tree, options );
 				TouchUpDataModel ( this );
@@ -1260,7 +1307,7 @@ XMPMeta::ParseFromBuffer ( XMP_StringPtr  buffer,
 				size_t schemaNum = 0;
 				while ( schemaNum < this->tree.children.size() ) {
 					XMP_Node * currSchema = this->tree.children[schemaNum];
-					if ( currSchema->children.size() > 0 ) {
+					if ( (currSchema->children.size() > 0) || IsLazySchema ( currSchema ) ) {
 						++schemaNum;
 					} else {
 						delete this->tree.children[schemaNum];	// ! Delete the schema node itself.
@@ -1288,3 +1335,149 @@ XMPMeta::ParseFromBuffer ( XMP_StringPtr  buffer,
 }	// ParseFromBuffer
 
 // =================================================================================================
+
+enum { kDefaultParseThreads = 4, kMaxParseThreads = 64 };
+
+struct ParseManyJob {
+	XMP_Mutex             lock;		// Protects nextPacket.
+	XMP_Int32             nextPacket;
+	XMP_Int32             packetCount;
+	const XMP_StringPtr * packets;
+	const XMP_StringLen * packetLens;
+	XMP_OptionBits        options;
+	XMPMetaRef *          xmpRefs;
+	XMP_Int32 *           errorIDs;
+	XMP_StringPtr *       errorMsgs;
+};
+
+// -------------------------------------------------------------------------------------------------
+// ParseManyWorker
+// ---------------
+//
+// The thread proc for ParseMany, also run by the calling thread. Pull packet indices until there
+// are none left. All exceptions are caught and turned into the packet's error ID, which is never 0.
+
+static void
+ParseManyWorker ( void * procArg )
+{
+	ParseManyJob * job = (ParseManyJob*)procArg;
+	
+	while ( true ) {
+
+		XMP_EnterCriticalRegion ( job->lock );
+		XMP_Int32 packetIndex = job->nextPacket;
+		if ( packetIndex < job->packetCount ) ++job->nextPacket;
+		XMP_ExitCriticalRegion ( job->lock );
+		if ( packetIndex >= job->packetCount ) break;
+
+		XMP_Int32     errorID  = 0;
+		XMP_StringPtr errorMsg = 0;
+
+		try {
+			XMPMeta * xmpObj = WtoXMPMeta_Ptr ( job->xmpRefs[packetIndex] );
+			xmpObj->ParseFromBuffer ( job->packets[packetIndex], job->packetLens[packetIndex], job->options );
+		} catch ( XMP_Error & excep ) {
+			errorID  = excep.GetID();
+			errorMsg = excep.GetErrMsg();	// ! The core only throws literal messages.
+			if ( errorID == kXMPErr_Unknown ) errorID = kXMPErr_UnknownException;
+		} catch ( std::exception & ) {
+			errorID  = kXMPErr_StdException;
+			errorMsg = "Caught std::exception";
+		} catch ( ... ) {
+			errorID  = kXMPErr_UnknownException;
+			errorMsg = "Caught unknown exception";
+		}
+
+		job->errorIDs[packetIndex]  = errorID;
+		job->errorMsgs[packetIndex] = errorMsg;
+
+	}
+
+}	// ParseManyWorker
+
+// -------------------------------------------------------------------------------------------------
+// ParseMany
+// ---------
+//
+// Parse a set of complete packets into a set of distinct XMP objects using worker threads. The
+// caller holds the XMP lock, so the only concurrency is among the workers. Each parse only touches
+// its own XMP object, apart from the namespace registry. Lookups in that are lock-free, new
+// namespaces from the packets are added by RegisterNamespace as copy-on-write updates. The maps
+// that were replaced are freed here after the workers are joined.
+//
+// If errorIDs is null the first failure, in packet order, is thrown after all packets are done.
+
+/* class static */ void
+XMPMeta::ParseMany ( XMP_Int32             packetCount,
+					 const XMP_StringPtr * packets,
+					 const XMP_StringLen * packetLens,
+					 XMP_OptionBits        options,
+					 XMP_Int32             maxThreads,
+					 XMPMetaRef *          xmpRefs,
+					 XMP_Int32 *           errorIDs )
+{
+	if ( options & kXMP_ParseMoreBuffers ) XMP_Throw ( "XMPMeta::ParseMany - Packets must be complete", kXMPErr_BadOptions );
+	if ( packetCount < 0 ) XMP_Throw ( "XMPMeta::ParseMany - Negative packet count", kXMPErr_BadParam );
+	if ( packetCount == 0 ) return;
+	if ( (packets == 0) || (packetLens == 0) || (xmpRefs == 0) ) XMP_Throw ( "XMPMeta::ParseMany - Null parameter", kXMPErr_BadParam );
+	for ( XMP_Int32 i = 0; i < packetCount; ++i ) {
+		if ( xmpRefs[i] == 0 ) XMP_Throw ( "XMPMeta::ParseMany - Null XMP object", kXMPErr_BadParam );
+	}
+	
+	std::vector<XMPMetaRef> sortedRefs ( xmpRefs, (xmpRefs + packetCount) );	// Two workers must not share an object.
+	std::sort ( sortedRefs.begin(), sortedRefs.end() );
+	if ( std::adjacent_find ( sortedRefs.begin(), sortedRefs.end() ) != sortedRefs.end() ) {
+		XMP_Throw ( "XMPMeta::ParseMany - Repeated XMP object", kXMPErr_BadParam );
+	}
+	
+	std::vector<XMP_Int32>     localIDs;
+	std::vector<XMP_StringPtr> errorMsgs ( packetCount );
+	if ( errorIDs == 0 ) {
+		localIDs.resize ( packetCount );
+		errorIDs = &localIDs[0];
+	}
+
+	ParseManyJob job;
+	job.nextPacket  = 0;
+	job.packetCount = packetCount;
+	job.packets     = packets;
+	job.packetLens  = packetLens;
+	job.options     = options;
+	job.xmpRefs     = xmpRefs;
+	job.errorIDs    = errorIDs;
+	job.errorMsgs   = &errorMsgs[0];
+	
+	if ( maxThreads <= 0 ) maxThreads = kDefaultParseThreads;
+	if ( maxThreads > kMaxParseThreads ) maxThreads = kMaxParseThreads;
+	if ( maxThreads > packetCount ) maxThreads = packetCount;
+
+	if ( ! XMP_InitMutex ( &job.lock ) ) XMP_Throw ( "XMPMeta::ParseMany - Can't create mutex", kXMPErr_ExternalFailure );
+	
+	// The calling thread is one of the workers. A thread that fails to start is just not used. The
+	// namespace maps are only replaced while there are other threads.
+
+	XMP_Thread threads [kMaxParseThreads];
+	XMP_Int32  threadCount = 0;
+	sParallelParsing = (maxThreads > 1);
+	for ( XMP_Int32 i = 1; i < maxThreads; ++i ) {
+		if ( XMP_StartThread ( &threads[threadCount], ParseManyWorker, &job ) ) ++threadCount;
+	}
+	
+	ParseManyWorker ( &job );
+	for ( XMP_Int32 i = 0; i < threadCount; ++i ) XMP_JoinThread ( &threads[i] );
+	sParallelParsing = false;
+
+	XMP_TermMutex ( job.lock );
+	
+	for ( size_t i = 0; i < sRetiredNamespaceMaps->size(); ++i ) delete (*sRetiredNamespaceMaps)[i];
+	sRetiredNamespaceMaps->clear();
+	
+	if ( ! localIDs.empty() ) {
+		for ( XMP_Int32 i = 0; i < packetCount; ++i ) {
+			if ( localIDs[i] != 0 ) XMP_Throw ( errorMsgs[i], localIDs[i] );
+		}
+	}
+
+}	// ParseMany
+
+// =================================================================================================
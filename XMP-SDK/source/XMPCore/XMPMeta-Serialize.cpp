@@ -86,52 +86,6 @@ static const char * kRDF_ValueEnd     = "</rdf:value>";
 // ===============
 
 
-// -------------------------------------------------------------------------------------------------
-// EstimateRDFSize
-// ---------------
-
-//  *** Pull the strlen(kXyz) calls into constants.
-
-static size_t
-EstimateRDFSize ( const XMP_Node * currNode, XMP_Index indent, size_t indentLen )
-{
-	size_t outputLen = 2 * (indent*indentLen + currNode->name.size() + 4);	// The property element tags.
-	
-	if ( ! currNode->qualifiers.empty() ) {
-		// This node has qualifiers, assume it is written using rdf:value and estimate the qualifiers.
-
-		indent += 2;	// Everything else is indented inside the rdf:Description element.
-		outputLen += 2 * ((indent-1)*indentLen + strlen(kRDF_StructStart) + 2);	// The rdf:Description tags.
-		outputLen += 2 * (indent*indentLen + strlen(kRDF_ValueStart) + 2);		// The rdf:value tags.
-
-		for ( size_t qualNum = 0, qualLim = currNode->qualifiers.size(); qualNum < qualLim; ++qualNum ) {
-			const XMP_Node * currQual = currNode->qualifiers[qualNum];
-			outputLen += EstimateRDFSize ( currQual, indent, indentLen );
-		}
-
-	}
-	
-	if ( currNode->options & kXMP_PropValueIsStruct ) {
-		indent += 1;
-		outputLen += 2 * (indent*indentLen + strlen(kRDF_StructStart) + 2);	// The rdf:Description tags.
-	} else if ( currNode->options & kXMP_PropValueIsArray ) {
-		indent += 2;
-		outputLen += 2 * ((indent-1)*indentLen + strlen(kRDF_BagStart) + 2);		// The rdf:Bag/Seq/Alt tags.
-		outputLen += 2 * currNode->children.size() * (strlen(kRDF_ItemStart) + 2);	// The rdf:li tags, indent counted in children.
-	} else if ( ! (currNode->options & kXMP_SchemaNode) ) {
-		outputLen += currNode->value.size();	// This is a leaf value node.
-	}
-
-	for ( size_t childNum = 0, childLim = currNode->children.size(); childNum < childLim; ++childNum ) {
-		const XMP_Node * currChild = currNode->children[childNum];
-		outputLen += EstimateRDFSize ( currChild, indent+1, indentLen );
-	}
-
-	return outputLen;
-	
-}	// EstimateRDFSize
-
-
 // -------------------------------------------------------------------------------------------------
 // DeclareOneNamespace
 // -------------------
@@ -271,15 +225,114 @@ EmitRDFArrayTag	( XMP_OptionBits  arrayForm,
 }	// EmitRDFArrayTag
 
 
+// -------------------------------------------------------------------------------------------------
+// Value Escaping Tables
+// ---------------------
+//
+// The escaped characters for elements and attributes are '&', '<', '>', and ASCII controls (tab,
+// LF, CR). In addition, '"' is escaped for attributes. The tables give the length of the escaped
+// form of each byte, zero means the byte is copied unchanged. The controls are written as "&#xn;".
+
+static const XMP_Uns8 kElemEscapeLen [256] = {
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,	// 0x00 .. 0x0F
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,	// 0x10 .. 0x1F
+	0, 0, 0, 0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x20 .. 0x2F, '&' is 0x26
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 4, 0	// 0x30 .. 0x3F, '<' is 0x3C, '>' is 0x3E
+};	// ! The remaining entries are implicitly zero.
+
+static const XMP_Uns8 kAttrEscapeLen [256] = {
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,	// 0x00 .. 0x0F
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,	// 0x10 .. 0x1F
+	0, 0, 6, 0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x20 .. 0x2F, '"' is 0x22, '&' is 0x26
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 4, 0	// 0x30 .. 0x3F, '<' is 0x3C, '>' is 0x3E
+};	// ! The remaining entries are implicitly zero.
+
+// -------------------------------------------------------------------------------------------------
+// WordNeedsEscape
+// ---------------
+//
+// Check 8 bytes at once for anything that might need escaping. This uses the usual "has zero byte"
+// bit trick, (x - 0x01..01) & ~x & 0x80..80 is nonzero iff some byte of x is zero, or with a
+// subtrahend of 0x20..20 iff some byte of x is less than 0x20. Bytes with the high bit set, i.e.
+// non-ASCII UTF-8, never match. A borrow can make a byte above a real match look like a match too,
+// that is harmless since the caller only uses the result to decide whether to look byte by byte.
+
+static const XMP_Uns64 kAllOnes  = 0x0101010101010101ULL;
+static const XMP_Uns64 kAllHighs = 0x8080808080808080ULL;
+
+#define HasZeroByte(x)		(((x) - kAllOnes) & ~(x) & kAllHighs)
+#define HasByteBelow(x,n)	(((x) - kAllOnes*(n)) & ~(x) & kAllHighs)
+#define HasByte(x,n)		HasZeroByte ( (x) ^ (kAllOnes*(n)) )
+
+static inline bool
+WordNeedsEscape ( XMP_Uns64 word, bool forAttribute )
+{
+	XMP_Uns64 hits = HasByteBelow ( word, 0x20 ) | HasByte ( word, '&' ) | HasByte ( word, '<' ) | HasByte ( word, '>' );
+	if ( forAttribute ) hits |= HasByte ( word, '"' );
+	return (hits != 0);
+}	// WordNeedsEscape
+
+// -------------------------------------------------------------------------------------------------
+// FindEscapeChar
+// --------------
+//
+// Return a pointer to the first byte in [runStart,runLimit) that needs escaping, or runLimit. The
+// bulk of a typical value is skipped 8 bytes at a time, the bytes of a flagged word and the tail
+// are checked with the table.
+
+static const unsigned char *
+FindEscapeChar ( const unsigned char * runStart, const unsigned char * runLimit, const XMP_Uns8 * escapeLen, bool forAttribute )
+{
+	const unsigned char * runEnd = runStart;
+	XMP_Uns64 word;
+
+	while ( (runLimit - runEnd) >= 8 ) {
+		memcpy ( &word, runEnd, 8 );	// ! Avoid alignment issues, endianness does not matter here.
+		if ( WordNeedsEscape ( word, forAttribute ) ) break;
+		runEnd += 8;
+	}
+
+	for ( ; runEnd < runLimit; ++runEnd ) {
+		if ( escapeLen[*runEnd] != 0 ) break;
+	}
+	
+	return runEnd;
+
+}	// FindEscapeChar
+
+// -------------------------------------------------------------------------------------------------
+// EscapedValueSize
+// ----------------
+//
+// The exact size of a value after AppendNodeValue's escaping.
+
+static size_t
+EscapedValueSize ( const XMP_VarString & value, bool forAttribute )
+{
+	const XMP_Uns8 * escapeLen = (forAttribute ? kAttrEscapeLen : kElemEscapeLen);
+	const unsigned char * runStart = (const unsigned char *) value.c_str();
+	const unsigned char * runLimit = runStart + value.size();
+	size_t escapedSize = value.size();
+	
+	while ( true ) {
+		runStart = FindEscapeChar ( runStart, runLimit, escapeLen, forAttribute );
+		if ( runStart == runLimit ) break;
+		escapedSize += escapeLen[*runStart] - 1;
+		++runStart;
+	}
+	
+	return escapedSize;
+
+}	// EscapedValueSize
+
 // -------------------------------------------------------------------------------------------------
 // AppendNodeValue
 // ---------------
 //
-// Append a property or qualifier value to the output with appropriate XML escaping. The escaped
-// characters for elements and attributes are '&', '<', '>', and ASCII controls (tab, LF, CR). In
-// addition, '"' is escaped for attributes. For efficiency, this is done in a double loop. The outer
-// loop makes sure the whole value is processed. The inner loop does a contiguous unescaped run
-// followed by one escaped character (if we're not at the end).
+// Append a property or qualifier value to the output with appropriate XML escaping, see the tables
+// above. For efficiency, this is done in a double loop. The outer loop makes sure the whole value
+// is processed. The inner search (FindEscapeChar) finds a contiguous unescaped run, which is then
+// appended in one piece followed by one escaped character (if we're not at the end).
 //
 // We depend on parsing and SetProperty logic to make sure there are no invalid ASCII controls in
 // the XMP values. The XML spec only allows tab, LF, and CR. Others are not even allowed as
@@ -294,45 +347,39 @@ static void
 AppendNodeValue ( XMP_VarString & outputStr, const XMP_VarString & value, bool forAttribute )
 {
 
-	unsigned char * runStart = (unsigned char *) value.c_str();
-	unsigned char * runLimit  = runStart + value.size();
-	unsigned char * runEnd;
-	unsigned char   ch;
+	const XMP_Uns8 * escapeLen = (forAttribute ? kAttrEscapeLen : kElemEscapeLen);
+	const unsigned char * runStart = (const unsigned char *) value.c_str();
+	const unsigned char * runLimit = runStart + value.size();
+	const unsigned char * runEnd;
+	unsigned char ch;
 	
 	while ( runStart < runLimit ) {
 	
-		for ( runEnd = runStart; runEnd < runLimit; ++runEnd ) {
-			ch = *runEnd;
-			if ( forAttribute && (ch == '"') ) break;
-			if ( (ch < 0x20) || (ch == '&') || (ch == '<') || (ch == '>') ) break;
-		}
-		
-		outputStr.append ( (char *) runStart, (runEnd - runStart) );
+		runEnd = FindEscapeChar ( runStart, runLimit, escapeLen, forAttribute );
+		outputStr.append ( (const char *) runStart, (runEnd - runStart) );
 		
 		if ( runEnd < runLimit ) {
 
+			ch = *runEnd;
+
 			if ( ch < 0x20 ) {
 			
 				XMP_Assert ( (ch == kTab) || (ch == kLF) || (ch == kCR) );
 
-				char hexBuf[16];
-				memcpy ( hexBuf, "&#xn;", 10 );	// AUDIT: Length of "&#xn;" is 5, hexBuf size is 16.
+				char hexBuf[8];
+				memcpy ( hexBuf, "&#xn;", 6 );	// AUDIT: Length of "&#xn;" is 5, hexBuf size is 8.
 				hexBuf[3] = kHexDigits[ch&0xF];
 				outputStr.append ( hexBuf, 5 );
 
+			} else if ( ch == '"' ) {
+				outputStr.append ( "&quot;", 6 );
+			} else if ( ch == '<' ) {
+				outputStr.append ( "&lt;", 4 );
+			} else if ( ch == '>' ) {
+				outputStr.append ( "&gt;", 4 );
 			} else {
-
-				if ( ch == '"' ) {
-					outputStr += "&quot;";
-				} else if ( ch == '<' ) {
-					outputStr += "&lt;";
-				} else if ( ch == '>' ) {
-					outputStr += "&gt;";
-				} else {
-					XMP_Assert ( ch == '&' );
-					outputStr += "&amp;";
-				}
-
+				XMP_Assert ( ch == '&' );
+				outputStr.append ( "&amp;", 5 );
 			}
 
 			++runEnd;
@@ -346,6 +393,82 @@ AppendNodeValue ( XMP_VarString & outputStr, const XMP_VarString & value, bool f
 }	// AppendNodeValue
 
 
+// -------------------------------------------------------------------------------------------------
+// EstimateRDFSize
+// ---------------
+
+// Estimate the worst case size of the RDF for a node. The structure is assumed to be written in
+// the pretty form, the values are counted exactly including character entities. Attribute escaping
+// is used for all values since it is a superset of element escaping.
+//
+//  *** Pull the strlen(kXyz) calls into constants.
+
+static size_t
+EstimateRDFSize ( const XMP_Node * currNode, XMP_Index indent, size_t indentLen )
+{
+	size_t outputLen = 2 * (indent*indentLen + currNode->name.size() + 4);	// The property element tags.
+	
+	if ( ! currNode->qualifiers.empty() ) {
+		// This node has qualifiers, assume it is written using rdf:value and estimate the qualifiers.
+
+		indent += 2;	// Everything else is indented inside the rdf:Description element.
+		outputLen += 2 * ((indent-1)*indentLen + strlen(kRDF_StructStart) + 2);	// The rdf:Description tags.
+		outputLen += 2 * (indent*indentLen + strlen(kRDF_ValueStart) + 2);		// The rdf:value tags.
+
+		for ( size_t qualNum = 0, qualLim = currNode->qualifiers.size(); qualNum < qualLim; ++qualNum ) {
+			const XMP_Node * currQual = currNode->qualifiers[qualNum];
+			outputLen += EstimateRDFSize ( currQual, indent, indentLen );
+		}
+
+	}
+	
+	if ( currNode->options & kXMP_PropValueIsStruct ) {
+		indent += 1;
+		outputLen += 2 * (indent*indentLen + strlen(kRDF_StructStart) + 2);	// The rdf:Description tags.
+	} else if ( currNode->options & kXMP_PropValueIsArray ) {
+		indent += 2;
+		outputLen += 2 * ((indent-1)*indentLen + strlen(kRDF_BagStart) + 2);		// The rdf:Bag/Seq/Alt tags.
+		outputLen += 2 * currNode->children.size() * (strlen(kRDF_ItemStart) + 2);	// The rdf:li tags, indent counted in children.
+	} else if ( ! (currNode->options & kXMP_SchemaNode) ) {
+		outputLen += EscapedValueSize ( currNode->value, kForAttribute );	// This is a leaf value node.
+	}
+
+	for ( size_t childNum = 0, childLim = currNode->children.size(); childNum < childLim; ++childNum ) {
+		const XMP_Node * currChild = currNode->children[childNum];
+		outputLen += EstimateRDFSize ( currChild, indent+1, indentLen );
+	}
+
+	return outputLen;
+	
+}	// EstimateRDFSize
+
+
+// -------------------------------------------------------------------------------------------------
+// EstimateXMLSize
+// ---------------
+//
+// Estimate the size of the RDF for a kept XML node of a lazy schema. The values are counted without
+// escaping, the fudge factor in SerializeAsRDF covers the usually few character entities.
+
+static size_t
+EstimateXMLSize ( const XML_Node * xmlNode, XMP_Index indent, size_t indentLen )
+{
+	size_t outputLen = 2 * (indent*indentLen + xmlNode->name.size() + 4) + xmlNode->value.size();
+
+	for ( size_t attrNum = 0, attrLim = xmlNode->attrs.size(); attrNum < attrLim; ++attrNum ) {
+		const XML_Node * currAttr = xmlNode->attrs[attrNum];
+		outputLen += currAttr->name.size() + currAttr->value.size() + 4;
+	}
+
+	for ( size_t childNum = 0, childLim = xmlNode->content.size(); childNum < childLim; ++childNum ) {
+		outputLen += EstimateXMLSize ( xmlNode->content[childNum], indent+1, indentLen );
+	}
+
+	return outputLen;
+	
+}	// EstimateXMLSize
+
+
 // -------------------------------------------------------------------------------------------------
 // CanBeRDFAttrProp
 // ----------------
@@ -680,6 +803,181 @@ SerializePrettyRDFSchema ( const XMP_VarString & treeName,
 }	// SerializePrettyRDFSchema
 
 
+// -------------------------------------------------------------------------------------------------
+// DeclareXMLNamespaces
+// --------------------
+//
+// Declare the namespaces used by a kept XML node of a lazy schema, and by its attributes and
+// content. The XML names use the registered prefixes, see SetQualName in ExpatAdapter.cpp.
+
+static void
+DeclareXMLNamespaces ( const XML_Node * xmlNode,
+					   XMP_VarString &  usedNS,
+					   XMP_VarString &	outputStr,
+					   XMP_StringPtr	newline,
+					   XMP_StringPtr	indentStr,
+					   XMP_Index		indent )
+{
+
+	if ( ! xmlNode->ns.empty() ) {
+		size_t colonPos = xmlNode->name.find ( ':' );
+		XMP_Assert ( colonPos != XMP_VarString::npos );
+		XMP_VarString nsPrefix ( xmlNode->name, 0, colonPos+1 );
+		DeclareOneNamespace ( nsPrefix, xmlNode->ns, usedNS, outputStr, newline, indentStr, indent );
+	}
+
+	for ( size_t attrNum = 0, attrLim = xmlNode->attrs.size(); attrNum < attrLim; ++attrNum ) {
+		DeclareXMLNamespaces ( xmlNode->attrs[attrNum], usedNS, outputStr, newline, indentStr, indent );
+	}
+
+	for ( size_t childNum = 0, childLim = xmlNode->content.size(); childNum < childLim; ++childNum ) {
+		const XML_Node * currChild = xmlNode->content[childNum];
+		if ( currChild->kind == kElemNode ) DeclareXMLNamespaces ( currChild, usedNS, outputStr, newline, indentStr, indent );
+	}
+	
+}	// DeclareXMLNamespaces
+
+
+// -------------------------------------------------------------------------------------------------
+// SerializeXMLElement
+// -------------------
+//
+// Write a kept XML element of a lazy schema. Text only content is written inline, element content
+// is written one child per line with the whitespace between the children dropped. This is how the
+// pretty RDF of SerializePrettyRDFProperty looks too.
+
+static void
+SerializeXMLElement ( const XML_Node * xmlNode,
+					  XMP_VarString &  outputStr,
+					  XMP_StringPtr	   newline,
+					  XMP_StringPtr	   indentStr,
+					  XMP_Index		   indent )
+{
+	XMP_Assert ( xmlNode->kind == kElemNode );
+	
+	XMP_Index level;
+	for ( level = indent; level > 0; --level ) outputStr += indentStr;
+	outputStr += '<';
+	outputStr += xmlNode->name;
+
+	for ( size_t attrNum = 0, attrLim = xmlNode->attrs.size(); attrNum < attrLim; ++attrNum ) {
+		const XML_Node * currAttr = xmlNode->attrs[attrNum];
+		outputStr += ' ';
+		outputStr += currAttr->name;
+		outputStr += "=\"";
+		AppendNodeValue ( outputStr, currAttr->value, kForAttribute );
+		outputStr += '"';
+	}
+	
+	bool hasElemContent = false;
+	for ( size_t childNum = 0, childLim = xmlNode->content.size(); childNum < childLim; ++childNum ) {
+		if ( xmlNode->content[childNum]->kind != kCDataNode ) hasElemContent = true;
+	}
+
+	if ( xmlNode->content.empty() ) {
+
+		outputStr += "/>";
+
+	} else if ( ! hasElemContent ) {
+	
+		outputStr += '>';
+		for ( size_t childNum = 0, childLim = xmlNode->content.size(); childNum < childLim; ++childNum ) {
+			AppendNodeValue ( outputStr, xmlNode->content[childNum]->value, kForElement );
+		}
+		outputStr += "</";
+		outputStr += xmlNode->name;
+		outputStr += '>';
+
+	} else {
+
+		outputStr += '>';
+		outputStr += newline;
+
+		for ( size_t childNum = 0, childLim = xmlNode->content.size(); childNum < childLim; ++childNum ) {
+			const XML_Node * currChild = xmlNode->content[childNum];
+			if ( currChild->kind == kElemNode ) {
+				SerializeXMLElement ( currChild, outputStr, newline, indentStr, indent+1 );
+			} else if ( (currChild->kind == kCDataNode) && (! IsWhitespaceNode ( *currChild )) ) {
+				for ( level = indent+1; level > 0; --level ) outputStr += indentStr;
+				AppendNodeValue ( outputStr, currChild->value, kForElement );
+				outputStr += newline;
+			}
+		}
+
+		for ( level = indent; level > 0; --level ) outputStr += indentStr;
+		outputStr += "</";
+		outputStr += xmlNode->name;
+		outputStr += '>';
+
+	}
+
+	outputStr += newline;
+
+}	// SerializeXMLElement
+
+
+// -------------------------------------------------------------------------------------------------
+// SerializeLazyRDFSchema
+// ----------------------
+//
+// Write a lazy schema straight from its kept XML, without materializing it. The layout is that of
+// SerializePrettyRDFSchema. Top level attribute properties are written as elements.
+
+static void
+SerializeLazyRDFSchema ( const XMP_VarString & treeName,
+						 const XMP_Node *	   schemaNode,
+						 XMP_VarString &	   outputStr,
+						 XMP_StringPtr		   newline,
+						 XMP_StringPtr		   indentStr,
+						 XMP_Index			   baseIndent )
+{
+	XMP_Assert ( IsLazySchema ( schemaNode ) );
+	const std::vector<const XML_Node*> & xmlProps = ((const XMP_LazySchemaNode*)schemaNode)->xmlProps;
+	
+	// Write the rdf:Description start tag with the namespace declarations.
+	
+	XMP_Index level;
+	for ( level = baseIndent+2; level > 0; --level ) outputStr += indentStr;
+	outputStr += kRDF_SchemaStart;
+	outputStr += '"';
+	outputStr += treeName;
+	outputStr += '"';
+
+	XMP_VarString usedNS ( "xml:rdf:" );
+	DeclareOneNamespace ( schemaNode->value, schemaNode->name, usedNS, outputStr, newline, indentStr, baseIndent+4 );
+	for ( size_t propNum = 0, propLim = xmlProps.size(); propNum < propLim; ++propNum ) {
+		DeclareXMLNamespaces ( xmlProps[propNum], usedNS, outputStr, newline, indentStr, baseIndent+4 );
+	}
+
+	outputStr += ">";
+	outputStr += newline;
+	
+	// Write each of the schema's kept properties.
+	for ( size_t propNum = 0, propLim = xmlProps.size(); propNum < propLim; ++propNum ) {
+		const XML_Node * currProp = xmlProps[propNum];
+		if ( currProp->kind == kElemNode ) {
+			SerializeXMLElement ( currProp, outputStr, newline, indentStr, baseIndent+3 );
+		} else {
+			for ( level = baseIndent+3; level > 0; --level ) outputStr += indentStr;
+			outputStr += '<';
+			outputStr += currProp->name;
+			outputStr += '>';
+			AppendNodeValue ( outputStr, currProp->value, kForElement );
+			outputStr += "</";
+			outputStr += currProp->name;
+			outputStr += '>';
+			outputStr += newline;
+		}
+	}
+	
+	// Write the rdf:Description end tag.
+	for ( level = baseIndent+2; level > 0; --level ) outputStr += indentStr;
+	outputStr += kRDF_SchemaEnd;
+	outputStr += newline;
+
+}	// SerializeLazyRDFSchema
+
+
 // -------------------------------------------------------------------------------------------------
 // SerializeCompactRDFAttrProps
 // ----------------------------
@@ -1074,22 +1372,32 @@ SerializeAsRDF ( const XMPMeta & xmpObj,
 	const size_t indentLen   = strlen ( indentStr );
 
 	// First estimate the worst case space and reserve room in the output string. This optimization
-	// avoids reallocating and copying the output as it grows. The initial count does not look at
-	// the values of properties, so it does not account for character entities, e.g. &#xA; for newline.
-	// Since there can be a lot of these in things like the base 64 encoding of a large thumbnail,
-	// inflate the count by 1/4 (easy to do) to accommodate.
+	// avoids reallocating and copying the output as it grows. The values are counted exactly, with
+	// their character entities, e.g. &#xA; for newline. The namespace declarations are counted once
+	// per schema, nested ones are not, so inflate the count by 1/16 (easy to do) to accommodate.
 	
 	// *** Need to include estimate for alias comments.
 	
+	// The compact form is only written from XMP nodes, lazy schemas must be materialized for it.
+	
+	if ( options & kXMP_UseCompactFormat ) MaterializeAllSchemas ( const_cast<XMP_Node*>(&xmpObj.tree) );
+
 	size_t outputLen = 2 * (strlen(kPacketHeader) + strlen(kRDF_XMPMetaStart) + strlen(kRDF_RDFStart) + 3*baseIndent*indentLen);
 	
 	for ( size_t schemaNum = 0, schemaLim = xmpObj.tree.children.size(); schemaNum < schemaLim; ++schemaNum ) {
 		const XMP_Node * currSchema = xmpObj.tree.children[schemaNum];
 		outputLen += 2*(baseIndent+2)*indentLen + strlen(kRDF_SchemaStart) + treeNameLen + strlen(kRDF_SchemaEnd) + 2;
+		outputLen += (baseIndent+3)*indentLen + currSchema->name.size() + currSchema->value.size() + 10;	// The xmlns declaration.
 		outputLen += EstimateRDFSize ( currSchema, baseIndent+2, indentLen );
+		if ( IsLazySchema ( currSchema ) ) {
+			const std::vector<const XML_Node*> & xmlProps = ((const XMP_LazySchemaNode*)currSchema)->xmlProps;
+			for ( size_t propNum = 0, propLim = xmlProps.size(); propNum < propLim; ++propNum ) {
+				outputLen += EstimateXMLSize ( xmlProps[propNum], baseIndent+3, indentLen );
+			}
+		}
 	}
 	
-	outputLen += (outputLen >> 2);	// Inflate by 1/4, an empirical fudge factor.
+	outputLen += (outputLen >> 4);	// Inflate by 1/16, an empirical fudge factor.
 	
 	// Now generate the RDF into the head string as UTF-8.
 	
@@ -1123,7 +1431,11 @@ SerializeAsRDF ( const XMPMeta & xmpObj,
 		if ( xmpObj.tree.children.size() > 0 ) {
 			for ( size_t schemaNum = 0, schemaLim = xmpObj.tree.children.size(); schemaNum < schemaLim; ++schemaNum ) {
 				const XMP_Node * currSchema = xmpObj.tree.children[schemaNum];
-				SerializePrettyRDFSchema ( xmpObj.tree.name, currSchema, headStr, options, newline, indentStr, baseIndent );
+				if ( IsLazySchema ( currSchema ) ) {
+					SerializeLazyRDFSchema ( xmpObj.tree.name, currSchema, headStr, newline, indentStr, baseIndent );
+				} else {
+					SerializePrettyRDFSchema ( xmpObj.tree.name, currSchema, headStr, options, newline, indentStr, baseIndent );
+				}
 			}
 		} else {
 			for ( XMP_Index level = baseIndent+2; level > 0; --level ) headStr += indentStr;
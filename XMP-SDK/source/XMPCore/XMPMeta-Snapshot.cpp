@@ -0,0 +1,729 @@
+// =================================================================================================
+// Copyright 2002-2007 Adobe Systems Incorporated
+// All Rights Reserved.
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this file in accordance with the terms
+// of the Adobe license agreement accompanying it.
+// =================================================================================================
+
+#include "XMP_Environment.h"	// ! This must be the first include!
+#include "XMPCore_Impl.hpp"
+
+#include "XMPMeta.hpp"
+#include "XMPFlatTree.hpp"
+#include "XMLParserAdapter.hpp"
+#include "UnicodeInlines.incl_cpp"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#if XMP_WinBuild
+	#pragma warning ( disable : 4800 )	// forcing value to bool 'true' or 'false' (performance warning)
+#endif
+
+// =================================================================================================
+// Notes
+// =====
+//
+// A snapshot is a binary form of an XMPMeta object, for caches that would otherwise store RDF and
+// parse it again on every hit. It is the XMP_FlatTree form of the tree with a header and a namespace
+// table. Everything is located by offsets from the start of the snapshot, so a snapshot can be used
+// straight from a memory mapped file. LoadFromSnapshot reads it in place, nothing is copied first.
+//
+// All integers are 32 bit little endian. The sections follow the header in this order, each starts
+// on a 4 byte boundary:
+//	- The namespace table, a prefix offset and a URI offset per namespace, into the namespace pool.
+//	- The nodes, 9 integers each in the order of the XMP_FlatNode fields.
+//	- The name table, an offset into the name pool per atom.
+//	- The namespace pool, name pool, and value pool. These hold nul terminated strings, the pool
+//	  lengths in the header do not include the padding to a 4 byte boundary.
+//
+// The namespace table has every prefix used by the names, with the URI it had when the snapshot was
+// made. When loading, the names are changed if a namespace now has a different prefix. The names are
+// atomized, so this is done once per distinct name. A namespace that is not yet registered is
+// registered with its old prefix, or a variant if that prefix is taken.
+//
+// The loader checks everything it uses, a damaged snapshot throws kXMPErr_BadParse and leaves the
+// object unchanged. The node ranges must tile the node array in breadth first order, that ensures the
+// nodes form one tree. The strings, names, and options must also satisfy what the parser guarantees
+// for a tree, the serializer and the rest of XMPCore assume it.
+
+static const char * kSnapshotMagic = "XMP_SNAP";	// ! Must be 8 characters.
+
+enum { kSnapshotVersion = 1 };
+
+enum {	// Offsets in the header.
+	kSnap_Magic           = 0,	// 8 bytes.
+	kSnap_Length          = 8,	// The length of the whole snapshot.
+	kSnap_Version         = 12,
+	kSnap_PrevTkVer       = 16,
+	kSnap_NSCount         = 20,
+	kSnap_NodeCount       = 24,
+	kSnap_NameCount       = 28,
+	kSnap_NSPoolLen       = 32,
+	kSnap_NamePoolLen     = 36,
+	kSnap_ValuePoolLen    = 40,
+	kSnap_HeaderSize      = 44
+};
+
+enum {	// Offsets in a node record, in units of XMP_Uns32.
+	kSnapNode_Options     = 0,
+	kSnapNode_NameAtom    = 1,
+	kSnapNode_ValueOffset = 2,
+	kSnapNode_ValueLen    = 3,
+	kSnapNode_Parent      = 4,
+	kSnapNode_FirstQual   = 5,
+	kSnapNode_QualCount   = 6,
+	kSnapNode_FirstChild  = 7,
+	kSnapNode_ChildCount  = 8,
+	kSnapNode_Size        = 9
+};
+
+struct SnapshotLayout {	// Where the sections are, set by CheckSnapshot.
+	XMP_Uns32 nsCount, nodeCount, nameCount;
+	XMP_Uns32 nsPoolLen, namePoolLen, valuePoolLen;
+	const XMP_Uns8 * nsTable;
+	const XMP_Uns8 * nodes;
+	const XMP_Uns8 * nameTable;
+	const char * nsPool;
+	const char * namePool;
+	const char * valuePool;
+};
+
+typedef std::map < XMP_VarString, XMP_VarString > XMP_PrefixMap;
+
+// =================================================================================================
+// Local Utilities
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+// GetSnapUns32 and PutSnapUns32
+// -----------------------------
+//
+// The bytes are assembled explicitly, so a snapshot can be read on any host and at any alignment.
+
+static inline XMP_Uns32
+GetSnapUns32 ( const XMP_Uns8 * bytes )
+{
+	return (XMP_Uns32)bytes[0] | ((XMP_Uns32)bytes[1] << 8) | ((XMP_Uns32)bytes[2] << 16) | ((XMP_Uns32)bytes[3] << 24);
+}
+
+static inline void
+PutSnapUns32 ( XMP_Uns32 value, XMP_Uns8 * bytes )
+{
+	bytes[0] = (XMP_Uns8)value;
+	bytes[1] = (XMP_Uns8)(value >> 8);
+	bytes[2] = (XMP_Uns8)(value >> 16);
+	bytes[3] = (XMP_Uns8)(value >> 24);
+}
+
+static inline XMP_Uns32
+GetSnapNodeField ( const SnapshotLayout & layout, XMP_Uns32 nodeNum, XMP_Uns32 field )
+{
+	return GetSnapUns32 ( layout.nodes + 4*(nodeNum*kSnapNode_Size + field) );
+}
+
+static inline XMP_Uns64
+SnapPad4 ( XMP_Uns64 length )
+{
+	return (length + 3) & ~(XMP_Uns64)3;
+}
+
+// -------------------------------------------------------------------------------------------------
+// CheckSnapshotText
+// -----------------
+//
+// The strings in a pool must be UTF-8 without ASCII controls other than tab, LF, and CR, as for
+// SetProperty. The serializer depends on this. The pool must end with a nul, that stops a partial
+// UTF-8 sequence at the end.
+
+static void
+CheckSnapshotText ( const char * pool, XMP_Uns32 poolLen )
+{
+	const XMP_Uns8 * textPos = (const XMP_Uns8 *) pool;
+	const XMP_Uns8 * textEnd = textPos + poolLen;
+
+	try {
+		while ( textPos < textEnd ) {
+			XMP_Uns8 ch = *textPos;
+			if ( ch >= 0x80 ) {
+				(void) GetCodePoint ( &textPos );	// Throws for bad UTF-8.
+			} else {
+				if ( (ch < 0x20) && (ch != 0) && (ch != kTab) && (ch != kLF) && (ch != kCR) ) break;
+				++textPos;
+			}
+		}
+	} catch ( ... ) {
+		// Fall through to the throw below.
+	}
+
+	if ( textPos != textEnd ) XMP_Throw ( "Bad XMP snapshot text", kXMPErr_BadParse );
+
+}	// CheckSnapshotText
+
+// -------------------------------------------------------------------------------------------------
+// CheckSnapshotOffspring
+// ----------------------
+//
+// Verify the options of a property, field, item, or qualifier against its place in the tree. These
+// are the invariants the parser establishes and the rest of XMPCore relies on. The ranges of both
+// nodes and the name atoms of the offspring's qualifiers have been verified.
+
+static void
+CheckSnapshotOffspring ( const SnapshotLayout & layout, XMP_Uns32 parentNum, XMP_Uns32 offspringNum )
+{
+	XMP_OptionBits parentOptions = GetSnapNodeField ( layout, parentNum, kSnapNode_Options );
+	XMP_OptionBits options = GetSnapNodeField ( layout, offspringNum, kSnapNode_Options );
+	XMP_Uns32 qualCount = GetSnapNodeField ( layout, offspringNum, kSnapNode_QualCount );
+
+	bool isQualifier = (offspringNum < GetSnapNodeField ( layout, parentNum, kSnapNode_FirstChild ));
+	bool isArrayItem = XMP_LitMatch ( (layout.namePool + GetSnapUns32 ( layout.nameTable + 4*GetSnapNodeField ( layout, offspringNum, kSnapNode_NameAtom ) )),
+									  kXMP_ArrayItemName );
+
+	if ( isQualifier ) {
+		if ( isArrayItem || (! (options & kXMP_PropIsQualifier)) ) XMP_Throw ( "Bad XMP snapshot qualifier", kXMPErr_BadParse );
+	} else {
+		if ( (options & kXMP_PropIsQualifier) || (isArrayItem != XMP_PropIsArray ( parentOptions )) ) XMP_Throw ( "Bad XMP snapshot child", kXMPErr_BadParse );
+		if ( XMP_ArrayIsAltText ( parentOptions ) && (! XMP_PropHasLang ( options )) ) XMP_Throw ( "Bad XMP snapshot AltText item", kXMPErr_BadParse );
+	}
+
+	if ( options & kXMP_ImplReservedMask ) XMP_Throw ( "Bad XMP snapshot node options", kXMPErr_BadParse );
+	if ( (options & kXMP_PropValueIsStruct) && (options & kXMP_PropValueIsArray) ) XMP_Throw ( "Bad XMP snapshot node form", kXMPErr_BadParse );
+	if ( ((options & kXMP_PropArrayIsAltText) && (! (options & kXMP_PropArrayIsAlternate))) ||
+		 ((options & kXMP_PropArrayIsAlternate) && (! (options & kXMP_PropArrayIsOrdered))) ||
+		 ((options & kXMP_PropArrayIsOrdered) && (! (options & kXMP_PropValueIsArray))) ) {
+		XMP_Throw ( "Bad XMP snapshot array form", kXMPErr_BadParse );
+	}
+
+	if ( XMP_PropIsSimple ( options ) ) {
+		if ( GetSnapNodeField ( layout, offspringNum, kSnapNode_ChildCount ) != 0 ) XMP_Throw ( "Bad XMP snapshot node form", kXMPErr_BadParse );
+	} else {
+		if ( (options & kXMP_PropValueIsURI) || (GetSnapNodeField ( layout, offspringNum, kSnapNode_ValueLen ) != 0) ) XMP_Throw ( "Bad XMP snapshot node form", kXMPErr_BadParse );
+	}
+
+	// The xml:lang qualifier is first when present, rdf:type is next.
+
+	if ( XMP_PropHasQualifiers ( options ) != (qualCount != 0) ) XMP_Throw ( "Bad XMP snapshot qualifiers", kXMPErr_BadParse );
+
+	XMP_Uns32 firstQual = GetSnapNodeField ( layout, offspringNum, kSnapNode_FirstQual );
+	XMP_Uns32 typeQual  = firstQual + (XMP_PropHasLang ( options ) ? 1 : 0);
+
+	for ( XMP_Uns32 qualNum = firstQual; qualNum < (firstQual + qualCount); ++qualNum ) {
+		XMP_StringPtr qualName = layout.namePool + GetSnapUns32 ( layout.nameTable + 4*GetSnapNodeField ( layout, qualNum, kSnapNode_NameAtom ) );
+		bool isLang = XMP_LitMatch ( qualName, "xml:lang" );
+		bool isType = XMP_LitMatch ( qualName, "rdf:type" );
+		bool langExpected = XMP_PropHasLang ( options ) && (qualNum == firstQual);
+		bool typeExpected = ((options & kXMP_PropHasType) != 0) && (qualNum == typeQual);
+		if ( (isLang != langExpected) || (isType != typeExpected) ) XMP_Throw ( "Bad XMP snapshot qualifiers", kXMPErr_BadParse );
+	}
+
+	if ( XMP_PropHasLang ( options ) && (qualCount == 0) ) XMP_Throw ( "Bad XMP snapshot qualifiers", kXMPErr_BadParse );
+	if ( (options & kXMP_PropHasType) && (qualCount < (XMP_PropHasLang ( options ) ? 2UL : 1UL)) ) XMP_Throw ( "Bad XMP snapshot qualifiers", kXMPErr_BadParse );
+
+}	// CheckSnapshotOffspring
+
+// -------------------------------------------------------------------------------------------------
+// CheckSnapshot
+// -------------
+//
+// Verify the header, locate the sections, and verify the node structure and string references.
+
+static void
+CheckSnapshot ( const XMP_Uns8 * snapshot, XMP_StringLen snapshotSize, SnapshotLayout * layout )
+{
+	if ( (snapshotSize < kSnap_HeaderSize) || (memcmp ( snapshot, kSnapshotMagic, 8 ) != 0) ) {
+		XMP_Throw ( "Not an XMP snapshot", kXMPErr_BadParse );
+	}
+	if ( GetSnapUns32 ( &snapshot[kSnap_Version] ) != kSnapshotVersion ) XMP_Throw ( "Unsupported XMP snapshot version", kXMPErr_BadParse );
+	if ( GetSnapUns32 ( &snapshot[kSnap_Length] ) != snapshotSize ) XMP_Throw ( "Wrong XMP snapshot length", kXMPErr_BadParse );
+
+	layout->nsCount      = GetSnapUns32 ( &snapshot[kSnap_NSCount] );
+	layout->nodeCount    = GetSnapUns32 ( &snapshot[kSnap_NodeCount] );
+	layout->nameCount    = GetSnapUns32 ( &snapshot[kSnap_NameCount] );
+	layout->nsPoolLen    = GetSnapUns32 ( &snapshot[kSnap_NSPoolLen] );
+	layout->namePoolLen  = GetSnapUns32 ( &snapshot[kSnap_NamePoolLen] );
+	layout->valuePoolLen = GetSnapUns32 ( &snapshot[kSnap_ValuePoolLen] );
+
+	// Locate the sections. The sums are 64 bit so that huge counts can't wrap.
+
+	XMP_Uns64 offset = kSnap_HeaderSize;
+	XMP_Uns64 nsTableOffset = offset;	offset += (XMP_Uns64)layout->nsCount * 8;
+	XMP_Uns64 nodesOffset = offset;		offset += (XMP_Uns64)layout->nodeCount * kSnapNode_Size * 4;
+	XMP_Uns64 nameTableOffset = offset;	offset += (XMP_Uns64)layout->nameCount * 4;
+	XMP_Uns64 nsPoolOffset = offset;	offset += SnapPad4 ( layout->nsPoolLen );
+	XMP_Uns64 namePoolOffset = offset;	offset += SnapPad4 ( layout->namePoolLen );
+	XMP_Uns64 valuePoolOffset = offset;	offset += SnapPad4 ( layout->valuePoolLen );
+
+	if ( offset != snapshotSize ) XMP_Throw ( "Inconsistent XMP snapshot sections", kXMPErr_BadParse );
+	if ( layout->nodeCount == 0 ) XMP_Throw ( "XMP snapshot has no root node", kXMPErr_BadParse );
+
+	layout->nsTable   = snapshot + nsTableOffset;
+	layout->nodes     = snapshot + nodesOffset;
+	layout->nameTable = snapshot + nameTableOffset;
+	layout->nsPool    = (const char *) (snapshot + nsPoolOffset);
+	layout->namePool  = (const char *) (snapshot + namePoolOffset);
+	layout->valuePool = (const char *) (snapshot + valuePoolOffset);
+
+	// Every string must be nul terminated within its pool. Checking the last byte of each pool then
+	// makes any offset within the pool safe.
+
+	if ( (layout->nsPoolLen > 0) && (layout->nsPool[layout->nsPoolLen-1] != 0) ) XMP_Throw ( "Bad XMP snapshot namespace pool", kXMPErr_BadParse );
+	if ( (layout->namePoolLen > 0) && (layout->namePool[layout->namePoolLen-1] != 0) ) XMP_Throw ( "Bad XMP snapshot name pool", kXMPErr_BadParse );
+	if ( (layout->valuePoolLen > 0) && (layout->valuePool[layout->valuePoolLen-1] != 0) ) XMP_Throw ( "Bad XMP snapshot value pool", kXMPErr_BadParse );
+
+	CheckSnapshotText ( layout->nsPool, layout->nsPoolLen );
+	CheckSnapshotText ( layout->namePool, layout->namePoolLen );
+	CheckSnapshotText ( layout->valuePool, layout->valuePoolLen );
+
+	for ( XMP_Uns32 nsNum = 0; nsNum < layout->nsCount; ++nsNum ) {
+		if ( (GetSnapUns32 ( layout->nsTable + 8*nsNum ) >= layout->nsPoolLen) ||
+			 (GetSnapUns32 ( layout->nsTable + 8*nsNum + 4 ) >= layout->nsPoolLen) ) {
+			XMP_Throw ( "Bad XMP snapshot namespace", kXMPErr_BadParse );
+		}
+	}
+
+	for ( XMP_Uns32 atomNum = 0; atomNum < layout->nameCount; ++atomNum ) {
+		if ( GetSnapUns32 ( layout->nameTable + 4*atomNum ) >= layout->namePoolLen ) XMP_Throw ( "Bad XMP snapshot name", kXMPErr_BadParse );
+	}
+
+	// The offspring ranges must tile the nodes after the root, in order, with matching parents.
+
+	if ( (GetSnapNodeField ( *layout, 0, kSnapNode_Parent ) != kXMP_FlatNoIndex) ||
+		 (GetSnapNodeField ( *layout, 0, kSnapNode_QualCount ) != 0) ) {
+		XMP_Throw ( "Bad XMP snapshot root", kXMPErr_BadParse );
+	}
+
+	XMP_Uns64 schemaLim = 1 + (XMP_Uns64)GetSnapNodeField ( *layout, 0, kSnapNode_ChildCount );	// The root's children are the schema nodes.
+
+	XMP_Uns64 nextNode = 1;
+
+	for ( XMP_Uns32 nodeNum = 0; nodeNum < layout->nodeCount; ++nodeNum ) {
+
+		if ( GetSnapNodeField ( *layout, nodeNum, kSnapNode_NameAtom ) >= layout->nameCount ) XMP_Throw ( "Bad XMP snapshot node name", kXMPErr_BadParse );
+
+		bool isSchema = ((0 < nodeNum) && (nodeNum < schemaLim));
+		XMP_OptionBits options = GetSnapNodeField ( *layout, nodeNum, kSnapNode_Options );
+		if ( isSchema ? ((options != kXMP_SchemaNode) || (GetSnapNodeField ( *layout, nodeNum, kSnapNode_QualCount ) != 0)) :
+						((options & kXMP_SchemaNode) != 0) ) {
+			XMP_Throw ( "Bad XMP snapshot schema node", kXMPErr_BadParse );
+		}
+
+		XMP_Uns64 valueOffset = GetSnapNodeField ( *layout, nodeNum, kSnapNode_ValueOffset );
+		XMP_Uns64 valueEnd    = valueOffset + GetSnapNodeField ( *layout, nodeNum, kSnapNode_ValueLen );
+		if ( (valueEnd >= layout->valuePoolLen) || (layout->valuePool[valueEnd] != 0) ||
+			 (memchr ( layout->valuePool + valueOffset, 0, (size_t)(valueEnd - valueOffset) ) != 0) ) {
+			XMP_Throw ( "Bad XMP snapshot node value", kXMPErr_BadParse );
+		}
+
+		if ( GetSnapNodeField ( *layout, nodeNum, kSnapNode_FirstQual ) != nextNode ) XMP_Throw ( "Bad XMP snapshot node layout", kXMPErr_BadParse );
+		nextNode += GetSnapNodeField ( *layout, nodeNum, kSnapNode_QualCount );
+		if ( GetSnapNodeField ( *layout, nodeNum, kSnapNode_FirstChild ) != nextNode ) XMP_Throw ( "Bad XMP snapshot node layout", kXMPErr_BadParse );
+		nextNode += GetSnapNodeField ( *layout, nodeNum, kSnapNode_ChildCount );
+		if ( nextNode > layout->nodeCount ) XMP_Throw ( "Bad XMP snapshot node layout", kXMPErr_BadParse );
+
+		XMP_Uns32 offspringStart = GetSnapNodeField ( *layout, nodeNum, kSnapNode_FirstQual );
+		for ( XMP_Uns32 offspringNum = offspringStart; offspringNum < (XMP_Uns32)nextNode; ++offspringNum ) {
+			if ( GetSnapNodeField ( *layout, offspringNum, kSnapNode_Parent ) != nodeNum ) XMP_Throw ( "Bad XMP snapshot node parent", kXMPErr_BadParse );
+			if ( GetSnapNodeField ( *layout, offspringNum, kSnapNode_NameAtom ) >= layout->nameCount ) XMP_Throw ( "Bad XMP snapshot node name", kXMPErr_BadParse );
+		}
+
+		if ( (! isSchema) && (nodeNum != 0) ) CheckSnapshotOffspring ( *layout, GetSnapNodeField ( *layout, nodeNum, kSnapNode_Parent ), nodeNum );
+
+	}
+
+	if ( nextNode != layout->nodeCount ) XMP_Throw ( "Bad XMP snapshot node layout", kXMPErr_BadParse );
+
+}	// CheckSnapshot
+
+// -------------------------------------------------------------------------------------------------
+// IsSnapshotPropName
+// ------------------
+//
+// A property, field, or qualifier name must be an array item name or a well formed qualified name
+// with a registered prefix, the serializer relies on that.
+
+enum { kAtomUnchecked = 0, kAtomPropName = 1, kAtomBadName = 2 };
+
+static bool
+IsSnapshotPropName ( const XMP_VarString & name )
+{
+
+	if ( name == kXMP_ArrayItemName ) return true;
+
+	size_t colonPos = name.find ( ':' );
+	if ( (colonPos == XMP_VarString::npos) || (colonPos == 0) || (colonPos+1 == name.size()) ) return false;
+
+	try {
+		VerifySimpleXMLName ( name.c_str(), name.c_str() + colonPos );
+		VerifySimpleXMLName ( name.c_str() + colonPos+1, name.c_str() + name.size() );
+	} catch ( ... ) {
+		return false;
+	}
+
+	XMP_VarString prefix ( name, 0, colonPos+1 );
+	XMP_StringPtr nsURI;
+	XMP_StringLen uriLen;
+	return XMPMeta::GetNamespaceURI ( prefix.c_str(), &nsURI, &uriLen );
+
+}	// IsSnapshotPropName
+
+// -------------------------------------------------------------------------------------------------
+// RemapPrefixes
+// -------------
+//
+// Make sure every namespace in the snapshot is registered. Returns the prefixes that are now
+// different, with the trailing colons. The namespace table is checked completely before anything is
+// registered, the registration loop has nothing left to reject.
+
+static void
+RemapPrefixes ( const SnapshotLayout & layout, XMP_PrefixMap * prefixMap )
+{
+	XMP_StringPtr newPrefix;
+	XMP_StringLen prefixLen;
+
+	for ( XMP_Uns32 nsNum = 0; nsNum < layout.nsCount; ++nsNum ) {
+
+		XMP_StringPtr oldPrefix = layout.nsPool + GetSnapUns32 ( layout.nsTable + 8*nsNum );
+		XMP_StringPtr nsURI     = layout.nsPool + GetSnapUns32 ( layout.nsTable + 8*nsNum + 4 );
+		if ( (*nsURI == 0) || (strpbrk ( nsURI, "\"<>&" ) != 0) ) XMP_Throw ( "Bad XMP snapshot namespace", kXMPErr_BadParse );	// ! The serializer does not escape URIs.
+
+		bool isRegistered = XMPMeta::GetNamespacePrefix ( nsURI, &newPrefix, &prefixLen );
+		if ( (! isRegistered) && (*oldPrefix == 0) ) XMP_Throw ( "Bad XMP snapshot namespace", kXMPErr_BadParse );
+
+		// The xml:lang and rdf:type qualifiers were checked by name, these prefixes are fixed. Both
+		// are always registered, so an unregistered URI would get a variant prefix.
+		if ( (XMP_LitMatch ( oldPrefix, "xml:" ) || XMP_LitMatch ( oldPrefix, "rdf:" )) &&
+			 ((! isRegistered) || (strcmp ( newPrefix, oldPrefix ) != 0)) ) {
+			XMP_Throw ( "Bad XMP snapshot namespace", kXMPErr_BadParse );
+		}
+
+	}
+
+	for ( XMP_Uns32 nsNum = 0; nsNum < layout.nsCount; ++nsNum ) {
+
+		XMP_StringPtr oldPrefix = layout.nsPool + GetSnapUns32 ( layout.nsTable + 8*nsNum );
+		XMP_StringPtr nsURI     = layout.nsPool + GetSnapUns32 ( layout.nsTable + 8*nsNum + 4 );
+
+		if ( ! XMPMeta::GetNamespacePrefix ( nsURI, &newPrefix, &prefixLen ) ) {
+			(void) XMPMeta::RegisterNamespace ( nsURI, oldPrefix, &newPrefix, &prefixLen );
+		}
+
+		if ( strcmp ( newPrefix, oldPrefix ) != 0 ) (*prefixMap)[oldPrefix] = newPrefix;
+
+	}
+
+}	// RemapPrefixes
+
+// -------------------------------------------------------------------------------------------------
+// RemapName
+// ---------
+
+static void
+RemapName ( XMP_VarString * name, const XMP_PrefixMap & prefixMap )
+{
+	size_t colonPos = name->find ( ':' );
+	if ( colonPos == XMP_VarString::npos ) return;
+
+	XMP_PrefixMap::const_iterator prefixPos = prefixMap.find ( name->substr ( 0, colonPos+1 ) );
+	if ( prefixPos != prefixMap.end() ) name->replace ( 0, colonPos+1, prefixPos->second );
+
+}	// RemapName
+
+// -------------------------------------------------------------------------------------------------
+// IdentifyNames
+// -------------
+//
+// Give equal names the same identifier, the lowest atom with that name. A damaged snapshot can have
+// repeated atoms, and prefix remapping can make distinct names equal.
+
+struct NameOrder {
+	const std::vector<XMP_VarString> & names;
+	NameOrder ( const std::vector<XMP_VarString> & _names ) : names(_names) {};
+	bool operator() ( XMP_Uns32 left, XMP_Uns32 right ) const
+		{ return (names[left] < names[right]) || ((names[left] == names[right]) && (left < right)); };
+};
+
+static void
+IdentifyNames ( const std::vector<XMP_VarString> & names, std::vector<XMP_Uns32> * nameIDs )
+{
+	const size_t nameCount = names.size();
+	std::vector<XMP_Uns32> order ( nameCount );
+	for ( size_t atomNum = 0; atomNum < nameCount; ++atomNum ) order[atomNum] = (XMP_Uns32)atomNum;
+	std::sort ( order.begin(), order.end(), NameOrder ( names ) );
+
+	nameIDs->resize ( nameCount );
+	for ( size_t orderNum = 0; orderNum < nameCount; ++orderNum ) {
+		XMP_Uns32 atomNum = order[orderNum];
+		if ( (orderNum > 0) && (names[atomNum] == names[order[orderNum-1]]) ) {
+			(*nameIDs)[atomNum] = (*nameIDs)[order[orderNum-1]];
+		} else {
+			(*nameIDs)[atomNum] = atomNum;
+		}
+	}
+
+}	// IdentifyNames
+
+// =================================================================================================
+// Class Methods
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+// SerializeToSnapshot
+// -------------------
+
+void
+XMPMeta::SerializeToSnapshot ( XMP_StringPtr * snapshot, XMP_StringLen * snapshotSize ) const
+{
+	XMP_Assert ( (snapshot != 0) && (snapshotSize != 0) );	// ! Enforced by wrapper.
+
+	MaterializeAllSchemas ( const_cast<XMP_Node*>(&this->tree) );
+
+	XMP_FlatTree flatTree;
+	flatTree.Flatten ( this->tree );
+
+	const size_t nodeCount = flatTree.nodes.size();
+	const size_t nameCount = flatTree.nameOffsets.size();
+
+	// Find the namespace of every prefix used in a name. The schema nodes give the URI directly,
+	// other prefixes are looked up. Schema names are URIs, they have no prefix.
+
+	XMP_PrefixMap nsTable;	// Prefix to URI.
+	std::vector<bool> prefixedAtoms ( nameCount, false );
+
+	for ( size_t nodeNum = 1; nodeNum < nodeCount; ++nodeNum ) {
+		const XMP_FlatNode & flatNode = flatTree.nodes[nodeNum];
+		if ( flatNode.options & kXMP_SchemaNode ) {
+			nsTable[flatTree.Value ( flatNode )] = flatTree.Name ( flatNode );
+		} else {
+			prefixedAtoms[flatNode.nameAtom] = true;
+		}
+	}
+
+	for ( size_t atomNum = 0; atomNum < nameCount; ++atomNum ) {
+		if ( ! prefixedAtoms[atomNum] ) continue;
+		XMP_StringPtr name = flatTree.namePool.c_str() + flatTree.nameOffsets[atomNum];
+		XMP_StringPtr colonPos = strchr ( name, ':' );
+		if ( colonPos == 0 ) continue;	// An array item.
+		XMP_VarString prefix ( name, (colonPos - name + 1) );
+		if ( nsTable.find ( prefix ) != nsTable.end() ) continue;
+		XMP_StringPtr nsURI;
+		XMP_StringLen uriLen;
+		if ( ! XMPMeta::GetNamespaceURI ( prefix.c_str(), &nsURI, &uriLen ) ) {
+			XMP_Throw ( "Unregistered namespace prefix in name", kXMPErr_InternalFailure );
+		}
+		nsTable[prefix] = nsURI;
+	}
+
+	XMP_VarString nsPool;
+	std::vector<XMP_Uns32> nsOffsets;
+	for ( XMP_PrefixMap::const_iterator nsPos = nsTable.begin(); nsPos != nsTable.end(); ++nsPos ) {
+		nsOffsets.push_back ( (XMP_Uns32)nsPool.size() );
+		nsPool.append ( nsPos->first.c_str(), nsPos->first.size()+1 );	// Include the nul.
+		nsOffsets.push_back ( (XMP_Uns32)nsPool.size() );
+		nsPool.append ( nsPos->second.c_str(), nsPos->second.size()+1 );
+	}
+
+	// Lay out and fill in the snapshot.
+
+	XMP_Uns64 nsTableOffset = kSnap_HeaderSize;
+	XMP_Uns64 nodesOffset = nsTableOffset + (XMP_Uns64)nsOffsets.size() * 4;
+	XMP_Uns64 nameTableOffset = nodesOffset + (XMP_Uns64)nodeCount * kSnapNode_Size * 4;
+	XMP_Uns64 nsPoolOffset = nameTableOffset + (XMP_Uns64)nameCount * 4;
+	XMP_Uns64 namePoolOffset = nsPoolOffset + SnapPad4 ( nsPool.size() );
+	XMP_Uns64 valuePoolOffset = namePoolOffset + SnapPad4 ( flatTree.namePool.size() );
+	XMP_Uns64 snapLength = valuePoolOffset + SnapPad4 ( flatTree.valuePool.size() );
+
+	if ( snapLength > 0xFFFFFFFFULL ) XMP_Throw ( "XMP snapshot is too large", kXMPErr_BadSerialize );
+
+	sOutputStr->erase();
+	sOutputStr->append ( (size_t)snapLength, 0 );
+	XMP_Uns8 * snapPtr = (XMP_Uns8 *) sOutputStr->c_str();	// Don't set until after sizing the string!
+
+	memcpy ( &snapPtr[kSnap_Magic], kSnapshotMagic, 8 );
+	PutSnapUns32 ( (XMP_Uns32)snapLength, &snapPtr[kSnap_Length] );
+	PutSnapUns32 ( kSnapshotVersion, &snapPtr[kSnap_Version] );
+	PutSnapUns32 ( (XMP_Uns32)this->prevTkVer, &snapPtr[kSnap_PrevTkVer] );
+	PutSnapUns32 ( (XMP_Uns32)nsTable.size(), &snapPtr[kSnap_NSCount] );
+	PutSnapUns32 ( (XMP_Uns32)nodeCount, &snapPtr[kSnap_NodeCount] );
+	PutSnapUns32 ( (XMP_Uns32)nameCount, &snapPtr[kSnap_NameCount] );
+	PutSnapUns32 ( (XMP_Uns32)nsPool.size(), &snapPtr[kSnap_NSPoolLen] );
+	PutSnapUns32 ( (XMP_Uns32)flatTree.namePool.size(), &snapPtr[kSnap_NamePoolLen] );
+	PutSnapUns32 ( (XMP_Uns32)flatTree.valuePool.size(), &snapPtr[kSnap_ValuePoolLen] );
+
+	XMP_Uns8 * nsTablePtr = snapPtr + nsTableOffset;
+	for ( size_t nsNum = 0; nsNum < nsOffsets.size(); ++nsNum ) PutSnapUns32 ( nsOffsets[nsNum], nsTablePtr + 4*nsNum );
+
+	XMP_Uns8 * nodePtr = snapPtr + nodesOffset;
+	for ( size_t nodeNum = 0; nodeNum < nodeCount; ++nodeNum, nodePtr += kSnapNode_Size*4 ) {
+		const XMP_FlatNode & flatNode = flatTree.nodes[nodeNum];
+		PutSnapUns32 ( flatNode.options, nodePtr + 4*kSnapNode_Options );
+		PutSnapUns32 ( flatNode.nameAtom, nodePtr + 4*kSnapNode_NameAtom );
+		PutSnapUns32 ( flatNode.valueOffset, nodePtr + 4*kSnapNode_ValueOffset );
+		PutSnapUns32 ( flatNode.valueLen, nodePtr + 4*kSnapNode_ValueLen );
+		PutSnapUns32 ( flatNode.parent, nodePtr + 4*kSnapNode_Parent );
+		PutSnapUns32 ( flatNode.firstQual, nodePtr + 4*kSnapNode_FirstQual );
+		PutSnapUns32 ( flatNode.qualCount, nodePtr + 4*kSnapNode_QualCount );
+		PutSnapUns32 ( flatNode.firstChild, nodePtr + 4*kSnapNode_FirstChild );
+		PutSnapUns32 ( flatNode.childCount, nodePtr + 4*kSnapNode_ChildCount );
+	}
+
+	XMP_Uns8 * nameTablePtr = snapPtr + nameTableOffset;
+	for ( size_t atomNum = 0; atomNum < nameCount; ++atomNum ) PutSnapUns32 ( flatTree.nameOffsets[atomNum], nameTablePtr + 4*atomNum );
+
+	memcpy ( snapPtr + nsPoolOffset, nsPool.c_str(), nsPool.size() );	// AUDIT: Sized above.
+	memcpy ( snapPtr + namePoolOffset, flatTree.namePool.c_str(), flatTree.namePool.size() );
+	memcpy ( snapPtr + valuePoolOffset, flatTree.valuePool.c_str(), flatTree.valuePool.size() );
+
+	*snapshot = sOutputStr->c_str();
+	*snapshotSize = (XMP_StringLen)sOutputStr->size();
+
+}	// SerializeToSnapshot
+
+// -------------------------------------------------------------------------------------------------
+// LoadFromSnapshot
+// ----------------
+//
+// Replace the object's content, as ParseFromBuffer does. The snapshot is checked completely before
+// the object is changed. The tree is rebuilt breadth first, straight from the snapshot's node records,
+// under a separate root that is moved into the object at the end.
+//
+// ! The namespaces are registered globally before the names are checked, the name checks need the
+// ! current prefixes. A snapshot rejected for a bad name leaves its namespaces registered, just as
+// ! the parser keeps the xmlns declarations of RDF it rejects. The object itself is unchanged.
+
+void
+XMPMeta::LoadFromSnapshot ( XMP_StringPtr snapshot, XMP_StringLen snapshotSize )
+{
+	if ( snapshot == 0 ) XMP_Throw ( "Null snapshot buffer", kXMPErr_BadParam );
+
+	SnapshotLayout layout;
+	CheckSnapshot ( (const XMP_Uns8 *)snapshot, snapshotSize, &layout );
+
+	XMP_PrefixMap prefixMap;
+	RemapPrefixes ( layout, &prefixMap );
+
+	// Make the names once per atom. Names of properties, fields, and qualifiers get the current
+	// prefixes and are checked the first time they are used. Schema names are URIs, the root name
+	// is the rdf:about value, these are kept.
+
+	std::vector<XMP_VarString> atomNames ( layout.nameCount );
+	std::vector<XMP_VarString> propNames;
+	std::vector<XMP_Uns8> atomState ( layout.nameCount, kAtomUnchecked );
+
+	for ( XMP_Uns32 atomNum = 0; atomNum < layout.nameCount; ++atomNum ) {
+		atomNames[atomNum] = layout.namePool + GetSnapUns32 ( layout.nameTable + 4*atomNum );
+	}
+
+	if ( ! prefixMap.empty() ) {
+		propNames = atomNames;
+		for ( XMP_Uns32 atomNum = 0; atomNum < layout.nameCount; ++atomNum ) RemapName ( &propNames[atomNum], prefixMap );
+	}
+
+	const std::vector<XMP_VarString> & nodeNames = (prefixMap.empty() ? atomNames : propNames);
+
+	// Siblings must have distinct names, except for array items. The offspring of a node are made
+	// together, so remembering the last parent that used a name is enough to find duplicates.
+
+	std::vector<XMP_Uns32> nameIDs;
+	IdentifyNames ( nodeNames, &nameIDs );
+
+	std::vector<XMP_Uns32> lastFieldParent ( layout.nameCount, kXMP_FlatNoIndex );
+	std::vector<XMP_Uns32> lastQualParent ( layout.nameCount, kXMP_FlatNoIndex );
+
+	XMP_Node newTree ( 0, "", 0 );	// Deletes the partial tree if anything throws.
+	newTree.name = atomNames[GetSnapNodeField ( layout, 0, kSnapNode_NameAtom )];
+	newTree.options = GetSnapNodeField ( layout, 0, kSnapNode_Options );
+	newTree.value.assign ( layout.valuePool + GetSnapNodeField ( layout, 0, kSnapNode_ValueOffset ),
+						   GetSnapNodeField ( layout, 0, kSnapNode_ValueLen ) );
+
+	std::vector<XMP_Node*> liveNodes ( layout.nodeCount, 0 );
+	liveNodes[0] = &newTree;
+
+	for ( XMP_Uns32 nodeNum = 0; nodeNum < layout.nodeCount; ++nodeNum ) {
+
+		XMP_Node * liveNode = liveNodes[nodeNum];
+		XMP_Uns32 firstQual  = GetSnapNodeField ( layout, nodeNum, kSnapNode_FirstQual );
+		XMP_Uns32 qualCount  = GetSnapNodeField ( layout, nodeNum, kSnapNode_QualCount );
+		XMP_Uns32 childCount = GetSnapNodeField ( layout, nodeNum, kSnapNode_ChildCount );
+
+		liveNode->qualifiers.reserve ( qualCount );	// ! So that push_back can't throw below.
+		liveNode->children.reserve ( childCount );
+
+		for ( XMP_Uns32 offspringNum = firstQual, offspringLim = firstQual + qualCount + childCount; offspringNum < offspringLim; ++offspringNum ) {
+
+			XMP_OptionBits options = GetSnapNodeField ( layout, offspringNum, kSnapNode_Options );
+			XMP_Uns32 nameAtom = GetSnapNodeField ( layout, offspringNum, kSnapNode_NameAtom );
+			XMP_StringPtr valuePtr = layout.valuePool + GetSnapNodeField ( layout, offspringNum, kSnapNode_ValueOffset );
+			XMP_Uns32 valueLen = GetSnapNodeField ( layout, offspringNum, kSnapNode_ValueLen );
+
+			bool isQualifier = (offspringNum < (firstQual + qualCount));
+			if ( isQualifier || (! XMP_PropIsArray ( liveNode->options )) ) {
+				std::vector<XMP_Uns32> & lastParent = (isQualifier ? lastQualParent : lastFieldParent);
+				XMP_Uns32 nameID = nameIDs[nameAtom];
+				if ( lastParent[nameID] == nodeNum ) XMP_Throw ( "Bad XMP snapshot, duplicate name", kXMPErr_BadParse );
+				lastParent[nameID] = nodeNum;
+			}
+
+			XMP_Node * newNode;
+
+			if ( options & kXMP_SchemaNode ) {
+
+				// The value is the prefix, use the one the URI is registered with now.
+				XMP_StringPtr nsPrefix;
+				XMP_StringLen prefixLen;
+				if ( atomNames[nameAtom].empty() || (! XMPMeta::GetNamespacePrefix ( atomNames[nameAtom].c_str(), &nsPrefix, &prefixLen )) ) {
+					XMP_Throw ( "Bad XMP snapshot schema", kXMPErr_BadParse );
+				}
+				newNode = new XMP_Node ( liveNode, atomNames[nameAtom], options );
+				newNode->value.assign ( nsPrefix, prefixLen );
+
+			} else {
+
+				if ( atomState[nameAtom] == kAtomUnchecked ) {
+					atomState[nameAtom] = (IsSnapshotPropName ( nodeNames[nameAtom] ) ? kAtomPropName : kAtomBadName);
+				}
+				if ( atomState[nameAtom] != kAtomPropName ) XMP_Throw ( "Bad XMP snapshot node name", kXMPErr_BadParse );
+				if ( (liveNode->options & kXMP_SchemaNode) &&
+					 (nodeNames[nameAtom].compare ( 0, liveNode->value.size(), liveNode->value ) != 0) ) {
+					XMP_Throw ( "Bad XMP snapshot property name", kXMPErr_BadParse );	// A top level name must have the schema's prefix.
+				}
+				newNode = new XMP_Node ( liveNode, nodeNames[nameAtom], options );
+				newNode->value.assign ( valuePtr, valueLen );
+
+			}
+
+			if ( isQualifier ) {
+				liveNode->qualifiers.push_back ( newNode );
+			} else {
+				liveNode->children.push_back ( newNode );
+			}
+
+			liveNodes[offspringNum] = newNode;
+
+		}
+
+	}
+
+	// Nothing below can throw, move the new tree into the object.
+
+	if ( this->xmlParser != 0 ) {	// Abandon an unfinished multiple buffer parse.
+		delete this->xmlParser;
+		this->xmlParser = 0;
+	}
+
+	this->tree.ClearNode();
+	this->tree.options = newTree.options;
+	this->tree.name.swap ( newTree.name );
+	this->tree.value.swap ( newTree.value );
+	this->tree.children.swap ( newTree.children );
+	for ( size_t schemaNum = 0, schemaLim = this->tree.children.size(); schemaNum < schemaLim; ++schemaNum ) {
+		this->tree.children[schemaNum]->parent = &this->tree;
+	}
+
+	this->prevTkVer = (XMP_Int32) GetSnapUns32 ( (const XMP_Uns8 *)&snapshot[kSnap_PrevTkVer] );
+
+}	// LoadFromSnapshot
+
+// =================================================================================================
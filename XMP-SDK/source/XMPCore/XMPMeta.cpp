@@ -481,6 +481,7 @@ XMPMeta::Initialize()
 	
 	sExceptionMessage = new XMP_VarString();
 	XMP_InitMutex ( &sXMPCoreLock );
+	XMP_InitMutex ( &sNamespaceLock );
     sOutputNS  = new XMP_VarString;
     sOutputStr = new XMP_VarString;
 
@@ -488,6 +489,7 @@ XMPMeta::Initialize()
 	
 	sNamespaceURIToPrefixMap	= new XMP_StringMap;
 	sNamespacePrefixToURIMap	= new XMP_StringMap;
+	sRetiredNamespaceMaps		= new std::vector<XMP_StringMap*>;
 	sRegisteredAliasMap			= new XMP_AliasMap;
 	
 	InitializeUnicodeConversions();
@@ -572,13 +574,13 @@ XMPMeta::Initialize()
 	XMP_Assert ( sizeof(XMP_Uns64) == 8 );
 	
 	XMP_Assert ( sizeof(XMP_OptionBits) == 4 );	// Check that option masking work on all 32 bits.
-	XMP_OptionBits flag = ~0UL;
+	XMP_OptionBits flag = ~0U;
 	XMP_Assert ( flag == (XMP_OptionBits)(-1L) );
 	XMP_Assert ( (flag ^ kXMP_PropHasLang) == 0xFFFFFFBFUL );
 	XMP_Assert ( (flag & ~kXMP_PropHasLang) == 0xFFFFFFBFUL );
 	
 	XMP_OptionBits opt1 = 0;	// Check the general option bit macros.
-	XMP_OptionBits opt2 = ~0UL;
+	XMP_OptionBits opt2 = ~0U;
 	XMP_SetOption ( opt1, kXMP_PropValueIsArray );
 	XMP_ClearOption ( opt2, kXMP_PropValueIsArray );
 	XMP_Assert ( opt1 == ~opt2 );
@@ -652,6 +654,7 @@ XMPMeta::Terminate() RELEASE_NO_THROW
 
 	EliminateGlobal ( sNamespaceURIToPrefixMap );
 	EliminateGlobal ( sNamespacePrefixToURIMap );
+	EliminateGlobal ( sRetiredNamespaceMaps );
 	EliminateGlobal ( sRegisteredAliasMap );
     
     EliminateGlobal ( xdefaultName );
@@ -659,6 +662,7 @@ XMPMeta::Terminate() RELEASE_NO_THROW
     EliminateGlobal ( sOutputStr );
 	EliminateGlobal ( sExceptionMessage );
 
+	XMP_TermMutex ( sNamespaceLock );
 	XMP_TermMutex ( sXMPCoreLock );
 
 }	// Terminate
@@ -864,6 +868,12 @@ XMPMeta::SetGlobalOptions ( XMP_OptionBits options )
 // -------------------------------------------------------------------------------------------------
 // RegisterNamespace
 // -----------------
+//
+// Normally the caller holds the XMP lock and the maps are updated in place. While XMPMeta::ParseMany
+// has worker threads running they call this concurrently with lock-free lookups from other workers.
+// The workers are serialized by sNamespaceLock, and instead of modifying the maps a new pair is built
+// and published. The prefix map is published first, so that a reader that finds a URI can also find
+// its prefix. The old maps are freed by ParseMany once the workers are joined.
 
 /* class-static */ bool
 XMPMeta::RegisterNamespace ( XMP_StringPtr	 namespaceURI,
@@ -883,9 +893,13 @@ XMPMeta::RegisterNamespace ( XMP_StringPtr	 namespaceURI,
 	if ( suggPrefix[suggPrefix.size()-1] != ':' ) suggPrefix += ':';
 	VerifySimpleXMLName ( suggestedPrefix, suggestedPrefix+suggPrefix.size()-1 );	// Exclude the colon.
 	
-	XMP_StringMapPos	uriPos	= sNamespaceURIToPrefixMap->find ( nsURI );
+	XMP_NamespaceAutoMutex nsLock;
+	
+	XMP_StringMap *		uriMap		= sNamespaceURIToPrefixMap;
+	XMP_StringMap *		prefixMap	= sNamespacePrefixToURIMap;
+	XMP_StringMapPos	uriPos		= uriMap->find ( nsURI );
 	
-	if ( uriPos == sNamespaceURIToPrefixMap->end() ) {
+	if ( uriPos == uriMap->end() ) {
 		
 		// The URI is not yet registered, make sure we use a unique prefix.
 		
@@ -894,7 +908,7 @@ XMPMeta::RegisterNamespace ( XMP_StringPtr	 namespaceURI,
 		char	buffer [32];
 
 		while ( true ) {
-			if ( sNamespacePrefixToURIMap->find ( uniqPrefix ) == sNamespacePrefixToURIMap->end() ) break;
+			if ( prefixMap->find ( uniqPrefix ) == prefixMap->end() ) break;
 			++suffix;
 			snprintf ( buffer, sizeof(buffer), "_%d_:", suffix );	// AUDIT: Using sizeof for snprintf length is safe.
 			uniqPrefix = suggPrefix;
@@ -902,13 +916,36 @@ XMPMeta::RegisterNamespace ( XMP_StringPtr	 namespaceURI,
 			uniqPrefix += buffer;
 		}
 		
-		// Add the new namespace to both maps.
+		// Add the new namespace to both maps, to copies of them if there are lock-free readers.
+		
+		XMP_StringMap *	oldURIMap		= uriMap;
+		XMP_StringMap *	oldPrefixMap	= prefixMap;
+
+		if ( sParallelParsing ) {
+			sRetiredNamespaceMaps->reserve ( sRetiredNamespaceMaps->size() + 2 );	// ! So push_back can't throw.
+			uriMap = new XMP_StringMap ( *oldURIMap );
+			try {
+				prefixMap = new XMP_StringMap ( *oldPrefixMap );
+			} catch ( ... ) {
+				delete uriMap;
+				throw;
+			}
+		}
 		
 		XMP_StringPair	newNS ( nsURI, uniqPrefix );
-		uriPos = sNamespaceURIToPrefixMap->insert ( sNamespaceURIToPrefixMap->end(), newNS );
+		uriPos = uriMap->insert ( uriMap->end(), newNS );
 		
 		newNS.first.swap ( newNS.second );
-		(void) sNamespacePrefixToURIMap->insert ( sNamespacePrefixToURIMap->end(), newNS );
+		(void) prefixMap->insert ( prefixMap->end(), newNS );
+		
+		if ( uriMap != oldURIMap ) {
+			sRetiredNamespaceMaps->push_back ( oldPrefixMap );
+			sRetiredNamespaceMaps->push_back ( oldURIMap );
+			XMP_MemoryBarrier();
+			sNamespacePrefixToURIMap = prefixMap;
+			XMP_MemoryBarrier();
+			sNamespaceURIToPrefixMap = uriMap;
+		}
 
 	}
 	
@@ -938,9 +975,10 @@ XMPMeta::GetNamespacePrefix	( XMP_StringPtr   namespaceURI,
 	XMP_Assert ( (namespacePrefix != 0) && (prefixSize != 0) );	// ! Enforced by wrapper.
 
 	XMP_VarString    nsURI ( namespaceURI );
-	XMP_StringMapPos uriPos	= sNamespaceURIToPrefixMap->find ( nsURI );
+	XMP_StringMap *  uriMap	= sNamespaceURIToPrefixMap;	// ! Load once, see RegisterNamespace.
+	XMP_StringMapPos uriPos	= uriMap->find ( nsURI );
 	
-	if ( uriPos != sNamespaceURIToPrefixMap->end() ) {
+	if ( uriPos != uriMap->end() ) {
 		*namespacePrefix = uriPos->second.c_str();
 		*prefixSize = uriPos->second.size();
 		found = true;
@@ -968,9 +1006,10 @@ XMPMeta::GetNamespaceURI ( XMP_StringPtr   namespacePrefix,
 	XMP_VarString nsPrefix ( namespacePrefix );
 	if ( nsPrefix[nsPrefix.size()-1] != ':' ) nsPrefix += ':';
 	
-	XMP_StringMapPos prefixPos = sNamespacePrefixToURIMap->find ( nsPrefix );
+	XMP_StringMap *  prefixMap = sNamespacePrefixToURIMap;	// ! Load once, see RegisterNamespace.
+	XMP_StringMapPos prefixPos = prefixMap->find ( nsPrefix );
 	
-	if ( prefixPos != sNamespacePrefixToURIMap->end() ) {
+	if ( prefixPos != prefixMap->end() ) {
 		*namespaceURI = prefixPos->second.c_str();
 		*uriSize = prefixPos->second.size();
 		found = true;
@@ -1289,6 +1328,8 @@ XMPMeta::DumpObject ( XMP_TextOutputProc outProc,
 	XMP_Assert ( outProc != 0 );	// ! Enforced by wrapper.
 	XMP_Status status;
 	
+	MaterializeAllSchemas ( const_cast<XMP_Node*>(&tree) );
+	
 	OutProcLiteral ( "Dumping XMPMeta object \"" );
 	OutProcString ( tree.name );
 	OutProcNChars ( "\"  ", 3 );
@@ -1461,6 +1502,7 @@ XMPMeta::Clone ( XMP_OptionBits options ) const
 		clone->tree._valuePtr = clone->tree.value.c_str();
 	#endif
 	
+	MaterializeAllSchemas ( const_cast<XMP_Node*>(&this->tree) );
 	CloneOffspring ( &this->tree, &clone->tree );
 	
 	XMP_Assert ( clone->clientRefs == 0 );	// Gets incremneted later.
@@ -125,6 +125,14 @@ public:
 				  XMP_StringLen *  valueSize,
 				  XMP_OptionBits * options ) const;
 	
+	XMP_Index
+	GetPropertyBatch ( XMP_Index			   propCount,
+					   const XMP_StringPtr *   schemaNS,
+					   const XMP_StringPtr *   propNames,
+					   XMP_PropertyBatchInfo * propInfo,
+					   XMP_StringPtr *		   valueArena,
+					   XMP_StringLen *		   arenaSize ) const;
+	
 	bool
 	GetArrayItem ( XMP_StringPtr	schemaNS,
 				   XMP_StringPtr	arrayName,
@@ -352,6 +360,20 @@ public:
 	ParseFromBuffer ( XMP_StringPtr	 buffer,
 					  XMP_StringLen	 bufferSize,
 					  XMP_OptionBits options );
+
+	static void
+	ParseMany ( XMP_Int32             packetCount,
+				const XMP_StringPtr * packets,
+				const XMP_StringLen * packetLens,
+				XMP_OptionBits        options,
+				XMP_Int32             maxThreads,
+				XMPMetaRef *          xmpRefs,
+				XMP_Int32 *           errorIDs );
+	
+	void
+	SetParseFilter ( XMP_OptionBits		   filterMode,
+					 const XMP_StringPtr * schemaList,
+					 XMP_Index			   schemaCount );
 	
 	void
 	SerializeToBuffer ( XMP_StringPtr * rdfString,
@@ -362,6 +384,14 @@ public:
 						XMP_StringPtr	indent,
 						XMP_Index		baseIndent ) const;
 	
+	void
+	SerializeToSnapshot ( XMP_StringPtr * snapshot,
+						  XMP_StringLen * snapshotSize ) const;
+	
+	void
+	LoadFromSnapshot ( XMP_StringPtr snapshot,
+					   XMP_StringLen snapshotSize );
+	
 	// =============================================================================================
 
 	// ---------------------------------------------------------------------------------------------
@@ -394,6 +424,7 @@ public:
 	XMP_Node  tree;
 
 	XMLParserAdapter * xmlParser;
+	XMP_SchemaFilter   parseFilter;	// Not copied by Clone, it only affects parsing into this object.
 	
 	friend class XMPIterator;
 	friend class XMPUtils;
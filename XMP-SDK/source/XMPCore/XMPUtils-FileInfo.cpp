@@ -1122,6 +1122,8 @@ XMPUtils::RemoveProperties ( XMPMeta *		xmpObj,
 		// ! Iterate backwards to reduce shuffling if schema are erased and to simplify the logic
 		// ! for denoting the current schema. (Erasing schema n makes the old n+1 now be n.)
 
+		MaterializeAllSchemas ( &xmpObj->tree );
+
 		size_t		   schemaCount = xmpObj->tree.children.size();
 		XMP_NodePtrPos beginPos	   = xmpObj->tree.children.begin();
 		
@@ -1150,6 +1152,8 @@ XMPUtils::AppendProperties ( const XMPMeta & source,
 	const bool replaceOld  = ((options & kXMPUtil_ReplaceOldValues) != 0);
 	const bool deleteEmpty = ((options & kXMPUtil_DeleteEmptyValues) != 0);
 
+	MaterializeAllSchemas ( const_cast<XMP_Node*>(&source.tree) );
+
 	for ( size_t schemaNum = 0, schemaLim = source.tree.children.size(); schemaNum != schemaLim; ++schemaNum ) {
 
 		const XMP_Node * sourceSchema = source.tree.children[schemaNum];
@@ -1022,11 +1022,31 @@ XMPUtils::ConvertFromDate ( const XMP_DateTime & binValue,
 							XMP_StringLen *		 strSize )
 {	
 	XMP_Assert ( (strValue != 0) && (strSize != 0) );	// Enforced by wrapper.
+	
+	ConvertFromDate ( binValue, sConvertedValue );
+	
+	*strValue = sConvertedValue->c_str();
+	*strSize  = sConvertedValue->size();
+	
+}	// ConvertFromDate
+
+// -------------------------------------------------------------------------------------------------
+// ConvertFromDate
+// ---------------
+//
+// Internal form that formats into a caller's string instead of the static output string, usable
+// from the worker threads of XMPMeta::ParseMany.
+
+/* class static */ void
+XMPUtils::ConvertFromDate ( const XMP_DateTime & binValue,
+							XMP_VarString *		 strValue )
+{	
+	XMP_Assert ( strValue != 0 );
 
 	bool addTimeZone = false;
 	char buffer [100];	// Plenty long enough.
 	
-	// Pick the format, use snprintf to format into a local buffer, assign to static output string.
+	// Pick the format, use snprintf to format into a local buffer, assign to the output string.
 	// Don't use AdjustTimeOverflow at the start, that will wipe out zero month or day values.
 	
 	// ! Photoshop 8 creates "time only" values with zeros for year, month, and day.
@@ -1098,7 +1118,7 @@ XMPUtils::ConvertFromDate ( const XMP_DateTime & binValue,
 	
 	}
 	
-	sConvertedValue->assign ( buffer );
+	strValue->assign ( buffer );
 	
 	if ( addTimeZone ) {
 
@@ -1111,18 +1131,15 @@ XMPUtils::ConvertFromDate ( const XMP_DateTime & binValue,
 		}
 
 		if ( tempDate.tzSign == 0 ) {
-			*sConvertedValue += 'Z';
+			*strValue += 'Z';
 		} else {
 			snprintf ( buffer, sizeof(buffer), "+%02d:%02d", tempDate.tzHour, tempDate.tzMinute );	// AUDIT: Using sizeof for snprintf length is safe.
 			if ( tempDate.tzSign < 0 ) buffer[0] = '-';
-			*sConvertedValue += buffer;
+			*strValue += buffer;
 		}
 
 	}
 	
-	*strValue = sConvertedValue->c_str();
-	*strSize  = sConvertedValue->size();
-	
 }	// ConvertFromDate
 
 
@@ -1679,6 +1696,7 @@ XMPUtils::PackageForJPEG ( const XMPMeta & origXMP,
 		stdXMP.tree.options = origXMP.tree.options;
 		stdXMP.tree.name    = origXMP.tree.name;
 		stdXMP.tree.value   = origXMP.tree.value;
+		MaterializeAllSchemas ( const_cast<XMP_Node*>(&origXMP.tree) );
 		CloneOffspring ( &origXMP.tree, &stdXMP.tree );
 		
 		if ( stdXMP.DoesPropertyExist ( kXMP_NS_XMP, "Thumbnails" ) ) {
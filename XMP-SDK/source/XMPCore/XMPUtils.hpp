@@ -110,6 +110,10 @@ public:
 					  XMP_StringPtr *	   strValue,
 					  XMP_StringLen *	   strSize );
 
+	static void
+	ConvertFromDate ( const XMP_DateTime & binValue,
+					  XMP_VarString *	   strValue );	// Internal, doesn't use the static output string.
+
 	// ---------------------------------------------------------------------------------------------
 
 	static bool
@@ -91,16 +91,16 @@ bool AVI_CheckFormat ( XMP_FileFormat format,
 			           LFA_FileRef    fileRef,
 			           XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(parent);
+	IgnoreParam(format);
 	XMP_Assert ( format == kXMP_AVIFile );
 
 	if ( fileRef == 0 ) return false;
 	
-	enum { kBufferSize = 12 };
-	XMP_Uns8 buffer [kBufferSize];
+	enum { kHeaderSize = 12 };
 	
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	LFA_Read ( fileRef, buffer, kBufferSize );
+	size_t prefixLen;
+	const XMP_Uns8 * buffer = GetFilePrefix ( parent, fileRef, &prefixLen );
+	if ( prefixLen < kHeaderSize ) return false;
 	
 	// "RIFF" is 52 49 46 46, "AVI " is 41 56 49 20
 	if ( (! CheckBytes ( &buffer[0], "\x52\x49\x46\x46", 4 )) ||
@@ -161,7 +161,10 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	if ( numTags == 0 ) return;
 
 	ok = RIFF_Support::PutChunk ( fileRef, riffState, formtypeAVI, kXMPUserDataType, (char*)packetStr, packetLen );
-	if ( ! ok )return;	// If there's an error writing the chunk, bail.
+	if ( ! ok ) {
+		RIFF_Support::CloseRIFF ( fileRef, riffState );
+		return;	// If there's an error writing the chunk, bail.
+	}
 
 	// Update legacy metadata
 
@@ -185,7 +188,7 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 
 		ok = FindChunk ( riffState, myCommentChunk, myCommentList, 0, 0, 0, 0 );
 
-		if ( ! ok ) {
+		if ( ok ) {
 
 			// Always rewrite the comment string, even if empty, so the user can erase it.
 			RIFF_Support::RewriteChunk ( fileRef, riffState, myCommentChunk, myCommentList, logCommentString.c_str() );
@@ -193,7 +196,10 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 		} else {
 
 			ok = MakeChunk ( fileRef, riffState, formtypeAVI, PR_AVI_COMMENTLEN );
-			if ( ! ok ) return; // If there's an error making a chunk, bail
+			if ( ! ok ) {
+				RIFF_Support::CloseRIFF ( fileRef, riffState );
+				return; // If there's an error making a chunk, bail
+			}
 
 			RIFF_Support::ltag listtag;
 			listtag.id = MakeUns32LE ( FOURCC_LIST );
@@ -201,6 +207,7 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 			listtag.subid = MakeUns32LE ( myCommentList );
 			LFA_Write ( fileRef, &listtag, 12 );
 
+			logCommentString.resize ( COMMENTLEN, 0 );	// The chunk has a fixed size, like RewriteChunk pad or truncate.
 			RIFF_Support::WriteChunk ( fileRef, myCommentChunk, logCommentString.c_str(), COMMENTLEN );
 
 		}
@@ -226,7 +233,10 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	} else {
 	
 		ok = MakeChunk ( fileRef, riffState, formtypeAVI, PR_AVI_TIMELEN );
-		if ( ! ok ) return; // If there's an error making a chunk, bail
+		if ( ! ok ) {
+			RIFF_Support::CloseRIFF ( fileRef, riffState );
+			return; // If there's an error making a chunk, bail
+		}
 
 		RIFF_Support::ltag listtag;
 		listtag.id = MakeUns32LE ( FOURCC_LIST );
@@ -234,6 +244,11 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 		listtag.subid = MakeUns32LE ( myTimeList );
 		LFA_Write(fileRef, &listtag, 12);
 
+		startTimecodeString.resize ( TIMELEN, 0 );	// The chunks have a fixed size, like RewriteChunk pad or truncate.
+		altTimecodeString.resize ( TIMELEN, 0 );
+		orgReelString.resize ( REELLEN, 0 );
+		altReelString.resize ( REELLEN, 0 );
+
 		RIFF_Support::WriteChunk ( fileRef, myOrgTimeChunk, startTimecodeString.c_str(), TIMELEN );
 		RIFF_Support::WriteChunk ( fileRef, myAltTimeChunk, altTimecodeString.c_str(), TIMELEN );
 		RIFF_Support::WriteChunk ( fileRef, myOrgReelChunk, orgReelString.c_str(), REELLEN );
@@ -241,6 +256,10 @@ void AVI_MetaHandler::UpdateFile ( bool doSafeUpdate )
 
 	}
 
+	// Write the RIFF length once, for all of the chunks that were appended.
+	ok = RIFF_Support::CloseRIFF ( fileRef, riffState );
+	if ( ! ok ) return;
+
 	this->needsUpdate = false;
 
 }	// AVI_MetaHandler::UpdateFile
@@ -271,8 +290,18 @@ void AVI_MetaHandler::CacheFileData()
 	LFA_FileRef fileRef ( this->parent->fileRef );
 	if ( fileRef == 0 ) return;
 
+	// Only walk the file until the XMP and all of the legacy chunks have been seen.
+	static const RIFF_Support::RiffChunkID kWantedChunks[] = {
+		{ kXMPUserDataType, 0 },
+		{ aviTimeChunk, avihdrlChunk },
+		{ myOrgTimeChunk, myTimeList }, { myAltTimeChunk, myTimeList },
+		{ myOrgReelChunk, myTimeList }, { myAltReelChunk, myTimeList },
+		{ myCommentChunk, myCommentList },
+		{ 0, 0 }
+	};
+
 	RIFF_Support::RiffState riffState;
-	long numTags = RIFF_Support::OpenRIFF ( fileRef, riffState );
+	long numTags = RIFF_Support::OpenRIFF ( fileRef, riffState, kWantedChunks );
 	if ( numTags == 0 ) return;
 
 	// Determine the size of the metadata
@@ -423,7 +452,10 @@ void AVI_MetaHandler::CacheFileData()
 	}
 
 	// Update the xmpPacket, as the xmpObj might have been updated with legacy info.
-	this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+	{
+		PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
+		this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+	}
 	this->packetInfo.offset = kXMPFiles_UnknownOffset;
 	this->packetInfo.length = this->xmpPacket.size();
 
@@ -99,6 +99,7 @@ void Basic_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & s
 	XMP_AbortProc abortProc  = this->parent->abortProc;
 	void *        abortArg   = this->parent->abortArg;
 	const bool    checkAbort = (abortProc != 0);
+	const bool    dropBehind = XMP_OptionIsSet ( this->parent->openFlags, kXMPFiles_OpenDropBehind );
 	
 	LFA_FileRef destRef = this->parent->fileRef;
 	
@@ -123,7 +124,7 @@ void Basic_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & s
 	XMP_Int64 xmpSectionOffset = this->xmpFileOffset - this->xmpPrefixSize;
 	XMP_Int32 oldSectionLength = this->xmpPrefixSize + this->xmpFileSize + this->xmpSuffixSize;
 	
-	LFA_Copy ( sourceRef, destRef, xmpSectionOffset, abortProc, abortArg );
+	LFA_Copy ( sourceRef, destRef, xmpSectionOffset, abortProc, abortArg, dropBehind );
 	this->NoteXMPRemoval();
 	packetInfo.offset = this->xmpFileOffset;	// ! The packet offset does not change.
 	this->NoteXMPInsertion();
@@ -146,7 +147,7 @@ void Basic_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & s
 	XMP_Int64 remainderOffset = xmpSectionOffset + oldSectionLength;
 
 	LFA_Seek ( sourceRef, remainderOffset, SEEK_SET );
-	LFA_Copy ( sourceRef, destRef, this->trailingContentSize, abortProc, abortArg );
+	LFA_Copy ( sourceRef, destRef, this->trailingContentSize, abortProc, abortArg, dropBehind );
 	this->RestoreFileEnding();
 	
 	// Done.
@@ -102,20 +102,14 @@ bool InDesign_CheckFormat ( XMP_FileFormat format,
 	                        LFA_FileRef    fileRef,
 	                        XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(filePath); IgnoreParam(parent);
+	IgnoreParam(format); IgnoreParam(filePath);
 	XMP_Assert ( format == kXMP_InDesignFile );
 	XMP_Assert ( strlen ( (const char *) kINDD_MasterPageGUID ) == kInDesignGUIDSize );
+	XMP_Assert ( (2*kINDD_PageSize) <= kProbeBufferSize );
 
-	enum { kBufferSize = 2*kINDD_PageSize };
-	XMP_Uns8 buffer [kBufferSize];
-
-	XMP_Int64 filePos   = 0;
-	XMP_Uns8 * bufPtr   = buffer;
-	XMP_Uns8 * bufLimit = bufPtr + kBufferSize;
-
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	size_t bufLen = LFA_Read ( fileRef, buffer, kBufferSize );
-	if ( bufLen != kBufferSize ) return false;
+	size_t prefixLen;
+	const XMP_Uns8 * bufPtr = GetFilePrefix ( parent, fileRef, &prefixLen );
+	if ( prefixLen < (2*kINDD_PageSize) ) return false;
 	
 	if ( ! CheckBytes ( bufPtr, kINDD_MasterPageGUID, kInDesignGUIDSize ) ) return false;
 	if ( ! CheckBytes ( bufPtr+kINDD_PageSize, kINDD_MasterPageGUID, kInDesignGUIDSize ) ) return false;
@@ -215,7 +209,8 @@ void InDesign_MetaHandler::CacheFileData()
 	// much and seeking back to the start of the following stream.
 	
 	XMP_Int64 cobjPos = (XMP_Int64)dbPages * kINDD_PageSize;	// ! Use a 64 bit multiply!
-	XMP_Uns32 streamLength = (XMP_Uns32)(-(long)(2*sizeof(InDesignContigObjMarker)));	// ! For the first pass in the loop.
+	XMP_Uns32 streamLength = 0;
+	cobjPos -= (2 * sizeof(InDesignContigObjMarker));	// ! For the first pass in the loop.
 
 	while ( true ) {
 
@@ -84,23 +84,23 @@ bool JPEG_CheckFormat ( XMP_FileFormat format,
                         LFA_FileRef    fileRef,
                         XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(filePath); IgnoreParam(parent);
+	IgnoreParam(format); IgnoreParam(filePath);
 	XMP_Assert ( format == kXMP_JPEGFile );
 
-	IOBuffer ioBuf;
-	
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	if ( ! CheckFileSpace ( fileRef, &ioBuf, 4 ) ) return false;	// We need at least 4, the buffer is filled anyway.
+	size_t prefixLen;
+	const XMP_Uns8 * bufPtr = GetFilePrefix ( parent, fileRef, &prefixLen );
+	const XMP_Uns8 * bufLimit = bufPtr + prefixLen;
+	if ( prefixLen < 4 ) return false;	// We need at least 4, the prefix is filled anyway.
 	
 	// First look for the SOI standalone marker. Then skip all 0xFF bytes, padding plus the high
 	// order byte of the next marker. Finally see if the next marker is legit.
 	
-	if ( ! CheckBytes ( ioBuf.ptr, "\xFF\xD8", 2 ) ) return false;
-	ioBuf.ptr += 2;	// Move past the SOI.
-	while ( (ioBuf.ptr < ioBuf.limit) && (*ioBuf.ptr == 0xFF) ) ++ioBuf.ptr;
-	if ( ioBuf.ptr == ioBuf.limit ) return false;
+	if ( ! CheckBytes ( bufPtr, "\xFF\xD8", 2 ) ) return false;
+	bufPtr += 2;	// Move past the SOI.
+	while ( (bufPtr < bufLimit) && (*bufPtr == 0xFF) ) ++bufPtr;
+	if ( bufPtr == bufLimit ) return false;
 	
-	XMP_Uns8 id = *ioBuf.ptr;
+	XMP_Uns8 id = *bufPtr;
 	if ( id >= 0xDD ) return true;	// The most probable cases.
 	if ( (id < 0xC0) || ((id & 0xF8) == 0xD0) || (id == 0xD8) || (id == 0xDA) || (id == 0xDC) ) return false;
 	return true;
@@ -226,6 +226,15 @@ void JPEG_MetaHandler::CacheFileData()
 	void *        abortArg   = this->parent->abortArg;
 	const bool    checkAbort = (abortProc != 0);
 	
+	// When only the XMP is wanted, skip the legacy marker segments instead of caching them. Never
+	// do this when opened for update, UpdateFile must write the legacy back. The Exif is still
+	// needed for the thumbnail.
+	
+	const XMP_OptionBits openFlags = this->parent->openFlags;
+	const bool skipPSIR = XMP_OptionIsSet ( openFlags, kXMPFiles_OpenOnlyXMP ) &&
+						  (! XMP_OptionIsSet ( openFlags, kXMPFiles_OpenForUpdate ));
+	const bool skipExif = skipPSIR && (! XMP_OptionIsSet ( openFlags, kXMPFiles_OpenCacheTNail ));
+	
 	ExtendedXMPInfo extXMP;
 	
 	XMP_Assert ( (! this->containsXMP) && (! this->containsTNail) );
@@ -239,9 +248,9 @@ void JPEG_MetaHandler::CacheFileData()
 	// Look for any of the Exif, PSIR, main XMP, or extended XMP marker segments. Quit when we hit
 	// an SOFn, EOI, or invalid/unexpected marker.
 
-	LFA_Seek ( fileRef, 2, SEEK_SET );	// Skip the SOI. The JPEG header has already been verified.
-	ioBuf.filePos = 2;
-	RefillBuffer ( fileRef, &ioBuf );
+	FillProbeBuffer ( this->parent, fileRef, &ioBuf );	// Start with the prefix the CheckProc looked at.
+	if ( ! CheckFileSpace ( fileRef, &ioBuf, 2 ) ) return;
+	ioBuf.ptr += 2;	// Skip the SOI. The JPEG header has already been verified.
 	
 	while ( true ) {
 
@@ -273,7 +282,7 @@ void JPEG_MetaHandler::CacheFileData()
 			segLen -= 2;	// Adjust segLen to count just the content portion.
 			
 			ok = CheckFileSpace ( fileRef, &ioBuf, kPSIRSignatureLength );
-			if ( ok && (segLen >= kPSIRSignatureLength) &&
+			if ( ok && (! skipPSIR) && (segLen >= kPSIRSignatureLength) &&
 				 CheckBytes ( ioBuf.ptr, kPSIRSignatureString, kPSIRSignatureLength ) ) {
 			
 				// This is the Photoshop image resources, cache the contents.
@@ -288,7 +297,7 @@ void JPEG_MetaHandler::CacheFileData()
 			
 			} else {
 			
-				// This is the not Photoshop image resources, skip the marker segment's content.
+				// This is not the Photoshop image resources, or they aren't wanted, skip the marker segment's content.
 
 				if ( segLen <= size_t(ioBuf.limit - ioBuf.ptr) ) {
 					ioBuf.ptr += segLen;	// The next marker is in this buffer.
@@ -296,7 +305,7 @@ void JPEG_MetaHandler::CacheFileData()
 					// The next marker is beyond this buffer, RefillBuffer assumes we're doing sequential reads.
 					size_t skipCount = segLen - (ioBuf.limit - ioBuf.ptr);	// The amount to move beyond this buffer.
 					ioBuf.filePos = LFA_Seek ( fileRef, skipCount, SEEK_CUR );
-					ioBuf.ptr = ioBuf.limit;		// No data left in the buffer.
+					ioBuf.ptr = ioBuf.limit = &ioBuf.data[0];	// No data left in the buffer, keep RefillBuffer from moving filePos.
 				}
 
 			}
@@ -320,7 +329,7 @@ void JPEG_MetaHandler::CacheFileData()
 			// Check for the Exif APP1 marker segment.
 			
 			ok = CheckFileSpace ( fileRef, &ioBuf, kExifSignatureLength );
-			if ( ok && (segLen >= kExifSignatureLength) &&
+			if ( ok && (! skipExif) && (segLen >= kExifSignatureLength) &&
 				 (CheckBytes ( ioBuf.ptr, kExifSignatureString, kExifSignatureLength ) ||
 				  CheckBytes ( ioBuf.ptr, kExifSignatureAltStr, kExifSignatureLength )) ) {
 			
@@ -440,7 +449,7 @@ void JPEG_MetaHandler::CacheFileData()
 				
 			}
 			
-			// If we get here this is some other uninteresting APP1 marker segment, skip it.
+			// If we get here this is some other uninteresting APP1 marker segment, or unwanted Exif, skip it.
 			
 			if ( segLen <= size_t(ioBuf.limit - ioBuf.ptr) ) {
 				ioBuf.ptr += segLen;	// The next marker is in this buffer.
@@ -448,7 +457,7 @@ void JPEG_MetaHandler::CacheFileData()
 				// The next marker is beyond this buffer, RefillBuffer assumes we're doing sequential reads.
 				size_t skipCount = segLen - (ioBuf.limit - ioBuf.ptr);	// The amount to move beyond this buffer.
 				ioBuf.filePos = LFA_Seek ( fileRef, skipCount, SEEK_CUR );
-				ioBuf.ptr = ioBuf.limit;		// No data left in the buffer.
+				ioBuf.ptr = ioBuf.limit = &ioBuf.data[0];	// No data left in the buffer, keep RefillBuffer from moving filePos.
 			}
 		
 		} else if ( TableOrDataMarker ( marker ) ) {
@@ -467,7 +476,7 @@ void JPEG_MetaHandler::CacheFileData()
 				// The next marker is beyond this buffer, RefillBuffer assumes we're doing sequential reads.
 				size_t skipCount = segLen - (ioBuf.limit - ioBuf.ptr);	// The amount to move beyond this buffer.
 				ioBuf.filePos = LFA_Seek ( fileRef, skipCount, SEEK_CUR );
-				ioBuf.ptr = ioBuf.limit;		// No data left in the buffer.
+				ioBuf.ptr = ioBuf.limit = &ioBuf.data[0];	// No data left in the buffer, keep RefillBuffer from moving filePos.
 			}
 			
 			continue;	// Move on to the next marker.
@@ -648,7 +657,7 @@ void JPEG_MetaHandler::ProcessXMP()
 			this->xmpObj.ParseFromBuffer ( packetStr, packetLen );
 		} catch ( ... ) {
 			XMP_ClearOption ( options, k2XMP_FileHadXMP );
-			ImportJTPtoXMP ( kXMP_JPEGFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options );
+			ImportJTPtoXMP ( kXMP_JPEGFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options, &this->exportState );
 			throw;	// ! Rethrow the exception, don't absorb it.
 		}
 	}
@@ -689,7 +698,7 @@ void JPEG_MetaHandler::ProcessXMP()
 	
 	// Process the legacy metadata.
 
-	ImportJTPtoXMP ( kXMP_JPEGFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options );
+	ImportJTPtoXMP ( kXMP_JPEGFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options, &this->exportState );
 	if ( haveExif | haveIPTC ) this->containsXMP = true;	// Assume we had something for the XMP.
 	
 }	// JPEG_MetaHandler::ProcessXMP
@@ -708,7 +717,7 @@ void JPEG_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	//	- The are no changes to the legacy Exif or PSIR portions. (The IPTC is in the PSIR.)
 	//	- The new XMP can fit in the old space, without extensions.
 
-	ExportXMPtoJTP ( kXMP_JPEGFile, &this->xmpObj, this->exifMgr, this->psirMgr, this->iptcMgr );
+	ExportXMPtoJTP ( kXMP_JPEGFile, &this->xmpObj, this->exifMgr, this->psirMgr, this->iptcMgr, 0, &this->exportState );
 	
 	XMP_Int64 oldPacketOffset = this->packetInfo.offset;
 	XMP_Int32 oldPacketLength = this->packetInfo.length;
@@ -725,10 +734,6 @@ void JPEG_MetaHandler::UpdateFile ( bool doSafeUpdate )
 
 	if ( doInPlace ) {
 
-		#if GatherPerformanceData
-			sAPIPerf->back().extraInfo += ", JPEG in-place update";
-		#endif
-	
 		LFA_FileRef liveFile = this->parent->fileRef;
 		std::string & newPacket = this->xmpPacket;
 	
@@ -739,10 +744,6 @@ void JPEG_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	
 	} else {
 
-		#if GatherPerformanceData
-			sAPIPerf->back().extraInfo += ", JPEG copy update";
-		#endif
-	
 		std::string origPath = this->parent->filePath;
 		LFA_FileRef origRef  = this->parent->fileRef;
 		
@@ -815,7 +816,7 @@ void JPEG_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & so
 	LFA_Truncate (destRef, 0 );
 
 	if ( ! skipReconcile ) {
-		ExportXMPtoJTP ( kXMP_JPEGFile, &this->xmpObj, this->exifMgr, this->psirMgr, this->iptcMgr );
+		ExportXMPtoJTP ( kXMP_JPEGFile, &this->xmpObj, this->exifMgr, this->psirMgr, this->iptcMgr, 0, &this->exportState );
 	}
 	
 	RefillBuffer ( sourceRef, &ioBuf );
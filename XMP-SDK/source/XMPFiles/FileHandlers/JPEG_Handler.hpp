@@ -13,6 +13,7 @@
 #include "TIFF_Support.hpp"
 #include "PSIR_Support.hpp"
 #include "IPTC_Support.hpp"
+#include "ReconcileLegacy.hpp"
 
 // =================================================================================================
 /// \file JPEG_Handler.hpp
@@ -84,6 +85,8 @@ private:
 	
 	bool skipReconcile;	// ! Used between UpdateFile and WriteFile.
 	
+	RecJTP_ExportState exportState;	// Which legacy digests are known to be current.
+	
 	typedef std::map < GUID_32, std::string > ExtendedXMPMap;
 	
 	ExtendedXMPMap extendedXMP;	// ! Only contains those with complete data.
@@ -8,7 +8,6 @@
 // =================================================================================================
 
 #include "MP3_Handler.hpp"
-#include "ID3_Support.hpp"
 
 using namespace std;
 
@@ -70,29 +69,21 @@ bool MP3_CheckFormat ( XMP_FileFormat format,
 
 	if ( inFileRef == 0 ) return false;
 
-	// BUG FIX 1219125: If we find that the "unsynchronistation" flag is turned on, we should fail on that file.
-	// TODO: Support "unsynchronized" files.
+	size_t prefixLen;
+	const XMP_Uns8 * prefix = GetFilePrefix ( parent, inFileRef, &prefixLen );
+	if ( prefixLen < 3 ) return false;
 
-	LFA_Seek ( inFileRef, 0ULL, SEEK_SET );
-
-	char szID [4] = { "xxx" };
-	long bytesRead = LFA_Read ( inFileRef, szID, 3 );
-	if ( bytesRead != 3 ) return false;
-
-	if ( strncmp ( szID, "ID3", 3 ) != 0 ) {
+	if ( ! CheckBytes ( prefix, "ID3", 3 ) ) {
 
 		return (parent->format == kXMP_MP3File);	// No ID3 signature, depend on first call hint.
 	
 	} else {
 
-		// Read the version, flag and size.
-		XMP_Uns8 v2 = 0, flags = 0, bMajorVer = 0;
-		unsigned long dwLen = 0;
-		bool ok = ID3_Support::GetTagInfo ( inFileRef, bMajorVer, v2, flags, dwLen );
-
-		if ( ok ) {
+		// Check the version. The tag header is "ID3", the major and minor version, the flags, and
+		// the size. Unsynchronised tags are OK, ID3_Support::ReadTag undoes the unsynchronisation.
+		if ( prefixLen >= 10 ) {
+			XMP_Uns8 bMajorVer = prefix[3];
 			if ( (bMajorVer < 3)  || (bMajorVer > 4) ) return false;
-			if ( flags & 0x80 ) return false;	// 0x80 == "unsynchronized"
 		}
 
 	}
@@ -142,11 +133,9 @@ void MP3_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	LFA_FileRef fileRef ( this->parent->fileRef );
 	if ( fileRef == 0 ) return;
 
-	// Get the id3v2 version
+	// Get the id3v2 version, the tag was read by CacheFileData.
 	XMP_Uns8 bVersion = 3;
-	unsigned long dwTagSize;
-	bool ok = ID3_Support::FindID3Tag ( fileRef, dwTagSize, bVersion );
-	if ( ! ok ) bVersion = 3;
+	if ( this->id3Tag.found ) bVersion = this->id3Tag.majorVersion;
 	
 	// Allocate the temp buffer for the native frames we have to overwrite
 	unsigned long bufferSize = 7*TAG_MAX_SIZE; // Just enough buffer for all 7 tags
@@ -201,7 +190,7 @@ void MP3_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	// TODO id3v1 tags
 
 	// Saving it all
-	ID3_Support::SetMetaData ( fileRef, (char*)packetStr, packetLen, buffer, dwCurOffset, fReconciliate );
+	ID3_Support::SetMetaData ( fileRef, this->id3Tag, (char*)packetStr, packetLen, buffer, dwCurOffset, fReconciliate );
 
 	this->needsUpdate = false;
 
@@ -235,44 +224,40 @@ void MP3_MetaHandler::CacheFileData()
 	LFA_FileRef fileRef ( this->parent->fileRef );
 	if ( fileRef == 0 ) return;
 
-	// Determine the size of the metadata
-	unsigned long bufferSize(0);
-	ok = ID3_Support::GetMetaData ( fileRef, 0, &bufferSize, 0 );
+	// Read the whole ID3 tag, most often it is all in the OpenFile prefix. Everything else is found
+	// in the tag's frame table, there is no further I/O.
+	size_t prefixLen;
+	const XMP_Uns8 * prefix = GetFilePrefix ( this->parent, fileRef, &prefixLen );
+	ID3_Support::ReadTag ( fileRef, prefix, prefixLen, &this->id3Tag );
+
+	// Get the metadata
+	XMP_Int64 xmpOffset;
+	ok = ID3_Support::GetMetaData ( this->id3Tag, &this->xmpPacket, &xmpOffset );
 
 	if ( ! ok ) {
 
+		this->xmpPacket.erase();
 		packetInfo.writeable = true;	// If no packet found, created packets will be writeable
 
-	} else if ( bufferSize > 0 ) {
-
-		// Allocate the buffer
-		std::string buffer;
-		buffer.reserve ( bufferSize );
-		buffer.assign ( bufferSize, ' ' );
-
-		// Get the metadata
-		XMP_Int64 xmpOffset;
-		ok = ID3_Support::GetMetaData ( fileRef, (char*)buffer.c_str(), &bufferSize, &xmpOffset );
-		if ( ok ) {
-			this->packetInfo.offset = xmpOffset;
-			this->packetInfo.length = bufferSize;
-			this->xmpPacket.assign(buffer.data(), bufferSize);
-			this->xmpObj.ParseFromBuffer ( this->xmpPacket.c_str(), this->xmpPacket.size() );
-			this->containsXMP = true;
-		}
+	} else if ( ! this->xmpPacket.empty() ) {
+
+		this->packetInfo.offset = xmpOffset;
+		this->packetInfo.length = (XMP_Int32)this->xmpPacket.size();
+		this->xmpObj.ParseFromBuffer ( this->xmpPacket.c_str(), this->xmpPacket.size() );
+		this->containsXMP = true;
 
 	}
 
 	if ( fReconciliate ) {
 
 		// ! Note that LoadPropertyFromID3 sets this->containsXMP, update this->processedXMP after!
-		LoadPropertyFromID3 ( fileRef, mp3TitleChunk, kXMP_NS_DC, kTitle, true );
-		LoadPropertyFromID3 ( fileRef, mp3CreateDateChunk3, kXMP_NS_XMP, kCreateDate );
-		LoadPropertyFromID3 ( fileRef, mp3ArtistChunk, kXMP_NS_DM, kArtist );
-		LoadPropertyFromID3 ( fileRef, mp3AlbumChunk, kXMP_NS_DM, kAlbum );
-		LoadPropertyFromID3 ( fileRef, mp3GenreChunk, kXMP_NS_DM, kGenre );
-		LoadPropertyFromID3 ( fileRef, mp3CommentChunk, kXMP_NS_DM, kLogComment );
-		LoadPropertyFromID3 ( fileRef, mp3TrackChunk, kXMP_NS_DM, kTrack );
+		LoadPropertyFromID3 ( mp3TitleChunk, kXMP_NS_DC, kTitle, true );
+		LoadPropertyFromID3 ( mp3CreateDateChunk3, kXMP_NS_XMP, kCreateDate );
+		LoadPropertyFromID3 ( mp3ArtistChunk, kXMP_NS_DM, kArtist );
+		LoadPropertyFromID3 ( mp3AlbumChunk, kXMP_NS_DM, kAlbum );
+		LoadPropertyFromID3 ( mp3GenreChunk, kXMP_NS_DM, kGenre );
+		LoadPropertyFromID3 ( mp3CommentChunk, kXMP_NS_DM, kLogComment );
+		LoadPropertyFromID3 ( mp3TrackChunk, kXMP_NS_DM, kTrack );
 
 	}
 
@@ -282,7 +267,7 @@ void MP3_MetaHandler::CacheFileData()
 
 // =================================================================================================
 
-bool MP3_MetaHandler::LoadPropertyFromID3 ( LFA_FileRef inFileRef, char * strFrame, char * strNameSpace, char * strXMPTag, bool fLocalText )
+bool MP3_MetaHandler::LoadPropertyFromID3 ( char * strFrame, char * strNameSpace, char * strXMPTag, bool fLocalText )
 {
 
 	// Allocate the temp buffer for the native frames we have to overwrite
@@ -300,7 +285,7 @@ bool MP3_MetaHandler::LoadPropertyFromID3 ( LFA_FileRef inFileRef, char * strFra
 	}
 
 	// Get the frame
-	bool ok = ID3_Support::GetFrameData ( inFileRef, strFrame, (char*)buffer.c_str(), bufferSize );
+	bool ok = ID3_Support::GetFrameData ( this->id3Tag, strFrame, (char*)buffer.c_str(), bufferSize );
 	if ( ok ) {
 		if ( ! buffer.empty() ) {
 
@@ -11,6 +11,7 @@
 // =================================================================================================
 
 #include "XMPFiles_Impl.hpp"
+#include "ID3_Support.hpp"
 
 // =================================================================================================
 /// \file MP3_Handler.hpp
@@ -47,7 +48,9 @@ public:
     void WriteFile  ( LFA_FileRef sourceRef, const std::string & sourcePath );
 
 private:
-	bool LoadPropertyFromID3(LFA_FileRef inFileRef, char *strFrame, char *strNameSpace, char *strXMPTag, bool fLocalText = false);
+	bool LoadPropertyFromID3(char *strFrame, char *strNameSpace, char *strXMPTag, bool fLocalText = false);
+
+	ID3_Support::ID3Tag id3Tag;	// The ID3v2 tag and its frames, read by CacheFileData and used again by UpdateFile.
 
 };	// MP3_MetaHandler
 
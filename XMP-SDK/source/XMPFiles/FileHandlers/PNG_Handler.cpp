@@ -40,15 +40,14 @@ bool PNG_CheckFormat ( XMP_FileFormat format,
                        LFA_FileRef    fileRef,
                        XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(fileRef); IgnoreParam(parent);
+	IgnoreParam(format);
 	XMP_Assert ( format == kXMP_PNGFile );
 
-	IOBuffer ioBuf;
-	
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	if ( ! CheckFileSpace ( fileRef, &ioBuf, PNG_SIGNATURE_LEN ) ) return false;	// We need at least 8, the buffer is filled anyway.
+	size_t prefixLen;
+	const XMP_Uns8 * prefix = GetFilePrefix ( parent, fileRef, &prefixLen );
+	if ( prefixLen < PNG_SIGNATURE_LEN ) return false;	// We need at least 8, the prefix is filled anyway.
 
-	if ( ! CheckBytes ( ioBuf.ptr, PNG_SIGNATURE_DATA, PNG_SIGNATURE_LEN ) ) return false;
+	if ( ! CheckBytes ( prefix, PNG_SIGNATURE_DATA, PNG_SIGNATURE_LEN ) ) return false;
 
 	return true;
 
@@ -87,7 +86,7 @@ void PNG_MetaHandler::CacheFileData()
 	if ( fileRef == 0) return;
 
 	PNG_Support::ChunkState chunkState;
-	long numChunks = PNG_Support::OpenPNG ( fileRef, chunkState );
+	long numChunks = PNG_Support::OpenPNG ( fileRef, chunkState, true );	// Only the XMP is needed.
 	if ( numChunks == 0 ) return;
 
 	if (chunkState.xmpLen != 0)
@@ -167,7 +166,7 @@ void PNG_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	if ( fileRef == 0 ) return;
 
 	PNG_Support::ChunkState chunkState;
-	long numChunks = PNG_Support::OpenPNG ( fileRef, chunkState );
+	long numChunks = PNG_Support::OpenPNG ( fileRef, chunkState, true );	// WriteFile does its own full walk.
 	if ( numChunks == 0 ) return;
 
 	// write/update chunk
@@ -212,6 +211,12 @@ void PNG_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & sou
 	PNG_Support::ChunkIterator curPos = chunkState.chunks.begin();
 	PNG_Support::ChunkIterator endPos = chunkState.chunks.end();
 
+	// Chunks that are adjacent in the source are copied as one run, a PNG can have thousands of
+	// IDAT chunks.
+
+	XMP_Uns64 runPos = 0;
+	XMP_Uns64 runLen = 0;
+
 	for (; (curPos != endPos); ++curPos)
 	{
 		PNG_Support::ChunkData chunk = *curPos;
@@ -221,11 +226,19 @@ void PNG_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & sou
 			continue;
 
 		// copy any other chunk
-		PNG_Support::CopyChunk(sourceRef, destRef, chunk);
+		if ( (runLen != 0) && (chunk.pos != (runPos + runLen)) ) {
+			PNG_Support::CopyChunkRun(sourceRef, destRef, runPos, runLen);
+			runLen = 0;
+		}
+		if ( runLen == 0 ) runPos = chunk.pos;
+		runLen += (XMP_Uns64)chunk.len + 12;
 
 		// place XMP chunk immediately after IHDR-chunk
 		if (PNG_Support::CheckIHDRChunkHeader(chunk))
 		{
+			PNG_Support::CopyChunkRun(sourceRef, destRef, runPos, runLen);
+			runLen = 0;
+
 			XMP_StringPtr packetStr = xmpPacket.c_str();
 			XMP_StringLen packetLen = xmpPacket.size();
 
@@ -233,6 +246,8 @@ void PNG_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & sou
 		}
 	}
 
+	if ( runLen != 0 ) PNG_Support::CopyChunkRun(sourceRef, destRef, runPos, runLen);
+
 }	// PNG_MetaHandler::WriteFile
 
 // =================================================================================================
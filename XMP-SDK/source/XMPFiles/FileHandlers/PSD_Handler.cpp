@@ -43,17 +43,15 @@ bool PSD_CheckFormat ( XMP_FileFormat format,
                        LFA_FileRef    fileRef,
                        XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(filePath); IgnoreParam(parent);
+	IgnoreParam(format); IgnoreParam(filePath);
 	XMP_Assert ( format == kXMP_PhotoshopFile );
 
-	IOBuffer ioBuf;
+	size_t prefixLen;
+	const XMP_Uns8 * prefix = GetFilePrefix ( parent, fileRef, &prefixLen );
+	if ( prefixLen < 34 ) return false;	// 34 = header plus 2 lengths
 	
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	if ( ! CheckFileSpace ( fileRef, &ioBuf, 34 ) ) return false;	// 34 = header plus 2 lengths
-	
-	if ( ! CheckBytes ( ioBuf.ptr, "8BPS", 4 ) ) return false;
-	ioBuf.ptr += 4;	// Move to the version.
-	XMP_Uns16 version = GetUns16BE ( ioBuf.ptr );
+	if ( ! CheckBytes ( prefix, "8BPS", 4 ) ) return false;
+	XMP_Uns16 version = GetUns16BE ( prefix+4 );
 	if ( (version != 1) && (version != 2) ) return false;
 
 	return true;
@@ -292,14 +290,14 @@ void PSD_MetaHandler::ProcessXMP()
 			this->xmpObj.ParseFromBuffer ( packetStr, packetLen );
 		} catch ( ... ) {
 			XMP_ClearOption ( options, k2XMP_FileHadXMP );
-			ImportJTPtoXMP ( kXMP_JPEGFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options );
+			ImportJTPtoXMP ( kXMP_JPEGFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options, &this->exportState );
 			throw;	// ! Rethrow the exception, don't absorb it.
 		}
 	}
 
 	// Process the legacy metadata.
 
-	ImportJTPtoXMP ( kXMP_PhotoshopFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options );
+	ImportJTPtoXMP ( kXMP_PhotoshopFile, lastLegacy, &exif, psir, &iptc, &this->xmpObj, options, &this->exportState );
 	this->containsXMP = true;	// Assume we now have something in the XMP.
 	
 }	// PSD_MetaHandler::ProcessXMP
@@ -317,7 +315,7 @@ void PSD_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	//	- The are no changes to the legacy image resources. (The IPTC and EXIF are in the PSIR.)
 	//	- The new XMP can fit in the old space.
 	
-	ExportXMPtoJTP ( kXMP_PhotoshopFile, &this->xmpObj, this->exifMgr, &this->psirMgr, this->iptcMgr );
+	ExportXMPtoJTP ( kXMP_PhotoshopFile, &this->xmpObj, this->exifMgr, &this->psirMgr, this->iptcMgr, 0, &this->exportState );
 	
 	XMP_Int64 oldPacketOffset = this->packetInfo.offset;
 	XMP_Int32 oldPacketLength = this->packetInfo.length;
@@ -332,10 +330,6 @@ void PSD_MetaHandler::UpdateFile ( bool doSafeUpdate )
 
 	if ( doInPlace ) {
 
-		#if GatherPerformanceData
-			sAPIPerf->back().extraInfo += ", PSD in-place update";
-		#endif
-
 		LFA_FileRef liveFile = this->parent->fileRef;
 	
 		XMP_Assert ( this->xmpPacket.size() == (size_t)oldPacketLength );	// ! Done by common PutXMP logic.
@@ -347,10 +341,6 @@ void PSD_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	
 	} else {
 
-		#if GatherPerformanceData
-			sAPIPerf->back().extraInfo += ", PSD copy update";
-		#endif
-
 		std::string origPath = this->parent->filePath;
 		LFA_FileRef origRef  = this->parent->fileRef;
 		
@@ -405,6 +395,7 @@ void PSD_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & sou
 	XMP_AbortProc abortProc  = this->parent->abortProc;
 	void *        abortArg   = this->parent->abortArg;
 	const bool    checkAbort = (abortProc != 0);
+	const bool    dropBehind = XMP_OptionIsSet ( this->parent->openFlags, kXMPFiles_OpenDropBehind );
 
 	XMP_Uns32 sourceLen = (XMP_Uns32) LFA_Measure ( sourceRef );
 	if ( sourceLen == 0 ) return;	// Tolerate empty files.
@@ -413,10 +404,13 @@ void PSD_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & sou
 	// get standard padding, PutXMP has probably done an in-place serialize. Set the XMP image resource.
 	
 	if ( ! skipReconcile ) {
-		ExportXMPtoJTP ( kXMP_PhotoshopFile, &this->xmpObj, this->exifMgr, &this->psirMgr, this->iptcMgr );
+		ExportXMPtoJTP ( kXMP_PhotoshopFile, &this->xmpObj, this->exifMgr, &this->psirMgr, this->iptcMgr, 0, &this->exportState );
 	}
 	
-	this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+	{
+		PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
+		this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+	}
 	this->packetInfo.offset = kXMPFiles_UnknownOffset;
 	this->packetInfo.length = this->xmpPacket.size();
 	this->packetInfo.padSize = GetPacketPadSize ( this->xmpPacket.c_str(), this->xmpPacket.size() );
@@ -448,7 +442,7 @@ void PSD_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & sou
 
 	LFA_Seek ( sourceRef, tailOffset, SEEK_SET );
 	LFA_Seek ( destRef, 0, SEEK_END );
-	LFA_Copy ( sourceRef, destRef, tailLength );	// Copy the tail of the file.
+	LFA_Copy ( sourceRef, destRef, tailLength, 0, 0, dropBehind );	// Copy the tail of the file.
 	
 	this->needsUpdate = false;
 
@@ -13,6 +13,7 @@
 #include "TIFF_Support.hpp"
 #include "PSIR_Support.hpp"
 #include "IPTC_Support.hpp"
+#include "ReconcileLegacy.hpp"
 
 // =================================================================================================
 /// \file PSD_Handler.hpp
@@ -65,6 +66,8 @@ private:
 	IPTC_Manager *  iptcMgr;	// Need to use pointers so we can properly select between read-only
 	TIFF_Manager *  exifMgr;	//	and read-write modes of usage.
 	
+	RecJTP_ExportState exportState;	// Which legacy digests are known to be current.
+	
 	XMP_Uns32 imageWidth, imageHeight;	// Pixel dimensions, used with thumbnail info.
 
 };	// PSD_MetaHandler
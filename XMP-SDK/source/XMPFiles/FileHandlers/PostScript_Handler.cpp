@@ -12,6 +12,8 @@
 #include "Scanner_Handler.hpp"
 #include "PostScript_Handler.hpp"
 
+#include <climits>
+
 using namespace std;
 
 // =================================================================================================
@@ -46,7 +48,7 @@ bool PostScript_CheckFormat ( XMP_FileFormat format,
 	                          LFA_FileRef    fileRef,
 	                          XMPFiles *     parent )
 {
-	IgnoreParam(filePath); IgnoreParam(parent);
+	IgnoreParam(filePath);
 	XMP_Assert ( (format == kXMP_EPSFile) || (format == kXMP_PostScriptFile) );
 
 	IOBuffer ioBuf;
@@ -57,7 +59,7 @@ bool PostScript_CheckFormat ( XMP_FileFormat format,
 	
 	// Check for the binary EPSF preview header.
 
-	LFA_Seek ( fileRef, 0, SEEK_SET );
+	FillProbeBuffer ( parent, fileRef, &ioBuf );
 	if ( ! CheckFileSpace ( fileRef, &ioBuf, 4 ) ) return false;
 	temp1 = GetUns32BE ( ioBuf.ptr );
 	
@@ -74,7 +76,7 @@ bool PostScript_CheckFormat ( XMP_FileFormat format,
 		
 		ioBuf.ptr = ioBuf.limit;	// Make sure RefillBuffer does a simple read.
 		RefillBuffer ( fileRef, &ioBuf );
-		if ( (ioBuf.len < kIOBufferSize) && (ioBuf.len < psLength) ) return false;	// Not enough PostScript.
+		if ( (ioBuf.len < ioBuf.size) && (ioBuf.len < psLength) ) return false;	// Not enough PostScript.
 
 	}
 	
@@ -429,6 +431,7 @@ bool PostScript_MetaHandler::FindLastPacket()
 	const bool    checkAbort = (abortProc != 0);
 	
 	LFA_Seek ( fileRef, 0, SEEK_SET );	// Seek back to the beginning of the file.
+	DropBehind dropBehind ( fileRef, XMP_OptionIsSet ( this->parent->openFlags, kXMPFiles_OpenDropBehind ) );
 	
 	for ( bufPos = 0; bufPos < fileLen; bufPos += bufLen ) {
 		if ( checkAbort && abortProc(abortArg) ) {
@@ -437,8 +440,11 @@ bool PostScript_MetaHandler::FindLastPacket()
 		bufLen = LFA_Read ( fileRef, buffer, kBufferSize );
 		if ( bufLen == 0 ) XMP_Throw ( "PostScript_MetaHandler::FindLastPacket: Read failure", kXMPErr_ExternalFailure );
 		scanner.Scan ( buffer, bufPos, bufLen );
+		dropBehind.Advance ( bufLen );
 	}
 	
+	dropBehind.Finish();
+	
 	// -------------------------------
 	// Pick the last the valid packet.
 	
@@ -246,6 +246,7 @@ void Scanner_MetaHandler::CacheFileData()
 		XMP_Uns8	buffer [kBufferSize];
 
 		LFA_Seek ( fileRef, 0, SEEK_SET );
+		DropBehind dropBehind ( fileRef, XMP_OptionIsSet ( this->parent->openFlags, kXMPFiles_OpenDropBehind ) );
 		
 		for ( bufPos = 0; bufPos < fileLen; bufPos += bufLen ) {
 			if ( checkAbort && abortProc(abortArg) ) {
@@ -254,8 +255,11 @@ void Scanner_MetaHandler::CacheFileData()
 			bufLen = LFA_Read ( fileRef, buffer, kBufferSize );
 			if ( bufLen == 0 ) XMP_Throw ( "Scanner_MetaHandler::LocateXMP: Read failure", kXMPErr_ExternalFailure );
 			scanner.Scan ( buffer, bufPos, bufLen );
+			dropBehind.Advance ( bufLen );
 		}
 		
+		dropBehind.Finish();
+		
 		// --------------------------------------------------------------
 		// Parse the valid packet snips, building a vector of candidates.
 		
@@ -40,20 +40,26 @@ bool TIFF_CheckFormat ( XMP_FileFormat format,
                         LFA_FileRef    fileRef,
                         XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(filePath); IgnoreParam(parent);
+	IgnoreParam(format); IgnoreParam(filePath);
 	XMP_Assert ( format == kXMP_TIFFFile );
 	
 	enum { kMinimalTIFFSize = 4+4+2+12+4 };	// Header plus IFD with 1 entry.
+	enum { kMinimalBigTIFFSize = 16+8+20+8 };	// BigTIFF header plus IFD with 1 entry.
 
-	IOBuffer ioBuf;
+	size_t prefixLen;
+	const XMP_Uns8 * prefix = GetFilePrefix ( parent, fileRef, &prefixLen );
+	if ( prefixLen < kMinimalTIFFSize ) return false;
 	
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	if ( ! CheckFileSpace ( fileRef, &ioBuf, kMinimalTIFFSize ) ) return false;
+	bool leTIFF = CheckBytes ( prefix, "\x49\x49\x2A\x00", 4 );
+	bool beTIFF = CheckBytes ( prefix, "\x4D\x4D\x00\x2A", 4 );
+	if ( leTIFF | beTIFF ) return true;
 	
-	bool leTIFF = CheckBytes ( ioBuf.ptr, "\x49\x49\x2A\x00", 4 );
-	bool beTIFF = CheckBytes ( ioBuf.ptr, "\x4D\x4D\x00\x2A", 4 );
+	if ( prefixLen < kMinimalBigTIFFSize ) return false;
 	
-	return (leTIFF | beTIFF);
+	bool leBigTIFF = CheckBytes ( prefix, "\x49\x49\x2B\x00", 4 );
+	bool beBigTIFF = CheckBytes ( prefix, "\x4D\x4D\x00\x2B", 4 );
+	
+	return (leBigTIFF | beBigTIFF);
 	
 }	// TIFF_CheckFormat
 
@@ -269,14 +275,14 @@ void TIFF_MetaHandler::ProcessXMP()
 			this->xmpObj.ParseFromBuffer ( packetStr, packetLen );
 		} catch ( ... ) {
 			XMP_ClearOption ( options, k2XMP_FileHadXMP );
-			ImportJTPtoXMP ( kXMP_TIFFFile, lastLegacy, &tiff, psir, &iptc, &this->xmpObj, options );
+			ImportJTPtoXMP ( kXMP_TIFFFile, lastLegacy, &tiff, psir, &iptc, &this->xmpObj, options, &this->exportState );
 			throw;	// ! Rethrow the exception, don't absorb it.
 		}
 	}
 
 	// Process the legacy metadata.
 
-	ImportJTPtoXMP ( kXMP_TIFFFile, lastLegacy, &tiff, psir, &iptc, &this->xmpObj, options );
+	ImportJTPtoXMP ( kXMP_TIFFFile, lastLegacy, &tiff, psir, &iptc, &this->xmpObj, options, &this->exportState );
 	this->containsXMP = true;	// Assume we now have something in the XMP.
 
 }	// TIFF_MetaHandler::ProcessXMP
@@ -304,7 +310,7 @@ void TIFF_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	//	- The are no changes to the legacy tags. (The IPTC and PSIR are in the TIFF tags.)
 	//	- The new XMP can fit in the old space.
 	
-	ExportXMPtoJTP ( kXMP_TIFFFile, &this->xmpObj, &this->tiffMgr, this->psirMgr, this->iptcMgr );
+	ExportXMPtoJTP ( kXMP_TIFFFile, &this->xmpObj, &this->tiffMgr, this->psirMgr, this->iptcMgr, 0, &this->exportState );
 	
 	XMP_Int64 oldPacketOffset = this->packetInfo.offset;
 	XMP_Int32 oldPacketLength = this->packetInfo.length;
@@ -317,10 +323,6 @@ void TIFF_MetaHandler::UpdateFile ( bool doSafeUpdate )
 
 	if ( doInPlace ) {
 
-		#if GatherPerformanceData
-			sAPIPerf->back().extraInfo += ", TIFF in-place update";
-		#endif
-	
 		LFA_FileRef liveFile = this->parent->fileRef;
 	
 		XMP_Assert ( this->xmpPacket.size() == (size_t)oldPacketLength );	// ! Done by common PutXMP logic.
@@ -330,12 +332,11 @@ void TIFF_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	
 	} else {
 
-		#if GatherPerformanceData
-			sAPIPerf->back().extraInfo += ", TIFF append update";
-		#endif
-	
 		// Reserialize the XMP to get standard padding, PutXMP has probably done an in-place serialize.
-		this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+		{
+			PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
+			this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+		}
 		this->packetInfo.offset = kXMPFiles_UnknownOffset;
 		this->packetInfo.length = this->xmpPacket.size();
 		this->packetInfo.padSize = GetPacketPadSize ( this->xmpPacket.c_str(), this->xmpPacket.size() );
@@ -362,15 +363,16 @@ void TIFF_MetaHandler::WriteFile ( LFA_FileRef sourceRef, const std::string & so
 	LFA_FileRef   destRef    = this->parent->fileRef;
 	XMP_AbortProc abortProc  = this->parent->abortProc;
 	void *        abortArg   = this->parent->abortArg;
+	const bool    dropBehind = XMP_OptionIsSet ( this->parent->openFlags, kXMPFiles_OpenDropBehind );
 	
 	XMP_Int64 fileLen = LFA_Measure ( sourceRef );
-	if ( fileLen > 0xFFFFFFFFLL ) {	// Check before making a copy of the file.
+	if ( (fileLen > 0xFFFFFFFFLL) && (! this->tiffMgr.IsBigTIFF()) ) {	// Check before making a copy of the file.
 		XMP_Throw ( "TIFF fles can't exceed 4GB", kXMPErr_BadTIFF );
 	}
 	
 	LFA_Seek ( sourceRef, 0, SEEK_SET );
 	LFA_Truncate ( destRef, 0 );
-	LFA_Copy ( sourceRef, destRef, fileLen, abortProc, abortArg );
+	LFA_Copy ( sourceRef, destRef, fileLen, abortProc, abortArg, dropBehind );
 
 	this->UpdateFile ( false );
 
@@ -13,6 +13,7 @@
 #include "TIFF_Support.hpp"
 #include "PSIR_Support.hpp"
 #include "IPTC_Support.hpp"
+#include "ReconcileLegacy.hpp"
 
 // =================================================================================================
 /// \file TIFF_Handler.hpp
@@ -63,6 +64,8 @@ private:
 	PSIR_Manager *  psirMgr;	// Need to use pointers so we can properly select between read-only and
 	IPTC_Manager *  iptcMgr;	//	read-write modes of usage.
 	
+	RecJTP_ExportState exportState;	// Which legacy digests are known to be current.
+	
 };	// TIFF_MetaHandler
 
 // =================================================================================================
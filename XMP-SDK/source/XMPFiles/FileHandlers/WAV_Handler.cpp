@@ -108,6 +108,52 @@ static inline int GetStringRiffSize ( const std::string & str )
 	return l;
 }
 
+// =================================================================================================
+
+static void AppendInfoChunk ( std::string * list, long tagID, const std::string & str )
+{
+	XMP_Uns32 header[2];
+	int len = GetStringRiffSize ( str );
+	header[0] = MakeUns32LE ( tagID );
+	header[1] = MakeUns32LE ( len );
+	list->append ( (const char *)&header[0], 8 );
+	list->append ( str.c_str(), len );	// ! The pad byte of an odd length string is the terminating nul.
+}
+
+// =================================================================================================
+//
+// Drops the legacy chunks that are being replaced from the contents of the old INFO list, along with
+// any padding chunks. Older versions left the replaced chunks in the list as padding.
+
+static const long kInfoLegacyChunks[] = { wavInfoCreateDateChunk, wavInfoArtistChunk, wavInfoAlbumChunk, wavInfoGenreChunk,
+										  wavInfoCommentChunk, wavInfoEngineerChunk, wavInfoCopyrightChunk, wavInfoSoftwareChunk,
+										  ckidPremierePadding, ckidJunk, 0 };
+
+static void RemoveLegacyChunks ( std::string * listData )
+{
+	std::string kept;
+	size_t pos = 0, limit = listData->size();
+
+	while ( (limit - pos) >= 8 ) {
+
+		const XMP_Uns8 * chunk = (const XMP_Uns8 *)listData->data() + pos;
+		long id = (long)GetUns32LE ( chunk );
+		size_t chunkLen = GetUns32LE ( chunk + 4 );
+		if ( chunkLen > (limit - pos - 8) ) break;	// Keep a malformed tail as it is.
+		chunkLen += 8 + (chunkLen & 1);
+		if ( chunkLen > (limit - pos) ) chunkLen = limit - pos;
+
+		size_t i = 0;
+		while ( (kInfoLegacyChunks[i] != 0) && (kInfoLegacyChunks[i] != id) ) ++i;
+		if ( kInfoLegacyChunks[i] == 0 ) kept.append ( *listData, pos, chunkLen );
+		pos += chunkLen;
+
+	}
+
+	kept.append ( *listData, pos, std::string::npos );
+	listData->swap ( kept );
+}
+
 // =================================================================================================
 /// \file WAV_Handler.cpp
 /// \brief File format handler for WAV.
@@ -131,27 +177,31 @@ XMPFileHandler * WAV_MetaHandlerCTor ( XMPFiles * parent )
 // ===============
 //
 // A WAVE file must begin with "RIFF", a 4 byte little endian length, then "WAVE". The length should
-// be fileSize-8, but we don't bother checking this here.
+// be fileSize-8, but we don't bother checking this here. A WAVE file larger than 4 GB begins with
+// "RF64" or "BW64" instead of "RIFF", the length is then 0xFFFFFFFF and the real one is in a ds64
+// chunk.
 
 bool WAV_CheckFormat ( XMP_FileFormat format,
 					   XMP_StringPtr  filePath,
 			           LFA_FileRef    fileRef,
 			           XMPFiles *     parent )
 {
-	IgnoreParam(format); IgnoreParam(parent);
+	IgnoreParam(format);
 	XMP_Assert ( format == kXMP_WAVFile );
 
 	if ( fileRef == 0 ) return false;
 	
-	enum { kBufferSize = 12 };
-	XMP_Uns8 buffer [kBufferSize];
+	enum { kHeaderSize = 12 };
 	
-	LFA_Seek ( fileRef, 0, SEEK_SET );
-	LFA_Read ( fileRef, buffer, kBufferSize );
+	size_t prefixLen;
+	const XMP_Uns8 * buffer = GetFilePrefix ( parent, fileRef, &prefixLen );
+	if ( prefixLen < kHeaderSize ) return false;
 	
-	// "RIFF" is 52 49 46 46, "WAVE" is 57 41 56 45
-	if ( (! CheckBytes ( &buffer[0], "\x52\x49\x46\x46", 4 )) ||
-		 (! CheckBytes ( &buffer[8], "\x57\x41\x56\x45", 4 )) ) return false;
+	// "RIFF" is 52 49 46 46, "RF64" is 52 46 36 34, "BW64" is 42 57 36 34, "WAVE" is 57 41 56 45
+	if ( (! CheckBytes ( &buffer[0], "\x52\x49\x46\x46", 4 )) &&
+		 (! CheckBytes ( &buffer[0], "\x52\x46\x36\x34", 4 )) &&
+		 (! CheckBytes ( &buffer[0], "\x42\x57\x36\x34", 4 )) ) return false;
+	if ( ! CheckBytes ( &buffer[8], "\x57\x41\x56\x45", 4 ) ) return false;
 
 	return true;
 	
@@ -241,6 +291,7 @@ void WAV_MetaHandler::UpdateFile ( bool doSafeUpdate )
 
 		XMP_StringLen oldLen = this->xmpPacket.size();
 		this->xmpObj.SetProperty ( kXMP_NS_WAV, "NativeDigest", digestStr.c_str() );
+		PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
 		try {
 			this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_ExactPacketLength, oldLen );
 		} catch ( ... ) {
@@ -267,76 +318,52 @@ void WAV_MetaHandler::UpdateFile ( bool doSafeUpdate )
 	if ( numTags == 0 ) return;
 
 	ok = RIFF_Support::PutChunk ( fileRef, riffState, formtypeWAVE, kXMPUserDataType, (char*)packetStr, packetLen );
-	if ( ! ok ) return;
 
 	// If needed, reconciliate the XMP data back into the native metadata.
-	if ( fReconciliate ) {
+	if ( ok && fReconciliate ) {
 
 		PutChunk ( fileRef, riffState, wavWaveTag, wavWaveTitleChunk, strTitle.c_str(), strTitle.size() );
 
-		// Pad the old tags
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoCreateDateChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoArtistChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoAlbumChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoGenreChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoCommentChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoEngineerChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoCopyrightChunk, 0 );
-		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, 0, wavInfoSoftwareChunk, 0 );
-
-		// Get the old INFO list
+		// Get the old INFO list, without the tags that are replaced
 		std::string strOldInfo;
 		unsigned long lOldSize = 0;
-		bool ok = RIFF_Support::GetRIFFChunk ( fileRef, riffState, FOURCC_LIST, wavWaveTag, wavInfoTag, 0, &lOldSize );
-		if ( ok ) {
-			// We have to get rid of the "INFO" first.
-			strOldInfo.reserve ( lOldSize );
+		bool found = RIFF_Support::GetRIFFChunk ( fileRef, riffState, FOURCC_LIST, wavWaveTag, wavInfoTag, 0, &lOldSize );
+		if ( found ) {
 			strOldInfo.assign ( lOldSize, ' ' );
-			RIFF_Support::GetRIFFChunk ( fileRef, riffState, FOURCC_LIST, wavWaveTag, wavInfoTag, (char*)strOldInfo.c_str(), &lOldSize );
-			// lOldSize -= 4;
+			found = RIFF_Support::GetRIFFChunk ( fileRef, riffState, FOURCC_LIST, wavWaveTag, wavInfoTag, (char*)strOldInfo.c_str(), &lOldSize );
+			if ( found ) {
+				RemoveLegacyChunks ( &strOldInfo );
+			} else {
+				strOldInfo.erase();
+			}
 		}
 
-		// TODO: Cleaning up the OldInfo from the padding
-
-		// Pad the old INFO list
+		// Pad the old INFO list, MakeChunk can put the new one in its place. The old tags go with it.
 		RIFF_Support::MarkChunkAsPadding ( fileRef, riffState, wavWaveTag, FOURCC_LIST, wavInfoTag );
 		
-		// Calculating the new INFO list size
-		XMP_Int32 dwListSize = 4 + 8 * 8 +
-						   GetStringRiffSize ( strCreateDate )  +
-						   GetStringRiffSize ( strArtist ) +
-						   GetStringRiffSize ( strAlbum ) +
-						   GetStringRiffSize ( strGenre ) +
-						   GetStringRiffSize ( strComment ) +
-						   GetStringRiffSize ( strEngineer ) +
-						   GetStringRiffSize ( strCopyright ) +
-						   GetStringRiffSize ( strSoftware ) +
-						   lOldSize;  // list id (4 bytes) + 8 tags hdrs (8 each)
-
-		ok = MakeChunk ( fileRef, riffState, formtypeWAVE, dwListSize + 8 );
-		if ( ! ok ) return; // If there's an error making a chunk, bail
-
-		// Building the INFO list header
-		RIFF_Support::ltag listtag;
-		listtag.id = MakeUns32LE ( FOURCC_LIST );
-		listtag.len = MakeUns32LE ( dwListSize );
-		listtag.subid = MakeUns32LE ( wavInfoTag );
-		LFA_Write ( fileRef, &listtag, 12 );
-
-		// Writing all the chunks
-		RIFF_Support::WriteChunk ( fileRef, wavInfoCreateDateChunk, strCreateDate.c_str(), GetStringRiffSize ( strCreateDate ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoArtistChunk, strArtist.c_str(), GetStringRiffSize ( strArtist ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoAlbumChunk, strAlbum.c_str(), GetStringRiffSize ( strAlbum ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoGenreChunk, strGenre.c_str(), GetStringRiffSize ( strGenre ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoCommentChunk, strComment.c_str(), GetStringRiffSize ( strComment ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoEngineerChunk, strEngineer.c_str(), GetStringRiffSize ( strEngineer ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoCopyrightChunk, strCopyright.c_str(), GetStringRiffSize ( strCopyright ) );
-		RIFF_Support::WriteChunk ( fileRef, wavInfoSoftwareChunk, strSoftware.c_str(), GetStringRiffSize ( strSoftware ) );
-
-		LFA_Write ( fileRef, strOldInfo.c_str(), lOldSize );
+		// Build the new INFO list, the list ID, the 8 tags, and the other old tags
+		std::string strInfo;
+		XMP_Uns32 infoID = MakeUns32LE ( wavInfoTag );
+		strInfo.append ( (const char *)&infoID, 4 );
+		AppendInfoChunk ( &strInfo, wavInfoCreateDateChunk, strCreateDate );
+		AppendInfoChunk ( &strInfo, wavInfoArtistChunk, strArtist );
+		AppendInfoChunk ( &strInfo, wavInfoAlbumChunk, strAlbum );
+		AppendInfoChunk ( &strInfo, wavInfoGenreChunk, strGenre );
+		AppendInfoChunk ( &strInfo, wavInfoCommentChunk, strComment );
+		AppendInfoChunk ( &strInfo, wavInfoEngineerChunk, strEngineer );
+		AppendInfoChunk ( &strInfo, wavInfoCopyrightChunk, strCopyright );
+		AppendInfoChunk ( &strInfo, wavInfoSoftwareChunk, strSoftware );
+		strInfo.append ( strOldInfo );
+
+		ok = MakeChunk ( fileRef, riffState, formtypeWAVE, (XMP_Uns32)strInfo.size() + 8 );
+		if ( ok ) ok = RIFF_Support::WriteChunk ( fileRef, FOURCC_LIST, strInfo.data(), (XMP_Uns32)strInfo.size() );
 
 	}
 
+	// Write the RIFF length once, for all of the chunks that were appended.
+	bool closed = RIFF_Support::CloseRIFF ( fileRef, riffState );
+	if ( (! ok) || (! closed) ) return;	// If there's an error making a chunk, bail
+
 	this->needsUpdate = false;
 
 }	// WAV_MetaHandler::UpdateFile
@@ -436,8 +463,20 @@ void WAV_MetaHandler::CacheFileData()
 
 	LFA_FileRef fileRef ( this->parent->fileRef );
 
+	// Only walk the file until the XMP and, if reconciling, all of the legacy chunks have been seen.
+	static const RIFF_Support::RiffChunkID kWantedChunks[] = {
+		{ kXMPUserDataType, 0 },
+		{ wavWaveTitleChunk, wavWaveTag },
+		{ wavInfoCreateDateChunk, wavInfoTag }, { wavInfoArtistChunk, wavInfoTag },
+		{ wavInfoAlbumChunk, wavInfoTag }, { wavInfoGenreChunk, wavInfoTag },
+		{ wavInfoCommentChunk, wavInfoTag }, { wavInfoEngineerChunk, wavInfoTag },
+		{ wavInfoCopyrightChunk, wavInfoTag }, { wavInfoSoftwareChunk, wavInfoTag },
+		{ 0, 0 }
+	};
+	static const RIFF_Support::RiffChunkID kWantedXMPOnly[] = { { kXMPUserDataType, 0 }, { 0, 0 } };
+
 	RIFF_Support::RiffState riffState;
-	long numTags = RIFF_Support::OpenRIFF ( fileRef, riffState );
+	long numTags = RIFF_Support::OpenRIFF ( fileRef, riffState, (fReconciliate ? kWantedChunks : kWantedXMPOnly) );
 	if ( numTags == 0 ) return;
 
 	// Determine the size of the metadata
@@ -503,7 +542,10 @@ void WAV_MetaHandler::CacheFileData()
 	}
 
 	// Update the xmpPacket, as the xmpObj might have been updated with legacy info
-	this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+	{
+		PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
+		this->xmpObj.SerializeToBuffer ( &this->xmpPacket, kXMP_UseCompactFormat );
+	}
 	this->packetInfo.offset = kXMPFiles_UnknownOffset;
 	this->packetInfo.length = this->xmpPacket.size();
 
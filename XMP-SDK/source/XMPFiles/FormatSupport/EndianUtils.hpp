@@ -38,7 +38,17 @@
 		#endif
 	#endif
 #elif XMP_UNIXBuild
-	#error "Endian macros not set up for generic UNIX yet"
+	#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		#define kBigEndianHost 1
+	#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+		#define kBigEndianHost 0
+	#elif defined(__sparc) || defined(__sparc__)
+		#define kBigEndianHost 1
+	#elif defined(__i386__) || defined(__x86_64__)
+		#define kBigEndianHost 0
+	#else
+		#error "Can't tell the byte order of this UNIX build"
+	#endif
 #else
 	#error "Unknown build environment"
 #endif
@@ -154,19 +154,12 @@ namespace ID3_Support {
 		"Unknown"			// 126
 	};
 
-	// Some types
-	#ifndef XMP_Int64
-		typedef unsigned long long XMP_Int64;
-	#endif
-
-	static bool FindXMPFrame(LFA_FileRef inFileRef, XMP_Int64 &posXMP, XMP_Int64 &posPAD, unsigned long &dwExtendedTag, unsigned long &dwLen);
-	static unsigned long SkipExtendedHeader(LFA_FileRef inFileRef, XMP_Uns8 bVersion, XMP_Uns8 flag);
-	static bool GetFrameInfo(LFA_FileRef inFileRef, XMP_Uns8 bVersion, char *strFrameID, XMP_Uns8 &cflag1, XMP_Uns8 &cflag2, unsigned long &dwSize);
-	static bool ReadSize(LFA_FileRef inFileRef, XMP_Uns8 bVersion, unsigned long &dwSize);
 	static unsigned long CalculateSize(XMP_Uns8 bVersion, unsigned long dwSizeIn);
-	static bool LoadTagHeaderAndUnknownFrames(LFA_FileRef inFileRef, char *strBuffer, bool fRecon, unsigned long &posPad);
-	
-	#define GetFilePosition(file)	LFA_Seek ( file, 0, SEEK_CUR )
+	static unsigned long GetSynchsafe(const XMP_Uns8 *ptr);
+	static unsigned long GetFrameSize(XMP_Uns8 bVersion, const XMP_Uns8 *ptr);
+	static size_t RemoveUnsync(XMP_Uns8 *data, size_t length);
+	static bool IsXMPFrame(const ID3Tag &tag, const ID3Frame &frame);
+	static void LoadTagHeaderAndUnknownFrames(const ID3Tag &tag, bool fRecon, std::string *strBuffer);
 
 	const unsigned long k_dwTagHeaderSize = 10;
 	const unsigned long k_dwFrameHeaderSize = 10;
@@ -183,6 +176,28 @@ namespace ID3_Support {
 	const unsigned char flagExp = 0x20;
 	const unsigned char flagFooter = 0x10;
 
+//     Frame format flags, v2.3   %ijk00000
+//	   Where:
+//			i - Compression, a 4 byte decompressed size follows the frame header
+//			j - Encryption, an encryption method byte follows
+//			k - Grouping identity, a group byte follows
+	const unsigned char flagV3Compressed = 0x80;
+	const unsigned char flagV3Encrypted = 0x40;
+	const unsigned char flagV3Grouped = 0x20;
+
+//     Frame format flags, v2.4   %0h00kmnp
+//	   Where:
+//			h - Grouping identity, a group byte follows the frame header
+//			k - Compression
+//			m - Encryption, an encryption method byte follows
+//			n - Unsynchronisation
+//			p - Data length indicator, a 4 byte synchsafe size follows
+	const unsigned char flagV4Grouped = 0x40;
+	const unsigned char flagV4Compressed = 0x08;
+	const unsigned char flagV4Encrypted = 0x04;
+	const unsigned char flagV4Unsync = 0x02;
+	const unsigned char flagV4DataLength = 0x01;
+
 
 #ifndef Trace_ID3_Support
 	#define Trace_ID3_Support 0
@@ -221,33 +236,124 @@ namespace ID3_Support {
 // =================================================================================================
 
 // *** Load Scenario:
-// - Check for id3v2 tag
+// - Check for id3v2 tag, read it into memory, and make the table of frames.
 //
-// - Parse through the frame for "PRIV" + UTF8 Encoding + "XMP"
+// - Look in the table for the "PRIV" frame with "XMP\0", and for the legacy frames.
 //
 // - If found, load it.
-bool GetMetaData ( LFA_FileRef inFileRef, char* buffer, unsigned long* pBufferSize, ::XMP_Int64* fileOffset )
+bool ReadTag ( LFA_FileRef inFileRef, const XMP_Uns8 * prefix, size_t prefixLen, ID3Tag * tag )
 {
+	// id3v2 tag:
+	//     ID3v2/file identifier      "ID3"
+	//     ID3v2 version              $04 00
+	//     ID3v2 flags                %abcd0000
+	//     ID3v2 size             4 * %0xxxxxxx
 
-	if ( pBufferSize == 0 ) return false;
+	// The caller usually has the start of the file already, from the OpenFile prefix. If not, the
+	// header is read on its own. The rest of the tag is then taken from the prefix, or read with
+	// one LFA_Read for whatever the prefix does not have.
 
-	unsigned long dwSizeIn = *pBufferSize;
-	*pBufferSize = 0;
-	XMP_Int64 posXMP = 0ULL, posPAD = 0ULL;
-	unsigned long dwLen = 0, dwExtendedTag = 0;
-	if ( ! FindXMPFrame ( inFileRef, posXMP, posPAD, dwExtendedTag, dwLen ) ) return false;
+	*tag = ID3Tag();
+
+	if ( prefix == 0 ) {
+		prefixLen = 0;
+		LFA_Seek ( inFileRef, 0ULL, SEEK_SET );
+		if ( LFA_Read ( inFileRef, tag->header, k_dwTagHeaderSize ) != (XMP_Int32)k_dwTagHeaderSize ) return false;
+	} else {
+		if ( prefixLen < k_dwTagHeaderSize ) return false;
+		memcpy ( tag->header, prefix, k_dwTagHeaderSize );
+	}
+
+	// Check for "ID3"
+	if ( ! CheckBytes ( tag->header, "ID3", 3 ) ) return false;
+
+	tag->found = true;
+	tag->majorVersion = tag->header[3];
+	tag->flags = tag->header[5];
+	tag->contentSize = GetSynchsafe ( &tag->header[6] );	// Tag size is always using the 4x7 format.
+
+	if ( (tag->majorVersion < 3) || (tag->majorVersion > 4) ) return true;	// Only v2.3 and v2.4 frames are understood.
+	if ( tag->contentSize == 0 ) return true;
+
+	std::string & body = tag->body;
+	size_t fromPrefix = 0;
+
+	if ( prefixLen > k_dwTagHeaderSize ) {
+		fromPrefix = prefixLen - k_dwTagHeaderSize;
+		if ( fromPrefix > tag->contentSize ) fromPrefix = tag->contentSize;
+		body.reserve ( tag->contentSize );
+		body.assign ( (const char*)prefix + k_dwTagHeaderSize, fromPrefix );
+	}
+
+	if ( fromPrefix < tag->contentSize ) {
+		XMP_Int64 readLen = tag->contentSize - fromPrefix;
+		const XMP_Int64 fileLen = LFA_Measure ( inFileRef );	// Don't trust the header with the allocation size.
+		if ( (XMP_Int64)(k_dwTagHeaderSize + fromPrefix + readLen) > fileLen ) {
+			readLen = fileLen - (XMP_Int64)(k_dwTagHeaderSize + fromPrefix);
+			if ( readLen < 0 ) readLen = 0;
+		}
+		body.append ( (size_t)readLen, '\0' );
+		if ( readLen > 0 ) {
+			LFA_Seek ( inFileRef, (k_dwTagHeaderSize + fromPrefix), SEEK_SET );
+			XMP_Int32 ioCount = LFA_Read ( inFileRef, &body[fromPrefix], (XMP_Int32)readLen );
+			body.erase ( fromPrefix + ioCount );
+		}
+	}
+
+	if ( body.empty() ) return true;
+
+	// In v2.3 unsynchronisation covers the whole tag after the header, including the frame headers.
+	// Frame sizes are for the resynchronised data. In v2.4 it is done per frame, see GetFrameContent.
+
+	if ( (tag->majorVersion == 3) && (tag->flags & flagUnsync) ) {
+		body.erase ( RemoveUnsync ( (XMP_Uns8*)&body[0], body.size() ) );
+	}
+
+	size_t bodyPos = 0;
+
+	// If there's an extended header, ignore it. The v2.3 size does not include itself, v2.4 does.
+	if ( tag->flags & flagExt ) {
+		if ( body.size() < 4 ) return true;
+		unsigned long dwExtSize;
+		if ( tag->majorVersion < 4 ) {
+			dwExtSize = GetUns32BE ( &body[0] );
+			if ( dwExtSize > (body.size() - 4) ) return true;
+			dwExtSize += 4;
+		} else {
+			dwExtSize = GetSynchsafe ( (XMP_Uns8*)&body[0] );
+			if ( dwExtSize > body.size() ) return true;
+		}
+		bodyPos = dwExtSize;
+	}
+
+	// Enumerate through the frames
+	while ( (body.size() - bodyPos) >= k_dwFrameHeaderSize ) {
+
+		//		Frame ID      $xx xx xx xx  (four characters)
+		//		Size      4 * %0xxxxxxx     <<--- IMPORTANT NOTE: This is true only in v4.0 (v3.0 uses a UInt32)
+		//		Flags         $xx xx
+
+		const XMP_Uns8 * frameHeader = (const XMP_Uns8*) &body[bodyPos];
+		unsigned long dwFrameSize = GetFrameSize ( tag->majorVersion, &frameHeader[4] );
+
+		// Are we in a padding frame?
+		if ( dwFrameSize == 0 ) break;
+
+		// A frame that runs past the end of the tag is garbage, so is anything after it.
+		if ( dwFrameSize > (body.size() - bodyPos - k_dwFrameHeaderSize) ) break;
+
+		ID3Frame frame;
+		memcpy ( frame.id, frameHeader, 4 );	// AUDIT: Safe, frame.id is 5 bytes.
+		frame.id[4] = 0;
+		frame.statusFlags = frameHeader[8];
+		frame.formatFlags = frameHeader[9];
+		frame.frameOffset = bodyPos;
+		frame.contentSize = dwFrameSize;
+		frame.filePos = k_dwTagHeaderSize + bodyPos + k_dwFrameHeaderSize;
+		tag->frames.push_back ( frame );
+
+		bodyPos += k_dwFrameHeaderSize + dwFrameSize;
 
-	// Found the XMP frame! Get the rest of frame into the buffer
-	unsigned long dwXMPBufferLen = dwLen - k_dwXMPLabelSize;
-	*pBufferSize = dwXMPBufferLen; 
-	
-	if ( fileOffset != 0 ) *fileOffset = posXMP + k_dwXMPLabelSize;
-	
-	if ( buffer != 0 ) {
-		// Seek 4 bytes ahead to get the XMP data.
-		LFA_Seek ( inFileRef, posXMP+k_dwXMPLabelSize, SEEK_SET );
-		if ( dwXMPBufferLen > dwSizeIn ) dwXMPBufferLen = dwSizeIn;
-		LFA_Read ( inFileRef, buffer, dwXMPBufferLen );	// Get the XMP frame
 	}
 
 	return true;
@@ -256,79 +362,83 @@ bool GetMetaData ( LFA_FileRef inFileRef, char* buffer, unsigned long* pBufferSi
 
 // =================================================================================================
 
-bool FindFrame ( LFA_FileRef inFileRef, char* strFrame, XMP_Int64 & posFrame, unsigned long & dwLen )
+const ID3Frame * FindFrame ( const ID3Tag & tag, const char * strFrame )
 {
-	// Taking into account that the first Tag is the ID3 tag
-	bool fReturn = false;
-	LFA_Seek ( inFileRef, 0ULL, SEEK_SET );
 
 	#if Trace_ID3_Support
 		fprintf ( stderr, "ID3_Support::FindFrame : Looking for %s\n", strFrame );
 	#endif
 
-	// Read the tag name
-	char szID[4] = {"xxx"};
-	long bytesRead = LFA_Read ( inFileRef, szID, 3 );
-	if ( bytesRead == 0 ) return fReturn;
+	for ( size_t i = 0, limit = tag.frames.size(); i < limit; ++i ) {
+		const ID3Frame & frame = tag.frames[i];
+		if ( strcmp ( frame.id, strFrame ) == 0 ) {
+			#if Trace_ID3_Support
+				fprintf ( stderr, "  Found %s, offset %d, length %d\n", strFrame, (long)frame.filePos, frame.contentSize );
+			#endif
+			return &frame;
+		}
+	}
 
-	// Check for "ID3"
-	if ( strcmp ( szID, "ID3" ) != 0 ) return fReturn;
+	return 0;
 
-	// Read the version, flag and size
-	XMP_Uns8 v1 = 0, v2 = 0, flags = 0;
-	unsigned long dwTagSize = 0;
+}
+
+// =================================================================================================
 
-	if ( ! GetTagInfo ( inFileRef, v1, v2, flags, dwTagSize ) ) return fReturn;
-	if ( dwTagSize == 0 ) return fReturn;
-	if ( v1 > 4 ) return fReturn; 	// We don't support anything newer than id3v2 4.0
+// Returns the frame content with the frame unsynchronisation undone, and without the bytes added by
+// the grouping, encryption, and data length format flags. Compressed and encrypted frames return
+// false, the content is of no use.
+bool GetFrameContent ( const ID3Tag & tag, const ID3Frame & frame, std::string * content )
+{
+	size_t extraLen = 0;
+	bool unsync = false;
 
-	// If there's an extended header, ignore it
-	XMP_Int32 dwExtendedTag = SkipExtendedHeader(inFileRef, v1, flags);
-	dwTagSize -= dwExtendedTag;
+	if ( tag.majorVersion < 4 ) {
+		if ( frame.formatFlags & (flagV3Compressed | flagV3Encrypted) ) return false;
+		if ( frame.formatFlags & flagV3Grouped ) extraLen += 1;
+	} else {
+		if ( frame.formatFlags & (flagV4Compressed | flagV4Encrypted) ) return false;
+		if ( frame.formatFlags & flagV4Grouped ) extraLen += 1;
+		if ( frame.formatFlags & flagV4DataLength ) extraLen += 4;
+		unsync = ((tag.flags & flagUnsync) != 0) || ((frame.formatFlags & flagV4Unsync) != 0);
+	}
 
-	// Enumerate through the frames
-	XMP_Int64 posCur = 0ULL;
-	posCur = GetFilePosition ( inFileRef );
-	XMP_Int64 posEnd = posCur + dwTagSize;
+	content->assign ( tag.body, (frame.frameOffset + k_dwFrameHeaderSize), frame.contentSize );
+	if ( unsync && (! content->empty()) ) content->erase ( RemoveUnsync ( (XMP_Uns8*)&(*content)[0], content->size() ) );
 
-	while ( posCur < posEnd ) {
+	if ( extraLen > content->size() ) return false;
+	content->erase ( 0, extraLen );
 
-		char szFrameID[5] = {"xxxx"};
-		unsigned long dwFrameSize = 0;
-		XMP_Uns8 cflag1 = 0, cflag2 = 0;
+	return true;
 
-		// Get the next frame
-		if ( ! GetFrameInfo ( inFileRef, v1, szFrameID, cflag1, cflag2, dwFrameSize ) ) break;
+}
 
-		// Are we in a padding frame?
-		if ( dwFrameSize == 0 ) break;
+// =================================================================================================
 
-		// Is it the Frame we're looking for?
-		if ( strcmp ( szFrameID, strFrame ) == 0 ) {
-			posFrame = GetFilePosition ( inFileRef );
-			dwLen = dwFrameSize;
-			fReturn = true;
-			break;
-		} else {
-			// Jump to the next frame
-			LFA_Seek ( inFileRef, dwFrameSize, SEEK_CUR );
-		}
+bool GetMetaData ( const ID3Tag & tag, std::string * packet, XMP_Int64 * fileOffset )
+{
 
-		posCur = GetFilePosition ( inFileRef );
+	// Use the last XMP frame if there is more than one.
+	const ID3Frame * xmpFrame = 0;
+	for ( size_t i = 0, limit = tag.frames.size(); i < limit; ++i ) {
+		if ( IsXMPFrame ( tag, tag.frames[i] ) ) xmpFrame = &tag.frames[i];
 	}
+	if ( xmpFrame == 0 ) return false;
 
-	#if Trace_ID3_Support
-		if ( fReturn ) {
-			fprintf ( stderr, "  Found %s, offset %d, length %d\n", strFrame, (long)posFrame, dwLen );
-		}
-	#endif
+	// Found the XMP frame! The packet is the rest of the frame after "XMP\0".
+	if ( ! GetFrameContent ( tag, *xmpFrame, packet ) ) return false;
+	packet->erase ( 0, k_dwXMPLabelSize );
+
+	if ( fileOffset != 0 ) *fileOffset = xmpFrame->filePos + (xmpFrame->contentSize - packet->size());
+
+	return true;
 
-	return fReturn;
 }
 
+
 // =================================================================================================
 
-bool GetFrameData ( LFA_FileRef inFileRef, char* strFrame, char* buffer, unsigned long &dwBufferSize )
+bool GetFrameData ( const ID3Tag & tag, const char* strFrame, char* buffer, unsigned long &dwBufferSize )
 {
 	char strData[TAG_MAX_SIZE+4];	// Plus 4 for two worst case UTF-16 nul terminators.
 	size_t sdPos = 0;	// Offset within strData to the value.
@@ -337,12 +447,15 @@ bool GetFrameData ( LFA_FileRef inFileRef, char* strFrame, char* buffer, unsigne
 	if ( (buffer == 0) || (dwBufferSize > TAG_MAX_SIZE) ) return false;
 
 	const unsigned long dwSizeIn = dwBufferSize;
-	XMP_Int64 posFrame = 0ULL;
-	unsigned long dwLen = 0;
 	XMP_Uns8 bEncoding = 0;
 
 	// Find the frame
-	if ( ! FindFrame ( inFileRef, strFrame, posFrame, dwLen ) ) return false;
+	const ID3Frame * frame = FindFrame ( tag, strFrame );
+	if ( frame == 0 ) return false;
+
+	std::string content;
+	if ( ! GetFrameContent ( tag, *frame, &content ) ) return false;
+	const unsigned long dwLen = (unsigned long) content.size();
 	#if Trace_ID3_Support
 		fprintf ( stderr, "  Getting frame data\n" );
 	#endif
@@ -359,18 +472,15 @@ bool GetFrameData ( LFA_FileRef inFileRef, char* strFrame, char* buffer, unsigne
 
 		dwBufferSize = dwLen - 1;	// Don't count the encoding byte.
 		
-		// Seek to the frame
-		LFA_Seek  (  inFileRef, posFrame, SEEK_SET  );
-
-		// Read the Encoding
-		LFA_Read ( inFileRef, &bEncoding, 1 );
+		// Get the Encoding
+		bEncoding = content[0];
 		if ( bEncoding > 3 ) return false;
 
 		// Get the frame
 		if ( dwBufferSize > dwSizeIn ) dwBufferSize = dwSizeIn;
 
 		if ( dwBufferSize >= TAG_MAX_SIZE ) return false;	// No room for data.
-		LFA_Read ( inFileRef, &strData[0], dwBufferSize );
+		memcpy ( &strData[0], content.data()+1, dwBufferSize );	// AUDIT: Protected by the above check.
 
 		if ( strcmp ( strFrame, "COMM" ) == 0 ) {
 		
@@ -664,7 +774,7 @@ static void OffsetAudioData ( LFA_FileRef inFileRef, XMP_Int64 audioOffset, XMP_
 
 // =================================================================================================
 
-bool SetMetaData ( LFA_FileRef inFileRef, char* strXMPPacket, unsigned long dwXMPPacketSize,
+bool SetMetaData ( LFA_FileRef inFileRef, const ID3Tag & tag, char* strXMPPacket, unsigned long dwXMPPacketSize,
                    char* strLegacyFrames, unsigned long dwFullLegacySize, bool fRecon )
 {
 	// The ID3 section layout:
@@ -674,20 +784,19 @@ bool SetMetaData ( LFA_FileRef inFileRef, char* strXMPPacket, unsigned long dwXM
 	//	XMP frame, content is "XMP\0" plus the packet
 	//	padding
 
-	// ID3 Buffer vars
-	const unsigned long kiMaxBuffer = 100*1000;
-	char szID3Buffer [kiMaxBuffer];	// Must be enough for the ID3 header, unknown ID3 frames, and legacy ID3 metadata.
-	unsigned long id3BufferLen = 0;	// The amount of stuff currently in the buffer.
+	// The whole new ID3 section is built in memory and written at once. The unknown frames come from
+	// the tag that was read by ReadTag.
+	std::string id3Buffer;
 
 	unsigned long dwOldID3ContentSize = 0;	// The size of the existing ID3 content (not counting the header).
 	unsigned long dwNewID3ContentSize = 0;	// The size of the updated ID3 content (not counting the header).
 	
 	unsigned long newPadSize = 0;
 
-	XMP_Uns8 bMajorVersion = 3;
-
-	bool fFoundID3 = FindID3Tag ( inFileRef, dwOldID3ContentSize, bMajorVersion );
+	bool fFoundID3 = tag.found;
+	XMP_Uns8 bMajorVersion = tag.majorVersion;
 	if ( (bMajorVersion > 4) || (bMajorVersion < 3) ) return false;	// Not supported
+	if ( fFoundID3 ) dwOldID3ContentSize = tag.contentSize;
 
 	// Now that we know the version of the ID3 tag, let's format the size of the XMP frame.
 
@@ -719,9 +828,7 @@ bool SetMetaData ( LFA_FileRef inFileRef, char* strXMPPacket, unsigned long dwXM
 		char szID3Header [k_dwTagHeaderSize] = { 'I', 'D', '3', 3, 0, 0, 0, 0, 0, 0 };
 
 		// Copy the ID3 header
-		if ( sizeof(szID3Buffer) < k_dwTagHeaderSize ) return false;
-		memcpy ( szID3Buffer, szID3Header, k_dwTagHeaderSize );	// AUDIT: Protected by the above check.
-		id3BufferLen = k_dwTagHeaderSize;
+		id3Buffer.assign ( szID3Header, k_dwTagHeaderSize );
 
 		newPadSize = 100;
 		dwNewID3ContentSize = dwFullLegacySize + dwFullXMPFrameSize + newPadSize;
@@ -732,14 +839,11 @@ bool SetMetaData ( LFA_FileRef inFileRef, char* strXMPPacket, unsigned long dwXM
 		// 1. Copy all the unknown tags
 		// 2. Make the rest padding (to be used right there).
 
-		if ( (k_dwFrameHeaderSize + dwOldID3ContentSize) > kiMaxBuffer ) {
-			// The ID3Buffer is not big enough to fit the id3v2 tag... let's bail...
-			return false;
-		}
-
-		LoadTagHeaderAndUnknownFrames ( inFileRef, szID3Buffer, fRecon, id3BufferLen );
+		LoadTagHeaderAndUnknownFrames ( tag, fRecon, &id3Buffer );
+		unsigned long id3BufferLen = (unsigned long) id3Buffer.size();
+		if ( id3BufferLen > (k_dwTagHeaderSize + dwOldID3ContentSize) ) return false;	// Can't happen, the frames came from the tag.
 		
-		unsigned long spareLen = (k_dwFrameHeaderSize + dwOldID3ContentSize) - id3BufferLen;
+		unsigned long spareLen = (k_dwTagHeaderSize + dwOldID3ContentSize) - id3BufferLen;
 		
 		if ( spareLen >= (dwFullLegacySize + dwFullXMPFrameSize) ) {
 		
@@ -776,33 +880,22 @@ bool SetMetaData ( LFA_FileRef inFileRef, char* strXMPPacket, unsigned long dwXM
 	// Set the new size for the ID3 content. This always uses the 4x7 format.
 	
 	dwFormattedTemp = CalculateSize ( 4, dwNewID3ContentSize );
-	szID3Buffer[6] = (char)(dwFormattedTemp >> 24);
-	szID3Buffer[7] = (char)((dwFormattedTemp >> 16) & 0xFF);
-	szID3Buffer[8] = (char)((dwFormattedTemp >> 8) & 0xFF);
-	szID3Buffer[9] = (char)(dwFormattedTemp & 0xFF);
-
-	// Write the partial ID3 buffer (ID3 header plus unknown tags)
-	LFA_Seek ( inFileRef, 0, SEEK_SET );
-	LFA_Write ( inFileRef, szID3Buffer, id3BufferLen );
-
-	// Append the new legacy metadata frames
-	if ( dwFullLegacySize > 0 ) {
-		LFA_Write ( inFileRef, strLegacyFrames, dwFullLegacySize );
-	}
+	id3Buffer[6] = (char)(dwFormattedTemp >> 24);
+	id3Buffer[7] = (char)((dwFormattedTemp >> 16) & 0xFF);
+	id3Buffer[8] = (char)((dwFormattedTemp >> 8) & 0xFF);
+	id3Buffer[9] = (char)(dwFormattedTemp & 0xFF);
 
-	// Append the XMP frame prefix
-	LFA_Write ( inFileRef, szXMPPrefix, k_XMPPrefixSize );
+	// Append the new legacy metadata frames, the XMP frame prefix, the XMP packet, and the padding to
+	// the ID3 header and unknown frames. Then write it all.
 
-	// Append the XMP packet
-	LFA_Write ( inFileRef, strXMPPacket, dwXMPPacketSize );
+	id3Buffer.reserve ( k_dwTagHeaderSize + dwNewID3ContentSize );
+	if ( dwFullLegacySize > 0 ) id3Buffer.append ( strLegacyFrames, dwFullLegacySize );
+	id3Buffer.append ( szXMPPrefix, k_XMPPrefixSize );
+	id3Buffer.append ( strXMPPacket, dwXMPPacketSize );
+	if ( newPadSize > 0 ) id3Buffer.append ( newPadSize, '\0' );
 
-	// Append the padding.
-	if ( newPadSize > 0 ) {
-		std::string szPad;
-		szPad.reserve ( newPadSize );
-		szPad.assign ( newPadSize, '\0' );
-		LFA_Write ( inFileRef, const_cast<char *>(szPad.data()), newPadSize );
-	}
+	LFA_Seek ( inFileRef, 0, SEEK_SET );
+	LFA_Write ( inFileRef, id3Buffer.data(), (XMP_Int32)id3Buffer.size() );
 
 	LFA_Flush ( inFileRef );
 
@@ -812,45 +905,23 @@ bool SetMetaData ( LFA_FileRef inFileRef, char* strXMPPacket, unsigned long dwXM
 
 // =================================================================================================
 
-bool LoadTagHeaderAndUnknownFrames ( LFA_FileRef inFileRef, char * strBuffer, bool fRecon, unsigned long & posPad )
+static void LoadTagHeaderAndUnknownFrames ( const ID3Tag & tag, bool fRecon, std::string * strBuffer )
 {
 
-	LFA_Seek ( inFileRef, 3ULL, SEEK_SET );	// Point after the "ID3"
-
-	// Get the tag info
-	unsigned long dwOffset = 0;
-	XMP_Uns8 v1 = 0, v2 = 0, flags = 0;
-	unsigned long dwTagSize = 0;
-	GetTagInfo ( inFileRef, v1, v2, flags, dwTagSize );
+	strBuffer->assign ( (const char*)tag.header, k_dwTagHeaderSize );
 
-	unsigned long dwExtendedTag = SkipExtendedHeader ( inFileRef, v1, flags );
+	// Completely ignore the Extended Header, if the flag has been set, let's reset it. The frames are
+	// copied resynchronised for v2.3, so the tag is no longer unsynchronised. For v2.4 the copied
+	// frames are marked individually below.
+	(*strBuffer)[5] = (char)(tag.flags & ~(flagExt | flagUnsync));
 
-	LFA_Seek ( inFileRef, 0ULL, SEEK_SET );
-	LFA_Read ( inFileRef, strBuffer, k_dwTagHeaderSize );
-	dwOffset += k_dwTagHeaderSize;
-
-	// Completely ignore the Extended Header
-	if ( ((flags & flagExt) == flagExt) && (dwExtendedTag > 0) ) {
-		strBuffer[5] = strBuffer[5] & 0xBF;	// If the flag has been set, let's reset it
-		LFA_Seek ( inFileRef, dwExtendedTag, SEEK_CUR );	// And let's seek up to after the extended header
-	}
+	const bool v4Unsync = (tag.majorVersion == 4) && ((tag.flags & flagUnsync) != 0);
 
 	// Enumerate through the frames
-	XMP_Int64 posCur = 0ULL;
-	posCur = GetFilePosition ( inFileRef );
-	XMP_Int64 posEnd = posCur + dwTagSize;
+	for ( size_t i = 0, limit = tag.frames.size(); i < limit; ++i ) {
 
-	while ( posCur < posEnd ) {
-
-		char szFrameID[5] = {"xxxx"};
-		unsigned long dwFrameSize = 0;
-		XMP_Uns8 cflag1 = 0, cflag2 = 0;
-
-		// Get the next frame
-		if ( ! GetFrameInfo ( inFileRef, v1, szFrameID, cflag1, cflag2, dwFrameSize ) ) break;
-
-		// Are we in a padding frame?
-		if ( dwFrameSize == 0 ) break;	// We just hit a padding frame
+		const ID3Frame & frame = tag.frames[i];
+		const char * szFrameID = frame.id;
 
 		bool fIgnore = false;
 		bool knownID = (strcmp ( szFrameID, "TIT2" ) == 0) ||
@@ -865,253 +936,88 @@ bool LoadTagHeaderAndUnknownFrames ( LFA_FileRef inFileRef, char * strBuffer, bo
 		// If a known frame, just ignore
 		// Note: If recon is turned off, let's consider all known frames as unknown
 		if ( knownID && fRecon ) {
-
 			fIgnore = true;
-
-		} else if ( strcmp ( szFrameID, "PRIV" ) == 0 ) {
-
-			// Read the "PRIV" frame
-		    //		<Header for "PRIV">
-		    //		Short content descrip. <text string according to encoding> $00 (00)
-		    //		The actual data        <full text string according to encoding>
-
-			// Get the PRIV descriptor
-			char szXMPTag[4] = {"xxx"};
-			if ( LFA_Read ( inFileRef, &szXMPTag, k_dwXMPLabelSize ) != 0 ) {
-				// Is it a XMP "PRIV"
-				if ( (szXMPTag[3] == 0) && (strcmp ( szXMPTag, "XMP" ) == 0) ) fIgnore = true;
-				LFA_Seek ( inFileRef, -(long)k_dwXMPLabelSize, SEEK_CUR );
-			}
-
+		} else if ( IsXMPFrame ( tag, frame ) ) {
+			fIgnore = true;
 		}
 
-		if ( fIgnore ) {
-			LFA_Seek ( inFileRef, dwFrameSize, SEEK_CUR );
-		} else {
+		if ( ! fIgnore ) {
 			// Unknown frame, let's copy it
-			LFA_Seek ( inFileRef, -(long)k_dwFrameHeaderSize, SEEK_CUR );
-			LFA_Read ( inFileRef, strBuffer+dwOffset, dwFrameSize+k_dwFrameHeaderSize );
-			dwOffset += dwFrameSize+k_dwFrameHeaderSize;
+			size_t copyPos = strBuffer->size();
+			strBuffer->append ( tag.body, frame.frameOffset, (k_dwFrameHeaderSize + frame.contentSize) );
+			if ( v4Unsync ) (*strBuffer)[copyPos+9] = (char)(frame.formatFlags | flagV4Unsync);
 		}
 
-		posCur = GetFilePosition ( inFileRef );
-
 	}
 
-	posPad = dwOffset;
-
-	return true;
-
 }
 
 // =================================================================================================
 
-bool FindID3Tag ( LFA_FileRef inFileRef, unsigned long & dwLen, XMP_Uns8 & bMajorVer )
+// Is this a "PRIV" frame holding XMP?
+//		<Header for "PRIV">
+//		Short content descrip. <text string according to encoding> $00 (00)
+//		The actual data        <full text string according to encoding>
+static bool IsXMPFrame ( const ID3Tag & tag, const ID3Frame & frame )
 {
-	// id3v2 tag:
-	//     ID3v2/file identifier      "ID3"
-	//     ID3v2 version              $04 00
-	//     ID3v2 flags                %abcd0000
-	//     ID3v2 size             4 * %0xxxxxxx
-
-	// Taking into account that the first Tag is the ID3 tag
-	LFA_Seek ( inFileRef, 0ULL, SEEK_SET );
 
-	// Read the tag name
-	char szID[4] = {"xxx"};
-	long bytesRead = LFA_Read ( inFileRef, szID, 3 );
-	if ( bytesRead == 0 ) return false;
+	if ( strcmp ( frame.id, "PRIV" ) != 0 ) return false;
 
-	// Check for "ID3"
-	if ( strcmp ( szID, "ID3" ) != 0 ) return false;
-
-	// Read the version, flag and size
-	XMP_Uns8 v2 = 0, flags = 0;
-	if ( ! GetTagInfo ( inFileRef, bMajorVer, v2, flags, dwLen ) ) return false;
+	// Check the stored content directly unless a format flag or unsynchronisation changes it.
+	if ( (frame.formatFlags == 0) && (! ((tag.majorVersion == 4) && (tag.flags & flagUnsync))) ) {
+		if ( frame.contentSize < k_dwXMPLabelSize ) return false;
+		return CheckBytes ( &tag.body[frame.frameOffset + k_dwFrameHeaderSize], "XMP", k_dwXMPLabelSize );
+	}
 
-	return true;
+	std::string content;
+	if ( ! GetFrameContent ( tag, frame, &content ) ) return false;
+	return (content.size() >= k_dwXMPLabelSize) && CheckBytes ( content.data(), "XMP", k_dwXMPLabelSize );
 
 }
 
 // =================================================================================================
 
-bool GetTagInfo ( LFA_FileRef inFileRef, XMP_Uns8 & v1, XMP_Uns8 & v2, XMP_Uns8 & flags, unsigned long & dwTagSize )
+static unsigned long GetSynchsafe ( const XMP_Uns8 * ptr )
 {
-
-	if ((LFA_Read(inFileRef, &v1, 1)) == 0) return false;
-	if ((LFA_Read(inFileRef, &v2, 1)) == 0) return false;
-	if ((LFA_Read(inFileRef, &flags, 1)) == 0) return false;
-	if (!ReadSize(inFileRef, 4, dwTagSize)) return false; // Tag size is always using the size reading method.
-	
-	return true;
+	return ((ptr[0] & 0x7f) << 21) | ((ptr[1] & 0x7f) << 14) | ((ptr[2] & 0x7f) << 7) | (ptr[3] & 0x7f);
 
 }
 
 // =================================================================================================
 
-static bool FindXMPFrame ( LFA_FileRef inFileRef, XMP_Int64 & posXMP, XMP_Int64 & posPAD, unsigned long & dwExtendedTag, unsigned long & dwLen )
+static unsigned long GetFrameSize ( XMP_Uns8 bVersion, const XMP_Uns8 * ptr )
 {
-	// Taking into account that the first Tag is the ID3 tag
-	bool fReturn = false;
-	dwExtendedTag = 0;
-	posPAD = 0;
-
-	LFA_Seek ( inFileRef, 0ULL, SEEK_SET );
-
-	// Read the tag name
-	char szID[4] = {"xxx"};
-	long bytesRead = LFA_Read ( inFileRef, szID, 3 );
-	if ( bytesRead == 0 ) return fReturn;
-
-	// Check for "ID3"
-	if ( strcmp ( szID, "ID3") != 0 ) return fReturn;
-
-	// Read the version, flag and size
-	XMP_Uns8 v1 = 0, v2 = 0, flags = 0;
-	unsigned long dwTagSize = 0;
-	if ( ! GetTagInfo ( inFileRef, v1, v2, flags, dwTagSize ) ) return fReturn;
-	if ( dwTagSize == 0 ) return fReturn;
-	if ( v1 > 4 ) return fReturn; 	// We don't support anything newer than id3v2 4.0
-
-	// If there's an extended header, ignore it
-	dwExtendedTag = SkipExtendedHeader(inFileRef, v1, flags);
-	dwTagSize -= dwExtendedTag;
-
-	// Enumerate through the frames
-	XMP_Int64 posCur = 0ULL;
-	posCur = GetFilePosition ( inFileRef );
-	XMP_Int64 posEnd = posCur + dwTagSize;
-
-	while ( posCur < posEnd ) {
-
-		char szFrameID[5] = {"xxxx"};
-		unsigned long dwFrameSize = 0;
-		XMP_Uns8 cflag1 = 0, cflag2 = 0;
-
-		// Get the next frame
-		if ( ! GetFrameInfo ( inFileRef, v1, szFrameID, cflag1, cflag2, dwFrameSize ) ) {
-			// Set the file pointer to the XMP or the start
-			LFA_Seek ( inFileRef, fReturn ? posXMP : 0ULL, SEEK_SET );
-			break;
-		}
-
-		// Are we in a padding frame?
-		if ( dwFrameSize == 0 ) {
-
-			// We just hit a padding frame
-			LFA_Seek ( inFileRef, -(long)k_dwFrameHeaderSize, SEEK_CUR );
-			posPAD = GetFilePosition ( inFileRef );
-
-			// Set the file pointer to the XMP or the start
-			LFA_Seek ( inFileRef, fReturn ? posXMP : 0ULL, SEEK_SET );
-			break;
-
-		}
-
-		// Is it a "PRIV"?
-		if ( strcmp(szFrameID, "PRIV") != 0 ) {
-
-			// Jump to the next frame
-			LFA_Seek ( inFileRef, dwFrameSize, SEEK_CUR );
-
-		} else {
-
-			// Read the "PRIV" frame
-		    //		<Header for "PRIV">
-		    //		Short content descrip. <text string according to encoding> $00 (00)
-		    //		The actual data        <full text string according to encoding>
-
-			unsigned long dwBytesRead = 0;
-
-			// Get the PRIV descriptor
-			char szXMPTag[4] = {"xxx"};
-			if (LFA_Read(inFileRef, &szXMPTag, k_dwXMPLabelSize) == 0) return fReturn;
-			dwBytesRead += k_dwXMPLabelSize;
-
-			// Is it a XMP "PRIV"
-			if ( (szXMPTag[3] == 0) && (strcmp ( szXMPTag, "XMP" ) == 0) ) {
-				dwLen = dwFrameSize;
-				LFA_Seek ( inFileRef, -(long)k_dwXMPLabelSize, SEEK_CUR );
-				posXMP = GetFilePosition ( inFileRef );
-				fReturn = true;
-				dwBytesRead -= k_dwXMPLabelSize;
-			}
-
-			// Didn't find it, let skip the rest of the frame and continue
-			LFA_Seek ( inFileRef, dwFrameSize - dwBytesRead, SEEK_CUR );
-
-		}
-
-		posCur = GetFilePosition ( inFileRef );
-
-	}
-
-	return fReturn;
+	if ( bVersion > 3 ) return GetSynchsafe ( ptr );
+	return GetUns32BE ( ptr );
 
 }
 
 // =================================================================================================
 
-// Returns the size of the extended header
-static unsigned long SkipExtendedHeader ( LFA_FileRef inFileRef, XMP_Uns8 bVersion, XMP_Uns8 flags )
+// Undo unsynchronisation in place, each $FF $00 becomes $FF. Returns the new length.
+static size_t RemoveUnsync ( XMP_Uns8 * data, size_t length )
 {
-	if ( flags & flagExt ) {
-
-		unsigned long dwExtSize = 0; // <-- This will include the size (full extended header size)
-
-		if ( ReadSize ( inFileRef, bVersion, dwExtSize ) ) {
-			if ( bVersion < 4 ) dwExtSize += 4;	// v3 doesn't include the size, while v4 does.
-			LFA_Seek ( inFileRef, (size_t)(dwExtSize - 4), SEEK_CUR );
-		}
-
-		return dwExtSize;
-
+	const XMP_Uns8 * inPtr = (const XMP_Uns8*) memchr ( data, 0xFF, length );
+	if ( inPtr == 0 ) return length;
+
+	const XMP_Uns8 * inLimit = data + length;
+	XMP_Uns8 * outPtr = data + (inPtr - data);
+
+	while ( inPtr < inLimit ) {
+		XMP_Uns8 ch = *inPtr;
+		*outPtr = ch;
+		++inPtr;
+		++outPtr;
+		if ( (ch == 0xFF) && (inPtr < inLimit) && (*inPtr == 0) ) ++inPtr;
 	}
 
-	return 0;
+	return (size_t)(outPtr - data);
 
 }
 
-// =================================================================================================
-
-static bool GetFrameInfo ( LFA_FileRef inFileRef, XMP_Uns8 bVersion, char * strFrameID, XMP_Uns8 & cflag1, XMP_Uns8 & cflag2, unsigned long & dwSize)
-{
-    //		Frame ID      $xx xx xx xx  (four characters)
-    //		Size      4 * %0xxxxxxx                          <<--- IMPORTANT NOTE: This is true only in v4.0 (v3.0 uses a XMP_Int32)
-    //		Flags         $xx xx
-
-	if ( strFrameID == 0 ) return false;
-
-	if ( LFA_Read ( inFileRef, strFrameID, 4 ) == 0 ) return false;
-	if ( ! ReadSize ( inFileRef, bVersion, dwSize ) ) return false;
-	if ( LFA_Read ( inFileRef, &cflag1, 1 ) == 0 ) return false;
-	if ( LFA_Read ( inFileRef, &cflag2, 1 ) == 0 ) return false;
-
-	return true;
-
-}
 
 // =================================================================================================
 
-static bool ReadSize ( LFA_FileRef inFileRef, XMP_Uns8 bVersion, unsigned long & dwSize )
-{
-	char s4 = 0, s3 = 0, s2 = 0, s1 = 0;
-
-	if ( LFA_Read ( inFileRef, &s4, 1 ) == 0 ) return false;
-	if ( LFA_Read ( inFileRef, &s3, 1 ) == 0 ) return false;
-	if ( LFA_Read ( inFileRef, &s2, 1 ) == 0 ) return false;
-	if ( LFA_Read ( inFileRef, &s1, 1 ) == 0 ) return false;
-
-	if ( bVersion > 3 ) {
-		dwSize = ((s4 & 0x7f) << 21) | ((s3 & 0x7f) << 14) | ((s2 & 0x7f) << 7) | (s1 & 0x7f);
-	} else {
-		dwSize = ((s4 << 24) | (s3 << 16) | (s2 << 8) | s1);
-	}
-
-	return true;
-
-}
-
 // =================================================================================================
 
 static unsigned long CalculateSize ( XMP_Uns8 bVersion, unsigned long dwSizeIn )
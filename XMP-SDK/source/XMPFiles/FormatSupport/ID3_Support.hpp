@@ -12,6 +12,7 @@
 
 #include "XMP_Environment.h"	// ! This must be the first include.
 
+#include <string>
 #include <vector>
 
 #include "XMP_Const.h"
@@ -22,17 +23,44 @@
 namespace ID3_Support 
 {
 
-	bool GetMetaData ( LFA_FileRef inFileRef, char* buffer, unsigned long* pBufferSize, XMP_Int64* fileOffset );
-	bool SetMetaData ( LFA_FileRef inFileRef, char * buffer, unsigned long bufferSize,
-					   char * strReconciliatedFrames, unsigned long dwReconciliatedFramesSize, bool fRecon );
+	// An ID3v2 tag is read into memory in one piece, then the frames are found and decoded from
+	// there. ReadTag builds the table of frames, it is used both to find the XMP and to reconcile the
+	// legacy frames, and again by SetMetaData to copy the unknown frames. Whole tag unsynchronisation
+	// (v2.3) is undone in the body as it is loaded, frame unsynchronisation (v2.4) by GetFrameContent.
+
+	struct ID3Frame {
+		char      id[5];			// The frame ID, nul terminated.
+		XMP_Uns8  statusFlags;		// The first frame header flag byte.
+		XMP_Uns8  formatFlags;		// The second frame header flag byte.
+		size_t    frameOffset;		// Offset in ID3Tag::body of the frame header.
+		size_t    contentSize;		// Size of the stored content, not counting the frame header.
+		XMP_Int64 filePos;			// File offset of the content, exact unless the tag is unsynchronised.
+	};
+
+	struct ID3Tag {
+		bool          found;		// True if the file begins with an ID3v2 tag, frames are only parsed for v2.3 and v2.4.
+		XMP_Uns8      majorVersion;
+		XMP_Uns8      flags;
+		unsigned long contentSize;	// The tag size from the header, not counting the header.
+		XMP_Uns8      header [10];
+		std::string   body;			// The tag following the header.
+		std::vector<ID3Frame> frames;
+		ID3Tag() : found(false), majorVersion(3), flags(0), contentSize(0) {};
+	};
 
-	bool GetTagInfo ( LFA_FileRef inFileRef, XMP_Uns8 & v1, XMP_Uns8 & v2, XMP_Uns8 & flags, unsigned long & dwTagSize );
-	bool FindID3Tag ( LFA_FileRef inFileRef, unsigned long & dwLen, XMP_Uns8 & bMajorVer );
+	bool ReadTag ( LFA_FileRef inFileRef, const XMP_Uns8 * prefix, size_t prefixLen, ID3Tag * tag );
+
+	const ID3Frame * FindFrame ( const ID3Tag & tag, const char * strFrame );
+	bool GetFrameContent ( const ID3Tag & tag, const ID3Frame & frame, std::string * content );
+
+	bool GetMetaData ( const ID3Tag & tag, std::string * packet, XMP_Int64 * fileOffset );
+	bool SetMetaData ( LFA_FileRef inFileRef, const ID3Tag & tag, char * buffer, unsigned long bufferSize,
+					   char * strReconciliatedFrames, unsigned long dwReconciliatedFramesSize, bool fRecon );
 
 	bool AddXMPTagToID3Buffer ( char * strCur, unsigned long * pdwCurOffset, unsigned long dwMaxSize,
 								XMP_Uns8 bVersion, char * strFrameName, const char * strXMPTag, unsigned long dwXMPLength );
 
-	bool GetFrameData ( LFA_FileRef inFileRef, char * strFrame, char * buffer, unsigned long & dwBufferSize );
+	bool GetFrameData ( const ID3Tag & tag, const char * strFrame, char * buffer, unsigned long & dwBufferSize );
 
 } // namespace ID3_Support
 
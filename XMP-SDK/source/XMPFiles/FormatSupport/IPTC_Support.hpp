@@ -37,7 +37,8 @@
 /// for example.
 ///
 /// The IPTC DataSet organization differs from TIFF tags and Photoshop image resources in allowing
-/// muultiple occurrences for some IDs. The C++ STL multimap is a natural data structure for IPTC.
+/// muultiple occurrences for some IDs. The DataSets are kept in a FlatMap, a sorted vector used like
+/// a multimap, repeated DataSets are kept in the order they are added.
 ///
 /// Support is only provided for DataSet 1:90 to decide if local or UTF-8 text encoding is used, and
 /// the following text valued DataSets: 2:05, 2:10, 2:15, 2:20, 2:25, 2:40, 2:55, 2:80, 2:85, 2:90,
@@ -216,7 +217,7 @@ protected:
 	
 	enum { kMinDataSetSize = 5 };	// 1+1+1+2
 	
-	typedef std::multimap<XMP_Uns16,DataSetInfo>  DataSetMap;
+	typedef FlatMap<XMP_Uns16,DataSetInfo>  DataSetMap;	// Repeats are kept in file order.
 	
 	DataSetMap dataSets;
 
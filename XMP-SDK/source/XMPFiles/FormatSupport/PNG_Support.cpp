@@ -102,72 +102,57 @@ namespace PNG_Support
 
 	// =============================================================================================
 
-	long OpenPNG ( LFA_FileRef fileRef, ChunkState & inOutChunkState )
-	{
-		XMP_Uns64 pos = 0;
-		long name;
-		XMP_Uns32 len;
-	
-		pos = LFA_Seek ( fileRef, 8, SEEK_SET );
-		if (pos != 8) return 0;
-	
-		// read first and following chunks
-		while ( ReadChunk ( fileRef, inOutChunkState, &name, &len, pos) ) {}
-	
-		return inOutChunkState.chunks.size();
-
-	}
-
-	// =============================================================================================
+	// The chunk headers are read through an IOBuffer, so a run of small chunks costs a single read
+	// and a large chunk costs one seek and read to reach the following header. The iTXt header is
+	// checked from the same buffer. A chunk is recorded if its length, type, and 4 more bytes are
+	// present, even if its data runs past the end of the file.
 
-	bool  ReadChunk ( LFA_FileRef fileRef, ChunkState & inOutChunkState, long * chunkType, XMP_Uns32 * chunkLength, XMP_Uns64 & inOutPosition )
+	long OpenPNG ( LFA_FileRef fileRef, ChunkState & inOutChunkState, bool xmpOnly /* = false */ )
 	{
 		try
 		{
-			XMP_Uns64 startPosition = inOutPosition;
-			long bytesRead;
-			char buffer[4];
+			XMP_Int64 fileLen = LFA_Measure ( fileRef );
+			XMP_Int64 pos = PNG_SIGNATURE_LEN;
+			bool haveIDAT = false;
 
-			bytesRead = LFA_Read ( fileRef, buffer, 4 );
-			if ( bytesRead != 4 ) return false;
-			inOutPosition += 4;
-			*chunkLength = GetUns32BE(buffer);
+			IOBuffer ioBuf;
 
-			bytesRead = LFA_Read ( fileRef, buffer, 4 );
-			if ( bytesRead != 4 ) return false;
-			inOutPosition += 4;
-			*chunkType = GetUns32BE(buffer);
+			while ( (pos + 12) <= fileLen ) {
 
-			inOutPosition += *chunkLength;
+				MoveToOffset ( fileRef, pos, &ioBuf );
+				if ( ! CheckFileSpace ( fileRef, &ioBuf, 12 ) ) break;
 
-			bytesRead = LFA_Read ( fileRef, buffer, 4 );
-			if ( bytesRead != 4 ) return false;
-			inOutPosition += 4;
-			long crc = GetUns32BE(buffer);
+				ChunkData newChunk;
 
-			ChunkData	newChunk;
-	
-			newChunk.pos = startPosition;
-			newChunk.len = *chunkLength;
-			newChunk.type = *chunkType;
+				newChunk.pos = pos;
+				newChunk.len = GetUns32BE ( ioBuf.ptr );
+				newChunk.type = GetUns32BE ( ioBuf.ptr + 4 );
 
-			// check for XMP in iTXt-chunk
-			if (newChunk.type == iTXt)
-			{
-				CheckiTXtChunkHeader(fileRef, inOutChunkState, newChunk);
-			}
+				// check for XMP in iTXt-chunk
+				if ( (newChunk.type == iTXt) && (newChunk.len > ITXT_HEADER_LEN) &&
+					 CheckFileSpace ( fileRef, &ioBuf, (8 + ITXT_HEADER_LEN) ) &&
+					 (memcmp ( (ioBuf.ptr + 8), ITXT_HEADER_DATA, ITXT_HEADER_LEN ) == 0) ) {
+					inOutChunkState.xmpPos = newChunk.pos + 8 + ITXT_HEADER_LEN;
+					inOutChunkState.xmpLen = newChunk.len - ITXT_HEADER_LEN;
+					newChunk.xmp = true;
+					inOutChunkState.xmpChunk = newChunk;
+				}
 
-			inOutChunkState.chunks.push_back ( newChunk );
+				inOutChunkState.chunks.push_back ( newChunk );
+				pos += (XMP_Int64)newChunk.len + 12;
 
-			LFA_Seek ( fileRef, inOutPosition, SEEK_SET );
+				if ( newChunk.type == IDAT ) haveIDAT = true;
+				if ( xmpOnly && haveIDAT && (inOutChunkState.xmpLen != 0) ) break;
+
+			}
 
 		} catch ( ... ) {
 
-			return false;
+			// Keep the chunks found so far, a read error ends the walk like the end of the file.
 
 		}
 	
-		return true;
+		return inOutChunkState.chunks.size();
 
 	}
 
@@ -208,12 +193,12 @@ namespace PNG_Support
 
 	// =============================================================================================
 
-	bool CopyChunk ( LFA_FileRef sourceRef, LFA_FileRef destRef, ChunkData& chunk )
+	bool CopyChunkRun ( LFA_FileRef sourceRef, LFA_FileRef destRef, XMP_Uns64 pos, XMP_Uns64 len )
 	{
 		try
 		{
-			LFA_Seek (sourceRef, chunk.pos, SEEK_SET );
-			LFA_Copy (sourceRef, destRef, (chunk.len + 12));
+			LFA_Seek (sourceRef, pos, SEEK_SET );
+			LFA_Copy (sourceRef, destRef, len);
 
 		} catch ( ... ) {
 
@@ -261,39 +246,6 @@ namespace PNG_Support
 		return (inOutChunkData.type == IHDR);
 	}
 
-	// =============================================================================================
-
-	unsigned long CheckiTXtChunkHeader ( LFA_FileRef fileRef, ChunkState& inOutChunkState, ChunkData& inOutChunkData )
-	{
-		try
-		{
-			LFA_Seek(fileRef, (inOutChunkData.pos + 8), SEEK_SET);
-
-			char buffer[ITXT_HEADER_LEN];
-			long bytesRead = LFA_Read ( fileRef, buffer, ITXT_HEADER_LEN );
-
-			if (bytesRead == ITXT_HEADER_LEN)
-			{
-				if (memcmp(buffer, ITXT_HEADER_DATA, ITXT_HEADER_LEN) == 0)
-				{
-					// return length of XMP
-					if (inOutChunkData.len > ITXT_HEADER_LEN)
-					{
-						inOutChunkState.xmpPos = inOutChunkData.pos + 8 + ITXT_HEADER_LEN;
-						inOutChunkState.xmpLen = inOutChunkData.len - ITXT_HEADER_LEN;
-						inOutChunkState.xmpChunk = inOutChunkData;
-						inOutChunkData.xmp = true;
-
-						return inOutChunkState.xmpLen;
-					}
-				}
-			}
-		}
-		catch ( ... ) {}
-	
-		return 0;
-	}
-
 	bool ReadBuffer ( LFA_FileRef fileRef, XMP_Uns64 & pos, XMP_Uns32 len, char * outBuffer )
 	{
 		try
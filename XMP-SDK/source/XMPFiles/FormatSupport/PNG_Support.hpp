@@ -54,15 +54,17 @@ namespace PNG_Support
 			ChunkVector chunks;	/* vector of chunks */
 	};
 
-	long OpenPNG ( LFA_FileRef fileRef, ChunkState& inOutChunkState );
+	// OpenPNG walks the chunk headers and returns the number of chunks recorded. With xmpOnly the
+	// walk stops once the XMP iTXt chunk is found and the IDAT chunks have begun, the recorded chunks
+	// are then only a prefix of the file. Use a full walk when the chunks are to be copied.
+
+	long OpenPNG ( LFA_FileRef fileRef, ChunkState& inOutChunkState, bool xmpOnly = false );
 
-	bool ReadChunk ( LFA_FileRef fileRef, ChunkState& inOutChunkState, long* chunkType, XMP_Uns32* chunkLength, XMP_Uns64& inOutPosition );
 	bool WriteXMPChunk ( LFA_FileRef fileRef, XMP_Uns32 len, const char* inBuffer );
-	bool CopyChunk ( LFA_FileRef sourceRef, LFA_FileRef destRef, ChunkData& chunk );
+	bool CopyChunkRun ( LFA_FileRef sourceRef, LFA_FileRef destRef, XMP_Uns64 pos, XMP_Uns64 len );	// Adjacent chunks.
 	unsigned long UpdateChunkCRC( LFA_FileRef fileRef, ChunkData& inOutChunkData );
 
 	bool CheckIHDRChunkHeader ( ChunkData& inOutChunkData );
-	unsigned long CheckiTXtChunkHeader ( LFA_FileRef fileRef, ChunkState& inOutChunkState, ChunkData& inOutChunkData );
 
 	bool ReadBuffer ( LFA_FileRef fileRef, XMP_Uns64& pos, XMP_Uns32 len, char* outBuffer );
 	bool WriteBuffer ( LFA_FileRef fileRef, XMP_Uns64& pos, XMP_Uns32 len, const char* inBuffer );
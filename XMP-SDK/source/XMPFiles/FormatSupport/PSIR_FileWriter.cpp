@@ -53,13 +53,10 @@ void PSIR_FileWriter::DeleteExistingInfo()
 
 	if ( this->memParsed ) {
 		if ( this->ownedContent ) free ( this->memContent );
-	} else {
-		InternalRsrcMap::iterator irPos = this->imgRsrcs.begin();
-		InternalRsrcMap::iterator irEnd = this->imgRsrcs.end();
-		for ( ; irPos != irEnd; ++irPos ) irPos->second.changed = true;	// Fool the InternalRsrcInfo destructor.
 	}
 
 	this->imgRsrcs.clear();
+	this->rsrcPool.clear();
 
 	this->memContent = 0;
 	this->memLength  = 0;
@@ -75,9 +72,8 @@ void PSIR_FileWriter::DeleteExistingInfo()
 // PSIR_FileWriter::~PSIR_FileWriter
 // =================================
 //
-// The InternalRsrcInfo destructor will deallocate the data for changed image resources. It does not
-// know whether they are memory-parsed or file-parsed though, so it won't deallocate captured but
-// unchanged file-parsed resources. Mark those as changed to make the destructor deallocate them.
+// The InternalRsrcInfo destructor will deallocate the data for changed image resources. Unchanged
+// resources point into the memory content or, for file parses, into the resource pool.
 
 PSIR_FileWriter::~PSIR_FileWriter()
 {
@@ -87,15 +83,6 @@ PSIR_FileWriter::~PSIR_FileWriter()
 		XMP_Assert ( this->memContent != 0 );
 		free ( this->memContent );
 	}
-	
-	if ( this->fileParsed ) {
-		InternalRsrcMap::iterator irPos = this->imgRsrcs.begin();
-		InternalRsrcMap::iterator irEnd = this->imgRsrcs.end();
-		for ( ; irPos != irEnd; ++irPos ) {
-			if ( irPos->second.dataPtr != 0 ) irPos->second.changed = true;
-		}
-	}
-	
 
 }	// PSIR_FileWriter::~PSIR_FileWriter
 
@@ -276,7 +263,12 @@ void PSIR_FileWriter::ParseFileResources ( LFA_FileRef fileRef, XMP_Uns32 length
 	this->fileParsed = true;
 	if ( length == 0 ) return;
 	
-	// Parse the image resource block.
+	// Parse the image resource block. The values of the metadata resources are appended to a pool
+	// instead of being allocated one at a time. The pool can move as it grows, so the value pointers
+	// are set at the end from the recorded pool offsets.
+
+	typedef std::pair<XMP_Uns16,size_t> PooledValue;
+	std::vector<PooledValue> pooledValues;
 
 	IOBuffer ioBuf;
 	ioBuf.filePos = LFA_Seek ( fileRef, 0, SEEK_CUR );
@@ -324,35 +316,35 @@ void PSIR_FileWriter::ParseFileResources ( LFA_FileRef fileRef, XMP_Uns32 length
 			continue;
 		}
 
-		newRsrc.dataPtr = malloc ( dataLen );
-		if ( newRsrc.dataPtr == 0 ) XMP_Throw ( "Out of memory", kXMPErr_NoMemory );
-		
-		try {
-			
-			if ( dataTotal <= kIOBufferSize ) {
-				// The image resource data fits within the I/O buffer.
-				ok = CheckFileSpace ( fileRef, &ioBuf, dataTotal );
-				if ( ! ok ) break;	// Bad image resource. Throw instead?
-				memcpy ( (void*)newRsrc.dataPtr, ioBuf.ptr, dataLen );	// AUDIT: Safe, malloc'ed dataLen bytes above.
-				ioBuf.ptr += dataTotal;	// ! Add the rounded length.
-			} else {
-				// The image resource data is bigger than the I/O buffer.
-				LFA_Seek ( fileRef, (ioBuf.filePos + (ioBuf.ptr - ioBuf.data)), SEEK_SET );
-				LFA_Read ( fileRef, (void*)newRsrc.dataPtr, dataLen );
-				FillBuffer ( fileRef, nextRsrcPos, &ioBuf );
-			}
-			
-			this->imgRsrcs[id].dataPtr = newRsrc.dataPtr;
-
-		} catch ( ... ) {
-
-			free ( (void*)newRsrc.dataPtr );
-			throw;
+		size_t poolOffset = this->rsrcPool.size();
+		this->rsrcPool.resize ( poolOffset + dataLen );
 
+		if ( dataTotal <= ioBuf.size ) {
+			// The image resource data fits within the I/O buffer.
+			ok = CheckFileSpace ( fileRef, &ioBuf, dataTotal );
+			if ( ! ok ) break;	// Bad image resource. Throw instead?
+			if ( dataLen > 0 ) memcpy ( &this->rsrcPool[poolOffset], ioBuf.ptr, dataLen );	// AUDIT: Safe, resized the pool above.
+			ioBuf.ptr += dataTotal;	// ! Add the rounded length.
+		} else {
+			// The image resource data is bigger than the I/O buffer.
+			LFA_Seek ( fileRef, (ioBuf.filePos + (ioBuf.ptr - ioBuf.data)), SEEK_SET );
+			LFA_Read ( fileRef, &this->rsrcPool[poolOffset], dataLen );
+			FillBuffer ( fileRef, nextRsrcPos, &ioBuf );
 		}
+
+		pooledValues.push_back ( PooledValue ( id, poolOffset ) );
 		
 	}
 	
+	if ( ! pooledValues.empty() ) {
+		if ( this->rsrcPool.empty() ) this->rsrcPool.push_back ( 0 );	// Keep zero length values non-null.
+		for ( size_t i = 0; i < pooledValues.size(); ++i ) {	// ! Later duplicates win, as in the parse.
+			InternalRsrcMap::iterator rsrcPos = this->imgRsrcs.find ( pooledValues[i].first );
+			XMP_Assert ( rsrcPos != this->imgRsrcs.end() );
+			rsrcPos->second.dataPtr = &this->rsrcPool[0] + pooledValues[i].second;
+		}
+	}
+	
 	#if 0
 	{
 		printf ( "\nPSIR_FileWriter::ParseFileResources, count = %d\n", this->imgRsrcs.size() );
@@ -192,7 +192,7 @@ private:
 	XMP_Uns32 psirLength;
 	XMP_Uns8* psirContent;
 	
-	typedef std::map<XMP_Uns16,ImgRsrcInfo>  ImgRsrcMap;
+	typedef FlatMap<XMP_Uns16,ImgRsrcInfo>  ImgRsrcMap;
 	
 	ImgRsrcMap imgRsrcs;
 
@@ -244,12 +244,20 @@ public:
 		InternalRsrcInfo() : changed(false), id(0), dataLen(0), dataPtr(0), origOffset(0), rsrcName(0) {};
 		InternalRsrcInfo ( XMP_Uns16 _id, XMP_Uns32 _dataLen, void* _dataPtr, XMP_Uns32 _origOffset )
 			: changed(false), id(_id), dataLen(_dataLen), dataPtr(_dataPtr), origOffset(_origOffset), rsrcName(0) {};
+		InternalRsrcInfo ( const InternalRsrcInfo & in )
+			: changed(in.changed), id(in.id), dataLen(in.dataLen), dataPtr(in.dataPtr),
+			  origOffset(in.origOffset), rsrcName(in.rsrcName)
+		{	// ! Hack to transfer ownership of the data block, the FlatMap copies entries as it grows.
+			*((void**)&in.dataPtr) = 0;
+		};
 		~InternalRsrcInfo()
 		{
 			if ( this->changed && (this->dataPtr != 0) ) free ( this->dataPtr );
 		};
 		void operator= ( const InternalRsrcInfo & in )
 		{	// ! Hack to transfer ownership of the data block.
+			if ( this == &in ) return;
+			if ( this->changed && (this->dataPtr != 0) ) free ( this->dataPtr );
 			this->changed = in.changed;
 			this->id = in.id;
 			this->dataLen = in.dataLen; this->dataPtr = in.dataPtr;
@@ -270,8 +278,10 @@ private:
 	XMP_Uns32 memLength;
 	XMP_Uns8* memContent;
 
-	typedef std::map<XMP_Uns16,InternalRsrcInfo>  InternalRsrcMap;
+	typedef FlatMap<XMP_Uns16,InternalRsrcInfo>  InternalRsrcMap;
 	InternalRsrcMap imgRsrcs;
+
+	std::vector<XMP_Uns8> rsrcPool;	// The captured values of unchanged file-parsed resources.
 	
 	struct OtherRsrcInfo {		// For the resources of types other than "8BIM".
 		XMP_Uns32 rsrcOffset;	// The offset of the resource origin, the type field.
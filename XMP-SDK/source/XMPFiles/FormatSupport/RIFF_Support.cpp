@@ -11,8 +11,25 @@
 
 namespace RIFF_Support {
 
-	#define	ckidPremierePadding	MakeFourCC ('J','U','N','Q')
 	#define	formtypeAVIX		MakeFourCC ('A', 'V', 'I', 'X')
+	#define	kForgottenParentID	ckidPremierePadding	/* see ForgetTag */
+
+	// RF64 (EBU Tech 3306) and BW64 (ITU-R BS.2088) replace the "RIFF" ID, set the 32 bit RIFF
+	// length to 0xFFFFFFFF, and put the 64 bit file length in a ds64 chunk that must come first.
+	// The ds64 also has the 64 bit length of the data chunk, and a table of 64 bit lengths for any
+	// other chunks with a 0xFFFFFFFF length.
+
+	#define	FOURCC_RF64			MakeFourCC ('R', 'F', '6', '4')
+	#define	FOURCC_BW64			MakeFourCC ('B', 'W', '6', '4')
+	#define	ckidDS64			MakeFourCC ('d', 's', '6', '4')
+	#define	ckidData			MakeFourCC ('d', 'a', 't', 'a')
+
+	#define	kRF64SizeMarker		((UInt32) 0xFFFFFFFF)
+
+	enum {
+		kDS64FixedSize = 28,		// riffSize, dataSize, sampleCount, tableLength.
+		kDS64TableEntrySize = 12	// chunkId, chunkSize.
+	};
 
 
 	#ifndef	AVIMAXCHUNKSIZE
@@ -22,25 +39,64 @@ namespace RIFF_Support {
 
 	typedef struct
 	{
-		long	id;
-		UInt32	len;
+		XMP_Uns32	id;
+		UInt32		len;
 	} atag;
 
+	// The chunk headers are read through a small window. A window is read at a header that is not
+	// already in the current one, so the header of a following short chunk usually comes for free
+	// while a skipped 'movi' list costs no more than a seek. The window is kept small so that little
+	// besides headers is read. A top level RIFF after the first, an AVIX in an OpenDML file, gets
+	// just enough for its own header and that of the 'movi' list that follows.
+
+	enum {
+		kRiffHeaderSize = 12,		// ID, length, and list type.
+		kRiffWindowSize = 4*1024,
+		kRiffAVIXWindowSize = 2*kRiffHeaderSize
+	};
+
+	struct RiffReader {
+
+		LFA_FileRef fileRef;
+		UInt64 filePos;		// Offset of the next chunk header.
+		UInt64 windowPos;
+		size_t windowLen;
+		XMP_Uns8 window [kRiffWindowSize];
+
+		const RiffChunkID * wanted;	// Optional, ends with a zero tagID.
+		std::vector<bool> found;
+		size_t foundCount;
+		bool done;					// Every wanted chunk has been found.
+
+		bool isRF64;				// The ds64 sizes, for an RF64 or BW64 file.
+		UInt64 riffSize, dataSize;
+		std::vector< std::pair<long,UInt64> > sizeTable;
+
+		RiffReader ( LFA_FileRef _fileRef, const RiffChunkID * _wanted );
+		const XMP_Uns8 * GetHeader ( size_t headerLen, size_t readLen );
+		void NoteTag ( long tagID, long parentID );
+		bool ReadDS64();
+		UInt64 ChunkSize ( long tagID, UInt32 len ) const;
+
+	};
+
 	// Local function declarations
-	static bool ReadTag ( LFA_FileRef inFileRef, long * outTag, UInt32 * outLength, long * subtype, UInt64 & inOutPosition );
+	static bool ReadTag ( RiffReader & reader, long * outTag, UInt32 * outLength, UInt64 * outSize, long * subtype, UInt64 & inOutPosition,
+						  size_t windowLen = kRiffWindowSize );
 	static void AddTag ( RiffState & inOutRiffState, long tag, UInt32 len, UInt64 & inOutPosition, long parentID, long parentnum, long subtypeID );
-	static long SubRead ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long parentid, UInt32 parentlen, UInt64 & inOutPosition );
+	static UInt64 SubRead ( RiffReader & reader, RiffState & inOutRiffState, long parentid, UInt64 parentlen, UInt64 & inOutPosition );
 	static bool ReadChunk ( LFA_FileRef inFileRef, UInt64 & pos, UInt32 len, char * outBuffer );
-
-	#define GetFilePosition(file)	LFA_Seek ( file, 0, SEEK_CUR )
+	static void MarkTagAsPadding ( LFA_FileRef inFileRef, RiffState & inOutRiffState, size_t index );
+	static bool TakePadding ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long riffType, size_t index, UInt32 len, bool allowGrowth );
 	
 	// =============================================================================================
 
 	bool GetMetaData ( LFA_FileRef inFileRef, long tagID, char * outBuffer, unsigned long * outBufferSize )
 	{
 		RiffState riffState;
+		RiffChunkID wanted[2] = { { tagID, 0 }, { 0, 0 } };
 	
-		long numTags = OpenRIFF ( inFileRef, riffState );
+		long numTags = OpenRIFF ( inFileRef, riffState, wanted );
 		if ( numTags == 0 ) return false;
 	
 		return GetRIFFChunk ( inFileRef, riffState, tagID, 0, 0, outBuffer, outBufferSize );
@@ -56,7 +112,9 @@ namespace RIFF_Support {
 		long numTags = OpenRIFF ( inFileRef, riffState );
 		if ( numTags == 0 ) return false;
 	
-		return PutChunk ( inFileRef, riffState, riffType, tagID, inBuffer, inBufferSize );
+		bool ok = PutChunk ( inFileRef, riffState, riffType, tagID, inBuffer, inBufferSize );
+		if ( ! CloseRIFF ( inFileRef, riffState ) ) ok = false;
+		return ok;
 	
 	}
 
@@ -64,27 +122,14 @@ namespace RIFF_Support {
 
 	bool MarkChunkAsPadding ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long riffType, long tagID, long subtypeID )
 	{
-		UInt32 len;
-		UInt64 pos;
-		atag tag;
+		long index = 0;
 	
 		try {
 	
-			bool found = FindChunk ( inOutRiffState, tagID, riffType, subtypeID, NULL, &len, &pos );
+			bool found = FindChunk ( inOutRiffState, tagID, riffType, subtypeID, &index, NULL, NULL );
 			if ( ! found ) return false;
 	
-			if ( subtypeID != 0 ) {
-				pos -= 12;
-			} else {
-				pos -= 8;
-			}
-
-			tag.id = MakeUns32LE ( ckidPremierePadding );
-			LFA_Seek ( inFileRef, pos, SEEK_SET );
-			LFA_Write ( inFileRef, &tag, 4 );
-	
-			pos += 8;
-			AddTag ( inOutRiffState, ckidPremierePadding, len, pos, 0, 0, 0 );
+			MarkTagAsPadding ( inFileRef, inOutRiffState, (index - 1) );
 	
 		} catch(...) {
 	
@@ -99,16 +144,16 @@ namespace RIFF_Support {
 
 	bool PutChunk ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long riffType, long tagID, const char * inBuffer, UInt32 inBufferSize )
 	{
+		long index = 0;
 		UInt32 len;
 		UInt64 pos;
-		atag tag;
 	
 		// Make sure we're writting an even number of bytes. Required by the RIFF specification.
 		XMP_Assert ( (inBufferSize & 1) == 0 );
 	
 		try {
 
-			bool found = FindChunk ( inOutRiffState, tagID, 0, 0, NULL, &len, &pos );
+			bool found = FindChunk ( inOutRiffState, tagID, 0, 0, &index, &len, &pos );
 			if ( found ) {
 
 				if ( len == inBufferSize ) {
@@ -117,14 +162,11 @@ namespace RIFF_Support {
 					return true;
 				}
 	
-				pos -= 8;
-				tag.id = MakeUns32LE ( ckidPremierePadding );
-				LFA_Seek ( inFileRef, pos, SEEK_SET );
-				LFA_Write ( inFileRef, &tag, 4 );
-	
-				if ( len > inBufferSize ) {
-					pos += 8;
-					AddTag ( inOutRiffState, ckidPremierePadding, len, pos, 0, 0, 0 );
+				// Try the old chunk's own space first, it can take following padding or grow at the end.
+				index -= 1;
+				MarkTagAsPadding ( inFileRef, inOutRiffState, index );
+				if ( TakePadding ( inFileRef, inOutRiffState, riffType, index, (inBufferSize + 8), true ) ) {
+					return WriteChunk ( inFileRef, tagID, inBuffer, inBufferSize );
 				}
 
 			}
@@ -151,9 +193,14 @@ namespace RIFF_Support {
 		UInt64 pos;
 	
 		try {
-			if ( FindChunk ( inOutRiffState, tagID, parentID, 0, NULL, &len, &pos ) ) {
+			if ( FindChunk ( inOutRiffState, tagID, parentID, 0, NULL, &len, &pos ) && (len > 0) ) {
+				// The chunk has a fixed size, the string is nul padded or truncated to fit.
+				std::string chunkData ( len, 0 );
+				size_t dataLen = strlen ( inData );
+				if ( dataLen > len ) dataLen = len;
+				chunkData.replace ( 0, dataLen, inData, dataLen );
 				LFA_Seek ( inFileRef, pos, SEEK_SET );
-				LFA_Write ( inFileRef, inData, len );
+				LFA_Write ( inFileRef, chunkData.data(), len );
 			}
 		} catch ( ... ) {
 			return false;
@@ -167,95 +214,211 @@ namespace RIFF_Support {
 
 	bool MakeChunk ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long riffType, UInt32 len )
 	{
-		long starttag, taglen;
-		UInt32 rifflen, avail;
-		UInt64 pos;
+		UInt64 pos, rifflen;
 	
-		/* look for top level Premiere padding chunk */
-		starttag = 0;
-		while ( FindChunk ( inOutRiffState, ckidPremierePadding, riffType, 0, &starttag, reinterpret_cast<unsigned long*>(&taglen), &pos ) ) {
+		try {
+
+			/* look for top level padding that fits, then for padding at the end of the file to grow */
+			size_t count = inOutRiffState.tags.size();
+			for ( size_t i = 0; i < count; ++i ) {
+				if ( TakePadding ( inFileRef, inOutRiffState, riffType, i, len, false ) ) return true;
+			}
+			for ( size_t i = 0; i < count; ++i ) {
+				if ( TakePadding ( inFileRef, inOutRiffState, riffType, i, len, true ) ) return true;
+			}
 	
-			pos -= 8;
-			taglen += 8;
-			long extra = taglen - len;
-			if ( extra < 0 ) continue;
+			/* can't take padding chunk, so append new chunk to end of file */
+
+			pos = LFA_Measure ( inFileRef );
+			LFA_Seek ( inFileRef, pos, SEEK_SET );
+			if ( (pos & 1) != 0 ) {
+				XMP_Uns8 padByte = 0;	/* the last chunk is missing its pad byte */
+				LFA_Write ( inFileRef, &padByte, 1 );
+				++pos;
+			}
+
+			rifflen = (pos + len) - (inOutRiffState.riffpos + 8);
 	
-			RiffIterator iter = inOutRiffState.tags.begin();
-			iter += (starttag - 1);
+			if ( (! inOutRiffState.isRF64) && (rifflen > (AVIMAXCHUNKSIZE - 8)) ) {
+
+				/* if needed, create new AVIX chunk, the current RIFF is finished */
+				if ( ! CloseRIFF ( inFileRef, inOutRiffState ) ) return false;
+				LFA_Seek ( inFileRef, pos, SEEK_SET );
+
+				ltag avix;
+				avix.id = MakeUns32LE ( FOURCC_RIFF );
+				avix.len = MakeUns32LE ( 4 + len );
+				avix.subid = MakeUns32LE ( formtypeAVIX );
+				LFA_Write(inFileRef, &avix, sizeof(avix));
 	
-			if ( extra == 0 ) {
+				pos += 12;
+				AddTag ( inOutRiffState, avix.id, len, pos, 0, 0, 0 );
+				return true;
 
-				iter->len = 0;
+			}
 
-			} else {
+			/* otherwise the last RIFF chunk in the file grows, an RF64 keeps its 32 bit length of 0xFFFFFFFF */
+			if ( (! inOutRiffState.isRF64) && (rifflen >= kRF64SizeMarker) ) return false;	/* would need to become RF64 */
+			inOutRiffState.rifflen = rifflen;
+			inOutRiffState.rifflenChanged = true;
 
-				atag pad;
-				UInt64 padpos;
-	
-				/*  need 8 bytes extra to be able to split it */
-				extra -= 8;
-				if ( extra < 0 ) continue;
-	
-				try{
-					padpos = pos + len;
-					LFA_Seek ( inFileRef, padpos, SEEK_SET );
-					pad.id = MakeUns32LE ( ckidPremierePadding );
-					pad.len = MakeUns32LE ( extra );
-					LFA_Write ( inFileRef, &pad, sizeof(pad) );
-				} catch ( ... ) {
-					return false;
-				}
+		} catch ( ... ) {
 
-				iter->pos = padpos + 8;
-				iter->len = extra;
+			return false;
 
-			}
+		}
 	
-			/* seek back to start of original padding chunk */
-			LFA_Seek ( inFileRef, pos, SEEK_SET );
+		return true;
+
+	}
+
+	// =============================================================================================
+
+	bool CloseRIFF ( LFA_FileRef inFileRef, RiffState & inOutRiffState )
+	{
+		if ( ! inOutRiffState.rifflenChanged ) return true;
 	
-			return true;
+		try {
+
+			if ( inOutRiffState.isRF64 ) {
+				XMP_Uns64 riffSize = MakeUns64LE ( inOutRiffState.rifflen );
+				LFA_Seek ( inFileRef, inOutRiffState.ds64pos, SEEK_SET );
+				LFA_Write ( inFileRef, &riffSize, 8 );
+			} else {
+				XMP_Uns32 fileLen = MakeUns32LE ( (XMP_Uns32)inOutRiffState.rifflen );
+				LFA_Seek ( inFileRef, (inOutRiffState.riffpos + 4), SEEK_SET );
+				LFA_Write ( inFileRef, &fileLen, 4 );
+			}
+
+		} catch ( ... ) {
+
+			return false;
 
 		}
 	
-		/* can't take padding chunk, so append new chunk to end of file */
+		inOutRiffState.rifflenChanged = false;
+		return true;
+
+	}
+
+	// =============================================================================================
+	//
+	// A replaced chunk is renamed to padding in the file and in the table, keeping its place in the
+	// table. The chunks inside a replaced list, and the padding chunks whose space was taken by
+	// TakePadding, are no chunks of their own any more. They keep their entries, so that the table
+	// indices stay valid, but get a parentID that no riffType matches.
+
+	static inline bool IsPadding ( const RiffTag & tag )
+	{
+		return ((tag.tagID == ckidPremierePadding) || (tag.tagID == ckidJunk)) && (tag.len != kRF64SizeMarker);
+	}
+
+	static inline UInt64 ChunkEnd ( const RiffTag & tag )
+	{
+		return tag.pos + tag.len + (tag.len & 1);
+	}
+
+	static inline void ForgetTag ( RiffTag & tag )
+	{
+		tag.tagID = ckidPremierePadding;
+		tag.parentID = kForgottenParentID;
+	}
+
+	// =============================================================================================
+
+	static void MarkTagAsPadding ( LFA_FileRef inFileRef, RiffState & inOutRiffState, size_t index )
+	{
+		RiffVector & tags = inOutRiffState.tags;
+		RiffTag & tag = tags[index];
+		UInt64 end = ChunkEnd ( tag );
+	
+		if ( tag.subtypeID != 0 ) {
+			tag.pos -= 4;	/* the padding takes in the list type */
+			tag.len += 4;
+			tag.subtypeID = 0;
+		}
+
+		XMP_Uns32 id = MakeUns32LE ( ckidPremierePadding );
+		LFA_Seek ( inFileRef, (tag.pos - 8), SEEK_SET );
+		LFA_Write ( inFileRef, &id, 4 );
+		tag.tagID = ckidPremierePadding;
+
+		for ( size_t i = index + 1, limit = tags.size(); (i < limit) && (tags[i].pos < end); ++i ) {
+			ForgetTag ( tags[i] );
+		}
+
+	}
+
+	// =============================================================================================
+	//
+	// Tries to put a chunk of len bytes, header included, at the top level padding chunk tags[index].
+	// Padding chunks right after it are merged in as needed. The space must fit exactly, or leave at
+	// least 8 bytes for a new padding chunk. If allowGrowth is set, padding that ends the RIFF and the
+	// file can also be too small, the RIFF then grows by the difference. Leaves the file positioned at
+	// the new chunk if successful. Write errors throw.
+
+	static bool TakePadding ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long riffType, size_t index, UInt32 len, bool allowGrowth )
+	{
+		RiffVector & tags = inOutRiffState.tags;
+		RiffTag & first = tags[index];
+		if ( (first.parentID != riffType) || (! IsPadding ( first )) ) return false;
+	
+		// Leave alone a JUNK chunk that starts the RIFF, EBU Tech 3306 reserves it to become a ds64.
+		UInt64 start = first.pos - 8;
+		if ( (first.tagID == ckidJunk) && (start == tags[first.parent].pos) ) return false;
+	
+		UInt64 end = ChunkEnd ( first );
+		size_t last = index;
+		for ( size_t i = index + 1, limit = tags.size(); i < limit; ++i ) {
+			if ( ((end - start) == len) || ((end - start) >= ((UInt64)len + 8)) ) break;
+			const RiffTag & next = tags[i];
+			if ( (next.parentID != riffType) || (next.parent != first.parent) ) continue;	/* inside a list, or forgotten */
+			if ( (! IsPadding ( next )) || ((next.pos - 8) != end) ) break;
+			end = ChunkEnd ( next );
+			last = i;
+		}
 	
-		rifflen = inOutRiffState.rifflen + 8;
-		avail = AVIMAXCHUNKSIZE - rifflen;
+		UInt64 avail = end - start;
+		UInt64 rifflen = inOutRiffState.rifflen;
 	
-		LFA_Seek ( inFileRef, 0, SEEK_END );
-		pos = GetFilePosition ( inFileRef );
+		if ( (avail != len) && (avail < ((UInt64)len + 8)) ) {
+			if ( (! allowGrowth) || (avail > len) ) return false;
+			if ( end != (inOutRiffState.riffpos + 8 + rifflen) ) return false;
+			if ( end != (UInt64)LFA_Measure ( inFileRef ) ) return false;
+			rifflen += (len - avail);
+			if ( (! inOutRiffState.isRF64) && (rifflen > (AVIMAXCHUNKSIZE - 8)) ) return false;
+			avail = len;
+		}
 	
-		if ( avail < len ) {
-
-			/* if needed, create new AVIX chunk */
-			ltag avix;
+		if ( avail > len ) {
+			atag pad;
+			pad.id = MakeUns32LE ( ckidPremierePadding );
+			pad.len = MakeUns32LE ( (UInt32)(avail - len - 8) );
+			LFA_Seek ( inFileRef, (start + len), SEEK_SET );
+			LFA_Write ( inFileRef, &pad, sizeof(pad) );
+		}
 	
-			avix.id = MakeUns32LE ( FOURCC_RIFF );
-			avix.len = MakeUns32LE ( 4 + len );
-			avix.subid = MakeUns32LE ( formtypeAVIX );
-			LFA_Write(inFileRef, &avix, sizeof(avix));
+		for ( size_t i = index + 1; i <= last; ++i ) {
+			if ( (tags[i].parentID == riffType) && (tags[i].parent == first.parent) ) ForgetTag ( tags[i] );
+		}
 	
-			pos += 12;
-			AddTag ( inOutRiffState, avix.id, len, pos, 0, 0, 0 );
-
+		if ( avail > len ) {
+			first.tagID = ckidPremierePadding;
+			first.pos = start + len + 8;
+			first.len = (UInt32)(avail - len - 8);
 		} else {
-
-			/* otherwise, rewrite length of last RIFF chunk in file */
-			pos = inOutRiffState.riffpos + 4;
-			rifflen = inOutRiffState.rifflen + len;
-			XMP_Uns32 fileLen = MakeUns32LE ( rifflen );
-			LFA_Seek ( inFileRef, pos, SEEK_SET );
-			LFA_Write ( inFileRef, &fileLen, 4 );
-			inOutRiffState.rifflen = rifflen;
+			ForgetTag ( first );
+		}
 	
-			/* prepare to write data */
-			LFA_Seek ( inFileRef, 0, SEEK_END );
-
+		if ( rifflen != inOutRiffState.rifflen ) {
+			inOutRiffState.rifflen = rifflen;
+			inOutRiffState.rifflenChanged = true;
 		}
 	
+		/* seek back to start of original padding chunk */
+		LFA_Seek ( inFileRef, start, SEEK_SET );
 		return true;
-
+	
 	}
 
 	// =============================================================================================
@@ -278,19 +441,148 @@ namespace RIFF_Support {
 
 	// =============================================================================================
 
-	long OpenRIFF ( LFA_FileRef inFileRef, RiffState & inOutRiffState )
+	RiffReader::RiffReader ( LFA_FileRef _fileRef, const RiffChunkID * _wanted )
+		: fileRef(_fileRef), filePos(0), windowPos(0), windowLen(0), wanted(_wanted), foundCount(0), done(false),
+		  isRF64(false), riffSize(0), dataSize(0)
+	{
+		if ( this->wanted != 0 ) {
+			size_t wantedCount = 0;
+			while ( this->wanted[wantedCount].tagID != 0 ) ++wantedCount;
+			this->found.assign ( wantedCount, false );
+			this->done = (wantedCount == 0);
+		}
+	}
+
+	// =============================================================================================
+
+	const XMP_Uns8 * RiffReader::GetHeader ( size_t headerLen, size_t readLen )
+	{
+		XMP_Assert ( (headerLen <= readLen) && (readLen <= kRiffWindowSize) );
+	
+		if ( (this->windowPos <= this->filePos) && ((this->filePos + headerLen) <= (this->windowPos + this->windowLen)) ) {
+			return &this->window[this->filePos - this->windowPos];
+		}
+	
+		this->windowLen = 0;	// ! In case the seek or read throws.
+		LFA_Seek ( this->fileRef, this->filePos, SEEK_SET );
+		this->windowPos = this->filePos;
+		this->windowLen = LFA_Read ( this->fileRef, &this->window[0], (XMP_Int32)readLen );
+	
+		if ( this->windowLen < headerLen ) return 0;
+		return &this->window[0];
+	
+	}
+
+	// =============================================================================================
+
+	void RiffReader::NoteTag ( long tagID, long parentID )
+	{
+		if ( this->wanted == 0 ) return;
+	
+		for ( size_t i = 0, limit = this->found.size(); i < limit; ++i ) {
+			if ( this->found[i] ) continue;
+			if ( this->wanted[i].tagID != tagID ) continue;
+			if ( (this->wanted[i].parentID != 0) && (this->wanted[i].parentID != parentID) ) continue;
+			this->found[i] = true;
+			++this->foundCount;
+		}
+	
+		this->done = (this->foundCount == this->found.size());
+	
+	}
+
+	// =============================================================================================
+	//
+	// Called with the filePos just past the RF64 or BW64 header. The ds64 chunk is only looked at
+	// here, the following SubRead adds it to the table like any other chunk. Table entries that do
+	// not fit in a window are ignored, there should be at most a few of them.
+
+	bool RiffReader::ReadDS64()
+	{
+		const XMP_Uns8 * header = this->GetHeader ( 8 + kDS64FixedSize, kRiffWindowSize );
+		if ( header == 0 ) return false;
+	
+		UInt32 ds64Len = GetUns32LE ( header + 4 );
+		if ( (GetUns32LE ( header ) != (XMP_Uns32)ckidDS64) || (ds64Len < kDS64FixedSize) ) return false;
+	
+		this->riffSize = GetUns64LE ( header + 8 );
+		this->dataSize = GetUns64LE ( header + 16 );
+		if ( this->riffSize < 4 ) return false;
+		this->isRF64 = true;
+	
+		size_t tableLength = GetUns32LE ( header + 32 );
+		size_t maxLength = (kRiffWindowSize - (8 + kDS64FixedSize)) / kDS64TableEntrySize;
+		if ( tableLength > maxLength ) tableLength = maxLength;
+		if ( tableLength > ((ds64Len - kDS64FixedSize) / kDS64TableEntrySize) ) tableLength = (ds64Len - kDS64FixedSize) / kDS64TableEntrySize;
+	
+		header = this->GetHeader ( 8 + kDS64FixedSize + tableLength*kDS64TableEntrySize, kRiffWindowSize );
+		if ( header == 0 ) return true;	// Just the fixed part.
+	
+		const XMP_Uns8 * entry = header + 8 + kDS64FixedSize;
+		for ( size_t i = 0; i < tableLength; ++i, entry += kDS64TableEntrySize ) {
+			this->sizeTable.push_back ( std::pair<long,UInt64> ( (long)GetUns32LE ( entry ), GetUns64LE ( entry + 4 ) ) );
+		}
+	
+		return true;
+	
+	}
+
+	// =============================================================================================
+
+	UInt64 RiffReader::ChunkSize ( long tagID, UInt32 len ) const
+	{
+		if ( (! this->isRF64) || (len != kRF64SizeMarker) ) return len;
+	
+		if ( (tagID == FOURCC_RF64) || (tagID == FOURCC_BW64) ) return this->riffSize;
+		if ( tagID == ckidData ) return this->dataSize;
+	
+		for ( size_t i = 0, limit = this->sizeTable.size(); i < limit; ++i ) {
+			if ( this->sizeTable[i].first == tagID ) return this->sizeTable[i].second;
+		}
+	
+		return len;
+	
+	}
+
+	// =============================================================================================
+
+	long OpenRIFF ( LFA_FileRef inFileRef, RiffState & inOutRiffState, const RiffChunkID * wantedChunks /* = 0 */ )
 	{
 		UInt64 pos = 0;
 		long tag, subtype;
 		UInt32 len;
+		UInt64 size;
 	
-		LFA_Seek ( inFileRef, 0, SEEK_SET );
+		RiffReader reader ( inFileRef, wantedChunks );
 	
 		// read first tag (always RIFFtype)
-		while ( ReadTag ( inFileRef, &tag, &len, &subtype, pos) ) {
-			if ( tag != FOURCC_RIFF ) break;
+		while ( ! reader.done ) {
+
+			bool isFirst = (reader.filePos == 0);
+			size_t windowLen = isFirst ? kRiffWindowSize : kRiffAVIXWindowSize;
+			if ( ! ReadTag ( reader, &tag, &len, &size, &subtype, pos, windowLen ) ) break;
+
+			bool isRF64 = (tag == FOURCC_RF64) || (tag == FOURCC_BW64);
+
+			if ( isRF64 ) {
+				if ( (! isFirst) || (! reader.ReadDS64()) ) break;
+				size = reader.riffSize - 4;	// ! ReadTag could not know this before the ds64 was read.
+			} else if ( tag != FOURCC_RIFF ) {
+				break;
+			}
+
 			AddTag ( inOutRiffState, tag, len, pos, 0, 0, subtype );
-			if ( subtype != 0 ) SubRead ( inFileRef, inOutRiffState, subtype, len, pos );
+			reader.NoteTag ( tag, 0 );
+
+			if ( isRF64 ) {
+				inOutRiffState.isRF64 = true;
+				inOutRiffState.riffpos = pos - 12;
+				inOutRiffState.rifflen = reader.riffSize;
+				inOutRiffState.ds64pos = pos + 8;
+			}
+
+			if ( subtype != 0 ) SubRead ( reader, inOutRiffState, subtype, size, pos );
+
 		}
 	
 		return inOutRiffState.tags.size();
@@ -299,40 +591,39 @@ namespace RIFF_Support {
 
 	// =============================================================================================
 
-	static bool  ReadTag ( LFA_FileRef inFileRef, long * outTag, UInt32 * outLength, long * subtype, UInt64 & inOutPosition )
+	static bool  ReadTag ( RiffReader & reader, long * outTag, UInt32 * outLength, UInt64 * outSize, long * subtype, UInt64 & inOutPosition,
+						   size_t windowLen /* = kRiffWindowSize */ )
 	{
-		UInt32	realLength;
+		UInt64	realLength;
 	
 		try {
 
-			long bytesRead;
-			bytesRead = LFA_Read ( inFileRef, outTag, 4 );
-			if ( bytesRead == 0 ) return false;
-			*outTag = GetUns32LE ( outTag );
-			
-			bytesRead = LFA_Read ( inFileRef, outLength, 4 );
-			if ( bytesRead == 0 ) return false;
-			*outLength = GetUns32LE ( outLength );
+			const XMP_Uns8 * header = reader.GetHeader ( 8, windowLen );
+			if ( header == 0 ) return false;
+			*outTag = GetUns32LE ( header );
+			*outLength = GetUns32LE ( header + 4 );
 	
-			realLength = *outLength;
+			*outSize = reader.ChunkSize ( *outTag, *outLength );
+			realLength = *outSize;
 			realLength += (realLength & 1);		// round up to words
 	
 			*subtype = 0;
 	
-			if ( (*outTag != FOURCC_LIST) && (*outTag != FOURCC_RIFF) ) {
+			if ( (*outTag != FOURCC_LIST) && (*outTag != FOURCC_RIFF) && (*outTag != FOURCC_RF64) && (*outTag != FOURCC_BW64) ) {
 
-				inOutPosition = GetFilePosition ( inFileRef );
-				UInt64 tempPos = inOutPosition + realLength;
-				LFA_Seek ( inFileRef, tempPos, SEEK_SET );
+				inOutPosition = reader.filePos + 8;
+				reader.filePos = inOutPosition + realLength;
 
 			} else  {
 
-				bytesRead = LFA_Read ( inFileRef, subtype, 4 );
-				if ( bytesRead == 0 ) return false;
-				*subtype = GetUns32LE ( subtype );
+				header = reader.GetHeader ( kRiffHeaderSize, windowLen );
+				if ( header == 0 ) return false;
+				*subtype = GetUns32LE ( header + 8 );
 
 				*outLength -= 4;
+				*outSize -= 4;
 				realLength -= 4;
+				reader.filePos += kRiffHeaderSize;
 	
 				// Special case:
 				// Since the 'movi' chunk can contain billions of subchunks, skip over the 'movi' subchunk.
@@ -341,15 +632,14 @@ namespace RIFF_Support {
 				// The subtype is returned empty so nobody will try to parse the subchunks.
 
 				if ( *subtype == listtypeAVIMOVIE ) {
-					inOutPosition = GetFilePosition ( inFileRef );
-					UInt64 tempPos = inOutPosition + realLength;
-					LFA_Seek ( inFileRef, tempPos, SEEK_SET );
+					reader.filePos += realLength;
 					*outLength += 4;
+					*outSize += 4;
 					*outTag = *subtype;
 					*subtype = 0;
 				}
 
-				inOutPosition = GetFilePosition ( inFileRef );
+				inOutPosition = reader.filePos;
 
 			}
 
@@ -387,28 +677,30 @@ namespace RIFF_Support {
 
 	// =============================================================================================
 
-	static long SubRead ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long parentid, UInt32 parentlen, UInt64 & inOutPosition )
+	static UInt64 SubRead ( RiffReader & reader, RiffState & inOutRiffState, long parentid, UInt64 parentlen, UInt64 & inOutPosition )
 	{
 		long tag;
 		long subtype = 0;
 		long parentnum;
-		UInt32 len, total, childlen;
+		UInt32 len;
+		UInt64 size, total, childlen;
 		UInt64 oldpos;
 	
 		total = 0;
 		parentnum = inOutRiffState.tags.size() - 1;
 	
-		while ( parentlen > 0 ) {
+		while ( (parentlen > 0) && (! reader.done) ) {
 
 			oldpos = inOutPosition;
-			ReadTag ( inFileRef, &tag, &len, &subtype, inOutPosition );
+			if ( ! ReadTag ( reader, &tag, &len, &size, &subtype, inOutPosition ) ) break;
 			AddTag ( inOutRiffState, tag, len, inOutPosition, parentid, parentnum, subtype );
-			len += (len & 1);
+			reader.NoteTag ( tag, parentid );
+			size += (size & 1);
 
 			if ( subtype == 0 ) {
-				childlen = 8 + len;
+				childlen = 8 + size;
 			} else {
-				childlen = 12 + SubRead ( inFileRef, inOutRiffState, subtype, len, inOutPosition );
+				childlen = 12 + SubRead ( reader, inOutRiffState, subtype, size, inOutPosition );
 			}
 
 			if ( parentlen < childlen ) parentlen = childlen;
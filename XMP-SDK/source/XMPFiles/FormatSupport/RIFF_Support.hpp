@@ -32,6 +32,10 @@
 	#endif
 #endif
 
+// Padding chunks, their space is reused for new chunks. Chunks that are replaced get the Premiere ID.
+#define	ckidPremierePadding	MakeFourCC ('J', 'U', 'N', 'Q')
+#define	ckidJunk			MakeFourCC ('J', 'U', 'N', 'K')
+
 namespace RIFF_Support 
 {
 	// Some types, if not already defined
@@ -39,7 +43,11 @@ namespace RIFF_Support
 		typedef unsigned long long UInt64;
 	#endif
 	#ifndef UInt32
-		typedef unsigned long UInt32;
+		#if XMP_UNIXBuild
+			typedef XMP_Uns32 UInt32;	// ! A long is 64 bits for LP64 UNIXes.
+		#else
+			typedef unsigned long UInt32;
+		#endif
 	#endif
 
 	/**
@@ -68,7 +76,7 @@ namespace RIFF_Support
 
 		UInt64	pos;		/* file offset of chunk data */
 		long	tagID;		/* ckid of chunk */
-		UInt32	len;		/* length of chunk data */
+		UInt32	len;		/* length of chunk data, 0xFFFFFFFF for an RF64 chunk that is sized by the ds64 */
 		long	parent;		/* chunk# of parent */
 		long	parentID;	/* FOURCC of parent */
 		long	subtypeID;	/* Subtype of the tag (aka LIST ID) */
@@ -86,28 +94,54 @@ namespace RIFF_Support
 	class RiffState {
 	public:
 
-		RiffState() : riffpos(0), rifflen(0), next(0) {}
+		RiffState() : riffpos(0), rifflen(0), next(0), isRF64(false), ds64pos(0), rifflenChanged(false) {}
 		virtual ~RiffState() {}
 
 		UInt64 riffpos;		/* file offset of current RIFF */
-		long rifflen;		/* length of RIFF incl. header */
+		UInt64 rifflen;		/* length of RIFF incl. header */
 		long next;			/* next one to search */
 		RiffVector tags;	/* vector of chunks */
 
+		bool isRF64;		/* an RF64 or BW64 file, the RIFF length is in the ds64 chunk */
+		UInt64 ds64pos;		/* file offset of the ds64 chunk data */
+
+		bool rifflenChanged;	/* rifflen grew, CloseRIFF must write it */
+
 	};
 
 	struct ltag {
-		long	id;
-		UInt32	len;
-		long	subid;
+		XMP_Uns32	id;
+		UInt32		len;
+		XMP_Uns32	subid;
+	};
+
+	/**
+	** Identifies a chunk for OpenRIFF to look for, matched like
+	** the tagID and parentID parameters of FindChunk.
+	*/
+	struct RiffChunkID {
+		long	tagID;
+		long	parentID;	/* 0 matches any parent */
 	};
 
 	/**
 	** Read from the RIFF file, and build a table of the chunks
-	** in the RIFFState class provided.
+	** in the RIFFState class provided. Only the chunk headers are
+	** read, the 'movi' lists are skipped without reading the media.
+	**
+	** An RF64 or BW64 file is walked using the 64 bit sizes in its
+	** ds64 chunk, for the file and for chunks larger than 4 GB.
+	**
+	** If wantedChunks is passed, a list ending with a zero tagID,
+	** the walk stops as soon as a chunk matching each entry has
+	** been added. The table then holds the chunks up to that point,
+	** FindChunk and GetRIFFChunk give the same answers for the wanted
+	** chunks as after a full walk. Use this only for reading, PutChunk
+	** and MakeChunk need the full table.
+	**
 	** Returns the number of chunks found.
 	*/
-	long OpenRIFF ( LFA_FileRef inFileRef, RiffState & inOutRiffState );
+	long OpenRIFF ( LFA_FileRef inFileRef, RiffState & inOutRiffState, const RiffChunkID * wantedChunks = 0 );
 
 	/**
 	** Get a chunk from an existing RIFFState, obtained from
@@ -122,7 +156,8 @@ namespace RIFF_Support
 
 
 	/**
-	** The routine finds an existing list and tags it as Padding
+	** The routine finds an existing list and tags it as Padding. A top level
+	** chunk can then be reused by MakeChunk, the chunks inside a list are gone.
 	**
 	** Returns true if success
 	*/
@@ -132,6 +167,9 @@ namespace RIFF_Support
 	/**
 	** The routine finds an existing location to put the chunk into if
 	** available, otherwise it creates a new chunk and writes to it.
+	** A chunk of a different size is replaced in its own space when
+	** that space, with any padding right after it, is big enough or
+	** ends the file, otherwise wherever MakeChunk finds room.
 	**
 	** Returns true if success
 	*/
@@ -161,12 +199,25 @@ namespace RIFF_Support
 
 	/**
 	** Attempts to find a location to write a chunk, and if not found, prepares a chunk
-	** at the end of the file.
+	** at the end of the file. The len includes the chunk header. Top level padding
+	** chunks are reused, adjacent ones together, the rest is left as a smaller padding
+	** chunk. Padding that ends the file is grown instead of appending after it.
+	**
+	** The file is left positioned at the new chunk. The RIFF length is not written
+	** here, call CloseRIFF after the last chunk is made.
 	**
 	** Returns true if successful.
 	*/
 	bool MakeChunk ( LFA_FileRef inFileRef, RiffState & inOutRiffState, long riffType, UInt32 len );
 
+	/**
+	** Writes the RIFF length, or the ds64 RIFF size, if MakeChunk changed it.
+	** Call this once when done with PutChunk and MakeChunk.
+	**
+	** Returns true if successful.
+	*/
+	bool CloseRIFF ( LFA_FileRef inFileRef, RiffState & inOutRiffState );
+
 } // namespace RIFF_Support
 
 #endif	// __RIFF_Support_hpp__
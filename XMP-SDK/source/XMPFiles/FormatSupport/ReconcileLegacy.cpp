@@ -36,8 +36,11 @@ void ImportJTPtoXMP ( XMP_FileFormat		srcFormat,
 					  const PSIR_Manager &  psir,
 					  IPTC_Manager *        iptc,	// ! Need to call UpdateDataSets.
 					  SXMPMeta *			xmp,
-					  XMP_OptionBits		options /* = 0 */ )
+					  XMP_OptionBits		options /* = 0 */,
+					  RecJTP_ExportState *  exportState /* = 0 */ )
 {
+	PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Reconcile );
+
 	bool haveXMP  = XMP_OptionIsSet ( options, k2XMP_FileHadXMP );
 	bool haveIPTC = XMP_OptionIsSet ( options, k2XMP_FileHadIPTC );
 	bool haveExif = XMP_OptionIsSet ( options, k2XMP_FileHadExif );
@@ -105,20 +108,61 @@ void ImportJTPtoXMP ( XMP_FileFormat		srcFormat,
 	
 	tiff->xmpHadUserComment = xmp->DoesPropertyExist ( kXMP_NS_EXIF, "UserComment" );
 	tiff->xmpHadRelatedSoundFile = xmp->DoesPropertyExist ( kXMP_NS_EXIF, "RelatedSoundFile" );
+	
+	// Remember the digests that matched, the export need not recompute them if the legacy does not
+	// change. The default digest states say nothing about legacy that is not in the file.
+	
+	if ( exportState != 0 ) {
+		exportState->iptcDigestOK = haveXMP && haveIPTC && (iptcDigestState == kDigestMatches);
+		exportState->tiffDigest.erase();
+		exportState->exifDigest.erase();
+		if ( haveXMP && haveExif ) {
+			if ( tiffDigestState == kDigestMatches ) {
+				(void) xmp->GetProperty ( kXMP_NS_TIFF, "NativeDigest", &exportState->tiffDigest, 0 );
+			}
+			if ( exifDigestState == kDigestMatches ) {
+				(void) xmp->GetProperty ( kXMP_NS_EXIF, "NativeDigest", &exportState->exifDigest, 0 );
+			}
+		}
+	}
 
 }	// ImportJTPtoXMP
 
+// =================================================================================================
+// IsDigestCurrent
+// ===============
+//
+// See if the XMP still has a TIFF or Exif digest that is known to match the legacy. The client
+// might have changed or deleted it since.
+
+static bool IsDigestCurrent ( const SXMPMeta & xmp, XMP_StringPtr schemaNS, const std::string & knownDigest )
+{
+	if ( knownDigest.empty() ) return false;
+	
+	std::string xmpDigest;
+	bool found = xmp.GetProperty ( schemaNS, "NativeDigest", &xmpDigest, 0 );
+	return (found && (xmpDigest == knownDigest));
+
+}	// IsDigestCurrent
+
 // =================================================================================================
 // ExportXMPtoJTP
 // ==============
+//
+// The export of the individual items is cheap, the legacy managers ignore sets of unchanged values.
+// Recomputing a digest means encoding and hashing the whole legacy block. That is only done if the
+// legacy changed, or if the digest was not known to match before.
 
 void ExportXMPtoJTP ( XMP_FileFormat destFormat,
 					  SXMPMeta *     xmp,
 					  TIFF_Manager * tiff,
 					  PSIR_Manager * psir,
 					  IPTC_Manager * iptc,
-					  XMP_OptionBits options /* = 0 */ )
+					  XMP_OptionBits options /* = 0 */,
+					  RecJTP_ExportState * exportState /* = 0 */ )
 {
+	PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Reconcile );
+
 	XMP_Assert ( xmp != 0 );
 	XMP_Assert ( (destFormat == kXMP_JPEGFile) || (destFormat == kXMP_TIFFFile) || (destFormat == kXMP_PhotoshopFile) );
 
@@ -128,6 +172,9 @@ void ExportXMPtoJTP ( XMP_FileFormat destFormat,
 	
 	bool iptcChanged = false;
 	
+	RecJTP_ExportState noState;	// Makes everything look unknown.
+	if ( exportState == 0 ) exportState = &noState;
+	
 	// Export the individual metadata items to the legacy forms. The PSIR and IPTC must be done
 	// before the TIFF and Exif. The PSIR and IPTC have side effects that can modify the XMP, and
 	// thus the values written to TIFF and Exif. The side effects are the CR<->LF normalization that
@@ -138,14 +185,29 @@ void ExportXMPtoJTP ( XMP_FileFormat destFormat,
 	if ( iptc != 0 ) {
 		ReconcileUtils::ExportIPTC ( xmp, iptc );
 		iptcChanged = iptc->IsChanged();	// ! Do after calling ExportIPTC and before calling SetIPTCDigest.
-		if ( psir != 0 ) ReconcileUtils::SetIPTCDigest ( iptc, psir );	// ! Do always, in case the digest was missing before.
+		if ( (psir != 0) && (iptcChanged || (! exportState->iptcDigestOK)) ) {
+			ReconcileUtils::SetIPTCDigest ( iptc, psir );	// ! The digest might have been missing before.
+		}
+		exportState->iptcDigestOK = (psir != 0);
 	}
 
 	if ( tiff != 0 ) {
+
 		ReconcileUtils::ExportTIFF ( *xmp, tiff );
 		ReconcileUtils::ExportExif ( *xmp, tiff );
-		ReconcileUtils::SetTIFFDigest ( *tiff, xmp );	// ! Do always, in case the digest was missing before.
-		ReconcileUtils::SetExifDigest ( *tiff, xmp );	// ! Do always, in case the digest was missing before.
+
+		bool tiffChanged = tiff->IsChanged();	// ! One check for both digests, the Exif is in the TIFF stream.
+
+		if ( tiffChanged || (! IsDigestCurrent ( *xmp, kXMP_NS_TIFF, exportState->tiffDigest )) ) {
+			ReconcileUtils::SetTIFFDigest ( *tiff, xmp );	// ! The digest might have been missing before.
+			(void) xmp->GetProperty ( kXMP_NS_TIFF, "NativeDigest", &exportState->tiffDigest, 0 );
+		}
+
+		if ( tiffChanged || (! IsDigestCurrent ( *xmp, kXMP_NS_EXIF, exportState->exifDigest )) ) {
+			ReconcileUtils::SetExifDigest ( *tiff, xmp );	// ! The digest might have been missing before.
+			(void) xmp->GetProperty ( kXMP_NS_EXIF, "NativeDigest", &exportState->exifDigest, 0 );
+		}
+
 	}
 	
 	// Now update the collections of metadata, e.g. the IPTC in PSIR 1028 or XMP in TIFF tag 700.
@@ -50,13 +50,26 @@ enum {	// Bits for the options to ImportJTPtoXMP.
 	k2XMP_FileHadExif = 0x0004	// Set if the file had legacy Exif.
 };
 
+// RecJTP_ExportState carries what ImportJTPtoXMP learned about the legacy digests over to
+// ExportXMPtoJTP, and from one ExportXMPtoJTP to the next. A digest is only recomputed if its
+// legacy changed, or if it was not known to match, or if the XMP copy of it was changed or removed.
+// The handler owns the state, passing 0 means the digests are always recomputed.
+
+struct RecJTP_ExportState {
+	bool iptcDigestOK;		// True if the PSIR 1061 digest is known to match the IPTC.
+	std::string tiffDigest;	// The tiff:NativeDigest value known to match the TIFF, empty if unknown.
+	std::string exifDigest;	// The exif:NativeDigest value known to match the Exif, empty if unknown.
+	RecJTP_ExportState() : iptcDigestOK(false) {};
+};
+
 extern void ImportJTPtoXMP ( XMP_FileFormat		   srcFormat,
 							 RecJTP_LegacyPriority lastLegacy,
 							 TIFF_Manager *        tiff,	// ! Need to modify for UserComment and RelatedSoundFile hack.
 							 const PSIR_Manager &  psir,
 						 	 IPTC_Manager *        iptc,	// ! Need to modify for UpdateDataSets.
 							 SXMPMeta *			   xmp,
-							 XMP_OptionBits		   options = 0 );
+							 XMP_OptionBits		   options = 0,
+							 RecJTP_ExportState *  exportState = 0 );	// Pass 0 if not wanted.
 
 #if 0	// Activate if we want to support the Mac pnot resource.
 extern void ImportJTPtoXMP ( XMP_FileFormat		   srcFormat,
@@ -77,7 +90,8 @@ extern void ExportXMPtoJTP ( XMP_FileFormat destFormat,
 							 TIFF_Manager * tiff, // Pass 0 if not wanted.
 							 PSIR_Manager * psir, // Pass 0 if not wanted.
 							 IPTC_Manager * iptc, // Pass 0 if not wanted.
-							 XMP_OptionBits options = 0 );
+							 XMP_OptionBits options = 0,
+							 RecJTP_ExportState * exportState = 0 );	// Pass 0 if not wanted.
 
 // =================================================================================================
 // Summary of TIFF/Exif mappings to XMP
@@ -399,7 +399,7 @@ ImportSingleTIFF_Long ( const TIFF_Manager::TagInfo & tagInfo, const bool native
 		if ( ! nativeEndian ) binValue = Flip4 ( binValue );
 	
 		char strValue[20];
-		snprintf ( strValue, sizeof(strValue), "%lu", binValue );	// AUDIT: Using sizeof(strValue) is safe.
+		snprintf ( strValue, sizeof(strValue), "%lu", (unsigned long)binValue );	// AUDIT: Using sizeof(strValue) is safe.
 	
 		xmp->SetProperty ( xmpNS, xmpProp, strValue );
 
@@ -429,7 +429,7 @@ ImportSingleTIFF_Rational ( const TIFF_Manager::TagInfo & tagInfo, const bool na
 		}
 	
 		char strValue[40];
-		snprintf ( strValue, sizeof(strValue), "%lu/%lu", binNum, binDenom );	// AUDIT: Using sizeof(strValue) is safe.
+		snprintf ( strValue, sizeof(strValue), "%lu/%lu", (unsigned long)binNum, (unsigned long)binDenom );	// AUDIT: Using sizeof(strValue) is safe.
 	
 		xmp->SetProperty ( xmpNS, xmpProp, strValue );
 
@@ -459,7 +459,7 @@ ImportSingleTIFF_SRational ( const TIFF_Manager::TagInfo & tagInfo, const bool n
 		}
 	
 		char strValue[40];
-		snprintf ( strValue, sizeof(strValue), "%ld/%ld", binNum, binDenom );	// AUDIT: Using sizeof(strValue) is safe.
+		snprintf ( strValue, sizeof(strValue), "%ld/%ld", (long)binNum, (long)binDenom );	// AUDIT: Using sizeof(strValue) is safe.
 	
 		xmp->SetProperty ( xmpNS, xmpProp, strValue );
 
@@ -590,7 +590,7 @@ ImportSingleTIFF_SLong ( const TIFF_Manager::TagInfo & tagInfo, const bool nativ
 		if ( ! nativeEndian ) Flip4 ( &binValue );
 	
 		char strValue[20];
-		snprintf ( strValue, sizeof(strValue), "%ld", binValue );	// AUDIT: Using sizeof(strValue) is safe.
+		snprintf ( strValue, sizeof(strValue), "%ld", (long)binValue );	// AUDIT: Using sizeof(strValue) is safe.
 	
 		xmp->SetProperty ( xmpNS, xmpProp, strValue );
 
@@ -761,7 +761,7 @@ ImportArrayTIFF_Long ( const TIFF_Manager::TagInfo & tagInfo, const bool nativeE
 			if ( ! nativeEndian ) binValue = Flip4 ( binValue );
 	
 			char strValue[20];
-			snprintf ( strValue, sizeof(strValue), "%lu", binValue );	// AUDIT: Using sizeof(strValue) is safe.
+			snprintf ( strValue, sizeof(strValue), "%lu", (unsigned long)binValue );	// AUDIT: Using sizeof(strValue) is safe.
 	
 			xmp->AppendArrayItem ( xmpNS, xmpProp, kXMP_PropArrayIsOrdered, strValue );
 	
@@ -796,7 +796,7 @@ ImportArrayTIFF_Rational ( const TIFF_Manager::TagInfo & tagInfo, const bool nat
 			}
 	
 			char strValue[40];
-			snprintf ( strValue, sizeof(strValue), "%lu/%lu", binNum, binDenom );	// AUDIT: Using sizeof(strValue) is safe.
+			snprintf ( strValue, sizeof(strValue), "%lu/%lu", (unsigned long)binNum, (unsigned long)binDenom );	// AUDIT: Using sizeof(strValue) is safe.
 	
 			xmp->AppendArrayItem ( xmpNS, xmpProp, kXMP_PropArrayIsOrdered, strValue );
 	
@@ -831,7 +831,7 @@ ImportArrayTIFF_SRational ( const TIFF_Manager::TagInfo & tagInfo, const bool na
 			}
 	
 			char strValue[40];
-			snprintf ( strValue, sizeof(strValue), "%ld/%ld", binNum, binDenom );	// AUDIT: Using sizeof(strValue) is safe.
+			snprintf ( strValue, sizeof(strValue), "%ld/%ld", (long)binNum, (long)binDenom );	// AUDIT: Using sizeof(strValue) is safe.
 	
 			xmp->AppendArrayItem ( xmpNS, xmpProp, kXMP_PropArrayIsOrdered, strValue );
 	
@@ -991,7 +991,7 @@ ImportArrayTIFF_SLong ( const TIFF_Manager::TagInfo & tagInfo, const bool native
 			if ( ! nativeEndian ) Flip4 ( &binValue );
 	
 			char strValue[20];
-			snprintf ( strValue, sizeof(strValue), "%ld", binValue );	// AUDIT: Using sizeof(strValue) is safe.
+			snprintf ( strValue, sizeof(strValue), "%ld", (long)binValue );	// AUDIT: Using sizeof(strValue) is safe.
 	
 			xmp->AppendArrayItem ( xmpNS, xmpProp, kXMP_PropArrayIsOrdered, strValue );
 	
@@ -1171,7 +1171,7 @@ static bool
 ImportTIFF_CheckStandardMapping ( const TIFF_Manager::TagInfo & tagInfo,
 								  const TIFF_MappingToXMP & mapInfo )
 {
-	XMP_Assert ( (kTIFF_ByteType <= tagInfo.type) && (tagInfo.type <= kTIFF_LastType) );
+	XMP_Assert ( (kTIFF_ByteType <= tagInfo.type) && (tagInfo.type <= kTIFF_LastBigType) );
 	XMP_Assert ( mapInfo.type <= kTIFF_LastType );
 
 	if ( (tagInfo.type < kTIFF_ByteType) || (tagInfo.type > kTIFF_LastType) ) return false;
@@ -1432,6 +1432,7 @@ ImportTIFF_OECFTable ( const TIFF_Manager::TagInfo & tagInfo, bool nativeEndian,
 		xmp->SetStructField ( xmpNS, xmpProp, kXMP_NS_EXIF, "Rows", buffer );
 		
 		std::string arrayPath;
+		XMP_Int32 * binPtr;	// ! Declared here so the gotos do not cross its initialization.
 		
 		SXMPUtils::ComposeStructFieldPath ( xmpNS, xmpProp, kXMP_NS_EXIF, "Names", &arrayPath );
 		
@@ -1446,7 +1447,7 @@ ImportTIFF_OECFTable ( const TIFF_Manager::TagInfo & tagInfo, bool nativeEndian,
 		if ( (byteEnd - bytePtr) != (8 * columns * rows) ) goto BadExif;	// Make sure the values are present.
 		SXMPUtils::ComposeStructFieldPath ( xmpNS, xmpProp, kXMP_NS_EXIF, "Values", &arrayPath );
 	
-		XMP_Int32 * binPtr = (XMP_Int32*)bytePtr;
+		binPtr = (XMP_Int32*)bytePtr;
 		for ( size_t i = (columns * rows); i > 0; --i, binPtr += 2 ) {
 	
 			XMP_Int32 binNum   = binPtr[0];
@@ -1456,7 +1457,7 @@ ImportTIFF_OECFTable ( const TIFF_Manager::TagInfo & tagInfo, bool nativeEndian,
 				Flip4 ( &binDenom );
 			}
 	
-			snprintf ( buffer, sizeof(buffer), "%ld/%ld", binNum, binDenom );	// AUDIT: Use of sizeof(buffer) is safe.
+			snprintf ( buffer, sizeof(buffer), "%ld/%ld", (long)binNum, (long)binDenom );	// AUDIT: Use of sizeof(buffer) is safe.
 	
 			xmp->AppendArrayItem ( xmpNS, arrayPath.c_str(), kXMP_PropArrayIsOrdered, buffer );
 	
@@ -1506,6 +1507,7 @@ ImportTIFF_SFRTable ( const TIFF_Manager::TagInfo & tagInfo, bool nativeEndian,
 		xmp->SetStructField ( xmpNS, xmpProp, kXMP_NS_EXIF, "Rows", buffer );
 		
 		std::string arrayPath;
+		XMP_Uns32 * binPtr;	// ! Declared here so the gotos do not cross its initialization.
 		
 		SXMPUtils::ComposeStructFieldPath ( xmpNS, xmpProp, kXMP_NS_EXIF, "Names", &arrayPath );
 		
@@ -1520,7 +1522,7 @@ ImportTIFF_SFRTable ( const TIFF_Manager::TagInfo & tagInfo, bool nativeEndian,
 		if ( (byteEnd - bytePtr) != (8 * columns * rows) ) goto BadExif;	// Make sure the values are present.
 		SXMPUtils::ComposeStructFieldPath ( xmpNS, xmpProp, kXMP_NS_EXIF, "Values", &arrayPath );
 	
-		XMP_Uns32 * binPtr = (XMP_Uns32*)bytePtr;
+		binPtr = (XMP_Uns32*)bytePtr;
 		for ( size_t i = (columns * rows); i > 0; --i, binPtr += 2 ) {
 	
 			XMP_Uns32 binNum   = binPtr[0];
@@ -1530,7 +1532,7 @@ ImportTIFF_SFRTable ( const TIFF_Manager::TagInfo & tagInfo, bool nativeEndian,
 				binDenom = Flip4 ( binDenom );
 			}
 	
-			snprintf ( buffer, sizeof(buffer), "%lu/%lu", binNum, binDenom );	// AUDIT: Use of sizeof(buffer) is safe.
+			snprintf ( buffer, sizeof(buffer), "%lu/%lu", (unsigned long)binNum, (unsigned long)binDenom );	// AUDIT: Use of sizeof(buffer) is safe.
 	
 			xmp->AppendArrayItem ( xmpNS, arrayPath.c_str(), kXMP_PropArrayIsOrdered, buffer );
 	
@@ -1710,7 +1712,7 @@ ImportTIFF_GPSCoordinate ( const TIFF_Manager & tiff, const TIFF_Manager::TagInf
 		
 		if ( (degDenom == 1) && (minDenom == 1) && (secDenom == 1) ) {
 		
-			snprintf ( buffer, sizeof(buffer), "%lu,%lu,%lu%c", degNum, minNum, secNum, ref );	// AUDIT: Using sizeof(buffer is safe.
+			snprintf ( buffer, sizeof(buffer), "%lu,%lu,%lu%c", (unsigned long)degNum, (unsigned long)minNum, (unsigned long)secNum, ref );	// AUDIT: Using sizeof(buffer is safe.
 		
 		} else {
 		
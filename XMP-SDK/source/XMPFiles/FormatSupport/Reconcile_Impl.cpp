@@ -167,9 +167,54 @@ bool ReconcileUtils::IsUTF8 ( const void * utf8Ptr, size_t utf8Len )
 
 #elif XMP_UNIXBuild
 
-	#error "UTF8ToHostEncoding is not implemented for UNIX"
-	// *** A nice definition of Windows 1252 is at http://www.microsoft.com/globaldev/reference/sbcs/1252.mspx
-	// *** We should code our own conversions for this, and use it for UNIX - unless better POSIX routines exist.
+	// There are no system encoding services to count on for generic UNIX. Windows code page 1252 is
+	// done here by hand, it is also used as the local encoding. A definition of 1252 is at
+	// http://www.microsoft.com/globaldev/reference/sbcs/1252.mspx. The 5 undefined bytes in the
+	// 0x80..0x9F range map to the same C1 control code points, as the Windows conversions do.
+
+	static const XMP_Uns16 kCP1252HighCodes [32] = {
+		0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,		// 0x80 .. 0x87
+		0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,		// 0x88 .. 0x8F
+		0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,		// 0x90 .. 0x97
+		0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178 };	// 0x98 .. 0x9F
+
+	static void UTF8ToCP1252 ( const XMP_Uns8 * utf8Ptr, size_t utf8Len, std::string * cp1252 )
+	{
+		UTF32Unit cp;
+		size_t    utf8Read;
+
+		cp1252->reserve ( utf8Len );	// As good a guess as any.
+
+		while ( utf8Len > 0 ) {
+
+			if ( *utf8Ptr < 0x80 ) {
+				cp1252->append ( 1, (char)*utf8Ptr );
+				++utf8Ptr;
+				--utf8Len;
+				continue;
+			}
+
+			CodePoint_from_UTF8 ( utf8Ptr, utf8Len, &cp, &utf8Read );
+			if ( utf8Read == 0 ) break;	// Make sure forward progress happens.
+			utf8Ptr += utf8Read;
+			utf8Len -= utf8Read;
+
+			XMP_Uns8 cpByte = '?';	// Used for characters that 1252 can't represent.
+			if ( (cp >= 0xA0) && (cp <= 0xFF) ) {
+				cpByte = (XMP_Uns8)cp;
+			} else {
+				for ( size_t i = 0; i < 32; ++i ) {
+					if ( cp == kCP1252HighCodes[i] ) {
+						cpByte = (XMP_Uns8)(0x80 + i);
+						break;
+					}
+				}
+			}
+			cp1252->append ( 1, (char)cpByte );
+
+		}
+
+	}	// UTF8ToCP1252
 
 #endif
 
@@ -205,7 +250,7 @@ void ReconcileUtils::UTF8ToLocal ( const void * _utf8Ptr, size_t utf8Len, std::s
 	
 	#elif XMP_UNIXBuild
 	
-		#error "UTF8ToLocal is not implemented for UNIX"
+		UTF8ToCP1252 ( utf8Ptr, utf8Len, local );
 	
 	#endif
 
@@ -242,7 +287,7 @@ void ReconcileUtils::UTF8ToLatin1 ( const void * _utf8Ptr, size_t utf8Len, std::
 	
 	#elif XMP_UNIXBuild
 	
-		#error "UTF8ToLatin1 is not implemented for UNIX"
+		UTF8ToCP1252 ( utf8Ptr, utf8Len, latin1 );
 	
 	#endif
 
@@ -316,7 +361,29 @@ void ReconcileUtils::UTF8ToLatin1 ( const void * _utf8Ptr, size_t utf8Len, std::
 
 #elif XMP_UNIXBuild
 
-	#error "HostEncodingToUTF8 is not implemented for UNIX"
+	static void CP1252ToUTF8 ( const XMP_Uns8 * cp1252Ptr, size_t cp1252Len, std::string * utf8 )
+	{
+		UTF8Unit buffer [8];
+		size_t   utf8Written;
+
+		utf8->reserve ( cp1252Len );	// As good a guess as any.
+
+		for ( ; cp1252Len > 0; --cp1252Len, ++cp1252Ptr ) {
+
+			XMP_Uns8 cpByte = *cp1252Ptr;
+			if ( cpByte < 0x80 ) {
+				utf8->append ( 1, (char)cpByte );
+				continue;
+			}
+
+			UTF32Unit cp = cpByte;
+			if ( cpByte < 0xA0 ) cp = kCP1252HighCodes [cpByte - 0x80];
+			CodePoint_to_UTF8 ( cp, buffer, sizeof(buffer), &utf8Written );
+			utf8->append ( (const char *)buffer, utf8Written );
+
+		}
+
+	}	// CP1252ToUTF8
 
 #endif
 
@@ -351,7 +418,7 @@ void ReconcileUtils::LocalToUTF8 ( const void * _localPtr, size_t localLen, std:
 
 	#elif XMP_UNIXBuild
 	
-		#error "LocalToUTF8 is not implemented for UNIX"
+		CP1252ToUTF8 ( localPtr, localLen, utf8 );
 	
 	#endif
 
@@ -388,7 +455,7 @@ void ReconcileUtils::Latin1ToUTF8 ( const void * _latin1Ptr, size_t latin1Len, s
 
 	#elif XMP_UNIXBuild
 	
-		#error "Latin1ToUTF8 is not implemented for UNIX"
+		CP1252ToUTF8 ( latin1Ptr, latin1Len, utf8 );
 	
 	#endif
 
@@ -14,10 +14,11 @@
 /// \brief TIFF_FileWriter is used for memory-based read-write access and all file-based access.
 ///
 /// \c TIFF_FileWriter is used for memory-based read-write access and all file-based access. The
-/// main internal data structure is the InternalTagMap, a std::map that uses the tag number as the
+/// main internal data structure is the InternalTagMap, a FlatMap that uses the tag number as the
 /// key and InternalTagInfo as the value. There are 5 of these maps, one for each of the recognized
 /// IFDs. The maps contain an entry for each tag in the IFD, whether we capture the data or not. The
-/// dataPtr and dataLen fields in the InternalTagInfo are zero if the tag is not captured.
+/// dataPtr and dataLen fields in the InternalTagInfo are zero if the tag is not captured. The large
+/// values captured by a file parse share one allocation per IFD, the IFD's valuePool.
 // =================================================================================================
 
 // =================================================================================================
@@ -49,8 +50,9 @@ TIFF_FileWriter::TIFF_FileWriter()
 // =================================
 //
 // The InternalTagInfo destructor will deallocate the data for changed tags. It does not know
-// whether they are memory-based or file-based though, so it won't deallocate captured but unchanged
-// file-based tags. Mark those as changed here to make the destructor deallocate them.
+// whether they are memory-based or file-based though, so it won't deallocate file-based tags that
+// were changed and then written by UpdateFileStream. Mark those as changed here to make the
+// destructor deallocate them. Values in the IFD's valuePool are not owned by the tag.
 
 TIFF_FileWriter::~TIFF_FileWriter()
 {
@@ -64,11 +66,13 @@ TIFF_FileWriter::~TIFF_FileWriter()
 
 	if ( this->fileParsed ) {
 		for ( int ifd = 0; ifd < kTIFF_KnownIFDCount; ++ifd ) {
+			const InternalIFDInfo& currIFD ( this->containedIFDs[ifd] );
 			InternalTagMap& currTagMap ( this->containedIFDs[ifd].tagMap );
 			InternalTagMap::iterator tagPos = currTagMap.begin();
 			InternalTagMap::iterator tagEnd = currTagMap.end();
 			for ( ; tagPos != tagEnd; ++tagPos ) {
-				if ( tagPos->second.dataPtr != 0 ) tagPos->second.changed = true;
+				InternalTagInfo& currTag = tagPos->second;
+				if ( (currTag.dataPtr != 0) && (! currIFD.IsPooled ( currTag.dataPtr )) ) currTag.changed = true;
 			}
 		}
 	}
@@ -158,7 +162,7 @@ bool TIFF_FileWriter::GetIFD ( XMP_Uns8 ifd, TagInfoMap* ifdMap ) const
 // TIFF_FileWriter::GetValueOffset
 // ===============================
 
-XMP_Uns32 TIFF_FileWriter::GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const
+XMP_Uns64 TIFF_FileWriter::GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const
 {
 	const InternalTagInfo* thisTag = this->FindTagInIFD ( ifd, id );
 	if ( (thisTag == 0) || (thisTag->origLen == 0) ) return 0;
@@ -196,7 +200,8 @@ bool TIFF_FileWriter::GetTag ( XMP_Uns8 ifd, XMP_Uns16 id, TagInfo* info ) const
 
 void TIFF_FileWriter::SetTag ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns16 type, XMP_Uns32 count, const void* clientPtr ) 
 {
-	if ( (type < kTIFF_ByteType) || (type > kTIFF_LastType) ) XMP_Throw ( "Invalid TIFF tag type", kXMPErr_BadParam );
+	XMP_Uns16 lastType = (this->bigTIFF ? kTIFF_LastBigType : kTIFF_LastType);
+	if ( (type < kTIFF_ByteType) || (type > lastType) || (kTIFF_TypeSizes[type] == 0) ) XMP_Throw ( "Invalid TIFF tag type", kXMPErr_BadParam );
 	size_t typeSize = kTIFF_TypeSizes[type];
 	size_t fullSize = count * typeSize;
 	
@@ -215,12 +220,14 @@ void TIFF_FileWriter::SetTag ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns16 type, XMP_U
 	newTag.changed = true;
 	newTag.dataLen = count * typeSize;
 	
-	if ( newTag.dataLen <= 4 ) {
-		// The data is less than 4 bytes, store it in the dataOrOffset field. Numbers are already flipped.
-		XMP_Assert ( sizeof ( newTag.dataOrOffset ) == 4 );
-		memcpy ( &newTag.dataOrOffset, clientPtr, newTag.dataLen );	// AUDIT: Safe, the length is <= 4.
+	if ( newTag.dataLen <= this->SmallValueLimit() ) {
+		// The data fits in the IFD entry (4 bytes, 8 for BigTIFF), store it in the dataOrOffset
+		// field. Numbers are already flipped.
+		XMP_Assert ( sizeof ( newTag.dataOrOffset ) == 8 );
+		newTag.dataPtr = (XMP_Uns8*) &newTag.dataOrOffset;
+		memcpy ( &newTag.dataOrOffset, clientPtr, newTag.dataLen );	// AUDIT: Safe, the length is <= 8.
 	} else {
-		// The data is more than 4 bytes, make a copy.
+		// The data does not fit in the IFD entry, make a copy.
 		newTag.dataPtr = (XMP_Uns8*) malloc ( newTag.dataLen );
 		if ( newTag.dataPtr == 0 ) XMP_Throw ( "Out of memory", kXMPErr_NoMemory );
 		memcpy ( newTag.dataPtr, clientPtr, newTag.dataLen );	// AUDIT: Safe, malloc'ed newTag.dataLen bytes above.
@@ -257,6 +264,47 @@ void TIFF_FileWriter::DeleteTag ( XMP_Uns8 ifd, XMP_Uns16 id )
 
 }	// TIFF_FileWriter::DeleteTag
 
+// =================================================================================================
+// TIFF_FileWriter::GetIFDPointer
+// ==============================
+//
+// Get the offset from one of the tags that point to the Exif, GPS, or Interoperability IFD. These
+// are type LONG with a count of 1 in classic TIFF. BigTIFF writers may also use LONG8 or IFD8.
+
+bool TIFF_FileWriter::GetIFDPointer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns64* offset ) const
+{
+	const InternalTagInfo* thisTag = this->FindTagInIFD ( ifd, id );
+	if ( (thisTag == 0) || (thisTag->count != 1) ) return false;
+	
+	if ( (thisTag->type == kTIFF_LongType) || (thisTag->type == kTIFF_IFDType) ) {
+		*offset = this->GetUns32 ( &thisTag->dataOrOffset );
+	} else if ( this->bigTIFF && ((thisTag->type == kTIFF_Long8Type) || (thisTag->type == kTIFF_IFD8Type)) ) {
+		*offset = this->GetUns64 ( &thisTag->dataOrOffset );
+	} else {
+		return false;
+	}
+	
+	return true;
+
+}	// TIFF_FileWriter::GetIFDPointer
+
+// =================================================================================================
+// TIFF_FileWriter::SetIFDPointer
+// ==============================
+
+void TIFF_FileWriter::SetIFDPointer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns64 offset )
+{
+	if ( ! this->bigTIFF ) {
+		XMP_Assert ( (offset >> 32) == 0 );
+		this->SetTag_Long ( ifd, id, (XMP_Uns32)offset );
+	} else {
+		XMP_Uns64 streamOffset;
+		this->PutUns64 ( offset, &streamOffset );
+		this->SetTag ( ifd, id, kTIFF_IFD8Type, 1, &streamOffset );
+	}
+
+}	// TIFF_FileWriter::SetIFDPointer
+
 // =================================================================================================
 // TIFF_FileWriter::GetTag_Integer
 // ===============================
@@ -557,14 +605,17 @@ void TIFF_FileWriter::ParseMemoryStream ( const void* data, XMP_Uns32 length, bo
 		this->memStream = (XMP_Uns8*) malloc(length);
 		if ( this->memStream == 0 ) XMP_Throw ( "Out of memory", kXMPErr_NoMemory );
 		memcpy ( this->memStream, data, length );	// AUDIT: Safe, malloc'ed length bytes above.
+		this->ownedStream = true;
 	}
 	this->tiffLength = length;
 
 	// Find and process the primary, Exif, GPS, and Interoperability IFDs.
 	
-	XMP_Uns32 primaryIFDOffset = this->CheckTIFFHeader ( this->memStream, length );
+	XMP_Uns32 primaryIFDOffset = (XMP_Uns32) this->CheckTIFFHeader ( this->memStream, length );
 	XMP_Uns32 tnailIFDOffset   = 0;
 	
+	if ( this->bigTIFF ) XMP_Throw ( "BigTIFF is only supported for file-based TIFF", kXMPErr_BadTIFF );
+	
 	if ( primaryIFDOffset != 0 ) tnailIFDOffset = this->ProcessMemoryIFD ( primaryIFDOffset, kTIFF_PrimaryIFD );
 
 	const InternalTagInfo* exifIFDTag = this->FindTagInIFD ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer );
@@ -604,13 +655,13 @@ void TIFF_FileWriter::ParseMemoryStream ( const void* data, XMP_Uns32 length, bo
 			InternalIFDInfo & thisIFD = this->containedIFDs[ifd];
 			printf ( "\n   IFD %d, count %d, mapped %d, offset %d (0x%X), next IFD %d (0x%X)\n",
 					 ifd, thisIFD.origCount, thisIFD.tagMap.size(),
-					 thisIFD.origOffset, thisIFD.origOffset, thisIFD.origNextIFD, thisIFD.origNextIFD );
+					 (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origNextIFD, (XMP_Uns32)thisIFD.origNextIFD );
 			InternalTagMap::iterator tagPos;
 			InternalTagMap::iterator tagEnd = thisIFD.tagMap.end();
 			for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
 				InternalTagInfo & thisTag = tagPos->second;
 				printf ( "      Tag %d, dataOrOffset 0x%X, origLen %d, origOffset %d (0x%X)\n",
-						 thisTag.id, thisTag.dataOrOffset, thisTag.origLen, thisTag.origOffset, thisTag.origOffset );
+						 thisTag.id, (XMP_Uns32)thisTag.dataOrOffset, thisTag.origLen, (XMP_Uns32)thisTag.origOffset, (XMP_Uns32)thisTag.origOffset );
 			}
 		}
 		printf ( "\n" );
@@ -640,6 +691,7 @@ XMP_Uns32 TIFF_FileWriter::ProcessMemoryIFD ( XMP_Uns32 ifdOffset, XMP_Uns8 ifd
 	
 	ifdInfo.origOffset = ifdOffset;
 	ifdInfo.origCount  = tagCount;
+	ifdInfo.tagMap.reserve ( tagCount );
 	
 	for ( size_t i = 0; i < tagCount; ++i ) {
 	
@@ -648,7 +700,7 @@ XMP_Uns32 TIFF_FileWriter::ProcessMemoryIFD ( XMP_Uns32 ifdOffset, XMP_Uns8 ifd
 		if ( (mapTag.type < kTIFF_ByteType) || (mapTag.type > kTIFF_LastType) ) continue;	// Bad type, skip this tag.
 
 		mapTag.dataLen = mapTag.origLen = mapTag.count * kTIFF_TypeSizes[mapTag.type];
-		mapTag.dataOrOffset = rawTag->dataOrOffset;	// Keep the value or offset in stream byte ordering.
+		memcpy ( &mapTag.dataOrOffset, &rawTag->dataOrOffset, 4 );	// Keep the value or offset in stream byte ordering.
 
 		if ( mapTag.dataLen <= 4 ) {
 			mapTag.dataPtr = (XMP_Uns8*) &mapTag.dataOrOffset;
@@ -692,7 +744,7 @@ static XMP_Uns8* CaptureJPEGTNail ( LFA_FileRef fileRef, IOBuffer* ioBuf, const
 	
 	try {
 	
-		if ( jpegLen > kIOBufferSize ) {
+		if ( jpegLen > ioBuf->size ) {
 			// This value is bigger than the I/O buffer, read it directly and restore the file position.
 			LFA_Seek ( fileRef, jpegOffset, SEEK_SET );
 			LFA_Read ( fileRef, jpegPtr, jpegLen, kLFA_RequireAll );
@@ -732,35 +784,36 @@ void TIFF_FileWriter::ParseFileStream ( LFA_FileRef fileRef )
 
 	this->DeleteExistingInfo();
 	this->fileParsed = true;
-	this->tiffLength = (XMP_Uns32) LFA_Measure ( fileRef );
+	this->tiffLength = LFA_Measure ( fileRef );
 	if ( this->tiffLength == 0 ) return;
 	
-	// Find and process the primary, Exif, GPS, and Interoperability IFDs.
+	// Find and process the primary, Exif, GPS, and Interoperability IFDs. A BigTIFF header is 16
+	// bytes, a classic header is 8. CheckTIFFHeader looks at the version before the offset.
 	
 	ioBuf.filePos = LFA_Seek ( fileRef, 0, SEEK_SET );
-	ok = CheckFileSpace ( fileRef, &ioBuf, 8 );
+	ok = CheckFileSpace ( fileRef, &ioBuf, ((this->tiffLength >= kEmptyBigTIFFLength) ? kEmptyBigTIFFLength : 8) );
 	if ( ! ok ) XMP_Throw ( "TIFF too small", kXMPErr_BadTIFF );
 		
-	XMP_Uns32 primaryIFDOffset = this->CheckTIFFHeader ( ioBuf.ptr, this->tiffLength );
-	XMP_Uns32 tnailIFDOffset   = 0;
+	XMP_Uns64 primaryIFDOffset = this->CheckTIFFHeader ( ioBuf.ptr, this->tiffLength );
+	XMP_Uns64 tnailIFDOffset   = 0;
 	
 	if ( primaryIFDOffset != 0 ) tnailIFDOffset = this->ProcessFileIFD ( kTIFF_PrimaryIFD, primaryIFDOffset, fileRef, &ioBuf );
 
-	const InternalTagInfo* exifIFDTag = this->FindTagInIFD ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer );
-	if ( (exifIFDTag != 0) && (exifIFDTag->type == kTIFF_LongType) && (exifIFDTag->count == 1) ) {
-		XMP_Uns32 exifOffset = this->GetUns32 ( &exifIFDTag->dataOrOffset );
-		(void) this->ProcessFileIFD ( kTIFF_ExifIFD, exifOffset, fileRef, &ioBuf );
-	}
+	// Get the Exif and GPS IFD offsets up front and start reading both, so the GPS I/O overlaps the
+	// Exif processing. The prefetch is skipped if the IFD is already in the I/O buffer.
 
-	const InternalTagInfo* gpsIFDTag = this->FindTagInIFD ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer );
-	if ( (gpsIFDTag != 0) && (gpsIFDTag->type == kTIFF_LongType) && (gpsIFDTag->count == 1) ) {
-		XMP_Uns32 gpsOffset = this->GetUns32 ( &gpsIFDTag->dataOrOffset );
-		(void) this->ProcessFileIFD ( kTIFF_GPSInfoIFD, gpsOffset, fileRef, &ioBuf );
-	}
+	XMP_Uns64 exifOffset = 0, gpsOffset = 0, interopOffset = 0;
 
-	const InternalTagInfo* interopIFDTag = this->FindTagInIFD ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer );
-	if ( (interopIFDTag != 0) && (interopIFDTag->type == kTIFF_LongType) && (interopIFDTag->dataLen == 4) ) {
-		XMP_Uns32 interopOffset = this->GetUns32 ( &interopIFDTag->dataOrOffset );
+	bool haveExif = this->GetIFDPointer ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer, &exifOffset );
+	if ( haveExif ) PrefetchRange ( fileRef, exifOffset, ioBuf.size, &ioBuf );
+
+	bool haveGPS = this->GetIFDPointer ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer, &gpsOffset );
+	if ( haveGPS ) PrefetchRange ( fileRef, gpsOffset, ioBuf.size, &ioBuf );
+
+	if ( haveExif ) (void) this->ProcessFileIFD ( kTIFF_ExifIFD, exifOffset, fileRef, &ioBuf );
+	if ( haveGPS ) (void) this->ProcessFileIFD ( kTIFF_GPSInfoIFD, gpsOffset, fileRef, &ioBuf );
+
+	if ( this->GetIFDPointer ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer, &interopOffset ) ) {
 		(void) this->ProcessFileIFD ( kTIFF_InteropIFD, interopOffset, fileRef, &ioBuf );
 	}
 	
@@ -779,13 +832,13 @@ void TIFF_FileWriter::ParseFileStream ( LFA_FileRef fileRef )
 			InternalIFDInfo & thisIFD = this->containedIFDs[ifd];
 			printf ( "\n   IFD %d, count %d, mapped %d, offset %d (0x%X), next IFD %d (0x%X)\n",
 					 ifd, thisIFD.origCount, thisIFD.tagMap.size(),
-					 thisIFD.origOffset, thisIFD.origOffset, thisIFD.origNextIFD, thisIFD.origNextIFD );
+					 (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origNextIFD, (XMP_Uns32)thisIFD.origNextIFD );
 			InternalTagMap::iterator tagPos;
 			InternalTagMap::iterator tagEnd = thisIFD.tagMap.end();
 			for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
 				InternalTagInfo & thisTag = tagPos->second;
 				printf ( "      Tag %d, dataOrOffset 0x%X, origLen %d, origOffset %d (0x%X)\n",
-						 thisTag.id, thisTag.dataOrOffset, thisTag.origLen, thisTag.origOffset, thisTag.origOffset );
+						 thisTag.id, (XMP_Uns32)thisTag.dataOrOffset, thisTag.origLen, (XMP_Uns32)thisTag.origOffset, (XMP_Uns32)thisTag.origOffset );
 			}
 		}
 		printf ( "\n" );
@@ -798,59 +851,83 @@ void TIFF_FileWriter::ParseFileStream ( LFA_FileRef fileRef )
 // TIFF_FileWriter::ProcessFileIFD
 // ===============================
 
-XMP_Uns32 TIFF_FileWriter::ProcessFileIFD ( XMP_Uns8 ifd, XMP_Uns32 ifdOffset, LFA_FileRef fileRef, IOBuffer* ioBuf ) 
+XMP_Uns64 TIFF_FileWriter::ProcessFileIFD ( XMP_Uns8 ifd, XMP_Uns64 ifdOffset, LFA_FileRef fileRef, IOBuffer* ioBuf ) 
 {
 	InternalIFDInfo& ifdInfo ( this->containedIFDs[ifd] );
 	
+	// A classic IFD has a 2 byte count, 12 byte entries, and a 4 byte next IFD offset. A BigTIFF
+	// IFD has an 8 byte count, 20 byte entries, and an 8 byte next IFD offset.
+
+	const size_t countSize  = (this->bigTIFF ? 8 : 2);
+	const size_t entrySize  = (this->bigTIFF ? kBigIFDEntryLength : 12);
+	const size_t offsetSize = (this->bigTIFF ? 8 : 4);
+	const size_t smallLimit = this->SmallValueLimit();
+	
 	MoveToOffset ( fileRef, ifdOffset, ioBuf );	// Move to the start of the IFD.
 	
-	bool ok = CheckFileSpace ( fileRef, ioBuf, 2 );
+	bool ok = CheckFileSpace ( fileRef, ioBuf, countSize );
 	if ( ! ok ) XMP_Throw ( "IFD count missing", kXMPErr_BadTIFF );
-	XMP_Uns16 tagCount = this->GetUns16 ( ioBuf->ptr );
+	XMP_Uns64 fullCount = (this->bigTIFF ? this->GetUns64 ( ioBuf->ptr ) : this->GetUns16 ( ioBuf->ptr ));
 
-	if ( tagCount >= 0x8000 ) XMP_Throw ( "Outrageous IFD count", kXMPErr_BadTIFF );
-	if ( (ifdOffset + 2 + tagCount*12 + 4) > this->tiffLength ) XMP_Throw ( "Out of bounds IFD", kXMPErr_BadTIFF );
+	if ( fullCount >= 0x8000 ) XMP_Throw ( "Outrageous IFD count", kXMPErr_BadTIFF );
+	XMP_Uns16 tagCount = (XMP_Uns16)fullCount;
+	if ( (ifdOffset > this->tiffLength) ||
+		 ((countSize + tagCount*entrySize + offsetSize) > (this->tiffLength - ifdOffset)) ) {
+		XMP_Throw ( "Out of bounds IFD", kXMPErr_BadTIFF );
+	}
 	
 	ifdInfo.origOffset = ifdOffset;
 	ifdInfo.origCount  = tagCount;
+	ifdInfo.tagMap.reserve ( tagCount );
 	
 	// ---------------------------------------------------------------------------------------------
 	// First create all of the IFD map entries, capturing short values, and get the next IFD offset.
-	// We're using a std::map for storage, it automatically eliminates duplicates and provides
+	// We're using a FlatMap for storage, it automatically eliminates duplicates and provides
 	// sorted output. Plus the "map[key] = value" assignment conveniently keeps the last encountered
-	// value, following Photoshop's behavior.
+	// value, following Photoshop's behavior. The tags are normally in order, so entries are appended.
 
-	ioBuf->ptr += 2;	// Move to the first IFD entry.
+	ioBuf->ptr += countSize;	// Move to the first IFD entry.
+	
+	const XMP_Uns16 lastType = (this->bigTIFF ? kTIFF_LastBigType : kTIFF_LastType);
 	
-	for ( XMP_Uns16 i = 0; i < tagCount; ++i, ioBuf->ptr += 12 ) {
+	for ( XMP_Uns16 i = 0; i < tagCount; ++i, ioBuf->ptr += entrySize ) {
 	
-		if ( ! CheckFileSpace ( fileRef, ioBuf, 12 ) ) XMP_Throw ( "EOF within IFD", kXMPErr_BadTIFF );
+		if ( ! CheckFileSpace ( fileRef, ioBuf, entrySize ) ) XMP_Throw ( "EOF within IFD", kXMPErr_BadTIFF );
 		
-		RawIFDEntry*    rawTag = (RawIFDEntry*)ioBuf->ptr;
-		InternalTagInfo mapTag ( this->GetUns16(&rawTag->id), this->GetUns16(&rawTag->type), this->GetUns32(&rawTag->count) );
-		if ( (mapTag.type < kTIFF_ByteType) || (mapTag.type > kTIFF_LastType) ) continue;	// Bad type, skip this tag.
+		const XMP_Uns8* entryPtr = (XMP_Uns8*)ioBuf->ptr;
+		XMP_Uns16 type = this->GetUns16 ( entryPtr + 2 );
+		if ( (type < kTIFF_ByteType) || (type > lastType) || (kTIFF_TypeSizes[type] == 0) ) continue;	// Bad type, skip this tag.
+
+		XMP_Uns64 count = (this->bigTIFF ? this->GetUns64 ( entryPtr + 4 ) : this->GetUns32 ( entryPtr + 4 ));
+		if ( count > (0xFFFFFFFFUL / kTIFF_TypeSizes[type]) ) continue;	// Value length overflows, skip this tag.
 
+		InternalTagInfo mapTag ( this->GetUns16 ( entryPtr ), type, (XMP_Uns32)count );
 		mapTag.dataLen = mapTag.origLen = mapTag.count * kTIFF_TypeSizes[mapTag.type];
-		mapTag.dataOrOffset = rawTag->dataOrOffset;	// Keep the value or offset in stream byte ordering.
+		
+		// Keep the value or offset in stream byte ordering.
+		const XMP_Uns8* valuePtr = entryPtr + (this->bigTIFF ? 12 : 8);
+		memcpy ( &mapTag.dataOrOffset, valuePtr, offsetSize );	// AUDIT: Safe, dataOrOffset is 8 bytes.
 
-		if ( mapTag.dataLen <= 4 ) {
+		if ( mapTag.dataLen <= smallLimit ) {
 			mapTag.dataPtr = (XMP_Uns8*) &mapTag.dataOrOffset;
-			mapTag.origOffset = ifdOffset + 2 + (12 * i);	// Compute the data offset.
+			mapTag.origOffset = ifdOffset + countSize + (entrySize * i);	// Compute the data offset.
 		} else {
-			mapTag.origOffset = this->GetUns32 ( &rawTag->dataOrOffset );	// Extract the data offset.
+			mapTag.origOffset = this->GetOffset ( valuePtr );	// Extract the data offset.
 		}
 		ifdInfo.tagMap[mapTag.id] = mapTag;
 	
 	}
 	
-	if ( ! CheckFileSpace ( fileRef, ioBuf, 4 ) ) XMP_Throw ( "EOF at next IFD offset", kXMPErr_BadTIFF );
-	ifdInfo.origNextIFD = this->GetUns32 ( ioBuf->ptr );
+	if ( ! CheckFileSpace ( fileRef, ioBuf, offsetSize ) ) XMP_Throw ( "EOF at next IFD offset", kXMPErr_BadTIFF );
+	ifdInfo.origNextIFD = this->GetOffset ( ioBuf->ptr );
 	
 	// ---------------------------------------------------------------------------------------------
 	// Go back over the tag map and extract the data for large recognized tags. This is done in 2
 	// passes, in order to lessen the typical amount of I/O. On the first pass make sure we have at
 	// least 32K of data following the IFD in the buffer, and extract all of the values in that
 	// portion. This should cover an original file, or the appended values with an appended IFD.
+	//
+	// The values are copied into the IFD's valuePool, sized here for all of the captured values.
 	
 	if ( (ioBuf->limit - ioBuf->ptr) < 32*1024 ) RefillBuffer ( fileRef, ioBuf );
 	
@@ -859,14 +936,46 @@ XMP_Uns32 TIFF_FileWriter::ProcessFileIFD ( XMP_Uns8 ifd, XMP_Uns32 ifdOffset, L
 	
 	const XMP_Uns16* knownTagPtr = sKnownTags[ifd];	// Points into the ordered recognized tag list.
 	
-	XMP_Uns32 bufBegin = (XMP_Uns32)ioBuf->filePos;	// TIFF stream bounds for the current buffer.
-	XMP_Uns32 bufEnd   = bufBegin + ioBuf->len;
+	size_t poolSize = 0;
+
+	for ( ; tagPos != tagEnd; ++tagPos ) {
+		const InternalTagInfo* currTag = &tagPos->second;
+		if ( currTag->dataLen <= smallLimit ) continue;
+		while ( *knownTagPtr < currTag->id ) ++knownTagPtr;
+		if ( *knownTagPtr != currTag->id ) continue;
+		if ( currTag->dataLen > 1024*1024 ) XMP_Throw ( "Outrageous data length", kXMPErr_BadTIFF );
+		poolSize += currTag->dataLen;
+	}
+	
+	ifdInfo.valuePool.resize ( poolSize );
+	XMP_Uns8* poolPtr = (poolSize == 0) ? 0 : &ifdInfo.valuePool[0];
+
+	tagPos = ifdInfo.tagMap.begin();	// Reset both map/array positions.
+	knownTagPtr = sKnownTags[ifd];
+	
+	// Before the first pass, start reading any values that the second pass will need. The OS can
+	// then fetch them while the in-buffer values are being copied.
+
+	for ( ; tagPos != tagEnd; ++tagPos ) {
+		const InternalTagInfo* currTag = &tagPos->second;
+		if ( currTag->dataLen <= smallLimit ) continue;
+		while ( *knownTagPtr < currTag->id ) ++knownTagPtr;
+		if ( *knownTagPtr != currTag->id ) continue;
+		if ( (currTag->dataLen > 1024*1024) || ((currTag->origOffset + currTag->dataLen) > this->tiffLength) ) continue;
+		PrefetchRange ( fileRef, currTag->origOffset, currTag->dataLen, ioBuf );
+	}
+	
+	tagPos = ifdInfo.tagMap.begin();	// Reset both map/array positions.
+	knownTagPtr = sKnownTags[ifd];
+	
+	XMP_Uns64 bufBegin = ioBuf->filePos;	// TIFF stream bounds for the current buffer.
+	XMP_Uns64 bufEnd   = bufBegin + ioBuf->len;
 	
 	for ( ; tagPos != tagEnd; ++tagPos ) {
 	
 		InternalTagInfo* currTag = &tagPos->second;
 
-		if ( currTag->dataLen <= 4 ) continue;	// Short values are already in the dataOrOffset field.
+		if ( currTag->dataLen <= smallLimit ) continue;	// Short values are already in the dataOrOffset field.
 		while ( *knownTagPtr < currTag->id ) ++knownTagPtr;
 		if ( *knownTagPtr != currTag->id ) continue;	// Skip unrecognized tags.
 		if ( currTag->dataLen > 1024*1024 ) XMP_Throw ( "Outrageous data length", kXMPErr_BadTIFF );
@@ -874,9 +983,9 @@ XMP_Uns32 TIFF_FileWriter::ProcessFileIFD ( XMP_Uns8 ifd, XMP_Uns32 ifdOffset, L
 		if ( (bufBegin <= currTag->origOffset) && ((currTag->origOffset + currTag->dataLen) <= bufEnd) ) {
 			// This value is already fully within the current I/O buffer, copy it.
 			MoveToOffset ( fileRef, currTag->origOffset, ioBuf );
-			currTag->dataPtr = (XMP_Uns8*) malloc ( currTag->dataLen );
-			if ( currTag->dataPtr == 0 ) XMP_Throw ( "No data block", kXMPErr_NoMemory );
-			memcpy ( currTag->dataPtr, ioBuf->ptr, currTag->dataLen );	// AUDIT: Safe, malloc'ed currTag->dataLen bytes above.
+			currTag->dataPtr = poolPtr;
+			poolPtr += currTag->dataLen;
+			memcpy ( currTag->dataPtr, ioBuf->ptr, currTag->dataLen );	// AUDIT: Safe, the pool has room for all values.
 		}
 	
 	}
@@ -892,15 +1001,15 @@ XMP_Uns32 TIFF_FileWriter::ProcessFileIFD ( XMP_Uns8 ifd, XMP_Uns32 ifdOffset, L
 	
 		InternalTagInfo* currTag = &tagPos->second;
 
-		if ( (currTag->dataLen <= 4) || (currTag->dataPtr != 0) ) continue;	// Done this tag?
+		if ( (currTag->dataLen <= smallLimit) || (currTag->dataPtr != 0) ) continue;	// Done this tag?
 		while ( *knownTagPtr < currTag->id ) ++knownTagPtr;
 		if ( *knownTagPtr != currTag->id ) continue;	// Skip unrecognized tags.
 		if ( currTag->dataLen > 1024*1024 ) XMP_Throw ( "Outrageous data length", kXMPErr_BadTIFF );
 
-		currTag->dataPtr = (XMP_Uns8*) malloc ( currTag->dataLen );
-		if ( currTag->dataPtr == 0 ) XMP_Throw ( "No data block", kXMPErr_NoMemory );
+		currTag->dataPtr = poolPtr;
+		poolPtr += currTag->dataLen;
 		
-		if ( currTag->dataLen > kIOBufferSize ) {
+		if ( currTag->dataLen > ioBuf->size ) {
 			// This value is bigger than the I/O buffer, read it directly and restore the file position.
 			LFA_Seek ( fileRef, currTag->origOffset, SEEK_SET );
 			LFA_Read ( fileRef, currTag->dataPtr, currTag->dataLen, kLFA_RequireAll );
@@ -910,11 +1019,13 @@ XMP_Uns32 TIFF_FileWriter::ProcessFileIFD ( XMP_Uns8 ifd, XMP_Uns32 ifdOffset, L
 			MoveToOffset ( fileRef, currTag->origOffset, ioBuf );
 			ok = CheckFileSpace ( fileRef, ioBuf, currTag->dataLen );
 			if ( ! ok ) XMP_Throw ( "EOF in data block", kXMPErr_BadTIFF );
-			memcpy ( currTag->dataPtr, ioBuf->ptr, currTag->dataLen );	// AUDIT: Safe, malloc'ed currTag->dataLen bytes above.
+			memcpy ( currTag->dataPtr, ioBuf->ptr, currTag->dataLen );	// AUDIT: Safe, the pool has room for all values.
 		}
 		
 	}
 	
+	XMP_Assert ( (poolSize == 0) || (poolPtr == (&ifdInfo.valuePool[0] + poolSize)) );
+	
 	// Done, return the next IFD offset.
 	
 	return ifdInfo.origNextIFD;
@@ -955,7 +1066,7 @@ void* TIFF_FileWriter::CopyTagToMasterIFD ( const TagInfo & ps6Tag, InternalIFDI
 	
 	if ( newTag.dataLen <= 4 ) {
 		newTag.dataPtr = (XMP_Uns8*) &newTag.dataOrOffset;
-		newTag.dataOrOffset = *((XMP_Uns32*)ps6Tag.dataPtr);
+		memcpy ( &newTag.dataOrOffset, ps6Tag.dataPtr, newTag.dataLen );	// AUDIT: Safe, the length is <= 4.
 	} else {
 		XMP_Assert ( newTag.dataOrOffset == 0 );
 		newTag.dataPtr = (XMP_Uns8*) malloc ( newTag.dataLen );
@@ -1174,9 +1285,9 @@ void TIFF_FileWriter::ProcessPShop6IFD ( const TIFF_MemoryReader& buriedExif, XM
 	#define Trace_DetermineAppendInfo 0
 #endif
 
-XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
+XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns64 appendedOrigin,
 												 bool      appendedIFDs[kTIFF_KnownIFDCount],
-												 XMP_Uns32 newIFDOffsets[kTIFF_KnownIFDCount],
+												 XMP_Uns64 newIFDOffsets[kTIFF_KnownIFDCount],
 												 bool      appendAll /* = false */ )
 {
 	XMP_Uns32 appendedLength = 0;
@@ -1189,7 +1300,7 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 			InternalIFDInfo & thisIFD = this->containedIFDs[ifd];
 			printf ( "\n   IFD %d, origCount %d, map.size %d, origOffset %d (0x%X), origNextIFD %d (0x%X)",
 					 ifd, thisIFD.origCount, thisIFD.tagMap.size(),
-					 thisIFD.origOffset, thisIFD.origOffset, thisIFD.origNextIFD, thisIFD.origNextIFD );
+					 (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origNextIFD, (XMP_Uns32)thisIFD.origNextIFD );
 			if ( thisIFD.changed ) printf ( ", changed" );
 			if ( thisIFD.origCount < thisIFD.tagMap.size() ) printf ( ", should get appended" );
 			printf ( "\n" );
@@ -1198,9 +1309,9 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 			for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
 				InternalTagInfo & thisTag = tagPos->second;
 				printf ( "      Tag %d, dataOrOffset 0x%X, origLen %d, origOffset %d (0x%X)",
-						 thisTag.id, thisTag.dataOrOffset, thisTag.origLen, thisTag.origOffset, thisTag.origOffset );
+						 thisTag.id, (XMP_Uns32)thisTag.dataOrOffset, thisTag.origLen, (XMP_Uns32)thisTag.origOffset, (XMP_Uns32)thisTag.origOffset );
 				if ( thisTag.changed ) printf ( ", changed" );
-				if ( (thisTag.dataLen > thisTag.origLen) && (thisTag.dataLen > 4) ) printf ( ", should get appended" );
+				if ( (thisTag.dataLen > thisTag.origLen) && (thisTag.dataLen > this->SmallValueLimit()) ) printf ( ", should get appended" );
 				printf ( "\n" );
 			}
 		}
@@ -1221,19 +1332,19 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 	appendedIFDs[kTIFF_InteropIFD] |= (this->containedIFDs[kTIFF_InteropIFD].origCount <
 									   this->containedIFDs[kTIFF_InteropIFD].tagMap.size());
 	if ( appendedIFDs[kTIFF_InteropIFD] ) {
-		this->SetTag_Long ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer, 0xABADABAD );
+		this->SetIFDPointer ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer, 0xABADABAD );
 	}
 	
 	appendedIFDs[kTIFF_GPSInfoIFD] |= (this->containedIFDs[kTIFF_GPSInfoIFD].origCount <
 									   this->containedIFDs[kTIFF_GPSInfoIFD].tagMap.size());
 	if ( appendedIFDs[kTIFF_GPSInfoIFD] ) {
-		this->SetTag_Long ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer, 0xABADABAD );
+		this->SetIFDPointer ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer, 0xABADABAD );
 	}
 	
 	appendedIFDs[kTIFF_ExifIFD] |= (this->containedIFDs[kTIFF_ExifIFD].origCount <
 								    this->containedIFDs[kTIFF_ExifIFD].tagMap.size());
 	if ( appendedIFDs[kTIFF_ExifIFD] ) {
-		this->SetTag_Long ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer, 0xABADABAD );
+		this->SetIFDPointer ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer, 0xABADABAD );
 	}
 	
 	appendedIFDs[kTIFF_TNailIFD] |= (this->containedIFDs[kTIFF_TNailIFD].origCount <
@@ -1257,7 +1368,7 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 		newIFDOffsets[ifd] = ifdInfo.origOffset;
 		if ( appendedIFDs[ifd] ) {
 			newIFDOffsets[ifd] = appendedOrigin + appendedLength;
-			appendedLength += 6 + (12 * tagCount);
+			appendedLength += (XMP_Uns32) this->IFDLength ( tagCount );
 		}
 		
 		InternalTagMap::iterator tagPos = ifdInfo.tagMap.begin();
@@ -1266,12 +1377,12 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 		for ( ; tagPos != tagEnd; ++tagPos ) {
 
 			InternalTagInfo & currTag ( tagPos->second );
-			if ( (! (appendAll | currTag.changed)) || (currTag.dataLen <= 4) ) continue;
+			if ( (! (appendAll | currTag.changed)) || (currTag.dataLen <= this->SmallValueLimit()) ) continue;
 
 			if ( (currTag.dataLen <= currTag.origLen) && (! appendAll) ) {
-				this->PutUns32 ( currTag.origOffset, &currTag.dataOrOffset );	// Reuse the old space.
+				this->PutOffset ( currTag.origOffset, &currTag.dataOrOffset );	// Reuse the old space.
 			} else {
-				this->PutUns32 ( (appendedOrigin + appendedLength), &currTag.dataOrOffset );	// Set the appended offset.
+				this->PutOffset ( (appendedOrigin + appendedLength), &currTag.dataOrOffset );	// Set the appended offset.
 				appendedLength += ((currTag.dataLen + 1) & 0xFFFFFFFEUL);	// Round to an even size.
 			}
 
@@ -1282,13 +1393,13 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 	// If the Exif, GPS, or Interoperability IFDs get appended, update the tag values for their new offsets.
 	
 	if ( appendedIFDs[kTIFF_ExifIFD] ) {
-		this->SetTag_Long ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer, newIFDOffsets[kTIFF_ExifIFD] );
+		this->SetIFDPointer ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer, newIFDOffsets[kTIFF_ExifIFD] );
 	}
 	if ( appendedIFDs[kTIFF_GPSInfoIFD] ) {
-		this->SetTag_Long ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer, newIFDOffsets[kTIFF_GPSInfoIFD] );
+		this->SetIFDPointer ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer, newIFDOffsets[kTIFF_GPSInfoIFD] );
 	}
 	if ( appendedIFDs[kTIFF_InteropIFD] ) {
-		this->SetTag_Long ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer, newIFDOffsets[kTIFF_InteropIFD] );
+		this->SetIFDPointer ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer, newIFDOffsets[kTIFF_InteropIFD] );
 	}
 	
 	#if Trace_DetermineAppendInfo
@@ -1298,19 +1409,19 @@ XMP_Uns32 TIFF_FileWriter::DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
 			InternalIFDInfo & thisIFD = this->containedIFDs[ifd];
 			printf ( "\n   IFD %d, origCount %d, map.size %d, origOffset %d (0x%X), origNextIFD %d (0x%X)",
 					 ifd, thisIFD.origCount, thisIFD.tagMap.size(),
-					 thisIFD.origOffset, thisIFD.origOffset, thisIFD.origNextIFD, thisIFD.origNextIFD );
+					 (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origNextIFD, (XMP_Uns32)thisIFD.origNextIFD );
 			if ( thisIFD.changed ) printf ( ", changed" );
-			if ( appendedIFDs[ifd] ) printf ( ", will be appended at %d (0x%X)", newIFDOffsets[ifd], newIFDOffsets[ifd] );
+			if ( appendedIFDs[ifd] ) printf ( ", will be appended at %d (0x%X)", (XMP_Uns32)newIFDOffsets[ifd], (XMP_Uns32)newIFDOffsets[ifd] );
 			printf ( "\n" );
 			InternalTagMap::iterator tagPos;
 			InternalTagMap::iterator tagEnd = thisIFD.tagMap.end();
 			for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
 				InternalTagInfo & thisTag = tagPos->second;
 				printf ( "      Tag %d, dataOrOffset 0x%X, origLen %d, origOffset %d (0x%X)",
-						 thisTag.id, thisTag.dataOrOffset, thisTag.origLen, thisTag.origOffset, thisTag.origOffset );
+						 thisTag.id, (XMP_Uns32)thisTag.dataOrOffset, thisTag.origLen, (XMP_Uns32)thisTag.origOffset, (XMP_Uns32)thisTag.origOffset );
 				if ( thisTag.changed ) printf ( ", changed" );
-				if ( (thisTag.dataLen > thisTag.origLen) && (thisTag.dataLen > 4) ) {
-					XMP_Uns32 newOffset = this->GetUns32 ( &thisTag.dataOrOffset );
+				if ( (thisTag.dataLen > thisTag.origLen) && (thisTag.dataLen > this->SmallValueLimit()) ) {
+					XMP_Uns32 newOffset = (XMP_Uns32) this->GetOffset ( &thisTag.dataOrOffset );
 					printf ( ", will be appended at %d (0x%X)", newOffset, newOffset );
 				}
 				printf ( "\n" );
@@ -1347,8 +1458,8 @@ void TIFF_FileWriter::UpdateMemByAppend ( XMP_Uns8** newStream_out, XMP_Uns32* n
 										  bool appendAll /* = false */, XMP_Uns32 extraSpace /* = 0 */ )
 {
 	bool appendedIFDs[kTIFF_KnownIFDCount];
-	XMP_Uns32 newIFDOffsets[kTIFF_KnownIFDCount];
-	XMP_Uns32 appendedOrigin = ((this->tiffLength + 1) & 0xFFFFFFFEUL);	// Start at an even offset.
+	XMP_Uns64 newIFDOffsets[kTIFF_KnownIFDCount];
+	XMP_Uns32 appendedOrigin = (XMP_Uns32) ((this->tiffLength + 1) & 0xFFFFFFFEUL);	// Start at an even offset.
 	XMP_Uns32 appendedLength = DetermineAppendInfo ( appendedOrigin, appendedIFDs, newIFDOffsets, appendAll );
 
 	// Allocate the new block of memory for the full stream. Copy the original stream. Write the
@@ -1403,7 +1514,7 @@ void TIFF_FileWriter::UpdateMemByAppend ( XMP_Uns8** newStream_out, XMP_Uns32* n
 				this->PutUns32 ( currTag.count, ifdPtr );
 				ifdPtr += 4;
 
-				*((XMP_Uns32*)ifdPtr) = currTag.dataOrOffset;
+				memcpy ( ifdPtr, &currTag.dataOrOffset, 4 );	// AUDIT: Safe, 4 bytes left in the IFD entry.
 
 				if ( (appendAll | currTag.changed) && (currTag.dataLen > 4) ) {
 
@@ -1426,7 +1537,7 @@ void TIFF_FileWriter::UpdateMemByAppend ( XMP_Uns8** newStream_out, XMP_Uns32* n
 
 			}
 			
-			this->PutUns32 ( ifdInfo.origNextIFD, ifdPtr );
+			this->PutUns32 ( (XMP_Uns32)ifdInfo.origNextIFD, ifdPtr );
 			ifdPtr += 4;
 		
 		}
@@ -1436,13 +1547,13 @@ void TIFF_FileWriter::UpdateMemByAppend ( XMP_Uns8** newStream_out, XMP_Uns32* n
 		// Back fill the offsets for the primary and thumnbail IFDs, if they are now appended.
 		
 		if ( appendedIFDs[kTIFF_PrimaryIFD] ) {
-			this->PutUns32 ( newIFDOffsets[kTIFF_PrimaryIFD], (newStream + 4) );
+			this->PutUns32 ( (XMP_Uns32)newIFDOffsets[kTIFF_PrimaryIFD], (newStream + 4) );
 		}
 		
 		if ( appendedIFDs[kTIFF_TNailIFD] ) {
 			size_t primaryIFDCount = this->containedIFDs[kTIFF_PrimaryIFD].tagMap.size();
-			XMP_Uns32 tnailRefOffset = newIFDOffsets[kTIFF_PrimaryIFD] + 2 + (12 * primaryIFDCount);
-			this->PutUns32 ( newIFDOffsets[kTIFF_TNailIFD], (newStream + tnailRefOffset) );
+			XMP_Uns32 tnailRefOffset = (XMP_Uns32) (newIFDOffsets[kTIFF_PrimaryIFD] + 2 + (12 * primaryIFDCount));
+			this->PutUns32 ( (XMP_Uns32)newIFDOffsets[kTIFF_TNailIFD], (newStream + tnailRefOffset) );
 		}
 	
 	} catch ( ... ) {
@@ -1643,6 +1754,7 @@ void TIFF_FileWriter::UpdateMemByRewrite ( XMP_Uns8** newStream_out, XMP_Uns32*
 	// Save any old memory stream for the content behind hidden offsets. Setup a bare TIFF header.
 
 	XMP_Uns8* oldStream = this->memStream;
+	bool oldOwned = this->ownedStream;
 
 	XMP_Uns8 bareTIFF [8];
 	if ( this->bigEndian ) {
@@ -1674,6 +1786,8 @@ void TIFF_FileWriter::UpdateMemByRewrite ( XMP_Uns8** newStream_out, XMP_Uns32*
 		memcpy ( destPtr, srcPtr, hiddenLocations[i].length );	// AUDIT: Safe copy, not user data, computed length.
 
 	}
+	
+	if ( oldOwned ) free ( oldStream );	// ! The caller reparses the new stream, nothing refers to the old one.
 		
 }	// TIFF_FileWriter::UpdateMemByRewrite
 
@@ -1697,7 +1811,7 @@ XMP_Uns32 TIFF_FileWriter::UpdateMemoryStream ( void** dataPtr, bool condenseStr
 	
 	if ( ! this->changed ) {
 		if ( dataPtr != 0 ) *dataPtr = this->memStream;
-		return this->tiffLength;
+		return (XMP_Uns32)this->tiffLength;
 	}
 	
 	bool nowEmpty = true;
@@ -1737,7 +1851,7 @@ XMP_Uns32 TIFF_FileWriter::UpdateMemoryStream ( void** dataPtr, bool condenseStr
 	this->ownedStream = true;	// ! We really do own the stream.
 	
 	if ( dataPtr != 0 ) *dataPtr = this->memStream;
-	return this->tiffLength;
+	return (XMP_Uns32)this->tiffLength;
 	
 }	// TIFF_FileWriter::UpdateMemoryStream
 
@@ -1772,17 +1886,19 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 	if ( this->memParsed ) XMP_Throw ( "Not file based", kXMPErr_EnforceFailure );
 	if ( ! this->changed ) return;
 	
+	// Only classic TIFF is limited to 4GB, BigTIFF offsets are 64 bits.
+
 	XMP_Int64 origLength = LFA_Measure ( fileRef );
-	if ( (origLength >> 32) != 0 ) XMP_Throw ( "TIFF files can't exceed 4GB", kXMPErr_BadTIFF );
+	if ( (! this->bigTIFF) && ((origLength >> 32) != 0) ) XMP_Throw ( "TIFF files can't exceed 4GB", kXMPErr_BadTIFF );
 	
 	bool appendedIFDs[kTIFF_KnownIFDCount];
-	XMP_Uns32 newIFDOffsets[kTIFF_KnownIFDCount];
+	XMP_Uns64 newIFDOffsets[kTIFF_KnownIFDCount];
 	
 	#if Trace_UpdateFileStream
 		printf ( "\nStarting update of TIFF file stream\n" );
 	#endif
 
-	XMP_Uns32 appendedOrigin = (XMP_Uns32)origLength;
+	XMP_Uns64 appendedOrigin = origLength;
 	if ( (appendedOrigin & 1) != 0 ) {
 		++appendedOrigin;	// Start at an even offset.
 		LFA_Seek ( fileRef, 0, SEEK_END );
@@ -1790,7 +1906,7 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 	}
 
 	XMP_Uns32 appendedLength = DetermineAppendInfo ( appendedOrigin, appendedIFDs, newIFDOffsets );
-	if ( appendedLength > (0xFFFFFFFFUL - appendedOrigin) ) XMP_Throw ( "TIFF files can't exceed 4GB", kXMPErr_BadTIFF );
+	if ( (! this->bigTIFF) && (appendedLength > (0xFFFFFFFFUL - appendedOrigin)) ) XMP_Throw ( "TIFF files can't exceed 4GB", kXMPErr_BadTIFF );
 
 	// Do the in-place update for the IFDs and tag values that fit. This part does separate seeks
 	// and writes for the IFDs and values. Things to be updated can be anywhere in the file.
@@ -1808,7 +1924,7 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 		
 		if ( ! appendedIFDs[ifd] ) {
 			#if Trace_UpdateFileStream
-				printf ( "  Updating IFD %d in-place at offset %d (0x%X)\n", ifd, thisIFD.origOffset, thisIFD.origOffset );
+				printf ( "  Updating IFD %d in-place at offset %d (0x%X)\n", ifd, (XMP_Uns32)thisIFD.origOffset, (XMP_Uns32)thisIFD.origOffset );
 			#endif
 			LFA_Seek ( fileRef, thisIFD.origOffset, SEEK_SET );
 			this->WriteFileIFD ( fileRef, thisIFD );
@@ -1819,9 +1935,9 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 		
 		for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
 			InternalTagInfo & thisTag = tagPos->second;
-			if ( (! thisTag.changed) || (thisTag.dataLen <= 4) || (thisTag.dataLen > thisTag.origLen) ) continue;
+			if ( (! thisTag.changed) || (thisTag.dataLen <= this->SmallValueLimit()) || (thisTag.dataLen > thisTag.origLen) ) continue;
 			#if Trace_UpdateFileStream
-				printf ( "    Updating tag %d in IFD %d in-place at offset %d (0x%X)\n", thisTag.id, ifd, thisTag.origOffset, thisTag.origOffset );
+				printf ( "    Updating tag %d in IFD %d in-place at offset %d (0x%X)\n", thisTag.id, ifd, (XMP_Uns32)thisTag.origOffset, (XMP_Uns32)thisTag.origOffset );
 			#endif
 			LFA_Seek ( fileRef, thisTag.origOffset, SEEK_SET );
 			LFA_Write ( fileRef, thisTag.dataPtr, thisTag.dataLen );
@@ -1841,9 +1957,9 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 		
 		if ( appendedIFDs[ifd] ) {
 			#if Trace_UpdateFileStream
-				printf ( "  Updating IFD %d by append at offset %d (0x%X)\n", ifd, newIFDOffsets[ifd], newIFDOffsets[ifd] );
+				printf ( "  Updating IFD %d by append at offset %d (0x%X)\n", ifd, (XMP_Uns32)newIFDOffsets[ifd], (XMP_Uns32)newIFDOffsets[ifd] );
 			#endif
-			XMP_Assert ( newIFDOffsets[ifd] == LFA_Measure(fileRef) );
+			XMP_Assert ( newIFDOffsets[ifd] == (XMP_Uns64)LFA_Measure(fileRef) );
 			this->WriteFileIFD ( fileRef, thisIFD );
 		}
 			
@@ -1852,29 +1968,32 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 		
 		for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
 			InternalTagInfo & thisTag = tagPos->second;
-			if ( (! thisTag.changed) || (thisTag.dataLen <= 4) || (thisTag.dataLen <= thisTag.origLen) ) continue;
+			if ( (! thisTag.changed) || (thisTag.dataLen <= this->SmallValueLimit()) || (thisTag.dataLen <= thisTag.origLen) ) continue;
 			#if Trace_UpdateFileStream
-				XMP_Uns32 newOffset = this->GetUns32(&thisTag.dataOrOffset);
+				XMP_Uns32 newOffset = (XMP_Uns32) this->GetOffset(&thisTag.dataOrOffset);
 				printf ( "    Updating tag %d in IFD %d by append at offset %d (0x%X)\n", thisTag.id, ifd, newOffset, newOffset );
 			#endif
-			XMP_Assert ( this->GetUns32(&thisTag.dataOrOffset) == LFA_Measure(fileRef) );
+			XMP_Assert ( this->GetOffset(&thisTag.dataOrOffset) == (XMP_Uns64)LFA_Measure(fileRef) );
 			LFA_Write ( fileRef, thisTag.dataPtr, thisTag.dataLen );
 			if ( (thisTag.dataLen & 1) != 0 ) LFA_Write ( fileRef, "\0", 1 );
 		}
 
 	}
 
-	// Back-fill the offsets for the primary and thumnbail IFDs, if they are now appended.
+	// Back-fill the offsets for the primary and thumnbail IFDs, if they are now appended. The
+	// primary IFD offset is at 4 in a classic header, at 8 in a BigTIFF header.
 	
-	XMP_Uns32 newOffset;
+	XMP_Uns64 newOffset;
+	const size_t offsetSize = (this->bigTIFF ? 8 : 4);
 	
 	if ( appendedIFDs[kTIFF_PrimaryIFD] ) {
-		this->PutUns32 ( newIFDOffsets[kTIFF_PrimaryIFD], &newOffset );
+		this->PutOffset ( newIFDOffsets[kTIFF_PrimaryIFD], &newOffset );
 		#if TraceUpdateFileStream
-			printf ( "  Back-filling offset of primary IFD, pointing to %d (0x%X)\n", newOffset, newOffset );
+			printf ( "  Back-filling offset of primary IFD, pointing to %d (0x%X)\n",
+					 (XMP_Uns32)newIFDOffsets[kTIFF_PrimaryIFD], (XMP_Uns32)newIFDOffsets[kTIFF_PrimaryIFD] );
 		#endif
-		LFA_Seek ( fileRef, 4, SEEK_SET );
-		LFA_Write ( fileRef, &newOffset, 4 );
+		LFA_Seek ( fileRef, (this->bigTIFF ? 8 : 4), SEEK_SET );
+		LFA_Write ( fileRef, &newOffset, offsetSize );
 	}
 	
 	InternalIFDInfo & primaryIFD = this->containedIFDs[kTIFF_PrimaryIFD];
@@ -1883,15 +2002,16 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 	if ( appendedIFDs[kTIFF_TNailIFD] && (primaryIFD.origNextIFD == tnailIFD.origOffset) ) {
 
 		size_t primaryIFDCount = primaryIFD.tagMap.size();
-		XMP_Uns32 tnailRefOffset = newIFDOffsets[kTIFF_PrimaryIFD] + 2 + (12 * primaryIFDCount);
+		XMP_Uns64 tnailRefOffset = newIFDOffsets[kTIFF_PrimaryIFD] + this->IFDLength ( primaryIFDCount ) - offsetSize;
 
-		this->PutUns32 ( newIFDOffsets[kTIFF_TNailIFD], &newOffset );
+		this->PutOffset ( newIFDOffsets[kTIFF_TNailIFD], &newOffset );
 		#if TraceUpdateFileStream
 			printf ( "  Back-filling offset of thumbnail IFD, offset at %d (0x%X), pointing to %d (0x%X)\n",
-					 tnailRefOffset, tnailRefOffset, newOffset, newOffset );
+					 (XMP_Uns32)tnailRefOffset, (XMP_Uns32)tnailRefOffset,
+					 (XMP_Uns32)newIFDOffsets[kTIFF_TNailIFD], (XMP_Uns32)newIFDOffsets[kTIFF_TNailIFD] );
 		#endif
 		LFA_Seek ( fileRef, tnailRefOffset, SEEK_SET );
-		LFA_Write ( fileRef, &newOffset, 4 );
+		LFA_Write ( fileRef, &newOffset, offsetSize );
 		
 		primaryIFD.origNextIFD = newIFDOffsets[kTIFF_TNailIFD];	// ! Ought to be below, easier here.
 
@@ -1917,12 +2037,12 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 			if ( ! thisTag.changed ) continue;
 			thisTag.changed = false;
 			thisTag.origLen = thisTag.dataLen;
-			if ( thisTag.origLen > 4 ) thisTag.origOffset = this->GetUns32 ( &thisTag.dataOrOffset );
+			if ( thisTag.origLen > this->SmallValueLimit() ) thisTag.origOffset = this->GetOffset ( &thisTag.dataOrOffset );
 		}
 
 	}
 
-	this->tiffLength = (XMP_Uns32) LFA_Measure ( fileRef );
+	this->tiffLength = LFA_Measure ( fileRef );
 	LFA_Seek ( fileRef, 0, SEEK_END );	// Can't hurt.
 	
 	#if Trace_UpdateFileStream
@@ -1937,6 +2057,46 @@ void TIFF_FileWriter::UpdateFileStream ( LFA_FileRef fileRef )
 
 void TIFF_FileWriter::WriteFileIFD ( LFA_FileRef fileRef, InternalIFDInfo & thisIFD )
 {
+	if ( this->bigTIFF ) {
+	
+		// A BigTIFF IFD has an 8 byte count, 20 byte entries, and an 8 byte next IFD offset. Values
+		// of up to 8 bytes are stored in the entry. Take those from dataPtr, a value copied from a
+		// Photoshop 6 IFD might be longer than 4 bytes and still be in a separate block.
+
+		XMP_Uns64 bigCount;
+		this->PutUns64 ( thisIFD.tagMap.size(), &bigCount );
+		LFA_Write ( fileRef, &bigCount, 8 );
+		
+		InternalTagMap::iterator tagPos;
+		InternalTagMap::iterator tagEnd = thisIFD.tagMap.end();
+
+		for ( tagPos = thisIFD.tagMap.begin(); tagPos != tagEnd; ++tagPos ) {
+
+			InternalTagInfo & thisTag = tagPos->second;
+			XMP_Uns8 bigEntry [kBigIFDEntryLength];
+			memset ( bigEntry, 0, kBigIFDEntryLength );	// AUDIT: Safe, using sizeof the array.
+
+			this->PutUns16 ( thisTag.id, &bigEntry[0] );
+			this->PutUns16 ( thisTag.type, &bigEntry[2] );
+			this->PutUns64 ( thisTag.count, &bigEntry[4] );
+			if ( thisTag.dataLen <= 8 ) {
+				memcpy ( &bigEntry[12], thisTag.dataPtr, thisTag.dataLen );	// AUDIT: Safe, the length is <= 8.
+			} else {
+				memcpy ( &bigEntry[12], &thisTag.dataOrOffset, 8 );	// ! Already in stream endianness.
+			}
+
+			LFA_Write ( fileRef, bigEntry, kBigIFDEntryLength );
+
+		}
+		
+		XMP_Uns64 bigNext;
+		this->PutUns64 ( thisIFD.origNextIFD, &bigNext );
+		LFA_Write ( fileRef, &bigNext, 8 );
+		
+		return;
+
+	}
+
 	XMP_Uns16 tagCount;
 	this->PutUns16 ( thisIFD.tagMap.size(), &tagCount );
 	LFA_Write ( fileRef, &tagCount, 2 );
@@ -1952,7 +2112,7 @@ void TIFF_FileWriter::WriteFileIFD ( LFA_FileRef fileRef, InternalIFDInfo & this
 		this->PutUns16 ( thisTag.id, &ifdEntry.id );
 		this->PutUns16 ( thisTag.type, &ifdEntry.type );
 		this->PutUns32 ( thisTag.count, &ifdEntry.count );
-		ifdEntry.dataOrOffset = thisTag.dataOrOffset;	// ! Already in stream endianness.
+		memcpy ( &ifdEntry.dataOrOffset, &thisTag.dataOrOffset, 4 );	// ! Already in stream endianness.
 
 		LFA_Write ( fileRef, &ifdEntry, sizeof(ifdEntry) );
 		XMP_Assert ( sizeof(ifdEntry) == 12 );
@@ -1960,7 +2120,7 @@ void TIFF_FileWriter::WriteFileIFD ( LFA_FileRef fileRef, InternalIFDInfo & this
 	}
 	
 	XMP_Uns32 nextIFD;
-	this->PutUns32 ( thisIFD.origNextIFD, &nextIFD );
+	this->PutUns32 ( (XMP_Uns32)thisIFD.origNextIFD, &nextIFD );
 	LFA_Write ( fileRef, &nextIFD, 4 );
 
 }	// TIFF_FileWriter::WriteFileIFD
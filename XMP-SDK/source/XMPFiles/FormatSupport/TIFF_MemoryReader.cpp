@@ -123,11 +123,7 @@ bool TIFF_MemoryReader::GetIFD ( XMP_Uns8 ifd, TagInfoMap* ifdMap ) const
 
 			TagInfo info ( thisTag->id, thisTag->type, 0, 0, thisTag->bytes );
 			info.count = info.dataLen / kTIFF_TypeSizes[info.type];
-			if ( info.dataLen <= 4 ) {
-				info.dataPtr = &(thisTag->dataOrPtr);
-			} else {
-				info.dataPtr = (const void*)(thisTag->dataOrPtr);
-			}
+			info.dataPtr = this->GetDataPtr ( thisTag );
 
 			(*ifdMap)[info.id] = info;
 
@@ -186,13 +182,12 @@ const TIFF_MemoryReader::TweakedIFDEntry* TIFF_MemoryReader::FindTagInIFD ( XMP_
 // TIFF_MemoryReader::GetValueOffset
 // =================================
 
-XMP_Uns32 TIFF_MemoryReader::GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const
+XMP_Uns64 TIFF_MemoryReader::GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const
 {
 	const TweakedIFDEntry* thisTag = this->FindTagInIFD ( ifd, id );
 	if ( thisTag == 0 ) return 0;
 	
-	XMP_Uns8 * valuePtr = (XMP_Uns8*) thisTag->dataOrPtr;
-	if ( thisTag->bytes <= 4 ) valuePtr = (XMP_Uns8*) &(thisTag->dataOrPtr);
+	XMP_Uns8 * valuePtr = (XMP_Uns8*) this->GetDataPtr ( thisTag );
 	
 	return (valuePtr - this->tiffStream);
 	
@@ -214,11 +209,7 @@ bool TIFF_MemoryReader::GetTag ( XMP_Uns8 ifd, XMP_Uns16 id, TagInfo* info ) con
 		info->count = thisTag->bytes / kTIFF_TypeSizes[thisTag->type];
 		info->dataLen = thisTag->bytes;
 		
-		if ( thisTag->bytes <= 4 ) {
-			info->dataPtr = &(thisTag->dataOrPtr);
-		} else {
-			info->dataPtr = (const void*)(thisTag->dataOrPtr);
-		}
+		info->dataPtr = this->GetDataPtr ( thisTag );
 
 	}
 	
@@ -238,10 +229,10 @@ bool TIFF_MemoryReader::GetTag_Integer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns32*
 	if ( data != 0 ) {
 		if ( thisTag->type == kTIFF_ShortType ) {
 			if ( thisTag->bytes != 2 ) return false;	// Wrong count.
-			*data = this->GetUns16 ( &(thisTag->dataOrPtr) );
+			*data = this->GetUns16 ( &(thisTag->dataOrOffset) );
 		} else if ( thisTag->type == kTIFF_LongType ) {
 			if ( thisTag->bytes != 4 ) return false;	// Wrong count.
-			*data = this->GetUns32 ( &(thisTag->dataOrPtr) );
+			*data = this->GetUns32 ( &(thisTag->dataOrOffset) );
 		} else {
 			return false;
 		}
@@ -262,7 +253,7 @@ bool TIFF_MemoryReader::GetTag_Byte ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns8* data
 	if ( (thisTag->type != kTIFF_ByteType) || (thisTag->bytes != 1) ) return false;
 	
 	if ( data != 0 ) {
-		*data = * ( (XMP_Uns8*) (&(thisTag->dataOrPtr)) );
+		*data = * ( (XMP_Uns8*) (&(thisTag->dataOrOffset)) );
 	}
 	
 	return true;
@@ -280,7 +271,7 @@ bool TIFF_MemoryReader::GetTag_SByte ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Int8* dat
 	if ( (thisTag->type != kTIFF_SByteType) || (thisTag->bytes != 1) ) return false;
 	
 	if ( data != 0 ) {
-		*data = * ( (XMP_Int8*) (&(thisTag->dataOrPtr)) );
+		*data = * ( (XMP_Int8*) (&(thisTag->dataOrOffset)) );
 	}
 	
 	return true;
@@ -298,7 +289,7 @@ bool TIFF_MemoryReader::GetTag_Short ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns16* da
 	if ( (thisTag->type != kTIFF_ShortType) || (thisTag->bytes != 2) ) return false;
 	
 	if ( data != 0 ) {
-		*data = this->GetUns16 ( &(thisTag->dataOrPtr) );
+		*data = this->GetUns16 ( &(thisTag->dataOrOffset) );
 	}
 	
 	return true;
@@ -316,7 +307,7 @@ bool TIFF_MemoryReader::GetTag_SShort ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Int16* d
 	if ( (thisTag->type != kTIFF_SShortType) || (thisTag->bytes != 2) ) return false;
 	
 	if ( data != 0 ) {
-		*data = (XMP_Int16) this->GetUns16 ( &(thisTag->dataOrPtr) );
+		*data = (XMP_Int16) this->GetUns16 ( &(thisTag->dataOrOffset) );
 	}
 	
 	return true;
@@ -334,7 +325,7 @@ bool TIFF_MemoryReader::GetTag_Long ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns32* dat
 	if ( (thisTag->type != kTIFF_LongType) || (thisTag->bytes != 4) ) return false;
 	
 	if ( data != 0 ) {
-		*data = this->GetUns32 ( &(thisTag->dataOrPtr) );
+		*data = this->GetUns32 ( &(thisTag->dataOrOffset) );
 	}
 	
 	return true;
@@ -352,7 +343,7 @@ bool TIFF_MemoryReader::GetTag_SLong ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Int32* da
 	if ( (thisTag->type != kTIFF_SLongType) || (thisTag->bytes != 4) ) return false;
 	
 	if ( data != 0 ) {
-		*data = (XMP_Int32) this->GetUns32 ( &(thisTag->dataOrPtr) );
+		*data = (XMP_Int32) this->GetUns32 ( &(thisTag->dataOrOffset) );
 	}
 	
 	return true;
@@ -370,7 +361,7 @@ bool TIFF_MemoryReader::GetTag_Rational ( XMP_Uns8 ifd, XMP_Uns16 id, Rational*
 	if ( (thisTag->type != kTIFF_RationalType) || (thisTag->bytes != 8) ) return false;
 	
 	if ( data != 0 ) {
-		XMP_Uns32* dataPtr = (XMP_Uns32*)thisTag->dataOrPtr;
+		XMP_Uns32* dataPtr = (XMP_Uns32*) this->GetDataPtr ( thisTag );
 		data->num = this->GetUns32 ( dataPtr );
 		data->denom = this->GetUns32 ( dataPtr+1 );
 	}
@@ -390,7 +381,7 @@ bool TIFF_MemoryReader::GetTag_SRational ( XMP_Uns8 ifd, XMP_Uns16 id, SRational
 	if ( (thisTag->type != kTIFF_SRationalType) || (thisTag->bytes != 8) ) return false;
 	
 	if ( data != 0 ) {
-		XMP_Uns32* dataPtr = (XMP_Uns32*)thisTag->dataOrPtr;
+		XMP_Uns32* dataPtr = (XMP_Uns32*) this->GetDataPtr ( thisTag );
 		data->num = (XMP_Int32) this->GetUns32 ( dataPtr );
 		data->denom = (XMP_Int32) this->GetUns32 ( dataPtr+1 );
 	}
@@ -410,7 +401,7 @@ bool TIFF_MemoryReader::GetTag_Float ( XMP_Uns8 ifd, XMP_Uns16 id, float* data )
 	if ( (thisTag->type != kTIFF_FloatType) || (thisTag->bytes != 4) ) return false;
 	
 	if ( data != 0 ) {
-		*data = this->GetFloat ( &(thisTag->dataOrPtr) );
+		*data = this->GetFloat ( &(thisTag->dataOrOffset) );
 	}
 	
 	return true;
@@ -428,7 +419,7 @@ bool TIFF_MemoryReader::GetTag_Double ( XMP_Uns8 ifd, XMP_Uns16 id, double* data
 	if ( (thisTag->type != kTIFF_DoubleType) || (thisTag->bytes != 8) ) return false;
 	
 	if ( data != 0 ) {
-		double* dataPtr = (double*)thisTag->dataOrPtr;
+		double* dataPtr = (double*) this->GetDataPtr ( thisTag );
 		*data = this->GetDouble ( dataPtr );
 	}
 	
@@ -447,8 +438,7 @@ bool TIFF_MemoryReader::GetTag_ASCII ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_StringPtr
 	if ( thisTag->type != kTIFF_ASCIIType ) return false;
 	
 	if ( dataPtr != 0 ) {
-		*dataPtr = (XMP_StringPtr)thisTag->dataOrPtr;
-		if ( thisTag->bytes <= 4 ) *dataPtr = (XMP_StringPtr)(&thisTag->dataOrPtr);
+		*dataPtr = (XMP_StringPtr) this->GetDataPtr ( thisTag );
 	}
 	
 	if ( dataLen != 0 ) *dataLen = thisTag->bytes;
@@ -469,7 +459,7 @@ bool TIFF_MemoryReader::GetTag_EncodedString ( XMP_Uns8 ifd, XMP_Uns16 id, std::
 	
 	if ( utf8Str == 0 ) return true;	// Return true if the converted string is not wanted.
 	
-	bool ok = this->DecodeString ( (void*)thisTag->dataOrPtr, thisTag->bytes, utf8Str );
+	bool ok = this->DecodeString ( this->GetDataPtr ( thisTag ), thisTag->bytes, utf8Str );
 	return ok;
 
 }	// TIFF_MemoryReader::GetTag_EncodedString
@@ -511,28 +501,30 @@ void TIFF_MemoryReader::ParseMemoryStream ( const void* data, XMP_Uns32 length,
 
 	this->tiffLength = length;
 	
-	// Find and process the primary, Exif, GPS, and Interoperability IFDs.
+	// Find and process the primary, Exif, GPS, and Interoperability IFDs. The tweaked IFD entries
+	// are overlaid on the 12 byte classic entries, BigTIFF has to go through TIFF_FileWriter.
 	
-	XMP_Uns32 primaryIFDOffset = this->CheckTIFFHeader ( this->tiffStream, length );
+	XMP_Uns32 primaryIFDOffset = (XMP_Uns32) this->CheckTIFFHeader ( this->tiffStream, length );
+	if ( this->bigTIFF ) XMP_Throw ( "BigTIFF is not supported by TIFF_MemoryReader", kXMPErr_BadTIFF );
 	XMP_Uns32 tnailIFDOffset   = 0;
 	
 	if ( primaryIFDOffset != 0 ) tnailIFDOffset = this->ProcessOneIFD ( primaryIFDOffset, kTIFF_PrimaryIFD );
 
 	const TweakedIFDEntry* exifIFDTag = this->FindTagInIFD ( kTIFF_PrimaryIFD, kTIFF_ExifIFDPointer );
 	if ( (exifIFDTag != 0) && (exifIFDTag->type == kTIFF_LongType) && (exifIFDTag->bytes == 4) ) {
-		XMP_Uns32 exifOffset = this->GetUns32 ( &exifIFDTag->dataOrPtr );
+		XMP_Uns32 exifOffset = this->GetUns32 ( &exifIFDTag->dataOrOffset );
 		(void) this->ProcessOneIFD ( exifOffset, kTIFF_ExifIFD );
 	}
 
 	const TweakedIFDEntry* gpsIFDTag = this->FindTagInIFD ( kTIFF_PrimaryIFD, kTIFF_GPSInfoIFDPointer );
 	if ( (gpsIFDTag != 0) && (gpsIFDTag->type == kTIFF_LongType) && (gpsIFDTag->bytes == 4) ) {
-		XMP_Uns32 gpsOffset = this->GetUns32 ( &gpsIFDTag->dataOrPtr );
+		XMP_Uns32 gpsOffset = this->GetUns32 ( &gpsIFDTag->dataOrOffset );
 		(void) this->ProcessOneIFD ( gpsOffset, kTIFF_GPSInfoIFD );
 	}
 
 	const TweakedIFDEntry* interopIFDTag = this->FindTagInIFD ( kTIFF_ExifIFD, kTIFF_InteroperabilityIFDPointer );
 	if ( (interopIFDTag != 0) && (interopIFDTag->type == kTIFF_LongType) && (interopIFDTag->bytes == 4) ) {
-		XMP_Uns32 interopOffset = this->GetUns32 ( &interopIFDTag->dataOrPtr );
+		XMP_Uns32 interopOffset = this->GetUns32 ( &interopIFDTag->dataOrOffset );
 		(void) this->ProcessOneIFD ( interopOffset, kTIFF_InteropIFD );
 	}
 	
@@ -543,7 +535,7 @@ void TIFF_MemoryReader::ParseMemoryStream ( const void* data, XMP_Uns32 length,
 		(void) this->ProcessOneIFD ( tnailIFDOffset, kTIFF_TNailIFD );
 		const TweakedIFDEntry* jpegInfo = FindTagInIFD ( kTIFF_TNailIFD, kTIFF_JPEGInterchangeFormat );
 		if ( jpegInfo != 0 ) {
-			XMP_Uns32 tnailImageOffset = this->GetUns32 ( &jpegInfo->dataOrPtr );
+			XMP_Uns32 tnailImageOffset = this->GetUns32 ( &jpegInfo->dataOrOffset );
 			this->jpegTNailPtr = (XMP_Uns8*)this->tiffStream + tnailImageOffset;
 		}
 	}
@@ -592,8 +584,8 @@ XMP_Uns32 TIFF_MemoryReader::ProcessOneIFD ( XMP_Uns32 ifdOffset, XMP_Uns8 ifd )
 		thisEntry->bytes *= kTIFF_TypeSizes[thisEntry->type];
 		if ( thisEntry->bytes > this->tiffLength ) XMP_Throw ( "Bad TIFF data size", kXMPErr_BadTIFF );
 		if ( thisEntry->bytes > 4 ) {
-			if ( ! this->nativeEndian ) Flip4 ( &thisEntry->dataOrPtr );
-			thisEntry->dataOrPtr += (XMP_Uns32)this->tiffStream;
+			if ( ! this->nativeEndian ) Flip4 ( &thisEntry->dataOrOffset );
+			if ( thisEntry->dataOrOffset > (this->tiffLength - thisEntry->bytes) ) XMP_Throw ( "Bad TIFF data offset", kXMPErr_BadTIFF );
 		}
 
 	}
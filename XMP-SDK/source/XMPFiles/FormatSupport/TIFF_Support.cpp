@@ -25,9 +25,9 @@
 static bool sFirstCTor = true;
 
 TIFF_Manager::TIFF_Manager()
-	: bigEndian(false), nativeEndian(false), jpegTNailPtr(0),
-	  GetUns16(0), GetUns32(0), GetFloat(0), GetDouble(0),
-	  PutUns16(0), PutUns32(0), PutFloat(0), PutDouble(0),
+	: bigEndian(false), nativeEndian(false), bigTIFF(false), jpegTNailPtr(0),
+	  GetUns16(0), GetUns32(0), GetUns64(0), GetFloat(0), GetDouble(0),
+	  PutUns16(0), PutUns32(0), PutUns64(0), PutFloat(0), PutDouble(0),
 	  xmpHadUserComment(false), xmpHadRelatedSoundFile(false)
 {
 
@@ -48,10 +48,11 @@ TIFF_Manager::TIFF_Manager()
 // TIFF_Manager::CheckTIFFHeader
 // =============================
 //
-// Checks the 4 byte TIFF prefix for validity and endianness. Sets the endian flags and the Get
-// function pointers. Returns the 0th IFD offset.
+// Checks the 4 byte TIFF prefix for validity and endianness. Sets the endian and BigTIFF flags and
+// the Get function pointers. Returns the 0th IFD offset. The caller must provide the full 16 byte
+// header for BigTIFF, if the stream is that long.
 
-XMP_Uns32 TIFF_Manager::CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns32 length )
+XMP_Uns64 TIFF_Manager::CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns64 length )
 {
 	if ( length < kEmptyTIFFLength ) XMP_Throw ( "The TIFF is too small", kXMPErr_BadTIFF );
 	
@@ -59,8 +60,16 @@ XMP_Uns32 TIFF_Manager::CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns32 len
 	
 	if ( tiffPrefix == kBigEndianPrefix ) {
 		this->bigEndian = true;
+		this->bigTIFF = false;
 	} else if ( tiffPrefix == kLittleEndianPrefix ) {
 		this->bigEndian = false;
+		this->bigTIFF = false;
+	} else if ( tiffPrefix == kBigEndianBigTIFFPrefix ) {
+		this->bigEndian = true;
+		this->bigTIFF = true;
+	} else if ( tiffPrefix == kLittleEndianBigTIFFPrefix ) {
+		this->bigEndian = false;
+		this->bigTIFF = true;
 	} else {
 		XMP_Throw ( "Unrecognized TIFF prefix", kXMPErr_BadTIFF );
 	}
@@ -71,11 +80,13 @@ XMP_Uns32 TIFF_Manager::CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns32 len
 
 		this->GetUns16  = GetUns16BE;
 		this->GetUns32  = GetUns32BE;
+		this->GetUns64  = GetUns64BE;
 		this->GetFloat  = GetFloatBE;
 		this->GetDouble = GetDoubleBE;
 
 		this->PutUns16  = PutUns16BE;
 		this->PutUns32  = PutUns32BE;
+		this->PutUns64  = PutUns64BE;
 		this->PutFloat  = PutFloatBE;
 		this->PutDouble = PutDoubleBE;
 
@@ -83,26 +94,52 @@ XMP_Uns32 TIFF_Manager::CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns32 len
 
 		this->GetUns16  = GetUns16LE;
 		this->GetUns32  = GetUns32LE;
+		this->GetUns64  = GetUns64LE;
 		this->GetFloat  = GetFloatLE;
 		this->GetDouble = GetDoubleLE;
 
 		this->PutUns16  = PutUns16LE;
 		this->PutUns32  = PutUns32LE;
+		this->PutUns64  = PutUns64LE;
 		this->PutFloat  = PutFloatLE;
 		this->PutDouble = PutDoubleLE;
 
 	}
 
-	XMP_Uns32 mainIFDOffset = this->GetUns32 ( tiffPtr+4 );	// ! Do this after setting the Get/Put procs!
+	if ( ! this->bigTIFF ) {
+
+		XMP_Uns32 mainIFDOffset = this->GetUns32 ( tiffPtr+4 );	// ! Do this after setting the Get/Put procs!
+		
+		if ( mainIFDOffset != 0 ) {	// Tolerate empty TIFF even though formally invalid.
+			if ( (length < (kEmptyTIFFLength + kEmptyIFDLength)) ||
+				 (mainIFDOffset < kEmptyTIFFLength) || (mainIFDOffset > (length - kEmptyIFDLength)) ) {
+				XMP_Throw ( "Invalid primary IFD offset", kXMPErr_BadTIFF );
+			}
+		}
+		
+		return mainIFDOffset;
+	
+	} else {
 	
-	if ( mainIFDOffset != 0 ) {	// Tolerate empty TIFF even though formally invalid.
-		if ( (length < (kEmptyTIFFLength + kEmptyIFDLength)) ||
-			 (mainIFDOffset < kEmptyTIFFLength) || (mainIFDOffset > (length - kEmptyIFDLength)) ) {
-			XMP_Throw ( "Invalid primary IFD offset", kXMPErr_BadTIFF );
+		// The BigTIFF header has the offset byte size (always 8) and a reserved 0 before the offset.
+
+		if ( length < kEmptyBigTIFFLength ) XMP_Throw ( "The BigTIFF is too small", kXMPErr_BadTIFF );
+		if ( (this->GetUns16 ( tiffPtr+4 ) != 8) || (this->GetUns16 ( tiffPtr+6 ) != 0) ) {
+			XMP_Throw ( "Unrecognized BigTIFF offset size", kXMPErr_BadTIFF );
 		}
-	}
+
+		XMP_Uns64 mainIFDOffset = this->GetUns64 ( tiffPtr+8 );
+		
+		if ( mainIFDOffset != 0 ) {
+			if ( (length < (kEmptyBigTIFFLength + kEmptyBigIFDLength)) ||
+				 (mainIFDOffset < kEmptyBigTIFFLength) || (mainIFDOffset > (length - kEmptyBigIFDLength)) ) {
+				XMP_Throw ( "Invalid primary IFD offset", kXMPErr_BadTIFF );
+			}
+		}
+		
+		return mainIFDOffset;
 	
-	return mainIFDOffset;
+	}
 
 }	// TIFF_Manager::CheckTIFFHeader
 
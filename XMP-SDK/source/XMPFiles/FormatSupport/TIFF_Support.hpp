@@ -43,6 +43,10 @@
 /// \li The Exif GPS Info metadata IFD, from tag 34853 in the primary image IFD.
 /// \li The Exif Interoperability IFD, from tag 40965 in the Exif general metadata IFD.
 ///
+/// BigTIFF streams, with 64 bit offsets and counts, are supported by the file-based parse and update
+/// of TIFF_FileWriter. They are rejected by the memory-based parsing, Exif in JPEG or Photoshop
+/// files is always classic TIFF.
+///
 /// \note In the future we should add support for the non-Exif thumbnails in DNG (TIFF/EP) files.
 ///
 /// \note These classes are for use only when directly compiled and linked. They should not be
@@ -81,14 +85,19 @@ enum {	// Constants for the type field of a tag, as defined by TIFF.
 	kTIFF_SRationalType   = 10,
 	kTIFF_FloatType       = 11,
 	kTIFF_DoubleType      = 12,
-	kTIFF_LastType        = 12
+	kTIFF_LastType        = 12,
+	kTIFF_IFDType         = 13,	// The types past kTIFF_LastType are only recognized in BigTIFF.
+	kTIFF_Long8Type       = 16,
+	kTIFF_SLong8Type      = 17,
+	kTIFF_IFD8Type        = 18,
+	kTIFF_LastBigType     = 18
 };
 
-static const size_t kTIFF_TypeSizes[] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8 };
+static const size_t kTIFF_TypeSizes[] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8, 4, 0, 0, 8, 8, 8 };
 
 static const char * kTIFF_TypeNames[] = { "ShortOrLong", "BYTE", "ASCII", "SHORT", "LONG", "RATIONAL",
 										  "SBYTE", "UNDEFINED", "SSHORT", "SLONG", "SRATIONAL",
-										  "FLOAT", "DOUBLE" };
+										  "FLOAT", "DOUBLE", "IFD", "", "", "LONG8", "SLONG8", "IFD8" };
 
 enum {	// Encodings for SetTag_EncodedString.
 	kTIFF_EncodeUndefined = 0,
@@ -428,9 +437,16 @@ public:
 	static const XMP_Uns32 kBigEndianPrefix    = 0x4D4D002AUL;
 	static const XMP_Uns32 kLittleEndianPrefix = 0x49492A00UL;
 
+	static const XMP_Uns32 kBigEndianBigTIFFPrefix    = 0x4D4D002BUL;
+	static const XMP_Uns32 kLittleEndianBigTIFFPrefix = 0x49492B00UL;
+
 	static const size_t kEmptyTIFFLength = 8;		// Just the header.
 	static const size_t kEmptyIFDLength  = 2 + 4;	// Entry count and next-IFD offset.
 	static const size_t kIFDEntryLength  = 12;
+
+	static const size_t kEmptyBigTIFFLength = 16;		// The BigTIFF header, with a 64 bit IFD offset.
+	static const size_t kEmptyBigIFDLength  = 8 + 8;	// BigTIFF entry count and next-IFD offset.
+	static const size_t kBigIFDEntryLength  = 20;
 	
 	struct TagInfo {
 		XMP_Uns16   id;
@@ -457,6 +473,12 @@ public:
 	bool IsLittleEndian() const { return (! this->bigEndian); };
 	bool IsNativeEndian() const { return this->nativeEndian; };
 	
+	// ---------------------------------------------------------------------------------------------
+	// \c IsBigTIFF returns true if the parsed stream is BigTIFF, with 64 bit offsets. An update
+	// preserves the form of the stream.
+	
+	bool IsBigTIFF() const { return this->bigTIFF; };
+	
 	// ---------------------------------------------------------------------------------------------
 	// The TIFF_Manager only keeps explicit knowledge of up to 5 IFDs:
 	// - The primary image IFD, also known as the 0th IFD. This must be present.
@@ -484,7 +506,11 @@ public:
 	// exception is thrown if kTIFF_KnownIFD is passed to GetTag or SetTag and the tag is not known.
 	// \c SetTag replaces an existing tag regardless of type or count. \c DeleteTag deletes a tag,
 	// it is a no-op if the tag does not exist. \c GetValueOffset returns the offset within the
-	// parsed stream of the tag's value. It returns 0 if the tag was not in the parsed input.
+	// parsed stream of the tag's value. It returns 0 if the tag was not in the parsed input. The
+	// offset can be beyond 4GB for BigTIFF.
+	//
+	// For values of 4 bytes or less the dataPtr from \c GetTag or \c GetIFD points into the tag
+	// entry. With TIFF_FileWriter it is only valid until the next \c SetTag or \c DeleteTag.
 	
 	virtual bool GetIFD ( XMP_Uns8 ifd, TagInfoMap* ifdMap ) const = 0;
 	
@@ -494,7 +520,7 @@ public:
 	
 	virtual void DeleteTag ( XMP_Uns8 ifd, XMP_Uns16 id ) = 0;
 	
-	virtual XMP_Uns32 GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const = 0;
+	virtual XMP_Uns64 GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const = 0;
 	
 	// ---------------------------------------------------------------------------------------------
 	// These methods are for tags whose type can be short or long, depending on the actual value.
@@ -603,11 +629,13 @@ public:
 	
 	GetUns16_Proc  GetUns16;	// Get values from the TIFF stream.
 	GetUns32_Proc  GetUns32;	// Always native endian on the outside, stream endian in the stream.
+	GetUns64_Proc  GetUns64;
 	GetFloat_Proc  GetFloat;
 	GetDouble_Proc GetDouble;
 
 	PutUns16_Proc  PutUns16;	// Put values into the TIFF stream.
 	PutUns32_Proc  PutUns32;	// Always native endian on the outside, stream endian in the stream.
+	PutUns64_Proc  PutUns64;
 	PutFloat_Proc  PutFloat;
 	PutDouble_Proc PutDouble;
 
@@ -619,10 +647,18 @@ public:
 protected:
 
 	bool bigEndian, nativeEndian;
+	bool bigTIFF;
 	
 	XMP_Uns8 * jpegTNailPtr;
 
-	XMP_Uns32 CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns32 length );
+	XMP_Uns64 CheckTIFFHeader ( const XMP_Uns8* tiffPtr, XMP_Uns64 length );
+	
+	// Get or put a stream offset, 4 bytes in classic TIFF and 8 bytes in BigTIFF.
+
+	XMP_Uns64 GetOffset ( const void* addr ) const
+		{ return (this->bigTIFF ? this->GetUns64 ( addr ) : (XMP_Uns64)this->GetUns32 ( addr )); };
+	void PutOffset ( XMP_Uns64 offset, void* addr ) const
+		{ if ( this->bigTIFF ) { this->PutUns64 ( offset, addr ); } else { this->PutUns32 ( (XMP_Uns32)offset, addr ); } };
 	
 	TIFF_Manager();	// Force clients to use the reader or writer derived classes.
 
@@ -659,7 +695,7 @@ public:
 	
 	void DeleteTag ( XMP_Uns8 ifd, XMP_Uns16 id ) { NotAppropriate(); };
 	
-	XMP_Uns32 GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const;
+	XMP_Uns64 GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const;
 
 	bool GetTag_Integer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns32* data ) const;
 
@@ -708,8 +744,8 @@ private:
 		XMP_Uns16 id;
 		XMP_Uns16 type;
 		XMP_Uns32 bytes;
-		XMP_Uns32 dataOrPtr;
-		TweakedIFDEntry() : id(0), type(0), bytes(0), dataOrPtr(0) {};
+		XMP_Uns32 dataOrOffset;	// ! The value if 4 bytes or less, else the native endian stream offset.
+		TweakedIFDEntry() : id(0), type(0), bytes(0), dataOrOffset(0) {};
 	};
 	
 	struct TweakedIFDInfo {
@@ -726,6 +762,9 @@ private:
 	
 	const TweakedIFDEntry* FindTagInIFD ( XMP_Uns8 ifd, XMP_Uns16 id ) const;
 
+	const void* GetDataPtr ( const TweakedIFDEntry* thisTag ) const
+		{ if ( thisTag->bytes <= 4 ) return &thisTag->dataOrOffset; else return (this->tiffStream + thisTag->dataOrOffset); };
+
 	static inline void NotAppropriate() { XMP_Throw ( "Not appropriate for TIFF_Reader", kXMPErr_InternalFailure ); };
 	
 };	// TIFF_MemoryReader
@@ -754,7 +793,7 @@ public:
 	
 	void DeleteTag ( XMP_Uns8 ifd, XMP_Uns16 id );
 	
-	XMP_Uns32 GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const;
+	XMP_Uns64 GetValueOffset ( XMP_Uns8 ifd, XMP_Uns16 id ) const;
 
 	bool GetTag_Integer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns32* data ) const;
 
@@ -802,53 +841,77 @@ private:
 	bool ownedStream;
 
 	XMP_Uns8* memStream;
-	XMP_Uns32 tiffLength;
+	XMP_Uns64 tiffLength;
 
 	struct InternalTagInfo {
 		XMP_Uns16 id;
 		XMP_Uns16 type;
 		XMP_Uns32 count;
 		XMP_Uns32 dataLen;
-		XMP_Uns32 dataOrOffset;	// Small value or large offset in stream endianness.
+		XMP_Uns64 dataOrOffset;	// Small value or large offset in stream endianness, 4 bytes used in classic TIFF.
 		XMP_Uns8* dataPtr;		// Always set, even for small values.
 		XMP_Uns32 origLen;		// The original data length in bytes.
-		XMP_Uns32 origOffset;	// The original data offset, regardless of length.
+		XMP_Uns64 origOffset;	// The original data offset, regardless of length.
 		bool      changed;
 		InternalTagInfo() : id(0), type(0), count(0), dataLen(0), dataOrOffset(0), dataPtr(0), origLen(0), origOffset(0), changed(false) {};
 		InternalTagInfo ( XMP_Uns16 _id, XMP_Uns16 _type, XMP_Uns32 _count )
 			: id(_id), type(_type), count(_count), dataLen(0), dataOrOffset(0), dataPtr(0), origLen(0), origOffset(0), changed(false) {};
+		InternalTagInfo ( const InternalTagInfo & in )
+		{
+			// ! Gag! Transfer ownership of the dataPtr, the FlatMap copies entries as it grows.
+			memcpy ( this, &in, sizeof ( InternalTagInfo ) );	// AUDIT: Use of sizeof(InternalTagInfo) is safe.
+			if ( in.IsSmallValue() ) {
+				this->dataPtr = (XMP_Uns8*) &this->dataOrOffset;
+			} else {
+				*((XMP_Uns8**)&in.dataPtr) = 0;	// ! Avoid double calls to free from the destructor!
+			}
+		};
 		~InternalTagInfo()
 		{
-			if ( this->changed && (this->dataLen > 4) && (this->dataPtr != 0) ) free ( this->dataPtr );
+			if ( this->changed && (! this->IsSmallValue()) && (this->dataPtr != 0) ) free ( this->dataPtr );
 		};
 		void operator=  ( const InternalTagInfo & in )
 		{
 			// ! Gag! Transfer ownership of the dataPtr!
-			if ( this->changed && (this->dataLen > 4) && (this->dataPtr != 0) ) free ( this->dataPtr );
+			if ( this->changed && (! this->IsSmallValue()) && (this->dataPtr != 0) ) free ( this->dataPtr );
 			memcpy ( this, &in, sizeof ( InternalTagInfo ) );	// AUDIT: Use of sizeof(InternalTagInfo) is safe.
-			if ( this->dataLen <= 4 ) {
+			if ( in.IsSmallValue() ) {
 				this->dataPtr = (XMP_Uns8*) &this->dataOrOffset;
 			} else {
 				*((XMP_Uns8**)&in.dataPtr) = 0;	// ! Avoid double calls to free from the destructor!
 			}
 		};
+		bool IsSmallValue() const
+		{
+			// ! Small values are up to 4 bytes in classic TIFF and 8 in BigTIFF, the tag doesn't know
+			// ! which. Small values always have the dataPtr pointing to the dataOrOffset field.
+			return (this->dataPtr == (const XMP_Uns8*) &this->dataOrOffset);
+		};
 	};
 	
-	typedef std::map<XMP_Uns16,InternalTagInfo> InternalTagMap;
+	typedef FlatMap<XMP_Uns16,InternalTagInfo> InternalTagMap;
 	
 	struct InternalIFDInfo {
 		bool changed;
 		XMP_Uns16 origCount;	// Original number of IFD entries.
-		XMP_Uns32 origOffset;	// Original stream offset of the IFD.
-		XMP_Uns32 origNextIFD;	// Original stream offset of the following IFD.
+		XMP_Uns64 origOffset;	// Original stream offset of the IFD.
+		XMP_Uns64 origNextIFD;	// Original stream offset of the following IFD.
 		InternalTagMap tagMap;
+		std::vector<XMP_Uns8> valuePool;	// The captured large values from a file parse.
 		InternalIFDInfo() : changed(false), origCount(0), origOffset(0), origNextIFD(0) {};
+		bool IsPooled ( const XMP_Uns8* dataPtr ) const
+		{
+			if ( this->valuePool.empty() ) return false;
+			const XMP_Uns8* poolBegin = &this->valuePool[0];
+			return ( (poolBegin <= dataPtr) && (dataPtr < (poolBegin + this->valuePool.size())) );
+		};
 		void clear()
 		{
 			this->changed = false;
 			this->origCount = 0;
 			this->origOffset = this->origNextIFD = 0;
 			this->tagMap.clear();
+			this->valuePool.clear();
 		};
 	};
 	
@@ -856,11 +919,18 @@ private:
 	
 	static XMP_Uns8 PickIFD ( XMP_Uns8 ifd, XMP_Uns16 id );
 	const InternalTagInfo* FindTagInIFD ( XMP_Uns8 ifd, XMP_Uns16 id ) const;
+
+	XMP_Uns32 SmallValueLimit() const { return (this->bigTIFF ? 8 : 4); };
+	XMP_Uns64 IFDLength ( size_t tagCount ) const
+		{ return (this->bigTIFF ? (kEmptyBigIFDLength + kBigIFDEntryLength*tagCount) : (kEmptyIFDLength + kIFDEntryLength*tagCount)); };
+
+	bool GetIFDPointer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns64* offset ) const;
+	void SetIFDPointer ( XMP_Uns8 ifd, XMP_Uns16 id, XMP_Uns64 offset );
 	
 	void DeleteExistingInfo();
 
 	XMP_Uns32 ProcessMemoryIFD ( XMP_Uns32 ifdOffset, XMP_Uns8 ifd );
-	XMP_Uns32 ProcessFileIFD   ( XMP_Uns8 ifd, XMP_Uns32 ifdOffset, LFA_FileRef fileRef, IOBuffer* ioBuf );
+	XMP_Uns64 ProcessFileIFD   ( XMP_Uns8 ifd, XMP_Uns64 ifdOffset, LFA_FileRef fileRef, IOBuffer* ioBuf );
 
 	void ProcessPShop6IFD ( const TIFF_MemoryReader& buriedExif, XMP_Uns8 ifd );
 
@@ -872,9 +942,9 @@ private:
 	
 	XMP_Uns32 DetermineVisibleLength();
 
-	XMP_Uns32 DetermineAppendInfo ( XMP_Uns32 appendedOrigin,
+	XMP_Uns32 DetermineAppendInfo ( XMP_Uns64 appendedOrigin,
 									bool      appendedIFDs[kTIFF_KnownIFDCount],
-									XMP_Uns32 newIFDOffsets[kTIFF_KnownIFDCount],
+									XMP_Uns64 newIFDOffsets[kTIFF_KnownIFDCount],
 									bool      appendAll = false );
 
 	void WriteFileIFD ( LFA_FileRef fileRef, InternalIFDInfo & thisIFD );
@@ -20,6 +20,7 @@
 #include <cassert>
 #include <string>
 #include <cstdlib>
+#include <cstring>
 
 #if DEBUG
 	#include <iostream>
@@ -156,6 +156,66 @@ void WXMPFiles_GetFormatInfo_1 ( XMP_FileFormat   format,
 	XMP_EXIT_WRAPPER
 }
 
+// -------------------------------------------------------------------------------------------------
+
+void WXMPFiles_GetXMPBatch_1 ( XMP_Int32             fileCount,
+                               const XMP_StringPtr * filePaths,
+                               XMP_FileFormat        format,
+                               XMP_OptionBits        openFlags,
+                               XMP_Int32             maxThreads,
+                               XMP_BatchFileInfo *   fileInfo,
+                               XMPMetaRef *          xmpRefs,
+                               XMP_StringPtr *       xmpPackets,
+                               XMP_StringLen *       xmpPacketLens,
+                               WXMP_Result *         wResult )
+{
+	bool keepLock = (xmpPackets != 0);	// The packet strings are owned by XMPFiles until the client copies them.
+	XMP_ENTER_WRAPPER ( "WXMPFiles_GetXMPBatch_1" )
+	
+		XMPFiles::GetXMPBatch ( fileCount, filePaths, format, openFlags, maxThreads,
+		                        fileInfo, xmpRefs, xmpPackets, xmpPacketLens );
+	
+	XMP_EXIT_WRAPPER_KEEP_LOCK ( keepLock )
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void WXMPFiles_SetIndexCache_1 ( XMP_StringPtr  cacheFolder,
+                                 XMP_OptionBits options,
+                                 WXMP_Result *  wResult )
+{
+	XMP_ENTER_WRAPPER ( "WXMPFiles_SetIndexCache_1" )
+	
+		XMPFiles::SetIndexCache ( cacheFolder, options );
+	
+	XMP_EXIT_WRAPPER
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void WXMPFiles_SetPerfCounters_1 ( XMP_OptionBits options,
+                                   WXMP_Result *  wResult )
+{
+	XMP_ENTER_WRAPPER ( "WXMPFiles_SetPerfCounters_1" )
+	
+		XMPFiles::SetPerfCounters ( options );
+	
+	XMP_EXIT_WRAPPER
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void WXMPFiles_GetPerfCounters_1 ( XMP_FileFormat     handlerFormat,
+                                   XMP_PerfCounters * counters,
+                                   WXMP_Result *      wResult )
+{
+	XMP_ENTER_WRAPPER_NO_LOCK ( "WXMPFiles_GetPerfCounters_1" )	// ! The counters have their own lock, don't wait for a batch.
+	
+		wResult->int32Result = XMPFiles::GetPerfCounters ( handlerFormat, counters );
+	
+	XMP_EXIT_WRAPPER
+}
+
 // =================================================================================================
 
 void WXMPFiles_OpenFile_1 ( XMPFilesRef    xmpFilesRef,
@@ -165,13 +225,12 @@ void WXMPFiles_OpenFile_1 ( XMPFilesRef    xmpFilesRef,
                             WXMP_Result *  wResult )
 {
 	XMP_ENTER_WRAPPER ( "WXMPFiles_OpenFile_1" )
-		StartPerfCheck ( kAPIPerf_OpenFile, filePath );
 	
 		XMPFiles * thiz = (XMPFiles*)xmpFilesRef;
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_OpenFile, thiz );
 		bool ok = thiz->OpenFile ( filePath, format, openFlags );
 		wResult->int32Result = ok;
 	
-		EndPerfCheck ( kAPIPerf_OpenFile );
 	XMP_EXIT_WRAPPER
 }
     
@@ -182,12 +241,11 @@ void WXMPFiles_CloseFile_1 ( XMPFilesRef    xmpFilesRef,
                              WXMP_Result *  wResult )
 {
 	XMP_ENTER_WRAPPER ( "WXMPFiles_CloseFile_1" )
-		StartPerfCheck ( kAPIPerf_CloseFile, "" );
 	
 		XMPFiles * thiz = (XMPFiles*)xmpFilesRef;
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_CloseFile, thiz );
 		thiz->CloseFile ( closeFlags );
 	
-		EndPerfCheck ( kAPIPerf_CloseFile );
 	XMP_EXIT_WRAPPER
 }
 	
@@ -237,9 +295,9 @@ void WXMPFiles_GetXMP_1 ( XMPFilesRef      xmpFilesRef,
 {
 	bool hasXMP = false;
 	XMP_ENTER_WRAPPER ( "WXMPFiles_GetXMP_1" )
-		StartPerfCheck ( kAPIPerf_GetXMP, "" );
-
+	
 		XMPFiles * thiz = (XMPFiles*)xmpFilesRef;
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_GetXMP, thiz );
 		if ( xmpRef == 0 ) {
 			hasXMP = thiz->GetXMP ( 0, xmpPacket, xmpPacketLen, packetInfo );
 		} else {
@@ -248,7 +306,6 @@ void WXMPFiles_GetXMP_1 ( XMPFilesRef      xmpFilesRef,
 		}
 		wResult->int32Result = hasXMP;
 	
-		EndPerfCheck ( kAPIPerf_GetXMP );
 	XMP_EXIT_WRAPPER_KEEP_LOCK ( hasXMP )
 }
     
@@ -259,13 +316,12 @@ void WXMPFiles_GetThumbnail_1 ( XMPFilesRef         xmpFilesRef,
                                 WXMP_Result *       wResult )
 {
 	XMP_ENTER_WRAPPER ( "WXMPFiles_GetThumbnail_1" )
-		StartPerfCheck ( kAPIPerf_GetThumbnail, "" );
-
+	
 		XMPFiles * thiz = (XMPFiles*)xmpFilesRef;
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_GetThumbnail, thiz );
 		bool hasTNail = thiz->GetThumbnail ( tnailInfo );
 		wResult->int32Result = hasTNail;
 	
-		EndPerfCheck ( kAPIPerf_GetThumbnail );
 	XMP_EXIT_WRAPPER	// ! No need to keep the lock, the tnail info won't change.
 }
     
@@ -278,16 +334,15 @@ void WXMPFiles_PutXMP_1 ( XMPFilesRef   xmpFilesRef,
                           WXMP_Result * wResult )
 {
 	XMP_ENTER_WRAPPER ( "WXMPFiles_PutXMP_1" )
-		StartPerfCheck ( kAPIPerf_PutXMP, "" );
 	
 		XMPFiles * thiz = (XMPFiles*)xmpFilesRef;
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_PutXMP, thiz );
 		if ( xmpRef != 0 ) {
 			thiz->PutXMP ( xmpRef );
 		} else {
 			thiz->PutXMP ( xmpPacket, xmpPacketLen );
 		}
 	
-		EndPerfCheck ( kAPIPerf_PutXMP );
 	XMP_EXIT_WRAPPER
 }
     
@@ -300,16 +355,15 @@ void WXMPFiles_CanPutXMP_1 ( XMPFilesRef   xmpFilesRef,
                              WXMP_Result * wResult )
 {
 	XMP_ENTER_WRAPPER ( "WXMPFiles_CanPutXMP_1" )
-		StartPerfCheck ( kAPIPerf_CanPutXMP, "" );
 	
 		XMPFiles * thiz = (XMPFiles*)xmpFilesRef;
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_CanPutXMP, thiz );
 		if ( xmpRef != 0 ) {
 			wResult->int32Result = thiz->CanPutXMP ( xmpRef );
 		} else {
 			wResult->int32Result = thiz->CanPutXMP ( xmpPacket, xmpPacketLen );
 		}
 	
-		EndPerfCheck ( kAPIPerf_CanPutXMP );
 	XMP_EXIT_WRAPPER
 }
 
@@ -38,10 +38,6 @@
 
 long sXMPFilesInitCount = 0;
 
-#if GatherPerformanceData
-	APIPerfCollection* sAPIPerf = 0;
-#endif
-
 // These are embedded version strings.
 
 #if XMP_DebugBuild
@@ -78,6 +74,8 @@ typedef XMPFileHandlerTable::iterator XMPFileHandlerTablePos;
 
 static XMPFileHandlerTable * sRegisteredHandlers = 0;	// ! Only smart handlers are registered!
 
+static std::vector<std::string> * sBatchPackets = 0;	// Packet storage for GetXMPBatch, kept until the next batch.
+
 // =================================================================================================
 
 static XMPFileHandlerTablePos
@@ -106,6 +104,19 @@ FindHandler ( XMP_FileFormat format,
 
 // =================================================================================================
 
+static inline bool
+CallCheckProc ( XMPFileHandlerTablePos handlerPos,
+				XMP_StringPtr          filePath,
+				LFA_FileRef            fileRef,
+				XMPFiles *             parent )
+{
+	PerfPhaseTimer perf ( kXMPFiles_PerfPhase_CheckFormat, handlerPos->format );
+	return handlerPos->checkProc ( handlerPos->format, filePath, fileRef, parent );
+
+}	// CallCheckProc
+
+// =================================================================================================
+
 static void
 RegisterXMPFileHandler ( XMP_FileFormat     format,
 						 XMP_OptionBits     flags,
@@ -149,6 +160,9 @@ XMPFiles::GetVersionInfo ( XMP_VersionInfo * info )
 
 static bool sIgnoreQuickTime = false;
 
+static std::string * sIndexCacheFolder = 0;	// Empty if the index cache is off.
+static XMP_OptionBits sIndexCacheOptions = 0;
+
 /* class static */
 bool
 XMPFiles::Initialize ( XMP_OptionBits options /* = 0 */ )
@@ -158,11 +172,9 @@ XMPFiles::Initialize ( XMP_OptionBits options /* = 0 */ )
 	
 	SXMPMeta::Initialize();	// Just in case the client does not.
 	
-	#if GatherPerformanceData
-		sAPIPerf = new APIPerfCollection;
-	#endif
-
 	XMP_InitMutex ( &sXMPFilesLock );
+	PerfInitialize();
+	IOBufferInitialize();
 	
 	XMP_Uns16 endianInt  = 0x00FF;
 	XMP_Uns8  endianByte = *((XMP_Uns8*)&endianInt);
@@ -177,6 +189,8 @@ XMPFiles::Initialize ( XMP_OptionBits options /* = 0 */ )
 	
 	sRegisteredHandlers = new XMPFileHandlerTable;
 	sXMPFilesExceptionMessage = new XMP_VarString;
+	sBatchPackets = new std::vector<std::string>;
+	sIndexCacheFolder = new std::string;
 
 	InitializeUnicodeConversions();
 	
@@ -234,81 +248,6 @@ XMPFiles::Initialize ( XMP_OptionBits options /* = 0 */ )
  
 // =================================================================================================
 
-#if GatherPerformanceData
-
-#if XMP_WinBuild
-	#pragma warning ( disable : 4996 )	// '...' was declared deprecated
-#endif
-
-#include "PerfUtils.cpp"
-
-static void ReportPerformanceData()
-{
-	struct SummaryInfo {
-		size_t callCount;
-		double totalTime;
-		SummaryInfo() : callCount(0), totalTime(0.0) {};
-	};
-	
-	SummaryInfo perfSummary [kAPIPerfProcCount];
-	
-	XMP_DateTime now;
-	SXMPUtils::CurrentDateTime ( &now );
-	std::string nowStr;
-	SXMPUtils::ConvertFromDate ( now, &nowStr );
-	
-	#if XMP_WinBuild
-		#define kPerfLogPath "C:\\XMPFilesPerformanceLog.txt"
-	#else
-		#define kPerfLogPath "/XMPFilesPerformanceLog.txt"
-	#endif
-	FILE * perfLog = fopen ( kPerfLogPath, "ab" );
-	if ( perfLog == 0 ) return;
-	
-	fprintf ( perfLog, "\n\n// =================================================================================================\n\n" );
-	fprintf ( perfLog, "XMPFiles performance data\n" );
-	fprintf ( perfLog, "   %s\n", kXMPFiles_VersionMessage );
-	fprintf ( perfLog, "   Reported at %s\n", nowStr.c_str() );
-	fprintf ( perfLog, "   %s\n", PerfUtils::GetTimerInfo() );
-	
-	// Gather and report the summary info.
-	
-	for ( size_t i = 0; i < sAPIPerf->size(); ++i ) {
-		SummaryInfo& summaryItem = perfSummary [(*sAPIPerf)[i].whichProc];
-		++summaryItem.callCount;
-		summaryItem.totalTime += (*sAPIPerf)[i].elapsedTime;
-	}
-	
-	fprintf ( perfLog, "\nSummary data:\n" );
-	
-	for ( size_t i = 0; i < kAPIPerfProcCount; ++i ) {
-		long averageTime = 0;
-		if ( perfSummary[i].callCount != 0 ) {
-			averageTime = (long) (((perfSummary[i].totalTime/perfSummary[i].callCount) * 1000.0*1000.0) + 0.5);
-		}
-		fprintf ( perfLog, "   %s, %d total calls, %d average microseconds per call\n",
-				  kAPIPerfNames[i], perfSummary[i].callCount, averageTime );
-	}
-
-	fprintf ( perfLog, "\nPer-call data:\n" );
-	
-	// Report the info for each call.
-	
-	for ( size_t i = 0; i < sAPIPerf->size(); ++i ) {
-		long time = (long) (((*sAPIPerf)[i].elapsedTime * 1000.0*1000.0) + 0.5);
-		fprintf ( perfLog, "   %s, %d microSec, ref %.8X, \"%s\"\n",
-				  kAPIPerfNames[(*sAPIPerf)[i].whichProc], time,
-				  (*sAPIPerf)[i].xmpFilesRef, (*sAPIPerf)[i].extraInfo.c_str() );
-	}
-	
-	fclose ( perfLog );
-	
-}	// ReportAReportPerformanceDataPIPerformance
-
-#endif
-
-// =================================================================================================
-
 #define EliminateGlobal(g) delete ( g ); g = 0
 
 /* class static */
@@ -318,14 +257,14 @@ XMPFiles::Terminate()
 	--sXMPFilesInitCount;
 	if ( sXMPFilesInitCount != 0 ) return;
 
-	#if GatherPerformanceData
-		ReportPerformanceData();
-		EliminateGlobal ( sAPIPerf );
-	#endif
-	
 	EliminateGlobal ( sRegisteredHandlers );
 	EliminateGlobal ( sXMPFilesExceptionMessage );
+	EliminateGlobal ( sBatchPackets );
+	EliminateGlobal ( sIndexCacheFolder );
+	sIndexCacheOptions = 0;
 	
+	IOBufferTerminate();
+	PerfTerminate();
 	XMP_TermMutex ( sXMPFilesLock );
 	
 	SXMPMeta::Terminate();	// Just in case the client does not.
@@ -342,7 +281,11 @@ XMPFiles::XMPFiles() :
 	abortProc(0),
 	abortArg(0),
 	handler(0),
-	handlerTemp(0)
+	handlerTemp(0),
+	havePrefix(false),
+	indexState(0),
+	formatHint(kXMP_UnknownFile),
+	handlerFormat(kXMP_UnknownFile)
 {
 	// Nothing more to do, clientRefs is incremented in wrapper.
 
@@ -419,6 +362,411 @@ XMPFiles::GetFormatInfo ( XMP_FileFormat   format,
 	
 }	// XMPFiles::GetFormatInfo
  
+// =================================================================================================
+// DropFilePrefix
+// ==============
+//
+// Release the shared file prefix once the handler no longer needs it, the string capacity would
+// otherwise stay with the XMPFiles object.
+
+static void
+DropFilePrefix ( XMPFiles * files )
+{
+	std::string emptyPrefix;
+	files->filePrefix.swap ( emptyPrefix );
+	files->havePrefix = false;
+
+}	// DropFilePrefix
+
+// =================================================================================================
+// GetFileExtension
+// ================
+//
+// Get the lower case extension of the file, without the dot. It is empty if there is none.
+
+static void
+GetFileExtension ( XMP_StringPtr filePath, std::string * fileExt )
+{
+	fileExt->erase();
+	
+	size_t extPos = strlen ( filePath );
+	for ( --extPos; extPos > 0; --extPos ) if ( filePath[extPos] == '.' ) break;
+	if ( filePath[extPos] == '.' ) {
+		++extPos;
+		fileExt->assign ( &filePath[extPos] );
+		for ( size_t i = 0; i < fileExt->size(); ++i ) {
+			if ( ('A' <= (*fileExt)[i]) && ((*fileExt)[i] <= 'Z') ) (*fileExt)[i] += 0x20;
+		}
+	}
+
+}	// GetFileExtension
+
+// =================================================================================================
+// Index Cache
+// ===========
+//
+// The index cache remembers what OpenFile found in a file, so that later read-only opens of the
+// unchanged file can skip the CheckProcs and CacheFileData. Each entry is a small file in the cache
+// folder, named from the volume and file ID. The entry also has the file size and modification
+// time, plus the open options, format hint, and extension that affect handler selection. The entry
+// is ignored unless all of these match.
+//
+// An entry has the formats, the packet info, the raw packet, and optionally a snapshot of the XMP
+// tree after processing. A hit without a tree leaves the handler's XMP unprocessed, if an XMP object
+// is wanted GetXMP reopens the file normally since processing might need legacy that was never cached.
+// The same goes for a tree-less entry without XMP, processing can import legacy into an empty tree.
+// Only an entry written after processing records that a file has no XMP at all.
+//
+// Entries are written by CloseFile for read-only opens, to a temp file that is renamed into place.
+// Failures of any kind are ignored, the cache must never make an OpenFile fail.
+//
+// The values of XMPFiles::indexState are:
+//	kIndexState_None	- The index cache does not apply to this open.
+//	kIndexState_Miss	- Opened normally, CloseFile writes an entry.
+//	kIndexState_Hit		- Opened from an entry without a tree.
+//	kIndexState_HitTree	- Opened from an entry with a tree, or for a file that had no XMP after processing.
+//	kIndexState_Reopen	- Set by GetXMP while reopening, tells OpenFile to not look in the cache.
+
+enum {
+	kIndexState_None    = 0,
+	kIndexState_Miss    = 1,
+	kIndexState_Hit     = 2,
+	kIndexState_HitTree = 3,
+	kIndexState_Reopen  = 4
+};
+
+static const XMP_OptionBits kIndexCacheExcluded = (kXMPFiles_OpenForUpdate | kXMPFiles_OpenCacheTNail);
+static const XMP_OptionBits kIndexKeyFlags = (kXMPFiles_OpenOnlyXMP | kXMPFiles_OpenStrictly |
+											  kXMPFiles_OpenUseSmartHandler | kXMPFiles_OpenUsePacketScanning |
+											  kXMPFiles_OpenLimitedScanning);
+
+static const char * kIndexEntryMagic = "XMPIdx02";	// ! Change the digits if the layout changes.
+
+enum {	// Offsets in an entry, all values are little endian.
+	kIndexEntry_Magic         = 0,	// 8 bytes.
+	kIndexEntry_VolumeID      = 8,
+	kIndexEntry_FileID        = 16,
+	kIndexEntry_FileSize      = 24,
+	kIndexEntry_ModTime       = 32,
+	kIndexEntry_OpenFlags     = 40,
+	kIndexEntry_FormatHint    = 44,
+	kIndexEntry_FileFormat    = 48,
+	kIndexEntry_HandlerFormat = 52,
+	kIndexEntry_PacketOffset  = 56,
+	kIndexEntry_PacketLength  = 64,
+	kIndexEntry_PadSize       = 68,
+	kIndexEntry_CharForm      = 72,
+	kIndexEntry_Writeable     = 73,
+	kIndexEntry_ContainsXMP   = 74,
+	kIndexEntry_HasTree       = 75,
+	kIndexEntry_ExtLen        = 76,
+	kIndexEntry_PacketLen     = 80,
+	kIndexEntry_TreeLen       = 84,
+	kIndexEntry_HeaderSize    = 88	// The extension, packet, and tree strings follow.
+};
+
+// -------------------------------------------------------------------------------------------------
+// GetIndexEntryPath
+// -----------------
+
+static void
+GetIndexEntryPath ( const XMP_FileIdentity & identity, std::string * entryPath )
+{
+	static const char * kHexDigits = "0123456789ABCDEF";
+	
+	entryPath->assign ( *sIndexCacheFolder );
+	char lastChar = (*entryPath)[entryPath->size()-1];
+	if ( (lastChar != '/') && (lastChar != '\\') ) entryPath->append ( 1, '/' );	// ! Windows accepts '/'.
+	
+	XMP_Uns64 idParts[2] = { identity.volumeID, identity.fileID };
+	for ( size_t i = 0; i < 2; ++i ) {
+		if ( i > 0 ) entryPath->append ( 1, '-' );
+		for ( int shift = 60; shift >= 0; shift -= 4 ) entryPath->append ( 1, kHexDigits[(idParts[i] >> shift) & 0xF] );
+	}
+	entryPath->append ( ".xmpidx" );
+
+}	// GetIndexEntryPath
+
+// -------------------------------------------------------------------------------------------------
+// RemoveIndexEntry
+// ----------------
+
+static void
+RemoveIndexEntry ( XMP_StringPtr filePath )
+{
+	XMP_FileIdentity identity;
+	if ( ! GetFileIdentity ( filePath, &identity ) ) return;
+	
+	std::string entryPath;
+	GetIndexEntryPath ( identity, &entryPath );
+
+	XMP_FileIdentity entryIdentity;
+	if ( ! GetFileIdentity ( entryPath.c_str(), &entryIdentity ) ) return;	// Avoid a throw in the common case.
+	
+	try {
+		LFA_Delete ( entryPath.c_str() );
+	} catch ( ... ) {
+		// Ignore failures, at worst a stale entry whose size or time won't match.
+	}
+
+}	// RemoveIndexEntry
+
+// -------------------------------------------------------------------------------------------------
+// WriteIndexEntry
+// ---------------
+
+static void
+WriteIndexEntry ( XMPFiles * files )
+{
+	XMPFileHandler * handler = files->handler;
+	const XMP_FileIdentity & identity = files->fileIdentity;
+
+	std::string fileExt, xmpTree;
+	GetFileExtension ( files->filePath.c_str(), &fileExt );
+	
+	// Without XMP after processing nothing more is needed. Before processing containsXMP only says
+	// there is no packet, ProcessXMP might still import legacy. The JPEG, TIFF, and PSD handlers set
+	// containsXMP there when they find Exif or IPTC.
+
+	bool hasTree = (handler->processedXMP && (! handler->containsXMP));
+	
+	try {
+	
+		if ( handler->containsXMP && handler->processedXMP && (sIndexCacheOptions & kXMPFiles_IndexCacheXMPTree) ) {
+			handler->xmpObj.SerializeToSnapshot ( &xmpTree );
+			hasTree = true;
+		}
+
+		std::string entry;
+		entry.reserve ( kIndexEntry_HeaderSize + fileExt.size() + handler->xmpPacket.size() + xmpTree.size() );
+		entry.assign ( kIndexEntry_HeaderSize, 0 );
+		XMP_Uns8 * header = (XMP_Uns8*) entry.c_str();	// Don't set until after reserving the space!
+		
+		memcpy ( &header[kIndexEntry_Magic], kIndexEntryMagic, 8 );
+		PutUns64LE ( identity.volumeID, &header[kIndexEntry_VolumeID] );
+		PutUns64LE ( identity.fileID, &header[kIndexEntry_FileID] );
+		PutUns64LE ( identity.fileSize, &header[kIndexEntry_FileSize] );
+		PutUns64LE ( (XMP_Uns64)identity.modTime, &header[kIndexEntry_ModTime] );
+		PutUns32LE ( (files->openFlags & kIndexKeyFlags), &header[kIndexEntry_OpenFlags] );
+		PutUns32LE ( files->formatHint, &header[kIndexEntry_FormatHint] );
+		PutUns32LE ( files->format, &header[kIndexEntry_FileFormat] );
+		PutUns32LE ( files->handlerFormat, &header[kIndexEntry_HandlerFormat] );
+		PutUns64LE ( (XMP_Uns64)handler->packetInfo.offset, &header[kIndexEntry_PacketOffset] );
+		PutUns32LE ( (XMP_Uns32)handler->packetInfo.length, &header[kIndexEntry_PacketLength] );
+		PutUns32LE ( (XMP_Uns32)handler->packetInfo.padSize, &header[kIndexEntry_PadSize] );
+		header[kIndexEntry_CharForm] = handler->packetInfo.charForm;
+		header[kIndexEntry_Writeable] = handler->packetInfo.writeable;
+		header[kIndexEntry_ContainsXMP] = handler->containsXMP;
+		header[kIndexEntry_HasTree] = hasTree;
+		PutUns32LE ( (XMP_Uns32)fileExt.size(), &header[kIndexEntry_ExtLen] );
+		PutUns32LE ( (XMP_Uns32)handler->xmpPacket.size(), &header[kIndexEntry_PacketLen] );
+		PutUns32LE ( (XMP_Uns32)xmpTree.size(), &header[kIndexEntry_TreeLen] );
+		
+		entry.append ( fileExt );
+		entry.append ( handler->xmpPacket );
+		entry.append ( xmpTree );
+		
+		std::string entryPath, tempPath;
+		GetIndexEntryPath ( identity, &entryPath );
+		tempPath = entryPath + ".tmp";
+		
+		try {
+			AutoFile tempFile;
+			tempFile.fileRef = LFA_Create ( tempPath.c_str() );
+			LFA_Write ( tempFile.fileRef, entry.c_str(), (XMP_Int32)entry.size() );
+		} catch ( ... ) {
+			// Most likely a concurrent writer or a temp file left by a crash, remove it for next time.
+			try { LFA_Delete ( tempPath.c_str() ); } catch ( ... ) {}
+			return;
+		}
+		
+		try {
+			LFA_Rename ( tempPath.c_str(), entryPath.c_str() );
+		} catch ( ... ) {
+			LFA_Delete ( entryPath.c_str() );	// ! Not all platforms replace an existing file.
+			LFA_Rename ( tempPath.c_str(), entryPath.c_str() );
+		}
+	
+	} catch ( ... ) {
+		// Ignore all failures, the entry just isn't there next time.
+	}
+
+}	// WriteIndexEntry
+
+// -------------------------------------------------------------------------------------------------
+// OpenFromIndexCache
+// ------------------
+//
+// Look for a matching entry and create the handler from it. The caller has set files->fileIdentity
+// and files->formatHint. Returns false, with no handler, if the entry is missing or unusable.
+
+static bool
+OpenFromIndexCache ( XMPFiles * files, XMP_StringPtr filePath, const std::string & fileExt )
+{
+	const XMP_FileIdentity & identity = files->fileIdentity;
+
+	std::string entryPath, entry;
+	GetIndexEntryPath ( identity, &entryPath );
+	
+	XMP_FileIdentity entryIdentity;
+	if ( ! GetFileIdentity ( entryPath.c_str(), &entryIdentity ) ) return false;	// Avoid a throw in the common case.
+	if ( (entryIdentity.fileSize < kIndexEntry_HeaderSize) || (entryIdentity.fileSize > 0x7FFFFFFF) ) return false;
+
+	try {
+		AutoFile entryFile;
+		entryFile.fileRef = LFA_Open ( entryPath.c_str(), 'r' );
+		entry.reserve ( (size_t)entryIdentity.fileSize );
+		entry.assign ( (size_t)entryIdentity.fileSize, 0 );
+		XMP_StringPtr entryStr = XMP_StringPtr ( entry.c_str() );	// Don't set until after reserving the space!
+		LFA_Read ( entryFile.fileRef, (char*)entryStr, (XMP_Int32)entry.size(), kLFA_RequireAll );
+	} catch ( ... ) {
+		return false;
+	}
+	
+	// Make sure this entry is for the same file content and the same kind of open.
+	
+	const XMP_Uns8 * header = (const XMP_Uns8 *) entry.c_str();
+
+	if ( ! CheckBytes ( &header[kIndexEntry_Magic], kIndexEntryMagic, 8 ) ) return false;
+	if ( GetUns64LE ( &header[kIndexEntry_VolumeID] ) != identity.volumeID ) return false;
+	if ( GetUns64LE ( &header[kIndexEntry_FileID] ) != identity.fileID ) return false;
+	if ( GetUns64LE ( &header[kIndexEntry_FileSize] ) != identity.fileSize ) return false;
+	if ( (XMP_Int64)GetUns64LE ( &header[kIndexEntry_ModTime] ) != identity.modTime ) return false;
+	if ( GetUns32LE ( &header[kIndexEntry_OpenFlags] ) != (files->openFlags & kIndexKeyFlags) ) return false;
+	if ( GetUns32LE ( &header[kIndexEntry_FormatHint] ) != files->formatHint ) return false;
+
+	size_t extLen    = GetUns32LE ( &header[kIndexEntry_ExtLen] );
+	size_t packetLen = GetUns32LE ( &header[kIndexEntry_PacketLen] );
+	size_t treeLen   = GetUns32LE ( &header[kIndexEntry_TreeLen] );
+	if ( (kIndexEntry_HeaderSize + (XMP_Uns64)extLen + packetLen + treeLen) != entry.size() ) return false;
+	
+	XMP_StringPtr extPtr    = entry.c_str() + kIndexEntry_HeaderSize;
+	XMP_StringPtr packetPtr = extPtr + extLen;
+	XMP_StringPtr treePtr   = packetPtr + packetLen;
+	if ( fileExt.compare ( 0, std::string::npos, extPtr, extLen ) != 0 ) return false;
+	
+	// Find the handler, the registered handler table can change between runs.
+	
+	XMP_FileFormat     handlerFormat = GetUns32LE ( &header[kIndexEntry_HandlerFormat] );
+	XMPFileHandlerCTor handlerCTor   = 0;
+	
+	if ( handlerFormat == kXMP_UnknownFile ) {
+		handlerCTor = Scanner_MetaHandlerCTor;
+	} else {
+		std::string noExt;
+		XMPFileHandlerTablePos handlerPos = FindHandler ( handlerFormat, noExt );
+		if ( handlerPos == sRegisteredHandlers->end() ) return false;
+		if ( handlerPos->flags & kXMPFiles_HandlerOwnsFile ) return false;
+		handlerCTor = handlerPos->handlerCTor;
+	}
+	
+	// Create the handler and fill in what CacheFileData would have.
+	
+	files->fileRef  = 0;
+	files->filePath = filePath;
+	files->format   = GetUns32LE ( &header[kIndexEntry_FileFormat] );
+	files->handlerFormat = handlerFormat;
+
+	XMPFileHandler * handler = (*handlerCTor) ( files );
+	files->handler = handler;
+	
+	handler->containsXMP = (header[kIndexEntry_ContainsXMP] != 0);
+	handler->packetInfo.offset    = (XMP_Int64)GetUns64LE ( &header[kIndexEntry_PacketOffset] );
+	handler->packetInfo.length    = (XMP_Int32)GetUns32LE ( &header[kIndexEntry_PacketLength] );
+	handler->packetInfo.padSize   = (XMP_Int32)GetUns32LE ( &header[kIndexEntry_PadSize] );
+	handler->packetInfo.charForm  = header[kIndexEntry_CharForm];
+	handler->packetInfo.writeable = (header[kIndexEntry_Writeable] != 0);
+	handler->xmpPacket.assign ( packetPtr, packetLen );
+	
+	handler->containsTNail  = false;	// ! kXMPFiles_OpenCacheTNail is never used with the index cache.
+	handler->processedTNail = true;
+	
+	files->indexState = kIndexState_Hit;
+
+	if ( header[kIndexEntry_HasTree] != 0 ) {
+		if ( treeLen > 0 ) {
+			try {
+				handler->xmpObj.LoadFromSnapshot ( treePtr, (XMP_StringLen)treeLen );
+			} catch ( ... ) {
+				delete handler;
+				files->handler = 0;
+				files->format  = kXMP_UnknownFile;
+				files->indexState = kIndexState_Miss;
+				return false;
+			}
+		}
+		handler->processedXMP = true;
+		files->indexState = kIndexState_HitTree;
+	}
+	
+	return true;
+
+}	// OpenFromIndexCache
+
+// -------------------------------------------------------------------------------------------------
+// ReopenWithoutIndexCache
+// -----------------------
+//
+// Replace a handler made from a tree-less index entry with one from a normal open.
+
+static void
+ReopenWithoutIndexCache ( XMPFiles * files )
+{
+	std::string    filePath ( files->filePath );
+	XMP_FileFormat formatHint = files->formatHint;
+	XMP_OptionBits openFlags  = files->openFlags;
+
+	delete files->handler;
+	files->handler = 0;
+	
+	files->indexState = kIndexState_Reopen;
+	bool ok = files->OpenFile ( filePath.c_str(), formatHint, openFlags );
+	if ( ! ok ) XMP_Throw ( "XMPFiles::GetXMP - Reopen failed", kXMPErr_ExternalFailure );
+
+}	// ReopenWithoutIndexCache
+
+// =================================================================================================
+
+/* class static */
+void
+XMPFiles::SetIndexCache ( XMP_StringPtr  cacheFolder,
+						  XMP_OptionBits options /* = 0 */ )
+{
+	if ( options & ~kXMPFiles_IndexCacheXMPTree ) XMP_Throw ( "Invalid options for SetIndexCache", kXMPErr_BadOptions );
+
+	if ( cacheFolder == 0 ) cacheFolder = "";
+	sIndexCacheFolder->assign ( cacheFolder );
+	sIndexCacheOptions = options;
+
+}	// XMPFiles::SetIndexCache
+
+// =================================================================================================
+
+/* class static */
+void
+XMPFiles::SetPerfCounters ( XMP_OptionBits options )
+{
+	if ( options & ~(kXMPFiles_PerfCountersOn | kXMPFiles_PerfCountersReset) ) {
+		XMP_Throw ( "Invalid options for SetPerfCounters", kXMPErr_BadOptions );
+	}
+	
+	if ( options & kXMPFiles_PerfCountersReset ) PerfReset();
+	sPerfCountersOn = ((options & kXMPFiles_PerfCountersOn) != 0);
+
+}	// XMPFiles::SetPerfCounters
+
+// =================================================================================================
+
+/* class static */
+bool
+XMPFiles::GetPerfCounters ( XMP_FileFormat     handlerFormat,
+							XMP_PerfCounters * counters )
+{
+	if ( counters == 0 ) XMP_Throw ( "Null counters pointer", kXMPErr_BadParam );
+	return PerfGetCounters ( handlerFormat, counters );
+
+}	// XMPFiles::GetPerfCounters
+
 // =================================================================================================
 
 bool
@@ -440,6 +788,10 @@ XMPFiles::OpenFile ( XMP_StringPtr  filePath,
 	// actual file content. If that is not possible, use the format hint. The initial CheckProc call
 	// has the presumed format in this->format, the later calls have kXMP_UnknownFile there.
 	
+	// The start of the file is read once, on demand, and shared by the CheckProcs through
+	// GetFilePrefix. It is kept until the handler has cached its data so CacheFileData can also
+	// start from it, then dropped.
+	
 	bool foundHandler = false;
 	LFA_FileRef fileRef = 0;
 	
@@ -449,18 +801,24 @@ XMPFiles::OpenFile ( XMP_StringPtr  filePath,
 	XMPFileHandlerTablePos handlerPos = sRegisteredHandlers->end();
 	
 	std::string fileExt;
-	size_t extPos = strlen ( filePath );
-	for ( --extPos; extPos > 0; --extPos ) if ( filePath[extPos] == '.' ) break;
-	if ( filePath[extPos] == '.' ) {
-		++extPos;
-		fileExt.assign ( &filePath[extPos] );
-		for ( size_t i = 0; i < fileExt.size(); ++i ) {
-			if ( ('A' <= fileExt[i]) && (fileExt[i] <= 'Z') ) fileExt[i] += 0x20;
-		}
-	}
+	GetFileExtension ( filePath, &fileExt );
 	
 	this->format = kXMP_UnknownFile;	// Make sure it is preset for later check.
 	this->openFlags = openFlags;		// ! The QuickTime support needs the InBackground bit.
+	DropFilePrefix ( this );			// Make sure a prefix from an earlier failed open is not used.
+	
+	// Try the index cache before doing any I/O on the file itself. A reopen from GetXMP must not
+	// find the entry that caused it.
+	
+	bool reopening = (this->indexState == kIndexState_Reopen);
+	this->indexState = kIndexState_None;
+	this->formatHint = format;
+	
+	if ( (! sIndexCacheFolder->empty()) && (! (openFlags & kIndexCacheExcluded)) &&
+		 GetFileIdentity ( filePath, &this->fileIdentity ) ) {
+		this->indexState = kIndexState_Miss;
+		if ( (! reopening) && OpenFromIndexCache ( this, filePath, fileExt ) ) return true;
+	}
 	
 	if ( ! (openFlags & kXMPFiles_OpenUsePacketScanning) ) {
 
@@ -469,10 +827,11 @@ XMPFiles::OpenFile ( XMP_StringPtr  filePath,
 		if ( handlerPos != sRegisteredHandlers->end() ) {
 			if ( ! (handlerPos->flags & kXMPFiles_HandlerOwnsFile) ) fileRef = LFA_Open ( filePath, openMode );
 			this->format = handlerPos->format;	// ! Hack to tell the CheckProc this is the first call.
-			foundHandler = handlerPos->checkProc ( handlerPos->format, filePath, fileRef, this );
+			foundHandler = CallCheckProc ( handlerPos, filePath, fileRef, this );
 		}
 		
 		if ( (openFlags & kXMPFiles_OpenStrictly) && (format != kXMP_UnknownFile) && (! foundHandler) ) {
+			DropFilePrefix ( this );
 			return false;
 		}
 		
@@ -483,7 +842,7 @@ XMPFiles::OpenFile ( XMP_StringPtr  filePath,
 			for ( handlerPos = sRegisteredHandlers->begin(); handlerPos != sRegisteredHandlers->end(); ++handlerPos ) {
 				if ( handlerPos->flags & kXMPFiles_HandlerOwnsFile ) break;
 				this->format = kXMP_UnknownFile;	// ! Hack to tell the CheckProc this is not the first call.
-				foundHandler = handlerPos->checkProc ( handlerPos->format, filePath, fileRef, this );
+				foundHandler = CallCheckProc ( handlerPos, filePath, fileRef, this );
 				if ( foundHandler ) break;	// ! Exit before incrementing handlerPos.
 			}
 		}
@@ -492,10 +851,11 @@ XMPFiles::OpenFile ( XMP_StringPtr  filePath,
 		if ( ! foundHandler ) {
 			LFA_Close ( fileRef );
 			fileRef = 0;
+			DropFilePrefix ( this );	// The owning handlers don't use the prefix.
 			for ( ; handlerPos != sRegisteredHandlers->end(); ++handlerPos ) {
 				XMP_Assert ( handlerPos->flags & kXMPFiles_HandlerOwnsFile );
 				this->format = kXMP_UnknownFile;	// ! Hack to tell the CheckProc this is not the first call.
-				foundHandler = handlerPos->checkProc ( handlerPos->format, filePath, 0, this );
+				foundHandler = CallCheckProc ( handlerPos, filePath, 0, this );
 				if ( foundHandler ) break;	// ! Exit before incrementing handlerPos.
 			}
 		}
@@ -542,9 +902,15 @@ XMPFiles::OpenFile ( XMP_StringPtr  filePath,
 	XMP_Assert ( handlerFlags == handler->handlerFlags );
 	
 	this->handler = handler;
+	this->handlerFormat = format;
 	if ( this->format == kXMP_UnknownFile ) this->format = format;	// ! The CheckProc might have set it.
+	if ( handlerFlags & kXMPFiles_HandlerOwnsFile ) this->indexState = kIndexState_None;
 	
-	handler->CacheFileData();
+	{
+		PerfPhaseTimer perf ( kXMPFiles_PerfPhase_CacheFileData, format );
+		handler->CacheFileData();
+	}
+	DropFilePrefix ( this );
 	
 	if ( ! (openFlags & kXMPFiles_OpenCacheTNail) ) {
 		handler->containsTNail = false;	// Make sure GetThumbnail will cleanly return false.
@@ -581,14 +947,24 @@ XMPFiles::CloseFile ( XMP_OptionBits closeFlags /* = 0 */ )
 	bool needsUpdate = this->handler->needsUpdate;
 	XMP_OptionBits handlerFlags = this->handler->handlerFlags;
 	
+	// Keep the index cache current. An updated file's entry is removed before and after the update,
+	// the second time in case another read-only open cached the old content in between.
+	
+	bool forgetIndexEntry = needsUpdate && (! sIndexCacheFolder->empty());
+	if ( forgetIndexEntry ) RemoveIndexEntry ( this->filePath.c_str() );
+
+	if ( (! needsUpdate) && (this->indexState != kIndexState_None) ) {
+		bool newTree = this->handler->processedXMP &&
+					   ((! this->handler->containsXMP) || (sIndexCacheOptions & kXMPFiles_IndexCacheXMPTree));
+		if ( (this->indexState == kIndexState_Miss) || ((this->indexState == kIndexState_Hit) && newTree) ) {
+			WriteIndexEntry ( this );
+		}
+	}
+	
 	// Decide if we're doing a safe update. If so, make sure the handler supports it. All handlers
 	// that don't own the file tolerate safe update using common code below.
 	
 	bool doSafeUpdate = XMP_OptionIsSet ( closeFlags, kXMPFiles_UpdateSafely );
-	#if GatherPerformanceData
-		if ( doSafeUpdate ) sAPIPerf->back().extraInfo += ", safe update";	// Client wants safe update.
-	#endif
-
 	if ( ! (this->openFlags & kXMPFiles_OpenForUpdate) ) doSafeUpdate = false;
 	if ( ! needsUpdate ) doSafeUpdate = false;
 	
@@ -615,11 +991,10 @@ XMPFiles::CloseFile ( XMP_OptionBits closeFlags /* = 0 */ )
 		
 			// Close the file without doing common crash-safe writing. The handler might do it.
 
-			#if GatherPerformanceData
-				if ( needsUpdate ) sAPIPerf->back().extraInfo += ", direct update";
-			#endif
-
-			if ( needsUpdate ) this->handler->UpdateFile ( doSafeUpdate );
+			if ( needsUpdate ) {
+				PerfPhaseTimer perf ( kXMPFiles_PerfPhase_UpdateFile );
+				this->handler->UpdateFile ( doSafeUpdate );
+			}
 			delete this->handler;
 			this->handler = 0;
 			if ( this->fileRef != 0 ) LFA_Close ( this->fileRef );
@@ -636,14 +1011,14 @@ XMPFiles::CloseFile ( XMP_OptionBits closeFlags /* = 0 */ )
 				// The handler can rewrite an entire file based on the original. Do this into a temp
 				// file next to the original, with the same ownership and permissions if possible.
 
-				#if GatherPerformanceData
-					sAPIPerf->back().extraInfo += ", file rewrite";
-				#endif
-				
-				CreateTempFile ( origFilePath, &tempFilePath, kCopyMacRsrc );
-				tempFileRef = LFA_Open ( tempFilePath.c_str(), 'w' );
+				{
+					PerfPhaseTimer perf ( kXMPFiles_PerfPhase_SafeSaveCopy );
+					CreateTempFile ( origFilePath, &tempFilePath, kCopyMacRsrc );
+					tempFileRef = LFA_Open ( tempFilePath.c_str(), 'w' );
+				}
 				this->fileRef = tempFileRef;
 				this->filePath = tempFilePath;
+				PerfPhaseTimer perf ( kXMPFiles_PerfPhase_UpdateFile );
 				this->handler->WriteFile ( origFileRef, origFilePath );
 
 			} else {
@@ -662,39 +1037,41 @@ XMPFiles::CloseFile ( XMP_OptionBits closeFlags /* = 0 */ )
 				// *** preserve ownership and permissions. Then the original can stay put until
 				// *** the final delete/rename.
 
-				#if GatherPerformanceData
-					sAPIPerf->back().extraInfo += ", copy update";
-				#endif
-				
-				CreateTempFile ( origFilePath, &copyFilePath, kCopyMacRsrc );
-				copyFileRef = LFA_Open ( copyFilePath.c_str(), 'w' );
-				XMP_Int64 fileSize = LFA_Measure ( origFileRef );
-				LFA_Seek ( origFileRef, 0, SEEK_SET );
-				LFA_Copy ( origFileRef, copyFileRef, fileSize, this->abortProc, this->abortArg );
-
-				LFA_Close ( origFileRef );
-				origFileRef = this->fileRef = 0;
-				LFA_Close ( copyFileRef );
-				copyFileRef = 0;
-
-				CreateTempFile ( origFilePath, &tempFilePath );
-				LFA_Delete ( tempFilePath.c_str() );	// ! Slight risk of name being grabbed before rename.
-				LFA_Rename ( origFilePath.c_str(), tempFilePath.c_str() );
-
-				tempFileRef = LFA_Open ( tempFilePath.c_str(), 'w' );
-				this->fileRef = tempFileRef;
-
-				try {
-					LFA_Rename ( copyFilePath.c_str(), origFilePath.c_str() );
-				} catch ( ... ) {
-					this->fileRef = 0;
-					LFA_Close ( tempFileRef );
-					LFA_Rename ( tempFilePath.c_str(), origFilePath.c_str() );
-					throw;
+				{
+					PerfPhaseTimer perf ( kXMPFiles_PerfPhase_SafeSaveCopy );
+
+					CreateTempFile ( origFilePath, &copyFilePath, kCopyMacRsrc );
+					copyFileRef = LFA_Open ( copyFilePath.c_str(), 'w' );
+					XMP_Int64 fileSize = LFA_Measure ( origFileRef );
+					LFA_Seek ( origFileRef, 0, SEEK_SET );
+					LFA_Copy ( origFileRef, copyFileRef, fileSize, this->abortProc, this->abortArg,
+							   XMP_OptionIsSet ( this->openFlags, kXMPFiles_OpenDropBehind ) );
+
+					LFA_Close ( origFileRef );
+					origFileRef = this->fileRef = 0;
+					LFA_Close ( copyFileRef );
+					copyFileRef = 0;
+
+					CreateTempFile ( origFilePath, &tempFilePath );
+					LFA_Delete ( tempFilePath.c_str() );	// ! Slight risk of name being grabbed before rename.
+					LFA_Rename ( origFilePath.c_str(), tempFilePath.c_str() );
+
+					tempFileRef = LFA_Open ( tempFilePath.c_str(), 'w' );
+					this->fileRef = tempFileRef;
+
+					try {
+						LFA_Rename ( copyFilePath.c_str(), origFilePath.c_str() );
+					} catch ( ... ) {
+						this->fileRef = 0;
+						LFA_Close ( tempFileRef );
+						LFA_Rename ( tempFilePath.c_str(), origFilePath.c_str() );
+						throw;
+					}
 				}
 
 				XMP_Assert ( (tempFileRef != 0) && (tempFileRef == this->fileRef) );
 				this->filePath = tempFilePath;
+				PerfPhaseTimer perf ( kXMPFiles_PerfPhase_UpdateFile );
 				this->handler->UpdateFile ( false );	// We're doing the safe update, not the handler.
 
 			}
@@ -744,6 +1121,8 @@ XMPFiles::CloseFile ( XMP_OptionBits closeFlags /* = 0 */ )
 	
 	}
 	
+	if ( forgetIndexEntry ) RemoveIndexEntry ( origFilePath.c_str() );
+
 	// Clear the XMPFiles member variables.
 	
 	this->handler   = 0;
@@ -751,6 +1130,7 @@ XMPFiles::CloseFile ( XMP_OptionBits closeFlags /* = 0 */ )
 	this->fileRef   = 0;
 	this->filePath.clear();
 	this->openFlags = 0;
+	this->indexState = kIndexState_None;
 	
 }	// XMPFiles::CloseFile
  
@@ -804,8 +1184,16 @@ XMPFiles::GetXMP ( SXMPMeta *       xmpObj /* = 0 */,
 {
 	if ( this->handler == 0 ) XMP_Throw ( "XMPFiles::GetXMP - No open file", kXMPErr_BadObject );
 	
-	if ( ! this->handler->processedXMP ) {
+	if ( (! this->handler->processedXMP) && (this->indexState == kIndexState_Hit) &&
+		 ((xmpObj != 0) || (! this->handler->containsXMP)) ) {
+		// The index cache entry has only the raw packet, processing needs the file's legacy. Without
+		// a packet processing decides if there is XMP at all, from the legacy.
+		ReopenWithoutIndexCache ( this );
+	}
+	
+	if ( (! this->handler->processedXMP) && (this->indexState != kIndexState_Hit) ) {
 		try {
+			PerfPhaseTimer perf ( kXMPFiles_PerfPhase_ProcessXMP );
 			this->handler->ProcessXMP();
 		} catch ( ... ) {
 			// Return the outputs then rethrow the exception.
@@ -841,6 +1229,211 @@ XMPFiles::GetXMP ( SXMPMeta *       xmpObj /* = 0 */,
  
 // =================================================================================================
 
+enum { kDefaultBatchThreads = 4, kMaxBatchThreads = 64 };
+
+struct BatchJob {
+	XMP_Mutex             lock;		// Protects nextFile.
+	XMP_Int32             nextFile;
+	XMP_Int32             fileCount;
+	const XMP_StringPtr * filePaths;
+	XMP_FileFormat        format;
+	XMP_OptionBits        openFlags;
+	XMP_BatchFileInfo *   fileInfo;
+	XMPMetaRef *          xmpRefs;
+	bool                  wantPackets;
+	XMP_Int32             prefetchAhead;	// How far ahead of nextFile to prefetch, 0 for none.
+};
+
+// -------------------------------------------------------------------------------------------------
+// ProcessBatchFile
+// ----------------
+//
+// Do the open/get/close cycle for one file of a batch. All exceptions are caught and turned into
+// the file's status. If there is no XMP object for this file don't call GetXMP, that would parse
+// and reconcile under the XMPCore lock just to throw the result away. The raw packet found by
+// CacheFileData is all that is needed. The calls bypass the WXMPFiles wrappers, so they are timed
+// here for the performance counters.
+
+static void
+ProcessBatchFile ( BatchJob * job, XMP_Int32 fileIndex )
+{
+	XMP_BatchFileInfo * info = &job->fileInfo[fileIndex];
+	*info = XMP_BatchFileInfo();
+	
+	try {
+
+		XMPFiles fileObj;
+		bool fileOpened;
+		{
+			PerfAPITimer perf ( kXMPFiles_PerfAPI_OpenFile, &fileObj );
+			fileOpened = fileObj.OpenFile ( job->filePaths[fileIndex], job->format, job->openFlags );
+		}
+		if ( ! fileOpened ) return;	// Leave the status as kXMPFiles_BatchNotOpened.
+		info->format = fileObj.format;
+		
+		XMPMetaRef xmpRef = 0;
+		if ( job->xmpRefs != 0 ) xmpRef = job->xmpRefs[fileIndex];
+		
+		bool hasXMP;
+		XMP_StringPtr packetStr = 0;
+		XMP_StringLen packetLen = 0;
+
+		if ( xmpRef != 0 ) {
+			SXMPMeta xmpObj ( xmpRef );
+			PerfAPITimer perf ( kXMPFiles_PerfAPI_GetXMP, &fileObj );
+			hasXMP = fileObj.GetXMP ( &xmpObj, &packetStr, &packetLen, &info->packetInfo );
+		} else {
+			XMPFileHandler * handler = fileObj.handler;
+			hasXMP = handler->containsXMP;
+			packetStr = handler->xmpPacket.c_str();
+			packetLen = handler->xmpPacket.size();
+			info->packetInfo = handler->packetInfo;
+		}
+
+		if ( hasXMP ) {
+			info->status = kXMPFiles_BatchHasXMP;
+			if ( job->wantPackets ) (*sBatchPackets)[fileIndex].assign ( packetStr, packetLen );
+		} else {
+			info->status = kXMPFiles_BatchNoXMP;
+			info->packetInfo = XMP_PacketInfo();
+		}
+		
+		PerfAPITimer perf ( kXMPFiles_PerfAPI_CloseFile, &fileObj );
+		fileObj.CloseFile();
+
+	} catch ( XMP_Error & excep ) {
+		info->status  = kXMPFiles_BatchFailed;
+		info->errorID = excep.GetID();
+	} catch ( ... ) {
+		info->status  = kXMPFiles_BatchFailed;
+		info->errorID = kXMPErr_Unknown;
+	}
+
+}	// ProcessBatchFile
+
+// -------------------------------------------------------------------------------------------------
+// PrefetchBatchFile
+// -----------------
+//
+// Start reading the probe prefix of a file a worker will get to soon, so that its OpenFile finds
+// the prefix in the cache instead of waiting on the disk. Failures are ignored, ProcessBatchFile
+// reports them when it gets to the file.
+
+static void
+PrefetchBatchFile ( BatchJob * job, XMP_Int32 fileIndex )
+{
+	try {
+		LFA_FileRef fileRef = LFA_Open ( job->filePaths[fileIndex], 'r' );
+		LFA_Prefetch ( fileRef, 0, kProbeBufferSize );
+		LFA_Close ( fileRef );
+	} catch ( ... ) {
+		// Ignore it, this is only a hint.
+	}
+
+}	// PrefetchBatchFile
+
+// -------------------------------------------------------------------------------------------------
+// BatchWorker
+// -----------
+//
+// The thread proc for GetXMPBatch, also run by the calling thread. Pull file indices until there
+// are none left. The files are handed out in order, but finish in whatever order they finish.
+// Each worker prefetches the file prefetchAhead past the one it takes, every file past the first
+// prefetchAhead is prefetched once.
+
+static void
+BatchWorker ( void * procArg )
+{
+	BatchJob * job = (BatchJob*)procArg;
+	
+	while ( true ) {
+		XMP_EnterCriticalRegion ( job->lock );
+		XMP_Int32 fileIndex = job->nextFile;
+		if ( fileIndex < job->fileCount ) ++job->nextFile;
+		XMP_ExitCriticalRegion ( job->lock );
+		if ( fileIndex >= job->fileCount ) break;
+		if ( (job->prefetchAhead > 0) && (fileIndex < (job->fileCount - job->prefetchAhead)) ) {
+			PrefetchBatchFile ( job, (fileIndex + job->prefetchAhead) );
+		}
+		ProcessBatchFile ( job, fileIndex );
+	}
+
+}	// BatchWorker
+
+// -------------------------------------------------------------------------------------------------
+
+/* class static */
+void
+XMPFiles::GetXMPBatch ( XMP_Int32             fileCount,
+                        const XMP_StringPtr * filePaths,
+                        XMP_FileFormat        format,
+                        XMP_OptionBits        openFlags,
+                        XMP_Int32             maxThreads,
+                        XMP_BatchFileInfo *   fileInfo,
+                        XMPMetaRef *          xmpRefs /* = 0 */,
+                        XMP_StringPtr *       xmpPackets /* = 0 */,
+                        XMP_StringLen *       xmpPacketLens /* = 0 */ )
+{
+	if ( openFlags & kXMPFiles_OpenForUpdate ) XMP_Throw ( "XMPFiles::GetXMPBatch - Update not allowed", kXMPErr_BadOptions );
+	if ( fileCount < 0 ) XMP_Throw ( "XMPFiles::GetXMPBatch - Negative file count", kXMPErr_BadParam );
+	if ( fileCount == 0 ) return;
+	if ( (filePaths == 0) || (fileInfo == 0) ) XMP_Throw ( "XMPFiles::GetXMPBatch - Null parameter", kXMPErr_BadParam );
+	if ( (xmpPackets == 0) != (xmpPacketLens == 0) ) XMP_Throw ( "XMPFiles::GetXMPBatch - Need both packets and lengths", kXMPErr_BadParam );
+	
+	// Size the packet storage first, the workers assign in place and must not cause reallocation.
+	
+	sBatchPackets->clear();
+	if ( xmpPackets != 0 ) sBatchPackets->resize ( fileCount );
+
+	BatchJob job;
+	job.nextFile    = 0;
+	job.fileCount   = fileCount;
+	job.filePaths   = filePaths;
+	job.format      = format;
+	job.openFlags   = openFlags;
+	job.fileInfo    = fileInfo;
+	job.xmpRefs     = xmpRefs;
+	job.wantPackets = (xmpPackets != 0);
+	
+	if ( maxThreads <= 0 ) maxThreads = kDefaultBatchThreads;
+	if ( maxThreads > kMaxBatchThreads ) maxThreads = kMaxBatchThreads;
+	if ( maxThreads > fileCount ) maxThreads = fileCount;
+	
+	// Prefetch one file ahead per worker. LFA_Prefetch only does something on UNIX, elsewhere the
+	// extra open and close would be wasted.
+	
+	#if XMP_UNIXBuild
+		job.prefetchAhead = maxThreads;
+	#else
+		job.prefetchAhead = 0;
+	#endif
+
+	if ( ! XMP_InitMutex ( &job.lock ) ) XMP_Throw ( "XMPFiles::GetXMPBatch - Can't create mutex", kXMPErr_ExternalFailure );
+	
+	// The calling thread is one of the workers. A thread that fails to start is just not used.
+
+	XMP_Thread threads [kMaxBatchThreads];
+	XMP_Int32  threadCount = 0;
+	for ( XMP_Int32 i = 1; i < maxThreads; ++i ) {
+		if ( XMP_StartThread ( &threads[threadCount], BatchWorker, &job ) ) ++threadCount;
+	}
+	
+	BatchWorker ( &job );
+	for ( XMP_Int32 i = 0; i < threadCount; ++i ) XMP_JoinThread ( &threads[i] );
+
+	XMP_TermMutex ( job.lock );
+	
+	if ( xmpPackets != 0 ) {
+		for ( XMP_Int32 i = 0; i < fileCount; ++i ) {
+			xmpPackets[i] = (*sBatchPackets)[i].c_str();
+			xmpPacketLens[i] = (*sBatchPackets)[i].size();
+		}
+	}
+
+}	// XMPFiles::GetXMPBatch
+ 
+// =================================================================================================
+
 bool
 XMPFiles::GetThumbnail ( XMP_ThumbnailInfo * tnailInfo )
 {
@@ -873,7 +1466,10 @@ DoPutXMP ( XMPFiles * thiz, const SXMPMeta & xmpObj, const bool doIt )
 	XMP_PacketInfo & packetInfo   = handler->packetInfo;
 	std::string &    xmpPacket    = handler->xmpPacket;
 	
-	if ( ! handler->processedXMP ) handler->ProcessXMP();	// Might have Open/Put with no GetXMP.
+	if ( ! handler->processedXMP ) {	// Might have Open/Put with no GetXMP.
+		PerfPhaseTimer perf ( kXMPFiles_PerfPhase_ProcessXMP );
+		handler->ProcessXMP();
+	}
 	
 	size_t oldPacketOffset = (size_t)packetInfo.offset;
 	size_t oldPacketLength = packetInfo.length;
@@ -909,6 +1505,7 @@ DoPutXMP ( XMPFiles * thiz, const SXMPMeta & xmpObj, const bool doIt )
 	if ( tryInPlace ) {
 		XMP_Assert ( handler->containsXMP && (oldPacketLength == xmpPacket.size()) );
 		try {
+			PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
 			xmpObj.SerializeToBuffer ( &xmpPacket, (options | kXMP_ExactPacketLength), oldPacketLength );
 			XMP_Assert ( xmpPacket.size() == oldPacketLength );
 		} catch ( ... ) {
@@ -923,6 +1520,7 @@ DoPutXMP ( XMPFiles * thiz, const SXMPMeta & xmpObj, const bool doIt )
 	
 	if ( ! tryInPlace ) {
 		try {
+			PerfPhaseTimer perf ( kXMPFiles_PerfPhase_Serialize );
 			xmpObj.SerializeToBuffer ( &xmpPacket, options );
 		} catch ( ... ) {
 			if ( ! doIt ) return false;
@@ -102,6 +102,28 @@ class XMPFileHandler;
 //	CanPutXMP:
 //		- Implement roughly as shown in TXMPFiles.hpp, there is no handler CanPutXMP method.
 //
+//	SetIndexCache:
+//		- Static. Sets the folder for the persistent index cache, an empty path turns it off.
+//		- OpenFile looks up read-only opens in the cache before trying any CheckProcs. A hit creates
+//		  the handler but skips CacheFileData, the packet info and raw packet come from the entry.
+//		- CloseFile writes the entry for read-only opens, and removes it for updated files.
+//		- GetXMP reopens the file normally if an XMP object is wanted and the entry had no tree.
+//
+//	SetPerfCounters, GetPerfCounters:
+//		- Static. Turn the performance counters on or off, reset them, and copy them out.
+//		- The WXMPFiles wrappers time each API call with a PerfAPITimer, the phases within the
+//		  calls are timed where they happen with a PerfPhaseTimer. The LFA functions count I/O.
+//		- Counts are kept as totals and per handler format, see "Performance counters" in
+//		  XMPFiles_Impl.hpp for how work is attributed to a handler.
+//
+//	GetXMPBatch:
+//		- Static, read-only. Process a list of files on a small set of worker threads.
+//		- Each worker pulls the next file index, then does OpenFile, GetXMP, CloseFile on its own
+//		  local XMPFiles object. Results are stored by index, so they are in input order.
+//		- Exceptions are caught per file and reported in the XMP_BatchFileInfo, never rethrown.
+//		- If no XMP object is wanted for a file the raw packet is returned without parsing or
+//		  reconciliation, avoiding the XMPCore lock entirely.
+//
 // -------------------------------------------------------------------------------------------------
 //
 // The format checker should do nothing but the minimal work to identify the overall file format.
@@ -112,10 +134,10 @@ class XMPFileHandler;
 // open or close the file themselves unless the handler sets the "handler-owns-file" flag.
 //
 // The format checker is passed the format being checked, allowing one checker to handle multiple
-// formats. It is passed the LFA file ref so that it can do additional reads if necessary. The
-// buffer is from the start of the file, the file will be positioned to the byte following the
-// buffer. The buffer length will be at least 4K, unless the file is smaller in which case it will
-// be the length of the file. This buffer may be reused for additional reads.
+// formats. It is passed the LFA file ref so that it can do additional reads if necessary. The start
+// of the file should be looked at through GetFilePrefix (or FillProbeBuffer for an IOBuffer), this
+// is read once per OpenFile and shared by all of the format checkers. The prefix is the first 64K
+// of the file, unless the file is smaller in which case it is the whole file.
 //
 // Identifying some file formats can require checking variable length strings. Doing seeks and reads
 // for each is suboptimal. There are utilities to maintain a rolling buffer and ensure that a given
@@ -140,7 +162,8 @@ class XMPFileHandler;
 //
 // The handler methods will be called in a per-object thread safe manner. Concurrent access might
 // occur for different objects, but not for the same object. The handler's constructor and destructor
-// will always be globally serialized, so they can safely modify global data structures.
+// are globally serialized for the normal API, but not within GetXMPBatch, where several read-only
+// handlers can be created and deleted concurrently. Handlers must not modify global data structures.
 //
 // (Testing issue: What about separate XMPFiles objects accessing the same file?)
 //
@@ -156,6 +179,14 @@ class XMPFileHandler;
 //
 // =================================================================================================
 
+struct XMP_FileIdentity {	// What identifies a file's content for the index cache.
+	XMP_Uns64 volumeID;
+	XMP_Uns64 fileID;
+	XMP_Uns64 fileSize;
+	XMP_Int64 modTime;	// In platform specific units, only compared for equality.
+	XMP_FileIdentity() : volumeID(0), fileID(0), fileSize(0), modTime(0) {};
+};
+
 class XMPFiles {
 public:
 
@@ -173,6 +204,24 @@ public:
 	static bool GetFormatInfo ( XMP_FileFormat   format,
                                 XMP_OptionBits * flags = 0 );
 
+	static void GetXMPBatch ( XMP_Int32             fileCount,
+	                          const XMP_StringPtr * filePaths,
+	                          XMP_FileFormat        format,
+	                          XMP_OptionBits        openFlags,
+	                          XMP_Int32             maxThreads,
+	                          XMP_BatchFileInfo *   fileInfo,
+	                          XMPMetaRef *          xmpRefs = 0,
+	                          XMP_StringPtr *       xmpPackets = 0,
+	                          XMP_StringLen *       xmpPacketLens = 0 );
+
+	static void SetIndexCache ( XMP_StringPtr  cacheFolder,
+	                            XMP_OptionBits options = 0 );
+
+	static void SetPerfCounters ( XMP_OptionBits options );
+
+	static bool GetPerfCounters ( XMP_FileFormat     handlerFormat,
+	                              XMP_PerfCounters * counters );
+
 	bool OpenFile ( XMP_StringPtr  filePath,
 			        XMP_FileFormat format = kXMP_UnknownFile,
 			        XMP_OptionBits openFlags = 0 );
@@ -215,6 +264,14 @@ public:
 	XMP_OptionBits   openFlags;
 	XMPFileHandler * handler;		// Non-null if a file is open.
 	void *           handlerTemp;	// For use between the CheckProc and handler creation.
+	
+	std::string      filePrefix;	// The start of the file, shared by the CheckProcs during OpenFile.
+	bool             havePrefix;
+	
+	XMP_Uns8         indexState;	// How this open relates to the index cache, see XMPFiles.cpp.
+	XMP_FileIdentity fileIdentity;	// The identity when opened, valid if indexState is not "none".
+	XMP_FileFormat   formatHint;	// The format passed to OpenFile, part of the index cache key.
+	XMP_FileFormat   handlerFormat;	// The registered format of the handler, kXMP_UnknownFile for the scanner.
 
 	XMP_AbortProc    abortProc;
 	void *           abortArg;
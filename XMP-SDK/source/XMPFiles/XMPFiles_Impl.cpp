@@ -17,6 +17,11 @@
 	#include <fcntl.h>
 	#include <sys/stat.h>
 	#include <unistd.h>
+	#include <time.h>
+#endif
+
+#if XMP_MacBuild | XMP_UNIXBuild
+	#include <sys/time.h>
 #endif
 
 using namespace std;
@@ -146,6 +151,265 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 // =================================================================================================
 
 // =================================================================================================
+// Performance counters
+// ====================
+
+volatile bool sPerfCountersOn = false;
+static XMP_ThreadKey sPerfThreadKey;	// Points to the PerfThreadState of the outermost running timer.
+
+typedef std::map < XMP_FileFormat, XMP_PerfCounters > PerfHandlerMap;
+
+static XMP_Mutex sPerfLock;
+static XMP_PerfCounters * sPerfTotals = 0;
+static PerfHandlerMap * sPerfHandlers = 0;
+
+struct PerfAutoLock {	// Not XMPFiles_AutoMutex, that is only for sXMPFilesLock.
+	PerfAutoLock() { XMP_EnterCriticalRegion ( sPerfLock ); };
+	~PerfAutoLock() { XMP_ExitCriticalRegion ( sPerfLock ); };
+};
+
+// -------------------------------------------------------------------------------------------------
+// PerfMicroseconds
+// ----------------
+//
+// Microseconds since some arbitrary start, only differences are meaningful.
+
+static XMP_Uns64 PerfMicroseconds()
+{
+
+	#if XMP_WinBuild
+
+		static LARGE_INTEGER frequency = { 0 };
+		if ( frequency.QuadPart == 0 ) QueryPerformanceFrequency ( &frequency );
+		LARGE_INTEGER now;
+		QueryPerformanceCounter ( &now );
+		return (XMP_Uns64) (now.QuadPart / (frequency.QuadPart / 1000000.0));
+
+	#else
+
+		#if XMP_UNIXBuild && defined ( CLOCK_MONOTONIC )
+			struct timespec now;
+			if ( clock_gettime ( CLOCK_MONOTONIC, &now ) == 0 ) {
+				return ((XMP_Uns64)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+			}
+		#endif
+
+		struct timeval tod;
+		gettimeofday ( &tod, 0 );
+		return ((XMP_Uns64)tod.tv_sec * 1000000) + tod.tv_usec;
+
+	#endif
+
+}	// PerfMicroseconds
+
+// -------------------------------------------------------------------------------------------------
+
+static void AddTiming ( XMP_PerfTiming * timing, XMP_Uns64 micros )
+{
+	++timing->callCount;
+	timing->totalMicroseconds += micros;
+	if ( micros > timing->maxMicroseconds ) timing->maxMicroseconds = micros;
+	
+	size_t bucket = 0;	// Bucket i counts times from 2^(i-1) up to 2^i us, bucket 0 is under 1 us.
+	while ( (bucket < kXMPFiles_PerfBucketCount-1) && (micros >= ((XMP_Uns64)1 << bucket)) ) ++bucket;
+	++timing->buckets[bucket];
+
+}	// AddTiming
+
+// -------------------------------------------------------------------------------------------------
+
+static void AddPendingIO ( XMP_PerfCounters * counters, const PerfPendingIO & pending )
+{
+	counters->readCalls    += pending.calls[kPerfIO_Read];
+	counters->bytesRead    += pending.bytesRead;
+	counters->writeCalls   += pending.calls[kPerfIO_Write];
+	counters->bytesWritten += pending.bytesWritten;
+	counters->seekCalls    += pending.calls[kPerfIO_Seek];
+	counters->otherCalls   += pending.calls[kPerfIO_Other];
+
+}	// AddPendingIO
+
+// -------------------------------------------------------------------------------------------------
+// FlushPendingIO
+// --------------
+//
+// Move a thread's pending I/O counts to the totals and the current handler. The caller must hold
+// sPerfLock.
+
+static void FlushPendingIO ( PerfThreadState * state )
+{
+	PerfPendingIO & pending = state->pending;
+	
+	XMP_Uns64 anyCalls = 0;
+	for ( size_t i = 0; i < kPerfIOKindCount; ++i ) anyCalls |= pending.calls[i];
+	if ( anyCalls == 0 ) return;
+
+	AddPendingIO ( sPerfTotals, pending );
+	if ( state->currentHandler != 0 ) AddPendingIO ( &(*sPerfHandlers)[state->currentHandler], pending );
+	memset ( &pending, 0, sizeof(pending) );
+
+}	// FlushPendingIO
+
+// -------------------------------------------------------------------------------------------------
+// PerfNoteThreadIO
+// ----------------
+//
+// Count one LFA call. Inside a timer this only touches the thread's pending counts, outside of any
+// timer there is nothing to flush them later so they go straight to the totals.
+
+void PerfNoteThreadIO ( XMP_Uns8 kind, XMP_Int64 bytes )
+{
+	PerfThreadState * state = (PerfThreadState*) XMP_GetThreadValue ( sPerfThreadKey );
+	
+	PerfThreadState oneCall;
+	if ( state == 0 ) {
+		memset ( &oneCall, 0, sizeof(oneCall) );
+		state = &oneCall;
+	}
+	
+	++state->pending.calls[kind];
+	if ( kind == kPerfIO_Read ) state->pending.bytesRead += bytes;
+	if ( kind == kPerfIO_Write ) state->pending.bytesWritten += bytes;
+
+	if ( state == &oneCall ) {
+		PerfAutoLock autoLock;
+		FlushPendingIO ( state );
+	}
+
+}	// PerfNoteThreadIO
+
+// -------------------------------------------------------------------------------------------------
+
+bool PerfInitialize()
+{
+	sPerfCountersOn = false;
+	sPerfTotals = new XMP_PerfCounters;
+	memset ( sPerfTotals, 0, sizeof(XMP_PerfCounters) );
+	sPerfHandlers = new PerfHandlerMap;
+	if ( ! XMP_InitMutex ( &sPerfLock ) ) return false;
+	return XMP_InitThreadKey ( &sPerfThreadKey );
+
+}	// PerfInitialize
+
+// -------------------------------------------------------------------------------------------------
+
+void PerfTerminate()
+{
+	sPerfCountersOn = false;
+	delete sPerfTotals;
+	sPerfTotals = 0;
+	delete sPerfHandlers;
+	sPerfHandlers = 0;
+	XMP_TermThreadKey ( sPerfThreadKey );
+	XMP_TermMutex ( sPerfLock );
+
+}	// PerfTerminate
+
+// -------------------------------------------------------------------------------------------------
+
+void PerfReset()
+{
+	PerfAutoLock autoLock;
+	memset ( sPerfTotals, 0, sizeof(XMP_PerfCounters) );
+	sPerfHandlers->clear();
+
+}	// PerfReset
+
+// -------------------------------------------------------------------------------------------------
+
+bool PerfGetCounters ( XMP_FileFormat handlerFormat, XMP_PerfCounters * counters )
+{
+	PerfAutoLock autoLock;
+	
+	PerfThreadState * state = (PerfThreadState*) XMP_GetThreadValue ( sPerfThreadKey );
+	if ( state != 0 ) FlushPendingIO ( state );	// Include I/O done so far by a running timer.
+	
+	if ( handlerFormat == kXMPFiles_PerfTotals ) {
+		*counters = *sPerfTotals;
+		XMP_Uns64 anyCounts = sPerfTotals->readCalls | sPerfTotals->writeCalls | sPerfTotals->seekCalls | sPerfTotals->otherCalls;
+		for ( size_t i = 0; i < kXMPFiles_PerfAPICount; ++i ) anyCounts |= sPerfTotals->api[i].callCount;
+		for ( size_t i = 0; i < kXMPFiles_PerfPhaseCount; ++i ) anyCounts |= sPerfTotals->phase[i].callCount;
+		return (anyCounts != 0);
+	}
+	
+	PerfHandlerMap::iterator pos = sPerfHandlers->find ( handlerFormat );
+	if ( pos == sPerfHandlers->end() ) {
+		memset ( counters, 0, sizeof(XMP_PerfCounters) );
+		return false;
+	}
+	
+	*counters = pos->second;
+	return true;
+
+}	// PerfGetCounters
+
+// -------------------------------------------------------------------------------------------------
+// PerfTimer::Start and PerfTimer::Stop
+// ------------------------------------
+//
+// The I/O done before the timer starts belongs to the enclosing timer, the I/O done while it runs
+// belongs to this one. An API timer's handler might only be known when it stops, as for OpenFile.
+//
+// The outermost timer on a thread makes its ownState the thread's state, nested timers share it.
+// Timers are always locals, so they stop in the reverse order they started.
+
+void PerfTimer::Start ( bool _isAPI, XMP_Uns8 _which, XMP_FileFormat _handlerFormat )
+{
+	this->threadState = (PerfThreadState*) XMP_GetThreadValue ( sPerfThreadKey );
+	if ( this->threadState == 0 ) {
+		memset ( &this->ownState, 0, sizeof(this->ownState) );
+		this->threadState = &this->ownState;
+		XMP_SetThreadValue ( sPerfThreadKey, this->threadState );
+	}
+	PerfThreadState * state = this->threadState;
+
+	this->isAPI = _isAPI;
+	this->which = _which;
+	this->savedHandler = state->currentHandler;
+	this->handlerFormat = _handlerFormat;
+	if ( (_handlerFormat == 0) && (! _isAPI) ) this->handlerFormat = state->currentHandler;
+	
+	{
+		PerfAutoLock autoLock;
+		FlushPendingIO ( state );
+	}
+	
+	state->currentHandler = this->handlerFormat;
+	this->startTime = PerfMicroseconds();
+
+}	// PerfTimer::Start
+
+// -------------------------------------------------------------------------------------------------
+
+void PerfTimer::Stop ( XMP_FileFormat lateFormat /* = 0 */ )
+{
+	XMP_Uns64 elapsed = PerfMicroseconds() - this->startTime;
+	if ( this->handlerFormat == 0 ) this->handlerFormat = lateFormat;
+	PerfThreadState * state = this->threadState;
+	
+	try {	// ! Called from destructors, possibly during exception unwinding.
+
+		PerfAutoLock autoLock;
+
+		state->currentHandler = this->handlerFormat;
+		FlushPendingIO ( state );
+		state->currentHandler = this->savedHandler;
+		
+		if ( this->isAPI ) {
+			AddTiming ( &sPerfTotals->api[this->which], elapsed );
+			if ( this->handlerFormat != 0 ) AddTiming ( &(*sPerfHandlers)[this->handlerFormat].api[this->which], elapsed );
+		} else {
+			AddTiming ( &sPerfTotals->phase[this->which], elapsed );
+			if ( this->handlerFormat != 0 ) AddTiming ( &(*sPerfHandlers)[this->handlerFormat].phase[this->which], elapsed );
+		}
+
+	} catch ( ... ) {
+		state->currentHandler = this->savedHandler;	// Just lose this timing.
+	}
+
+	if ( state == &this->ownState ) XMP_SetThreadValue ( sPerfThreadKey, 0 );
+
+}	// PerfTimer::Stop
 
 // =================================================================================================
 // LFA implementations for Macintosh
@@ -159,6 +423,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_Open ( const char * fileName, char mode )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		XMP_Assert ( (mode == 'r') || (mode == 'w') );
 		
 		FSRef fileRef;
@@ -183,6 +448,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_Create ( const char * fileName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		// *** Hack: Use fopen to avoid parent/child name separation needed by FSCreateFileUnicode.
 
 		FILE * temp;
@@ -204,6 +470,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Delete ( const char * fileName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		int err = remove ( fileName );	// *** Better to use an FS function.
 		if ( err != 0 ) XMP_Throw ( "LFA_Delete: remove failure", kXMPErr_ExternalFailure );
 		
@@ -213,6 +480,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Rename ( const char * oldName, const char * newName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		int err = rename ( oldName, newName );	// *** Better to use an FS function.
 		if ( err != 0 ) XMP_Throw ( "LFA_Rename: rename failure", kXMPErr_ExternalFailure );
 		
@@ -222,6 +490,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_OpenRsrc ( const char * fileName, char mode )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		XMP_Assert ( (mode == 'r') || (mode == 'w') );
 		
 		FSRef fileRef;
@@ -247,6 +516,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 	void LFA_Close ( LFA_FileRef file )
 	{
 		if ( file == 0 ) return;	// Can happen if LFA_Open throws an exception.
+		PerfNoteIO ( kPerfIO_Other );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 
 		OSErr err = FSCloseFork ( refNum );
@@ -258,6 +528,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int64 LFA_Seek ( LFA_FileRef file, XMP_Int64 offset, int mode, bool * okPtr )
 	{
+		PerfNoteIO ( kPerfIO_Seek );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 
 		UInt16 posMode;
@@ -312,6 +583,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 			XMP_Throw ( "LFA_Read: FSReadFork failure", kXMPErr_ExternalFailure );
 		}
 		
+		PerfNoteIO ( kPerfIO_Read, bytesRead );
 		return bytesRead;
 		
 	}	// LFA_Read
@@ -320,6 +592,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Write ( LFA_FileRef file, const void * buffer, XMP_Int32 bytes )
 	{
+		PerfNoteIO ( kPerfIO_Write, bytes );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 		ByteCount bytesWritten;
 		
@@ -332,6 +605,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Flush ( LFA_FileRef file )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 
 		OSErr err = FSFlushFork ( refNum );
@@ -343,6 +617,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int64 LFA_Measure ( LFA_FileRef file )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 		XMP_Int64 length;
 		
@@ -357,6 +632,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Extend ( LFA_FileRef file, XMP_Int64 length )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 		
 		OSErr err = FSSetForkSize ( refNum, fsFromStart, length );
@@ -368,6 +644,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Truncate ( LFA_FileRef file, XMP_Int64 length )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		long refNum = (long)file;	// ! Use long to avoid size warnings for SInt16 cast.
 		
 		OSErr err = FSSetForkSize ( refNum, fsFromStart, length );
@@ -377,6 +654,23 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	// ---------------------------------------------------------------------------------------------
 
+	void LFA_Prefetch ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length )
+	{
+		// *** There is no read-ahead hint for a fork refNum, the File Manager does its own caching.
+
+	}	// LFA_Prefetch
+
+	// ---------------------------------------------------------------------------------------------
+
+	void LFA_Advise ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length, XMP_Uns8 advice )
+	{
+		// *** The File Manager only takes caching hints per read, through the pleaseCache and
+		// *** noCacheMask position modes. Not worth threading through LFA_Read for now.
+
+	}	// LFA_Advise
+
+	// ---------------------------------------------------------------------------------------------
+
 #endif	// XMP_MacBuild
 
 // =================================================================================================
@@ -389,6 +683,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_Open ( const char * fileName, char mode )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		XMP_Assert ( (mode == 'r') || (mode == 'w') );
 		
 		DWORD access = GENERIC_READ;	// Assume read mode.
@@ -420,6 +715,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_Create ( const char * fileName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		std::string wideName;
 		const size_t utf8Len = strlen(fileName);
 		const size_t maxLen = 2 * (utf8Len+1);
@@ -450,6 +746,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Delete ( const char * fileName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		std::string wideName;
 		const size_t utf8Len = strlen(fileName);
 		const size_t maxLen = 2 * (utf8Len+1);
@@ -468,6 +765,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Rename ( const char * oldName, const char * newName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		std::string wideOldName, wideNewName;
 		size_t utf8Len = strlen(oldName);
 		if ( utf8Len < strlen(newName) ) utf8Len = strlen(newName);
@@ -494,6 +792,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 	void LFA_Close ( LFA_FileRef file )
 	{
 		if ( file == 0 ) return;	// Can happen if LFA_Open throws an exception.
+		PerfNoteIO ( kPerfIO_Other );
 		HANDLE fileHandle = (HANDLE)file;
 
 		BOOL ok = CloseHandle ( fileHandle );
@@ -505,6 +804,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int64 LFA_Seek ( LFA_FileRef file, XMP_Int64 offset, int mode, bool * okPtr )
 	{
+		PerfNoteIO ( kPerfIO_Seek );
 		HANDLE fileHandle = (HANDLE)file;
 
 		DWORD method;
@@ -547,6 +847,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 		BOOL ok = ReadFile ( fileHandle, buffer, bytes, &bytesRead, 0 );
 		if ( (! ok) || (requireAll && (bytesRead != bytes)) ) XMP_Throw ( "LFA_Read: ReadFile failure", kXMPErr_ExternalFailure );
 		
+		PerfNoteIO ( kPerfIO_Read, bytesRead );
 		return bytesRead;
 
 	}	// LFA_Read
@@ -555,6 +856,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Write ( LFA_FileRef file, const void * buffer, XMP_Int32 bytes )
 	{
+		PerfNoteIO ( kPerfIO_Write, bytes );
 		HANDLE fileHandle = (HANDLE)file;
 		DWORD  bytesWritten;
 		
@@ -567,6 +869,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Flush ( LFA_FileRef file )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		HANDLE fileHandle = (HANDLE)file;
 
 		BOOL ok = FlushFileBuffers ( fileHandle );
@@ -578,6 +881,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int64 LFA_Measure ( LFA_FileRef file )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		HANDLE fileHandle = (HANDLE)file;
 		LARGE_INTEGER length;
 		
@@ -592,6 +896,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Extend ( LFA_FileRef file, XMP_Int64 length )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		HANDLE fileHandle = (HANDLE)file;
 
 		LARGE_INTEGER winLength;
@@ -608,6 +913,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Truncate ( LFA_FileRef file, XMP_Int64 length )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		HANDLE fileHandle = (HANDLE)file;
 
 		LARGE_INTEGER winLength;
@@ -622,6 +928,23 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	// ---------------------------------------------------------------------------------------------
 
+	void LFA_Prefetch ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length )
+	{
+		// *** The file is not opened for overlapped I/O, so there is no cheap way to read ahead.
+		// *** Windows does sequential read-ahead on its own, random access is not helped.
+
+	}	// LFA_Prefetch
+
+	// ---------------------------------------------------------------------------------------------
+
+	void LFA_Advise ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length, XMP_Uns8 advice )
+	{
+		// *** FILE_FLAG_SEQUENTIAL_SCAN can only be given to CreateFile, not to an open handle.
+
+	}	// LFA_Advise
+
+	// ---------------------------------------------------------------------------------------------
+
 #endif	// XMP_WinBuild
 
 // =================================================================================================
@@ -640,6 +963,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_Open ( const char * fileName, char mode )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		XMP_Assert ( (mode == 'r') || (mode == 'w') );
 		
 		int flags = ((mode == 'r') ? O_RDONLY : O_RDWR);	// *** Include O_EXLOCK?
@@ -647,7 +971,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 		int descr = open ( fileName, flags, 0 );
 		if ( descr == -1 ) XMP_Throw ( "LFA_Open: open failure", kXMPErr_ExternalFailure );
 		
-		return (LFA_FileRef)descr;
+		return (LFA_FileRef)(size_t)descr;
 
 	}	// LFA_Open
 
@@ -655,6 +979,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	LFA_FileRef LFA_Create ( const char * fileName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		int descr;
 		
 		descr = open ( fileName, O_RDONLY, 0 );	// Make sure the file does not exist yet.
@@ -663,10 +988,10 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 			XMP_Throw ( "LFA_Create: file already exists", kXMPErr_ExternalFailure );
 		}
 
-		descr = open ( fileName, (O_CREAT | O_RDWR), 0 );	// *** Include O_EXCL? O_EXLOCK?
+		descr = open ( fileName, (O_CREAT | O_RDWR), 0666 );	// *** Include O_EXCL? O_EXLOCK? ! The umask applies.
 		if ( descr == -1 ) XMP_Throw ( "LFA_Create: open failure", kXMPErr_ExternalFailure );
 		
-		return (LFA_FileRef)descr;
+		return (LFA_FileRef)(size_t)descr;
 
 	}	// LFA_Create
 
@@ -674,6 +999,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Delete ( const char * fileName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		int err = unlink ( fileName );
 		if ( err != 0 ) XMP_Throw ( "LFA_Delete: unlink failure", kXMPErr_ExternalFailure );
 		
@@ -683,6 +1009,7 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Rename ( const char * oldName, const char * newName )
 	{
+		PerfNoteIO ( kPerfIO_Other );
 		int err = rename ( oldName, newName );	// *** POSIX rename clobbers existing destination!
 		if ( err != 0 ) XMP_Throw ( "LFA_Rename: rename failure", kXMPErr_ExternalFailure );
 		
@@ -693,7 +1020,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 	void LFA_Close ( LFA_FileRef file )
 	{
 		if ( file == 0 ) return;	// Can happen if LFA_Open throws an exception.
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Other );
+		int descr = (int)(size_t)file;
 
 		int err = close ( descr );
 		if ( err != 0 ) XMP_Throw ( "LFA_Close: close failure", kXMPErr_ExternalFailure );
@@ -704,7 +1032,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int64 LFA_Seek ( LFA_FileRef file, XMP_Int64 offset, int mode, bool * okPtr )
 	{
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Seek );
+		int descr = (int)(size_t)file;
 		
 		off_t newPos = lseek ( descr, offset, mode );
 		if ( okPtr != 0 ) {
@@ -721,11 +1050,12 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int32 LFA_Read ( LFA_FileRef file, void * buffer, XMP_Int32 bytes, bool requireAll )
 	{
-		int descr = (int)file;
+		int descr = (int)(size_t)file;
 		
 		ssize_t bytesRead = read ( descr, buffer, bytes );
 		if ( (bytesRead == -1) || (requireAll && (bytesRead != bytes)) ) XMP_Throw ( "LFA_Read: read failure", kXMPErr_ExternalFailure );
 		
+		PerfNoteIO ( kPerfIO_Read, bytesRead );
 		return bytesRead;
 
 	}	// LFA_Read
@@ -734,7 +1064,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Write ( LFA_FileRef file, const void * buffer, XMP_Int32 bytes )
 	{
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Write, bytes );
+		int descr = (int)(size_t)file;
 
 		ssize_t bytesWritten = write ( descr, buffer, bytes );
 		if ( bytesWritten != bytes ) XMP_Throw ( "LFA_Write: write failure", kXMPErr_ExternalFailure );
@@ -745,7 +1076,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Flush ( LFA_FileRef file )
 	{
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Other );
+		int descr = (int)(size_t)file;
 
 		int err = fsync ( descr );
 		if ( err != 0 ) XMP_Throw ( "LFA_Flush: fsync failure", kXMPErr_ExternalFailure );
@@ -756,7 +1088,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	XMP_Int64 LFA_Measure ( LFA_FileRef file )
 	{
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Other );
+		int descr = (int)(size_t)file;
 		
 		off_t currPos = lseek ( descr, 0, SEEK_CUR );
 		off_t length  = lseek ( descr, 0, SEEK_END );
@@ -771,7 +1104,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Extend ( LFA_FileRef file, XMP_Int64 length )
 	{
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Other );
+		int descr = (int)(size_t)file;
 		
 		int err = ftruncate ( descr, length );
 		if ( err != 0 ) XMP_Throw ( "LFA_Extend: ftruncate failure", kXMPErr_ExternalFailure );
@@ -782,7 +1116,8 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	void LFA_Truncate ( LFA_FileRef file, XMP_Int64 length )
 	{
-		int descr = (int)file;
+		PerfNoteIO ( kPerfIO_Other );
+		int descr = (int)(size_t)file;
 		
 		int err = ftruncate ( descr, length );
 		if ( err != 0 ) XMP_Throw ( "LFA_Truncate: ftruncate failure", kXMPErr_ExternalFailure );
@@ -791,18 +1126,140 @@ const char * kKnownScannedFiles[] =	// Files known to contain XMP but have no sm
 
 	// ---------------------------------------------------------------------------------------------
 
+	void LFA_Prefetch ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length )
+	{
+		LFA_Advise ( file, offset, length, kLFA_AdviseWillNeed );
+
+	}	// LFA_Prefetch
+
+	// ---------------------------------------------------------------------------------------------
+
+	void LFA_Advise ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length, XMP_Uns8 advice )
+	{
+		int descr = (int)(size_t)file;
+		
+		#if defined ( SYNC_FILE_RANGE_WRITE )	// Linux, DONTNEED skips dirty pages and pages being written.
+			if ( advice == kLFA_AdviseWriteBehind ) {
+				(void) sync_file_range ( descr, offset, length, SYNC_FILE_RANGE_WRITE );
+			} else if ( advice == kLFA_AdviseDontNeed ) {
+				(void) sync_file_range ( descr, offset, length, SYNC_FILE_RANGE_WAIT_BEFORE );
+			}
+		#endif
+
+		#if defined ( POSIX_FADV_NORMAL )
+			int posixAdvice;
+			switch ( advice ) {
+				case kLFA_AdviseSequential  : posixAdvice = POSIX_FADV_SEQUENTIAL; break;
+				case kLFA_AdviseWillNeed    : posixAdvice = POSIX_FADV_WILLNEED; break;
+				case kLFA_AdviseDontNeed    : posixAdvice = POSIX_FADV_DONTNEED; break;
+				case kLFA_AdviseWriteBehind : return;	// No fadvise equivalent.
+				default                     : posixAdvice = POSIX_FADV_NORMAL; break;
+			}
+			(void) posix_fadvise ( descr, offset, length, posixAdvice );	// Ignore errors, this is only a hint.
+		#endif
+
+	}	// LFA_Advise
+
+	// ---------------------------------------------------------------------------------------------
+
 #endif	// XMP_UNIXBuild
 
+// =================================================================================================
+// GetFileIdentity
+// ===============
+//
+// Get what identifies the file and the version of its content: the volume and file ID, the size,
+// and the modification time. This is the key for the index cache, it must not open the file.
+
+#if XMP_MacBuild
+
+	bool GetFileIdentity ( const char * filePath, XMP_FileIdentity * identity )
+	{
+		FSRef fileRef;
+		FSCatalogInfo catInfo;
+		
+		OSErr err = FSPathMakeRef ( (XMP_Uns8*)filePath, &fileRef, 0 );
+		if ( err != noErr ) return false;
+		
+		FSCatalogInfoBitmap whichInfo = (kFSCatInfoVolume | kFSCatInfoNodeID | kFSCatInfoDataSizes | kFSCatInfoContentMod);
+		err = FSGetCatalogInfo ( &fileRef, whichInfo, &catInfo, 0, 0, 0 );
+		if ( err != noErr ) return false;
+		
+		identity->volumeID = (XMP_Uns16) catInfo.volume;
+		identity->fileID   = catInfo.nodeID;
+		identity->fileSize = catInfo.dataLogicalSize;
+		identity->modTime  = ((XMP_Int64)catInfo.contentModDate.highSeconds << 48) |
+							 ((XMP_Int64)catInfo.contentModDate.lowSeconds << 16) |
+							 catInfo.contentModDate.fraction;
+		return true;
+	
+	}	// GetFileIdentity
+
+#elif XMP_WinBuild
+
+	bool GetFileIdentity ( const char * filePath, XMP_FileIdentity * identity )
+	{
+		std::string wideName;
+		const size_t utf8Len = strlen(filePath);
+		const size_t maxLen = 2 * (utf8Len+1);
+
+		wideName.reserve ( maxLen );
+		wideName.assign ( maxLen, ' ' );
+		int wideLen = MultiByteToWideChar ( CP_UTF8, 0, filePath, -1, (LPWSTR)wideName.data(), maxLen );
+		if ( wideLen == 0 ) return false;
+
+		// Opening for neither read nor write access only allows getting attributes.
+		HANDLE fileHandle = CreateFileW ( (LPCWSTR)wideName.data(), 0, (FILE_SHARE_READ | FILE_SHARE_WRITE), 0,
+										  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+		if ( fileHandle == INVALID_HANDLE_VALUE ) return false;
+		
+		BY_HANDLE_FILE_INFORMATION fileInfo;
+		BOOL ok = GetFileInformationByHandle ( fileHandle, &fileInfo );
+		CloseHandle ( fileHandle );
+		if ( ! ok ) return false;
+		
+		identity->volumeID = fileInfo.dwVolumeSerialNumber;
+		identity->fileID   = ((XMP_Uns64)fileInfo.nFileIndexHigh << 32) | fileInfo.nFileIndexLow;
+		identity->fileSize = ((XMP_Uns64)fileInfo.nFileSizeHigh << 32) | fileInfo.nFileSizeLow;
+		identity->modTime  = ((XMP_Int64)fileInfo.ftLastWriteTime.dwHighDateTime << 32) | fileInfo.ftLastWriteTime.dwLowDateTime;
+		return true;
+	
+	}	// GetFileIdentity
+
+#elif XMP_UNIXBuild
+
+	bool GetFileIdentity ( const char * filePath, XMP_FileIdentity * identity )
+	{
+		struct stat info;
+		if ( stat ( filePath, &info ) != 0 ) return false;
+		if ( ! S_ISREG ( info.st_mode ) ) return false;
+		
+		identity->volumeID = info.st_dev;
+		identity->fileID   = info.st_ino;
+		identity->fileSize = info.st_size;
+		identity->modTime  = (XMP_Int64)info.st_mtime * 1000*1000*1000;
+		#if defined ( st_mtime )	// Then st_mtime is a macro for st_mtim.tv_sec, add the nanoseconds.
+			identity->modTime += info.st_mtim.tv_nsec;
+		#endif
+		return true;
+	
+	}	// GetFileIdentity
+
+#endif
+
 // =================================================================================================
 
 void LFA_Copy ( LFA_FileRef sourceFile, LFA_FileRef destFile, XMP_Int64 length,
-                XMP_AbortProc abortProc /* = 0 */, void * abortArg /* = 0 */ )
+                XMP_AbortProc abortProc /* = 0 */, void * abortArg /* = 0 */, bool dropBehind /* = false */ )
 {
 	enum { kBufferLen = 64*1024 };
 	XMP_Uns8 buffer [kBufferLen];
 	
 	const bool checkAbort = (abortProc != 0);
 	
+	DropBehind sourceDrop ( sourceFile, dropBehind );
+	DropBehind destDrop ( destFile, dropBehind, kDropBehindOutput );
+	
 	while ( length > 0 ) {
 		if ( checkAbort && abortProc(abortArg) ) {
 			XMP_Throw ( "LFA_Copy - User abort", kXMPErr_UserAbort );
@@ -812,10 +1269,73 @@ void LFA_Copy ( LFA_FileRef sourceFile, LFA_FileRef destFile, XMP_Int64 length,
 		LFA_Read ( sourceFile, buffer, ioCount, kLFA_RequireAll );
 		LFA_Write ( destFile, buffer, ioCount );
 		length -= ioCount;
+		sourceDrop.Advance ( ioCount );
+		destDrop.Advance ( ioCount );
 	}
+	
+	sourceDrop.Finish();
+	destDrop.Finish();
 
 }	// LFA_Copy
 
+// =================================================================================================
+// DropBehind
+// ==========
+
+DropBehind::DropBehind ( LFA_FileRef _file, bool _active, bool _isOutput /* = false */ )
+	: file(_file), active(_active), isOutput(_isOutput), filePos(0), dropPos(0), flushPos(0), nextChunk(0)
+{
+
+	if ( ! this->active ) return;
+	
+	this->filePos = LFA_Seek ( this->file, 0, SEEK_CUR );
+	this->dropPos = this->flushPos = this->filePos;
+	this->nextChunk = (this->filePos / kDropBehindChunk + 1) * kDropBehindChunk;
+	
+	if ( ! this->isOutput ) LFA_Advise ( this->file, this->filePos, 0, kLFA_AdviseSequential );
+
+}	// DropBehind::DropBehind
+
+// -------------------------------------------------------------------------------------------------
+
+void DropBehind::DropChunks()
+{
+	XMP_Int64 chunkEnd = this->filePos - (this->filePos % kDropBehindChunk);
+	XMP_Assert ( chunkEnd > this->flushPos );
+	
+	if ( this->isOutput ) {
+		LFA_Advise ( this->file, this->flushPos, (chunkEnd - this->flushPos), kLFA_AdviseWriteBehind );
+		if ( this->flushPos > this->dropPos ) {
+			LFA_Advise ( this->file, this->dropPos, (this->flushPos - this->dropPos), kLFA_AdviseDontNeed );
+		}
+		this->dropPos = this->flushPos;
+	} else {
+		LFA_Advise ( this->file, this->dropPos, (chunkEnd - this->dropPos), kLFA_AdviseDontNeed );
+		this->dropPos = chunkEnd;
+	}
+	
+	this->flushPos = chunkEnd;
+	this->nextChunk = chunkEnd + kDropBehindChunk;
+
+}	// DropBehind::DropChunks
+
+// -------------------------------------------------------------------------------------------------
+
+void DropBehind::Finish()
+{
+
+	if ( ! this->active ) return;
+	this->active = false;
+	
+	if ( this->isOutput && (this->filePos > this->flushPos) ) {
+		LFA_Advise ( this->file, this->flushPos, (this->filePos - this->flushPos), kLFA_AdviseWriteBehind );
+	}
+	if ( this->filePos > this->dropPos ) {
+		LFA_Advise ( this->file, this->dropPos, (this->filePos - this->dropPos), kLFA_AdviseDontNeed );
+	}
+
+}	// DropBehind::Finish
+
 // =================================================================================================
 
 static bool CreateNewFile ( const char * newPath, const char * origPath, size_t filePos, bool copyMacRsrc )
@@ -1146,6 +1666,143 @@ void ReadXMPPacket ( XMPFileHandler * handler )
 	
 }	// ReadXMPPacket
 
+// =================================================================================================
+// GetFilePrefix
+// =============
+
+const XMP_Uns8 * GetFilePrefix ( XMPFiles * parent, LFA_FileRef fileRef, size_t * prefixLen )
+{
+	XMP_Assert ( (parent != 0) && (prefixLen != 0) );
+	XMP_Assert ( (size_t)kProbeBufferSize <= (size_t)kIOBufferSize );	// ! FillProbeBuffer relies on this.
+
+	std::string & filePrefix = parent->filePrefix;
+	
+	if ( ! parent->havePrefix ) {
+	
+		filePrefix.erase();
+		filePrefix.reserve ( kProbeBufferSize );
+		filePrefix.append ( kProbeBufferSize, ' ' );
+		
+		XMP_StringPtr prefixStr = XMP_StringPtr ( filePrefix.c_str() );	// Don't set until after reserving the space!
+
+		LFA_Seek ( fileRef, 0, SEEK_SET );
+		size_t readLen = LFA_Read ( fileRef, (char*)prefixStr, kProbeBufferSize );
+		filePrefix.erase ( readLen );
+		parent->havePrefix = true;
+	
+	}
+	
+	*prefixLen = filePrefix.size();
+	return (const XMP_Uns8 *) filePrefix.c_str();
+	
+}	// GetFilePrefix
+
+// =================================================================================================
+// FillProbeBuffer
+// ===============
+
+void FillProbeBuffer ( XMPFiles * parent, LFA_FileRef fileRef, IOBuffer* ioBuf )
+{
+	size_t prefixLen;
+	const XMP_Uns8 * prefix = GetFilePrefix ( parent, fileRef, &prefixLen );
+	
+	XMP_Assert ( prefixLen <= ioBuf->size );
+	memcpy ( &ioBuf->data[0], prefix, prefixLen );	// AUDIT: GetFilePrefix returns at most kProbeBufferSize bytes.
+	ioBuf->filePos = 0;
+	ioBuf->ptr = &ioBuf->data[0];
+	ioBuf->limit = ioBuf->ptr + prefixLen;
+	ioBuf->len = prefixLen;
+	ioBuf->refills = 0;
+	
+	LFA_Seek ( fileRef, prefixLen, SEEK_SET );	// ! RefillBuffer reads from the current position.
+	
+}	// FillProbeBuffer
+
+// =================================================================================================
+// IOBuffer data pool
+// ==================
+//
+// Released buffers are kept on a stack, the most recently released one is handed out first. That
+// is usually the one the same thread just let go of, and still in its cache. Only a few are kept,
+// twice GetXMPBatch's default thread count. Extra batch threads just malloc and free their own.
+
+enum { kIOBufferPoolMax = 8 };
+
+struct PooledIOBuffer {
+	XMP_Uns8 * data;
+	size_t     size;
+};
+
+static XMP_Mutex sIOBufferLock;
+static std::vector<PooledIOBuffer> * sIOBufferPool = 0;
+
+struct IOBufferAutoLock {	// Not XMPFiles_AutoMutex, that is only for sXMPFilesLock.
+	IOBufferAutoLock() { XMP_EnterCriticalRegion ( sIOBufferLock ); };
+	~IOBufferAutoLock() { XMP_ExitCriticalRegion ( sIOBufferLock ); };
+};
+
+// -------------------------------------------------------------------------------------------------
+
+bool IOBufferInitialize()
+{
+	sIOBufferPool = new std::vector<PooledIOBuffer>;
+	sIOBufferPool->reserve ( kIOBufferPoolMax );
+	return XMP_InitMutex ( &sIOBufferLock );
+
+}	// IOBufferInitialize
+
+// -------------------------------------------------------------------------------------------------
+
+void IOBufferTerminate()
+{
+	for ( size_t i = 0; i < sIOBufferPool->size(); ++i ) free ( (*sIOBufferPool)[i].data );
+	delete sIOBufferPool;
+	sIOBufferPool = 0;
+	XMP_TermMutex ( sIOBufferLock );
+
+}	// IOBufferTerminate
+
+// -------------------------------------------------------------------------------------------------
+
+XMP_Uns8 * AcquireIOBufferData ( size_t size )
+{
+	XMP_Assert ( size > 0 );
+
+	if ( sIOBufferPool != 0 ) {
+		IOBufferAutoLock autoLock;
+		for ( size_t i = sIOBufferPool->size(); i > 0; --i ) {
+			PooledIOBuffer & pooled = (*sIOBufferPool)[i-1];
+			if ( pooled.size != size ) continue;
+			XMP_Uns8 * data = pooled.data;
+			sIOBufferPool->erase ( sIOBufferPool->begin() + (i-1) );
+			return data;
+		}
+	}
+	
+	XMP_Uns8 * data = (XMP_Uns8*) malloc ( size );
+	if ( data == 0 ) XMP_Throw ( "Out of memory", kXMPErr_NoMemory );
+	return data;
+
+}	// AcquireIOBufferData
+
+// -------------------------------------------------------------------------------------------------
+
+void ReleaseIOBufferData ( XMP_Uns8 * data, size_t size )
+{
+
+	if ( sIOBufferPool != 0 ) {
+		IOBufferAutoLock autoLock;
+		if ( sIOBufferPool->size() < kIOBufferPoolMax ) {
+			PooledIOBuffer pooled = { data, size };
+			sIOBufferPool->push_back ( pooled );
+			return;
+		}
+	}
+	
+	free ( data );
+
+}	// ReleaseIOBufferData
+
 // =================================================================================================
 // XMPFileHandler::ProcessTNail
 // ============================
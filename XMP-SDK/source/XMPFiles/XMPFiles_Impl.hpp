@@ -27,6 +27,7 @@
 #include <map>
 
 #include <cassert>
+#include <cstring>
 
 #if XMP_MacBuild
 	#include <Multiprocessing.h>
@@ -42,64 +43,6 @@
 
 extern long sXMPFilesInitCount;
 
-#ifndef GatherPerformanceData
-	#define GatherPerformanceData 0
-#endif
-
-#if ! GatherPerformanceData
-
-	#define StartPerfCheck(proc,info)	/* do nothing */
-	#define EndPerfCheck(proc)	/* do nothing */
-
-#else
-
-	#include "PerfUtils.hpp"
-
-	enum {
-		kAPIPerf_OpenFile,
-		kAPIPerf_CloseFile,
-		kAPIPerf_GetXMP,
-		kAPIPerf_GetThumbnail,
-		kAPIPerf_PutXMP,
-		kAPIPerf_CanPutXMP,
-		kAPIPerfProcCount	// Last, count of the procs.
-	};
-	
-	static const char* kAPIPerfNames[] =
-		{ "OpenFile", "CloseFile", "GetXMP", "GetThumbnail", "PutXMP", "CanPutXMP", 0 };
-	
-	struct APIPerfItem {
-		XMP_Uns8    whichProc;
-		double      elapsedTime;
-		XMPFilesRef xmpFilesRef;
-		std::string extraInfo;
-		APIPerfItem ( XMP_Uns8 proc, double time, XMPFilesRef ref, const char * info )
-			: whichProc(proc), elapsedTime(time), xmpFilesRef(ref), extraInfo(info) {};
-	};
-	
-	typedef std::vector<APIPerfItem> APIPerfCollection;
-	
-	extern APIPerfCollection* sAPIPerf;
-
-	#define StartPerfCheck(proc,info)	\
-		sAPIPerf->push_back ( APIPerfItem ( proc, 0.0, xmpFilesRef, info ) );	\
-		APIPerfItem & thisPerf = sAPIPerf->back();								\
-		PerfUtils::MomentValue startTime, endTime;								\
-		try {																	\
-			startTime = PerfUtils::NoteThisMoment();
-
-	#define EndPerfCheck(proc)	\
-			endTime = PerfUtils::NoteThisMoment();										\
-			thisPerf.elapsedTime = PerfUtils::GetElapsedSeconds ( startTime, endTime );	\
-		} catch ( ... ) {																\
-			endTime = PerfUtils::NoteThisMoment();										\
-			thisPerf.elapsedTime = PerfUtils::GetElapsedSeconds ( startTime, endTime );	\
-			thisPerf.extraInfo += "  ** THROW **";										\
-			throw;																		\
-		}
-
-#endif
-
 #ifndef TrackMallocFree
 	#define TrackMallocFree 0
 #endif
@@ -273,6 +216,47 @@ private:
 	XMP_Mutex * mutex;
 };
 
+// -------------------------------------------------------------------------------------------------
+// Minimal worker thread support, used by XMPFiles::GetXMPBatch. A thread is started, runs the proc
+// once, and is joined. There is no detach or cancel. If XMP_StartThread returns false the caller
+// must do the work itself. Like the mutex utilities, these are implemented in XMPCore_Impl.cpp.
+
+typedef void (* XMP_ThreadProc) ( void * procArg );
+
+struct XMP_Thread {
+	XMP_ThreadProc proc;
+	void * procArg;
+	#if XMP_MacBuild
+		MPTaskID  taskID;
+		MPQueueID doneQueue;
+	#elif XMP_WinBuild
+		HANDLE    handle;
+	#elif XMP_UNIXBuild
+		pthread_t thread;
+	#endif
+};
+
+extern bool XMP_StartThread ( XMP_Thread * thread, XMP_ThreadProc proc, void * procArg );
+extern void XMP_JoinThread ( XMP_Thread * thread );
+
+// -------------------------------------------------------------------------------------------------
+// Per-thread values, used by the performance counters. A key holds one pointer for each thread, 0
+// until the thread sets it. Also implemented in XMPCore_Impl.cpp.
+
+#if XMP_MacBuild
+	typedef TaskStorageIndex XMP_ThreadKey;
+#elif XMP_WinBuild
+	typedef DWORD XMP_ThreadKey;
+#elif XMP_UNIXBuild
+	typedef pthread_key_t XMP_ThreadKey;
+#endif
+
+extern bool XMP_InitThreadKey ( XMP_ThreadKey * key );
+extern void XMP_TermThreadKey ( XMP_ThreadKey & key );
+
+extern void * XMP_GetThreadValue ( XMP_ThreadKey & key );
+extern void XMP_SetThreadValue ( XMP_ThreadKey & key, void * value );
+
 // *** Switch to XMPEnterObjectWrapper & XMPEnterStaticWrapper, to allow for per-object locks.
 
 // ! Don't do the initialization check (sXMP_InitCount > 0) for the no-lock case. That macro is used
@@ -332,6 +316,84 @@ private:
 	#define RELEASE_NO_THROW	throw()
 #endif
 
+// =================================================================================================
+// Performance counters
+// ====================
+//
+// Timings and I/O counts for XMPFiles::GetPerfCounters. Nothing is gathered until SetPerfCounters
+// turns it on, until then the timers and PerfNoteIO only test sPerfCountersOn.
+//
+// The LFA functions note each call in per-thread pending counts. A timer moves the pending counts
+// to the totals and to the current handler's counters when it starts and when it stops, so the
+// shared counters are only locked then. PerfAPITimer times a whole API call and makes the object's
+// handler current for the thread, the I/O and nested PerfPhaseTimers then count for that handler.
+// A PerfPhaseTimer given a format makes that handler current while it runs. A current handler of
+// 0 means none is known, work done then only shows in the totals.
+//
+// The pending counts and current handler live in a PerfThreadState owned by the outermost running
+// timer on the thread, found through a thread key. I/O done outside of any timer goes straight to
+// the totals.
+
+enum { kPerfIO_Read, kPerfIO_Write, kPerfIO_Seek, kPerfIO_Other, kPerfIOKindCount };
+
+struct PerfPendingIO {
+	XMP_Uns64 calls [kPerfIOKindCount];
+	XMP_Uns64 bytesRead;
+	XMP_Uns64 bytesWritten;
+};
+
+struct PerfThreadState {
+	PerfPendingIO  pending;
+	XMP_FileFormat currentHandler;
+};
+
+extern volatile bool sPerfCountersOn;
+extern void PerfNoteThreadIO ( XMP_Uns8 kind, XMP_Int64 bytes );
+
+static inline void
+PerfNoteIO ( XMP_Uns8 kind, XMP_Int64 bytes = 0 )
+{
+	if ( sPerfCountersOn ) PerfNoteThreadIO ( kind, bytes );
+}
+
+extern bool PerfInitialize();
+extern void PerfTerminate();
+extern void PerfReset();
+extern bool PerfGetCounters ( XMP_FileFormat handlerFormat, XMP_PerfCounters * counters );
+
+class PerfTimer {
+protected:
+	PerfTimer() : active(sPerfCountersOn) {};
+	void Start ( bool isAPI, XMP_Uns8 which, XMP_FileFormat handlerFormat );
+	void Stop ( XMP_FileFormat lateFormat = 0 );
+	bool           active;
+	bool           isAPI;
+	XMP_Uns8       which;
+	XMP_FileFormat handlerFormat;
+	XMP_FileFormat savedHandler;
+	XMP_Uns64      startTime;
+	PerfThreadState * threadState;
+	PerfThreadState   ownState;	// Only used by the outermost timer on the thread.
+};
+
+class PerfAPITimer : public PerfTimer {	// The handler might only be known at the end, as for OpenFile.
+public:
+	PerfAPITimer ( XMP_Uns8 api, const XMPFiles * _files ) : files(_files)
+		{ if ( this->active ) this->Start ( true, api, ((files->handler == 0) ? 0 : files->handlerFormat) ); };
+	~PerfAPITimer()
+		{ if ( this->active ) this->Stop ( (files->handler == 0) ? 0 : files->handlerFormat ); };
+private:
+	const XMPFiles * files;
+};
+
+class PerfPhaseTimer : public PerfTimer {
+public:
+	PerfPhaseTimer ( XMP_Uns8 phase, XMP_FileFormat handlerFormat = 0 )
+		{ if ( this->active ) this->Start ( false, phase, handlerFormat ); };
+	~PerfPhaseTimer()
+		{ if ( this->active ) this->Stop(); };
+};
+
 // =================================================================================================
 // FileHandler declarations
 
@@ -406,13 +468,17 @@ extern void        LFA_Flush    ( LFA_FileRef file );
 extern XMP_Int64   LFA_Measure  ( LFA_FileRef file );
 extern void        LFA_Extend   ( LFA_FileRef file, XMP_Int64 length );
 extern void        LFA_Truncate ( LFA_FileRef file, XMP_Int64 length );
+extern void        LFA_Prefetch ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length );	// Only a hint, might do nothing.
+extern void        LFA_Advise   ( LFA_FileRef file, XMP_Int64 offset, XMP_Int64 length, XMP_Uns8 advice );	// Ditto.
 
 #if XMP_MacBuild
 	extern LFA_FileRef LFA_OpenRsrc ( const char * fileName, char openMode );	// Open the Mac resource fork.
 #endif
 
+extern bool GetFileIdentity ( const char * filePath, XMP_FileIdentity * identity );	// False if the file can't be found.
+
 extern void LFA_Copy ( LFA_FileRef sourceFile, LFA_FileRef destFile, XMP_Int64 length,	// Not a primitive.
-                       XMP_AbortProc abortProc = 0, void * abortArg = 0 );
+                       XMP_AbortProc abortProc = 0, void * abortArg = 0, bool dropBehind = false );
 
 extern void CreateTempFile ( const std::string & origPath, std::string * tempPath, bool copyMacRsrc = false );
 enum { kCopyMacRsrc = true };
@@ -425,6 +491,14 @@ struct AutoFile {	// Provides auto close of files on exit or exception.
 
 enum { kLFA_RequireAll = true };	// Used for requireAll to LFA_Read.
 
+enum {	// Advice for LFA_Advise, a length of 0 means to the end of the file.
+	kLFA_AdviseNormal      = 0,	// Undo an earlier sequential advice.
+	kLFA_AdviseSequential  = 1,	// The range will be read front to back, read ahead more.
+	kLFA_AdviseWillNeed    = 2,	// The range will be read soon, start reading it now.
+	kLFA_AdviseDontNeed    = 3,	// The range won't be read again, drop it from the cache.
+	kLFA_AdviseWriteBehind = 4	// The range has been written, start writing it to the disk.
+};
+
 // -------------------------------------------------------------------------------------------------
 
 static inline bool
@@ -441,6 +515,118 @@ CheckCString ( const void * left, const void * right )
 	return (std::strcmp ( (char*)left, (char*)right ) == 0);
 }
 
+// -------------------------------------------------------------------------------------------------
+// FlatMap
+// -------
+//
+// A subset of the std::map and std::multimap interfaces, kept as a vector of pairs sorted by key.
+// It is used by the legacy metadata managers (IPTC, PSIR, TIFF) that build a small table on every
+// open: lookups are binary searches and the whole table is a single allocation instead of a node
+// per entry. Use operator[] for unique keys. The 2 parameter insert keeps equal keys in the order
+// they are inserted, as multimap does when inserting at upper_bound.
+//
+// Unlike std::map, inserting or erasing an entry moves the entries that follow it. Iterators and
+// pointers into the map are only valid until the next insert or erase. The value type is copied
+// when entries move, see InternalTagInfo and InternalRsrcInfo for values that own their data.
+
+template < class K, class V >
+class FlatMap {
+public:
+
+	typedef std::pair<K,V> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+	iterator begin() { return this->entries.begin(); };
+	iterator end()   { return this->entries.end(); };
+	const_iterator begin() const { return this->entries.begin(); };
+	const_iterator end() const   { return this->entries.end(); };
+
+	size_t size() const { return this->entries.size(); };
+	bool empty() const  { return this->entries.empty(); };
+	void clear() { this->entries.clear(); };
+	void reserve ( size_t count ) { this->entries.reserve ( count ); };
+
+	iterator lower_bound ( K key ) { return this->begin() + this->LowerIndex ( key ); };
+	iterator upper_bound ( K key ) { return this->begin() + this->UpperIndex ( key ); };
+	const_iterator lower_bound ( K key ) const { return this->begin() + this->LowerIndex ( key ); };
+	const_iterator upper_bound ( K key ) const { return this->begin() + this->UpperIndex ( key ); };
+
+	iterator find ( K key )
+	{
+		iterator pos = this->lower_bound ( key );
+		if ( (pos != this->end()) && (pos->first == key) ) return pos;
+		return this->end();
+	};
+
+	const_iterator find ( K key ) const
+	{
+		const_iterator pos = this->lower_bound ( key );
+		if ( (pos != this->end()) && (pos->first == key) ) return pos;
+		return this->end();
+	};
+
+	size_t count ( K key ) const { return this->UpperIndex ( key ) - this->LowerIndex ( key ); };
+
+	V & operator[] ( K key )
+	{
+		iterator pos = this->lower_bound ( key );
+		if ( (pos == this->end()) || (pos->first != key) ) pos = this->entries.insert ( pos, value_type ( key, V() ) );
+		return pos->second;
+	};
+
+	iterator insert ( iterator pos, const value_type & entry )
+	{
+		XMP_Assert ( (pos == this->begin()) || (!(entry.first < (pos-1)->first)) );
+		XMP_Assert ( (pos == this->end()) || (!(pos->first < entry.first)) );
+		return this->entries.insert ( pos, entry );
+	};
+
+	void erase ( iterator pos ) { this->entries.erase ( pos ); };
+	void erase ( iterator first, iterator last ) { this->entries.erase ( first, last ); };
+
+	size_t erase ( K key )
+	{
+		size_t first = this->LowerIndex ( key );
+		size_t last  = this->UpperIndex ( key );
+		this->entries.erase ( (this->begin() + first), (this->begin() + last) );
+		return (last - first);
+	};
+
+private:
+
+	std::vector<value_type> entries;
+
+	size_t LowerIndex ( K key ) const
+	{	// The index of the first entry that is not less than the key.
+		size_t lo = 0, hi = this->entries.size();
+		while ( lo < hi ) {
+			size_t mid = lo + (hi - lo) / 2;
+			if ( this->entries[mid].first < key ) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	};
+
+	size_t UpperIndex ( K key ) const
+	{	// The index of the first entry that is greater than the key.
+		size_t lo = 0, hi = this->entries.size();
+		while ( lo < hi ) {
+			size_t mid = lo + (hi - lo) / 2;
+			if ( key < this->entries[mid].first ) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		return lo;
+	};
+
+};	// FlatMap
+
 // -------------------------------------------------------------------------------------------------
 // CheckFileSpace and RefillBuffer
 // -------------------------------
@@ -462,16 +648,39 @@ CheckCString ( const void * left, const void * right )
 // check to be made. It refills the buffer if necessary, preserving the unprocessed data, setting
 // bufPtr and bufLimit appropriately. If we are too close to the end of the file to make the check
 // a failure status is returned.
+//
+// The data is not part of the IOBuffer, it comes from a small pool of buffers that is shared by all
+// threads. A thread that opens one file after another gets the same buffer back each time, and the
+// IOBuffer itself is small enough for the stack. The size defaults to kIOBufferSize, a different
+// size is allowed but must be at least kProbeBufferSize for FillProbeBuffer.
+//
+// RefillBuffer tells the OS the file is being read sequentially the second time it continues past
+// the end of the buffer without a FillBuffer in between. One refill is normal for a file's header
+// structures, two mean a scan.
 
 enum { kIOBufferSize = 128*1024 };
 
+extern XMP_Uns8 * AcquireIOBufferData ( size_t size );
+extern void ReleaseIOBufferData ( XMP_Uns8 * data, size_t size );
+
+extern bool IOBufferInitialize();
+extern void IOBufferTerminate();
+
 struct IOBuffer {
 	XMP_Int64 filePos;
 	XMP_Uns8* ptr;
 	XMP_Uns8* limit;
 	size_t    len;
-	XMP_Uns8  data [kIOBufferSize];
-	IOBuffer() : filePos(0), ptr(&data[0]), limit(ptr), len(0) {};
+	XMP_Uns8* data;
+	size_t    size;
+	XMP_Uns8  refills;	// RefillBuffer calls since the last FillBuffer, stops counting at 2.
+	explicit IOBuffer ( size_t _size = kIOBufferSize )
+		: filePos(0), ptr(0), limit(0), len(0), data(AcquireIOBufferData(_size)), size(_size), refills(0)
+		{ ptr = limit = &data[0]; };
+	~IOBuffer() { ReleaseIOBufferData ( data, size ); };
+private:
+	IOBuffer ( const IOBuffer & );	// ! Not implemented, the data must be released once.
+	void operator= ( const IOBuffer & );
 };
 
 static inline void
@@ -479,7 +688,8 @@ FillBuffer ( LFA_FileRef fileRef, XMP_Int64 fileOffset, IOBuffer* ioBuf )
 {
 	ioBuf->filePos = LFA_Seek ( fileRef, fileOffset, SEEK_SET );
 	if ( ioBuf->filePos != fileOffset ) XMP_Throw ( "Seek failure in FillBuffer", kXMPErr_ExternalFailure );
-	ioBuf->len = LFA_Read ( fileRef, &ioBuf->data[0], kIOBufferSize );
+	ioBuf->len = LFA_Read ( fileRef, &ioBuf->data[0], (XMP_Int32)ioBuf->size );
+	ioBuf->refills = 0;
 	ioBuf->ptr = &ioBuf->data[0];
 	ioBuf->limit = ioBuf->ptr + ioBuf->len;
 }
@@ -501,7 +711,11 @@ RefillBuffer ( LFA_FileRef fileRef, IOBuffer* ioBuf )
 	ioBuf->filePos += (ioBuf->ptr - &ioBuf->data[0]);	// ! Increment before the read.
 	size_t bufTail = ioBuf->limit - ioBuf->ptr;	// We'll re-read the tail portion of the buffer.
 	if ( bufTail > 0 ) ioBuf->filePos = LFA_Seek ( fileRef, -((XMP_Int64)bufTail), SEEK_CUR );
-	ioBuf->len = LFA_Read ( fileRef, &ioBuf->data[0], kIOBufferSize );
+	if ( ioBuf->refills < 2 ) {
+		++ioBuf->refills;
+		if ( ioBuf->refills == 2 ) LFA_Advise ( fileRef, ioBuf->filePos, 0, kLFA_AdviseSequential );
+	}
+	ioBuf->len = LFA_Read ( fileRef, &ioBuf->data[0], (XMP_Int32)ioBuf->size );
 	ioBuf->ptr = &ioBuf->data[0];
 	ioBuf->limit = ioBuf->ptr + ioBuf->len;
 }
@@ -514,4 +728,66 @@ static inline bool CheckFileSpace ( LFA_FileRef fileRef, IOBuffer* ioBuf, size_t
 	return (size_t(ioBuf->limit - ioBuf->ptr) >= size_t(neededLen));
 }
 
+// -------------------------------------------------------------------------------------------------
+// PrefetchRange
+// -------------
+//
+// Ask the OS to start reading a part of the file that will be needed soon, unless it is already
+// in the I/O buffer. This lets the next seek/read overlap with the processing of the current buffer.
+// It is only worthwhile for non-sequential access, the OS does its own sequential read-ahead.
+
+static inline void
+PrefetchRange ( LFA_FileRef fileRef, XMP_Int64 fileOffset, XMP_Int64 length, const IOBuffer* ioBuf )
+{
+	if ( (ioBuf->filePos <= fileOffset) && ((fileOffset + length) <= (ioBuf->filePos + (XMP_Int64)ioBuf->len)) ) return;
+	LFA_Prefetch ( fileRef, fileOffset, length );
+}
+
+// -------------------------------------------------------------------------------------------------
+// DropBehind
+// ----------
+//
+// Keeps a long sequential read or write of a file from filling the OS file cache, for clients that
+// pass kXMPFiles_OpenDropBehind. The DropBehind starts at the current file position, call Advance
+// after each read or write and Finish at the end. Each time the position crosses a multiple of
+// kDropBehindChunk the pages behind it are dropped, the chunk boundaries keep the dropped ranges page
+// aligned. Written pages must be on the disk before they can be dropped, so for output each chunk is
+// sent to the disk when it is done and dropped one chunk later. An inactive DropBehind does nothing.
+
+enum { kDropBehindChunk = 8*1024*1024 };
+enum { kDropBehindOutput = true };
+
+class DropBehind {
+public:
+	DropBehind ( LFA_FileRef _file, bool _active, bool _isOutput = false );
+	void Advance ( XMP_Int64 ioCount )
+		{ this->filePos += ioCount; if ( this->active && (this->filePos >= this->nextChunk) ) this->DropChunks(); };
+	void Finish();
+private:
+	LFA_FileRef file;
+	bool        active;
+	bool        isOutput;
+	XMP_Int64   filePos;
+	XMP_Int64   dropPos;	// Start of the pages not yet dropped.
+	XMP_Int64   flushPos;	// Start of the written pages not yet sent to the disk.
+	XMP_Int64   nextChunk;
+	void DropChunks();
+};
+
+// -------------------------------------------------------------------------------------------------
+// GetFilePrefix and FillProbeBuffer
+// ---------------------------------
+//
+// OpenFile reads the first kProbeBufferSize bytes of the file once, on the first request, and shares
+// them with all of the CheckProcs and the chosen handler's CacheFileData. GetFilePrefix returns the
+// prefix, the length is less than kProbeBufferSize only for a short file. FillProbeBuffer copies the
+// prefix into an IOBuffer and leaves the file positioned just past it, so that CheckFileSpace and
+// RefillBuffer carry on as if the IOBuffer had been read from offset 0.
+
+enum { kProbeBufferSize = 64*1024 };
+
+extern const XMP_Uns8 * GetFilePrefix ( XMPFiles * parent, LFA_FileRef fileRef, size_t * prefixLen );
+
+extern void FillProbeBuffer ( XMPFiles * parent, LFA_FileRef fileRef, IOBuffer* ioBuf );
+
 #endif /* __XMPFiles_Impl_hpp__ */